@@ -0,0 +1,644 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <winsock2.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "Autoscaler.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int   DEFAULT_SCALE_UP       = 80;
+const int   DEFAULT_SCALE_DOWN     = 30;
+const int   DEFAULT_SCALE_INTERVAL = 10;
+const int   DEFAULT_SCALE_COOLDOWN = 60;
+const DWORD SAMPLE_TIMEOUT_MS      = 2000;
+const int   SAMPLE_TEXT_SIZE       = 64;
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::setMetric
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set the load metric
+//
+// ARGUMENTS       : spec IN "cpu", "file <path>", "tcp <port>" or
+//                           "exec <command>"
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void Autoscaler::setMetric
+(
+	const char *spec
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("Autoscaler::setMetric('%s')",spec)
+
+#define	BAD_METRIC(reason) \
+	{ LOGGER_LOG_ERROR2("invalid scale metric '%s': %s",spec,reason) \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_INVALID_PARAMETER,"Autoscaler","setMetric") }
+
+	if((spec == 0)||(strlen(spec) >= AUTOSCALER_SPEC_SIZE)) BAD_METRIC("too long")
+
+	METRICS     type;
+	const char *args = spec;
+	while(*args == ' ') { args++; }
+	if(!_stricmp(args,"cpu"))           { type = METRIC_CPU;  args += 3; }
+	else if(!_strnicmp(args,"file ",5)) { type = METRIC_FILE; args += 5; }
+	else if(!_strnicmp(args,"tcp ",4))  { type = METRIC_TCP;  args += 4; }
+	else if(!_strnicmp(args,"exec ",5)) { type = METRIC_EXEC; args += 5; }
+	else BAD_METRIC("expected cpu, file, tcp or exec")
+	while(*args == ' ') { args++; }
+
+	if(type == METRIC_TCP)
+	{
+		char *end;
+		long  value = strtol(args,&end,10);
+		if((end == args)||(*end != '\0')||(value <= 0)||(value > 65535)) BAD_METRIC("invalid port")
+		port = (unsigned short)value;
+
+		if(!winsockStarted)
+		{
+			WSADATA wsaData;
+			int     error = WSAStartup(MAKEWORD(2,2),&wsaData);
+			if(error != 0)
+			{
+				LOGGER_LOG_ERROR1("failed to start Winsock, error=%d",error)
+				THROW_LiteSrv_EXCEPTION
+					(LiteSrv_EXCEPTION_GENERAL_ERROR,"Autoscaler","setMetric")
+			}
+			winsockStarted = true;
+		}
+	}
+	else if(type != METRIC_CPU)
+	{
+		if(*args == '\0') BAD_METRIC((type == METRIC_FILE) ? "no file" : "no command")
+		strcpy(argument,args);
+	}
+
+#undef	BAD_METRIC
+
+	metric = type;
+	strcpy(metricSpec,spec);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::isEnabled
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : has a metric been set?
+//
+// ============================================================================
+bool Autoscaler::isEnabled() const { return metric != METRIC_NONE; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::setMinimum
+//                   Autoscaler::setMaximum
+//                   Autoscaler::setScaleUp
+//                   Autoscaler::setScaleDown
+//                   Autoscaler::setInterval
+//                   Autoscaler::setCooldown
+//                   Autoscaler::getMinimum
+//                   Autoscaler::getMaximum
+//                   Autoscaler::getScaleUp
+//                   Autoscaler::getScaleDown
+//                   Autoscaler::getInterval
+//                   Autoscaler::getCooldown
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the limits, thresholds and schedule
+//
+// ============================================================================
+void Autoscaler::setMinimum(int mn) { minimum = (mn > 1) ? mn : 1; }
+void Autoscaler::setMaximum(int mx) { maximum = (mx > 0) ? mx : 0; }
+void Autoscaler::setScaleUp(int up) { scaleUp = (up > 0) ? up : 1; }
+void Autoscaler::setScaleDown(int dn) { scaleDown = (dn > 0) ? dn : 0; }
+void Autoscaler::setInterval(int in) { interval = (in > 0) ? in : 1; }
+void Autoscaler::setCooldown(int cd) { cooldown = (cd > 0) ? cd : 0; }
+int  Autoscaler::getMinimum() const { return minimum; }
+int  Autoscaler::getMaximum() const { return maximum; }
+int  Autoscaler::getScaleUp() const { return scaleUp; }
+int  Autoscaler::getScaleDown() const { return scaleDown; }
+int  Autoscaler::getInterval() const { return interval; }
+int  Autoscaler::getCooldown() const { return cooldown; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::validate
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : check that the settings fit together
+//
+// ARGUMENTS       : maxReplicas IN most replicas there can be
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void Autoscaler::validate
+(
+	int maxReplicas
+) const throw (LiteSrvException)
+{
+	if(!isEnabled()) { return; }
+
+	const char *error = 0;
+	if(maximum == 0)                  { error = "the maximum number of replicas must be set"; }
+	else if(maximum < minimum)        { error = "the maximum number of replicas is less than the minimum"; }
+	else if(maximum > maxReplicas)    { error = "the maximum number of replicas is too high"; }
+	else if(scaleDown >= scaleUp)     { error = "the scale down threshold must be below the scale up threshold"; }
+	if(error == 0) { return; }
+
+	LOGGER_LOG_ERROR1("invalid autoscaling: %s",error)
+	THROW_LiteSrv_EXCEPTION
+		(LiteSrv_EXCEPTION_INVALID_PARAMETER,"Autoscaler","validate")
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::getInitialCount
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : number of replicas to start with - the cooldown starts
+//                   now
+//
+// ARGUMENTS       : requested IN number of replicas configured
+//
+// ============================================================================
+int Autoscaler::getInitialCount
+(
+	int requested
+)
+{
+	lastChange      = GetTickCount64();
+	cpuProcessCount = 0;
+	cpuSampleTime   = 0;
+
+	if(requested < minimum) { return minimum; }
+	if(requested > maximum) { return maximum; }
+	return requested;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::decide
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : sample the load, and decide how many replicas there
+//                   should be
+//
+// ARGUMENTS       : current      IN number of replicas
+//                   processes    IN the replicas which are running
+//                   processCount IN number of processes
+//
+// RETURNS         : number of replicas there should be
+//
+// ============================================================================
+int Autoscaler::decide
+(
+	int     current,
+	HANDLE  processes[],
+	int     processCount
+)
+{
+	// sample even during the cooldown, to keep the cpu baseline current
+	double load;
+	if(!sample(processes,processCount,load)) { return current; }
+
+	double perReplica = load/current;
+	LOGGER_LOG_DEBUG3("autoscaler: load %.1f, %.1f per replica for %d replicas",load,perReplica,current)
+
+	ULONGLONG now = GetTickCount64();
+	if(now < lastChange+(ULONGLONG)cooldown*1000) { return current; }
+
+	int desired = current;
+	if(perReplica > scaleUp)
+	{
+		// enough replicas to bring the load per replica down to the threshold
+		desired = (int)(load/scaleUp);
+		if(desired*(double)scaleUp < load) { desired++; }
+	}
+	else if((perReplica < scaleDown)&&(current > 1)&&(load/(current-1) <= scaleUp))
+	{
+		// one at a time, so that the load can settle
+		desired = current-1;
+	}
+	if(desired < minimum) { desired = minimum; }
+	if(desired > maximum) { desired = maximum; }
+
+	if(desired != current)
+	{
+		LOGGER_LOG_INFO3("autoscaler: load %.1f per replica - scaling from %d to %d replicas",perReplica,current,desired)
+		lastChange = now;
+	}
+	return desired;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::Autoscaler
+//                   Autoscaler::~Autoscaler
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+Autoscaler::Autoscaler()
+{
+	metric          = METRIC_NONE;
+	metricSpec[0]   = '\0';
+	argument[0]     = '\0';
+	port            = 0;
+	minimum         = 1;
+	maximum         = 0;
+	scaleUp         = DEFAULT_SCALE_UP;
+	scaleDown       = DEFAULT_SCALE_DOWN;
+	interval        = DEFAULT_SCALE_INTERVAL;
+	cooldown        = DEFAULT_SCALE_COOLDOWN;
+	lastChange      = 0;
+	winsockStarted  = false;
+	cpuProcessCount = 0;
+	cpuSampleTime   = 0;
+}
+
+Autoscaler::~Autoscaler()
+{
+	if(winsockStarted) { WSACleanup(); }
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::sample
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : sample the metric
+//
+// ARGUMENTS       : processes    IN the replicas which are running
+//                   processCount IN number of processes
+//                   load         OUT load
+//
+// RETURNS         : false if there is no sample this time
+//
+// ============================================================================
+bool Autoscaler::sample
+(
+	HANDLE   processes[],
+	int      processCount,
+	double  &load
+)
+{
+	bool sampled = false;
+	switch(metric)
+	{
+	case METRIC_CPU:  sampled = sampleCpu(processes,processCount,load); break;
+	case METRIC_FILE: sampled = sampleFile(load); break;
+	case METRIC_TCP:  sampled = sampleTcp(load); break;
+	case METRIC_EXEC: sampled = sampleExec(load); break;
+	default: break;
+	}
+	return sampled;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::sampleCpu
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : CPU used by the processes since the last sample, in
+//                   percent of one CPU (the first sample only sets the
+//                   baseline)
+//
+// ARGUMENTS       : processes    IN the replicas which are running
+//                   processCount IN number of processes
+//                   load         OUT load
+//
+// RETURNS         : false if this is the first sample
+//
+// ============================================================================
+bool Autoscaler::sampleCpu
+(
+	HANDLE   processes[],
+	int      processCount,
+	double  &load
+)
+{
+	DWORD     processIds[MAX_AUTOSCALED_PROCESSES];
+	ULONGLONG times[MAX_AUTOSCALED_PROCESSES];
+	int       count = 0;
+	ULONGLONG used  = 0;
+
+	for(int i=0;(i<processCount)&&(count<MAX_AUTOSCALED_PROCESSES);i++)
+	{
+		FILETIME creation,exitTime,kernel,user;
+		if(!GetProcessTimes(processes[i],&creation,&exitTime,&kernel,&user)) { continue; }
+
+		ULONGLONG time = ((ULONGLONG)kernel.dwHighDateTime<<32)+kernel.dwLowDateTime+
+						 ((ULONGLONG)user.dwHighDateTime<<32)+user.dwLowDateTime;
+		processIds[count] = GetProcessId(processes[i]);
+		times[count]      = time;
+		count++;
+
+		// a process started since the last sample used all of its time since
+		ULONGLONG baseline = 0;
+		for(int j=0;j<cpuProcessCount;j++)
+		{
+			if(cpuProcessIds[j] == processIds[count-1]) { baseline = cpuTimes[j]; break; }
+		}
+		if(time > baseline) { used += time-baseline; }
+	}
+
+	ULONGLONG now     = GetTickCount64();
+	ULONGLONG elapsed = now-cpuSampleTime;
+	bool      first   = (cpuSampleTime == 0);
+
+	memcpy(cpuProcessIds,processIds,count*sizeof(DWORD));
+	memcpy(cpuTimes,times,count*sizeof(ULONGLONG));
+	cpuProcessCount = count;
+	cpuSampleTime   = now;
+	if(first||(elapsed == 0)) { return false; }
+
+	// 100ns units over milliseconds
+	load = (double)used/(elapsed*100.0);
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::sampleFile
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : the first number in the file
+//
+// ARGUMENTS       : load OUT load
+//
+// RETURNS         : false if the file cannot be read
+//
+// ============================================================================
+bool Autoscaler::sampleFile
+(
+	double &load
+)
+{
+	FILE *file = fopen(argument,"r");
+	if(file == 0)
+	{
+		LOGGER_LOG_ERROR1("autoscaler: cannot open '%s'",argument)
+		return false;
+	}
+
+	char   text[SAMPLE_TEXT_SIZE];
+	size_t length = fread(text,1,sizeof(text)-1,file);
+	fclose(file);
+	text[length] = '\0';
+
+	if(parseLoad(text,load)) { return true; }
+	LOGGER_LOG_ERROR1("autoscaler: no number in '%s'",argument)
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::sampleTcp
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : the first number read from a connection to the port
+//                   (the server writes it and closes the connection)
+//
+// ARGUMENTS       : load OUT load
+//
+// RETURNS         : false if there is no number
+//
+// ============================================================================
+bool Autoscaler::sampleTcp
+(
+	double &load
+)
+{
+	SOCKET s = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+	if(s == INVALID_SOCKET)
+	{
+		LOGGER_LOG_ERROR1("autoscaler: failed to create socket, error=%d",WSAGetLastError())
+		return false;
+	}
+	DWORD timeoutMs = SAMPLE_TIMEOUT_MS;
+	setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,(const char*)&timeoutMs,sizeof(timeoutMs));
+
+	sockaddr_in address;
+	memset(&address,0,sizeof(address));
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	char text[SAMPLE_TEXT_SIZE];
+	int  length = 0;
+	if(connect(s,(sockaddr*)&address,sizeof(address)) == SOCKET_ERROR)
+	{
+		LOGGER_LOG_ERROR2("autoscaler: cannot connect to port %d, error=%d",port,WSAGetLastError())
+		closesocket(s);
+		return false;
+	}
+	while(length < (int)sizeof(text)-1)
+	{
+		int received = recv(s,text+length,(int)sizeof(text)-1-length,0);
+		if(received <= 0) { break; }
+		length += received;
+		if(memchr(text,'\n',length) != 0) { break; }
+	}
+	closesocket(s);
+	text[length] = '\0';
+
+	if(parseLoad(text,load)) { return true; }
+	LOGGER_LOG_ERROR1("autoscaler: no number from port %d",port)
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::sampleExec
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : the first number the command writes to its output -
+//                   a command still running after the sample timeout is
+//                   killed
+//
+// ARGUMENTS       : load OUT load
+//
+// RETURNS         : false if there is no number
+//
+// ============================================================================
+bool Autoscaler::sampleExec
+(
+	double &load
+)
+{
+	SECURITY_ATTRIBUTES inheritable;
+	inheritable.nLength              = sizeof(inheritable);
+	inheritable.lpSecurityDescriptor = NULL;
+	inheritable.bInheritHandle       = TRUE;
+
+	HANDLE hRead,hWrite;
+	if(!CreatePipe(&hRead,&hWrite,&inheritable,0))
+	{
+		LOGGER_LOG_ERROR1("autoscaler: failed to create pipe, error=%d",GetLastError())
+		return false;
+	}
+	SetHandleInformation(hRead,HANDLE_FLAG_INHERIT,0);
+
+	STARTUPINFO         startupInfo;
+	PROCESS_INFORMATION processInfo;
+	char                command[AUTOSCALER_SPEC_SIZE];
+	memset(&startupInfo,0,sizeof(startupInfo));
+	startupInfo.cb         = sizeof(startupInfo);
+	startupInfo.dwFlags    = STARTF_USESTDHANDLES;
+	startupInfo.hStdInput  = NULL;
+	startupInfo.hStdOutput = hWrite;
+	startupInfo.hStdError  = NULL;
+	strcpy(command,argument);		// CreateProcess may modify it
+
+	// the command inherits the end of the pipe and nothing else (not the
+	// listening sockets, for one)
+	STARTUPINFOEX startupInfoEx;
+	SIZE_T        attributeListSize = 0;
+	memset(&startupInfoEx,0,sizeof(startupInfoEx));
+	startupInfoEx.StartupInfo    = startupInfo;
+	startupInfoEx.StartupInfo.cb = sizeof(startupInfoEx);
+	InitializeProcThreadAttributeList(NULL,1,0,&attributeListSize);
+	startupInfoEx.lpAttributeList = (LPPROC_THREAD_ATTRIBUTE_LIST)HeapAlloc(GetProcessHeap(),0,attributeListSize);
+	if((startupInfoEx.lpAttributeList == NULL)||
+	   (!InitializeProcThreadAttributeList(startupInfoEx.lpAttributeList,1,0,&attributeListSize))||
+	   (!UpdateProcThreadAttribute(startupInfoEx.lpAttributeList,0,PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+					&hWrite,sizeof(HANDLE),NULL,NULL)))
+	{
+		LOGGER_LOG_ERROR1("autoscaler: failed to set the handle to inherit, error=%d",GetLastError())
+		if(startupInfoEx.lpAttributeList != NULL) { HeapFree(GetProcessHeap(),0,startupInfoEx.lpAttributeList); }
+		CloseHandle(hWrite);
+		CloseHandle(hRead);
+		return false;
+	}
+
+	BOOL started = CreateProcess(NULL,command,NULL,NULL,TRUE,CREATE_NO_WINDOW|EXTENDED_STARTUPINFO_PRESENT,
+								 NULL,NULL,&startupInfoEx.StartupInfo,&processInfo);
+	DWORD error = GetLastError();
+	DeleteProcThreadAttributeList(startupInfoEx.lpAttributeList);
+	HeapFree(GetProcessHeap(),0,startupInfoEx.lpAttributeList);
+	CloseHandle(hWrite);
+	if(!started)
+	{
+		LOGGER_LOG_ERROR2("autoscaler: failed to run '%s', error=%d",argument,error)
+		CloseHandle(hRead);
+		return false;
+	}
+	CloseHandle(processInfo.hThread);
+
+	// the output is small enough to fit in the pipe, so the command can finish
+	// before it is read
+	if(WaitForSingleObject(processInfo.hProcess,SAMPLE_TIMEOUT_MS) != WAIT_OBJECT_0)
+	{
+		LOGGER_LOG_ERROR2("autoscaler: '%s' took more than %d ms - killing it",argument,SAMPLE_TIMEOUT_MS)
+		TerminateProcess(processInfo.hProcess,1);
+	}
+	CloseHandle(processInfo.hProcess);
+
+	// read what is there, without waiting for anything the command started
+	char  text[SAMPLE_TEXT_SIZE];
+	DWORD length = 0;
+	DWORD available,bytesRead;
+	while((length < sizeof(text)-1)&&
+		  PeekNamedPipe(hRead,NULL,0,NULL,&available,NULL)&&(available > 0)&&
+		  ReadFile(hRead,text+length,sizeof(text)-1-length,&bytesRead,NULL)&&(bytesRead > 0))
+	{
+		length += bytesRead;
+	}
+	CloseHandle(hRead);
+	text[length] = '\0';
+
+	if(parseLoad(text,load)) { return true; }
+	LOGGER_LOG_ERROR1("autoscaler: no number from '%s'",argument)
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Autoscaler::parseLoad
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : the first number in some text (after any white space)
+//
+// ARGUMENTS       : text IN  text
+//                   load OUT number
+//
+// RETURNS         : false if the text does not start with a number, or it
+//                   is negative
+//
+// ============================================================================
+bool Autoscaler::parseLoad
+(
+	const char  *text,
+	double      &load
+)
+{
+	while((*text == ' ')||(*text == '\t')||(*text == '\r')||(*text == '\n')) { text++; }
+
+	char   *end;
+	double  value = strtod(text,&end);
+	if((end == text)||(value < 0)) { return false; }
+	load = value;
+	return true;
+}
+
@@ -0,0 +1,171 @@
+
+// prevent multiple inclusion
+
+#if !defined(__AUTOSCALER_H__)
+#define __AUTOSCALER_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting Autoscaler")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("Autoscaler is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing Autoscaler")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most processes whose CPU use is sampled, and longest metric
+const int MAX_AUTOSCALED_PROCESSES = MAXIMUM_WAIT_OBJECTS;
+const int AUTOSCALER_SPEC_SIZE     = 1024;
+
+// ============================================================================
+//
+// Autoscaler class
+//
+// Decides how many replicas a service should run, between a minimum and a
+// maximum, from a load metric sampled every interval. The metric is one of
+//   cpu               CPU used by the replicas, in percent of one CPU
+//   file <path>       the first number in the file (eg a queue length)
+//   tcp <port>        the first number read from a connection to
+//                     localhost:port
+//   exec <command>    the first number the command writes to its output
+//
+// The load per replica is compared with two thresholds. Above scaleUp, the
+// service grows to as many replicas as bring the load per replica down to
+// scaleUp; below scaleDown, it shrinks by one replica (as long as that does
+// not take the load per replica above scaleUp). The gap between the
+// thresholds stops it flapping, and nothing changes until the cooldown has
+// passed since the service started or last changed size.
+//
+// Sampling is done by the supervision loop, and a file, tcp or exec sample
+// takes at most the sample timeout.
+//
+// ============================================================================
+class LiteSrv_DLL_API Autoscaler
+{
+public:
+	// metric (see above for the syntax of spec)
+	void setMetric(const char *spec) throw (LiteSrvException);
+	bool isEnabled() const;
+
+	// limits, thresholds (load per replica) and schedule (seconds)
+	void setMinimum(int mn);
+	void setMaximum(int mx);
+	void setScaleUp(int up);
+	void setScaleDown(int dn);
+	void setInterval(int in);
+	void setCooldown(int cd);
+	int  getMinimum() const;
+	int  getMaximum() const;
+	int  getScaleUp() const;
+	int  getScaleDown() const;
+	int  getInterval() const;
+	int  getCooldown() const;
+
+	// check that the settings fit together, with at most maxReplicas
+	void validate(int maxReplicas) const throw (LiteSrvException);
+
+	// number of replicas to start with (the requested number, within limits)
+	int getInitialCount(int requested);
+
+	// sample the load of the running replicas, and decide how many replicas
+	// there should be
+	int decide(int current,HANDLE processes[],int processCount);
+
+	// constructor and destructor
+	Autoscaler();
+	virtual ~Autoscaler();
+
+private:
+	typedef enum METRICS { METRIC_NONE, METRIC_CPU, METRIC_FILE, METRIC_TCP, METRIC_EXEC };
+
+	// service functions
+	bool sample(HANDLE processes[],int processCount,double &load);
+	bool sampleCpu(HANDLE processes[],int processCount,double &load);
+	bool sampleFile(double &load);
+	bool sampleTcp(double &load);
+	bool sampleExec(double &load);
+	static bool parseLoad(const char *text,double &load);
+
+	// private variables
+	METRICS        metric;
+	char           metricSpec[AUTOSCALER_SPEC_SIZE];	// as given (for log messages)
+	char           argument[AUTOSCALER_SPEC_SIZE];	// file path, exec command
+	unsigned short port;							// tcp
+	int            minimum;
+	int            maximum;
+	int            scaleUp;
+	int            scaleDown;
+	int            interval;						// seconds
+	int            cooldown;						// seconds
+	ULONGLONG      lastChange;
+	bool           winsockStarted;
+
+	// CPU time (100ns units) of each process at the last cpu sample
+	DWORD          cpuProcessIds[MAX_AUTOSCALED_PROCESSES];
+	ULONGLONG      cpuTimes[MAX_AUTOSCALED_PROCESSES];
+	int            cpuProcessCount;
+	ULONGLONG      cpuSampleTime;
+
+	// prevent copying
+	Autoscaler(const Autoscaler&);
+	Autoscaler &operator=(const Autoscaler&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__AUTOSCALER_H__)
@@ -15,16 +15,30 @@
 #define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
 #include <windows.h>
 #include <process.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <direct.h>
 
 // support headers
 #include <logger.h>
 
 // class headers
-#include "Sleeper.h"
 #include "StringSubstituter.h"
 #include "ScmConnector.h"
+#include "ControlQueue.h"
+#include "Watchdog.h"
+#include "HealthProbes.h"
+#include "TimerWheel.h"
+#include "ListenSockets.h"
+#include "Autoscaler.h"
+#include "ProcessPlacement.h"
+#include "ResourceLimits.h"
+#include "ResourceSampler.h"
+#include "LoadShedder.h"
+#include "ServiceMetrics.h"
+#include "MetricsServer.h"
+#include "StatusPage.h"
 #include "CmdRunner.h"
 
 // ============================================================================
@@ -44,6 +58,35 @@ using namespace LiteSrv;
 const char *DEFAULT_NAME			= "";
 const char *DEFAULT_COMMAND			= "";
 
+// delays may run late by this fraction, so that their wakeups coalesce
+const DWORD DELAY_SLACK_FRACTION	= 16;
+
+// how often to warn about a command which is slow to stop
+const DWORD SHUTDOWN_WARNING_MS		= 60000;
+const DWORD SHUTDOWN_WARNING_SLACK	= 1000;
+
+// how long a rolling restart waits for the new command to be ready (seconds)
+const int DEFAULT_HANDOFF_TIMEOUT	= 60;
+
+// how often an on-demand command is checked for activity, and the share
+// of that time it must spend on the CPU to count as active
+const DWORD IDLE_CHECK_MS			= 1000;
+const DWORD IDLE_CHECK_SLACK		= 250;
+const DWORD IDLE_CPU_FRACTION		= 100;
+
+// replicas (each one is waited on along with the control queue), and how
+// each one is told its instance number
+const int   MAX_REPLICAS			= MAXIMUM_WAIT_OBJECTS-1;
+const char *INSTANCE_NAME			= "INSTANCE";
+const char *INSTANCE_PLACEHOLDER	= "%INSTANCE%";
+
+// tells the shutdown command which process to stop
+const char *STOP_PID_NAME			= "LITESRV_STOP_PID";
+
+// names of the ScmConnector::SCM_STATUSES, as metric labels
+const char * const SCM_STATUS_NAMES[] = LITESRV_STATE_NAMES;
+const int SCM_STATUS_COUNT			= LITESRV_STATE_COUNT;
+
 // ============================================================================
 //
 // LOCAL FUNCTION PROTOTYPES
@@ -52,7 +95,8 @@ const char *DEFAULT_COMMAND			= "";
 
 void createProcess(char *command,bool wait,HANDLE &hProcess,DWORD *processId=0,void *env=0,
 					char *cwd=0,DWORD creationFlags=NORMAL_PRIORITY_CLASS,
-					STARTUPINFO *startupInfo=0,int waitInterval=1)
+					STARTUPINFO *startupInfo=0,int waitInterval=1,
+					HANDLE *inheritHandles=0,int inheritCount=0,HANDLE *hThread=0)
 					throw(LiteSrvException);
 void waitForProcessToComplete(HANDLE &hProcess,int waitInterval=1) throw(LiteSrvException);
 typedef enum STARTED_PROCESS_STATUS { 
@@ -61,6 +105,7 @@ typedef enum STARTED_PROCESS_STATUS {
 				PROCESS_STATUS_EXIT_FAILURE } ;
 static STARTED_PROCESS_STATUS getProcessStatus(HANDLE hProcess) throw(LiteSrvException);
 BOOL CALLBACK sendCloseMessage(HWND hwnd,LPARAM lParam);
+void expandInstance(StringSubstituter &ss,char *&expanded,const char *str,int instance);
 
 // ============================================================================
 //
@@ -84,6 +129,7 @@ struct CmdRunnerData
 	char *waitCommand;
 	char *shutdownCommand;
 	CmdRunner::SHUTDOWN_METHODS shutdownMethod;
+	char *outputFile;
 
 	// characteristics
 	int waitInterval;
@@ -92,10 +138,57 @@ struct CmdRunnerData
 	bool startMinimised;
 	bool startInNewWindow;
 
+	// CPUs, efficiency mode, I/O and memory priority
+	ProcessPlacement placement;
+
+	// memory, CPU and process limits
+	ResourceLimits limits;
+
+	// what each process of the command uses
+	ResourceSampler sampler;
+
+	// pauses the command while the host is under pressure
+	LoadShedder shedder;
+
+	// what has been done with the processes, where it is scraped from, and
+	// the page it is published on (with the state of the service)
+	ServiceMetrics metrics;
+	MetricsServer  metricsServer;
+	StatusPage     statusPage;
+
+	// replicas, and CPUs to pin each one to (0 = not pinned)
+	int replicaCount;
+	int replicaCpus;
+
+	// number of replicas driven by the load
+	Autoscaler autoscaler;
+
 	// auto-restart
 	bool autoRestart;
 	int  autoRestartInterval;
 
+	// watchdog, and seconds to wait for a stop before terminating the process
+	Watchdog watchdog;
+	int      killTimeout;
+
+	// liveness and readiness probes
+	HealthProbes healthProbes;
+
+	// listening sockets passed to the command (open across restarts)
+	ListenSockets listenSockets;
+
+	// rolling restart, and seconds to wait for the new command to be ready
+	// and for the old one to drain
+	bool rollingRestart;
+	int  handoffTimeout;
+	int  drainTimeout;
+
+	// on demand, seconds without activity before the command is stopped, and
+	// the CPU time (100ns units) it had used when it was last checked
+	bool      onDemand;
+	int       idleTimeout;
+	ULONGLONG idleCpuTime;
+
 	// process
 	HANDLE hCommandProcess;
 	DWORD  dwProcessId;
@@ -103,6 +196,12 @@ struct CmdRunnerData
 	// ScmConnector
 	ScmConnector *scmConnector;
 
+	// requests from the SCM (service mode)
+	ControlQueue controlQueue;
+
+	// delays
+	TimerWheel timers;
+
 	// 	StringSubstituter
 	StringSubstituter stringSubstituter;
 
@@ -118,6 +217,7 @@ struct CmdRunnerData
 		stringSubstituter.stringInit(startupDirectory);
 		stringSubstituter.stringInit(waitCommand);
 		stringSubstituter.stringInit(shutdownCommand);
+		stringSubstituter.stringInit(outputFile);
 		shutdownMethod = CmdRunner::SHUTDOWN_BY_KILL;
 
 		waitInterval      = 1;
@@ -126,9 +226,22 @@ struct CmdRunnerData
 		startMinimised    = false;
 		startInNewWindow  = false;
 
+		replicaCount = 1;
+		replicaCpus  = 0;
+
 		autoRestart         = false;
 		autoRestartInterval = 0;
 
+		killTimeout = 0;
+
+		rollingRestart = false;
+		handoffTimeout = DEFAULT_HANDOFF_TIMEOUT;
+		drainTimeout   = 0;
+
+		onDemand    = false;
+		idleTimeout = 0;
+		idleCpuTime = 0;
+
 		hCommandProcess = 0;
 
 		scmConnector = 0;
@@ -137,11 +250,13 @@ struct CmdRunnerData
 	
 	virtual ~CmdRunnerData()
 	{
+		if(hCommandProcess != 0) { CloseHandle(hCommandProcess); }
 		stringSubstituter.stringDelete(srvName);
 		stringSubstituter.stringDelete(startupCommand);
 		stringSubstituter.stringDelete(startupDirectory);
 		stringSubstituter.stringDelete(waitCommand);
 		stringSubstituter.stringDelete(shutdownCommand);
+		stringSubstituter.stringDelete(outputFile);
 	} ;
 
 } ;
@@ -189,10 +304,6 @@ throw (LiteSrvException)
 {
 	LOGGER_LOG_DEBUG("CmdRunner::CmdRunner()")
 
-	// initialise
-	stopCallbackVar   = false;
-	stopCallbackEvent = 0;
-
 	// allocate CmdRunner data
 	cmdRunnerData = new CmdRunnerData;
 
@@ -207,6 +318,7 @@ throw (LiteSrvException)
 	cmdRunnerData->stringSubstituter.stringCopy(cmdRunnerData->startupCommand,DEFAULT_COMMAND);
 	cmdRunnerData->stringSubstituter.stringCopy(cmdRunnerData->shutdownCommand,"");
 	cmdRunnerData->stringSubstituter.stringCopy(cmdRunnerData->waitCommand,"");
+	cmdRunnerData->stringSubstituter.stringCopy(cmdRunnerData->outputFile,"");
 
 	switch(mode)
 	{
@@ -267,38 +379,11 @@ throw (LiteSrvException)
 		}
 	}
 
-	// for service mode, install the callbacks
-	// note that only ONE of these callbacks is needed;
-	//  the other two are included for illsutrative purposes only!
-
+	// for service mode, SCM requests are delivered through the control queue
 	if(cmdRunnerData->startMode==SERVICE_MODE)
 	{
-		// install service stop callback variable
-		stopCallbackVar = false;
-		cmdRunnerData->scmConnector->installStopCallback(&stopCallbackVar);
-		LOGGER_LOG_DEBUG("installed callback variable")
-
-		// service stop callback event
-		stopCallbackEvent = CreateEvent(NULL,FALSE,FALSE,NULL);
-		if (stopCallbackEvent == NULL)
-		{
-			// failed to create wait event
-			LOGGER_LOG_ERROR1("CmdRunner(): failed to create stop callback event, error=%d",GetLastError())
-			THROW_LiteSrv_EXCEPTION
-				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","CmdRunner")
-		}
-		else
-		{
-			cmdRunnerData->scmConnector->installStopCallback(&stopCallbackEvent);
-			LOGGER_LOG_DEBUG("installed callback event")
-		}
-
-		// install service stop callback function
-		cmdRunnerData->scmConnector->installStopCallback(
-			static_cast<ScmConnector::STOP_HANDLER_FUNCTION*>(stopCallbackFunction),
-			static_cast<void*>(this));
-		LOGGER_LOG_DEBUG("installed callback function")
-
+		cmdRunnerData->scmConnector->installControlQueue(&cmdRunnerData->controlQueue);
+		LOGGER_LOG_DEBUG("installed control queue")
 	}
 
 	// we are ready to have our properties set now
@@ -326,6 +411,11 @@ void CmdRunner::start() throw (LiteSrvException)
 	// make sure that the command has been set
 	CHECK_GOOD_STRING("start",cmdRunnerData->startupCommand)
 
+	// %INSTANCE% is left for each instance of the command to fill in as it
+	// starts (a command run by system() is instance 0)
+	bool bySystem = (cmdRunnerData->startMode == COMMAND_MODE)&&(!cmdRunnerData->startInNewWindow);
+	SetEnvironmentVariable(INSTANCE_NAME,bySystem ? "0" : INSTANCE_PLACEHOLDER);
+
 	// we are now ready to perform the required substitutions
 	cmdRunnerData->stringSubstituter.stringSubstitute(cmdRunnerData->startupCommand);
 
@@ -336,6 +426,7 @@ void CmdRunner::start() throw (LiteSrvException)
 	_SUBSTITUTE(cmdRunnerData->startupDirectory)
 	_SUBSTITUTE(cmdRunnerData->waitCommand)
 	_SUBSTITUTE(cmdRunnerData->shutdownCommand)
+	_SUBSTITUTE(cmdRunnerData->outputFile)
 
 	// there are three cases to deal with
 
@@ -381,9 +472,16 @@ void CmdRunner::start() throw (LiteSrvException)
 		LOGGER_LOG_DEBUG("running command")
 		startCommand();
 
-		// watch the process (wait for it to complete)
+		// watch the process (wait for it to complete), running it again
+		// whenever it is killed for a restart (by the watchdog, say)
 		LOGGER_LOG_DEBUG("waiting for command to complete")
-		watchCommand();
+		while(watchCommand(false) == WATCH_COMMAND_RESTART)
+		{
+			LOGGER_LOG_DEBUG("command was killed for a restart - restarting")
+			CloseHandle(cmdRunnerData->hCommandProcess);
+			cmdRunnerData->hCommandProcess = 0;
+			startCommand();
+		}
 
 		// everything went ok - return
 		SS_RETURNV("CmdRunner::start")
@@ -393,37 +491,85 @@ void CmdRunner::start() throw (LiteSrvException)
 	// case 3: this is a service
 	LOGGER_LOG_DEBUG("start(): service")
 
+	// publish its status for monitoring tools
+	cmdRunnerData->statusPage.open(cmdRunnerData->srvName);
+	publishStatus();
+
+	// an on-demand service is started by connections to its listening sockets
+	if(cmdRunnerData->onDemand&&!cmdRunnerData->listenSockets.hasSockets())
+	{
+		LOGGER_LOG_ERROR1("service '%s' is on demand, but has no listening sockets",cmdRunnerData->srvName)
+		notifyStatus(ScmConnector::STATUS_STOPPING,true);
+		notifyStatus(ScmConnector::STATUS_STOPPED,true);
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"CmdRunner","start")
+	}
+
 	// if the service is set to auto-restart, we may have to loop
 	bool stillLooping = true;
 
 #define	CATCH_AND_NOTIFY \
 	catch(...) { \
-		cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_STOPPING,true); \
-		cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_STOPPED,true); \
+		notifyStatus(ScmConnector::STATUS_STOPPING,true); \
+		notifyStatus(ScmConnector::STATUS_STOPPED,true); \
 		throw; }
 
+	// replicas are supervised together
+	if((cmdRunnerData->replicaCount > 1)||cmdRunnerData->autoscaler.isEnabled())
+	{
+		try { runReplicas(); }
+		CATCH_AND_NOTIFY
+		SS_RETURNV("CmdRunner::start")
+	}
+
 	while(stillLooping)
 	{
 
-		// run the command
+		// on demand, wait for a connection first
+		if(cmdRunnerData->onDemand)
+		{
+			bool connected = false;
+			try { connected = waitForConnection(); }
+			CATCH_AND_NOTIFY
+			if(!connected)
+			{
+				LOGGER_LOG_DEBUG("stopped while waiting for a connection - exiting")
+				notifyStatus(ScmConnector::STATUS_STOPPING,true);
+				notifyStatus(ScmConnector::STATUS_STOPPED);
+				break;
+			}
+		}
+
+		// run the command (in place of the one which ran before, if any)
+		if(cmdRunnerData->hCommandProcess != 0)
+		{
+			CloseHandle(cmdRunnerData->hCommandProcess);
+			cmdRunnerData->hCommandProcess = 0;
+		}
 		try { startCommand(); }
 		CATCH_AND_NOTIFY
 
-		// wait for the process to start up
+		// wait for the process to start up (a stop request ends the wait, and
+		// the command)
 		LOGGER_LOG_DEBUG("process is starting")
-		try { waitForStartup(); }
-		CATCH_AND_NOTIFY
-
-		// it is running - notify the SCM
-		LOGGER_LOG_DEBUG("process is running")
-		try { cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_RUNNING); }
+		bool stopRequested = false;
+		try
+		{
+			if(!waitForStartup())
+			{
+				notifyStatus(ScmConnector::STATUS_STOPPING);
+				killCommand(cmdRunnerData->killTimeout);
+				stopRequested = true;
+			}
+		}
 		CATCH_AND_NOTIFY
 
-		// watch the process (wait for it to finish or be stopped)
-		LOGGER_LOG_DEBUG("waiting for process to finish")
+		// watch the process (notify the SCM that it is running once it is
+		// ready, then wait for it to finish or be stopped)
+		LOGGER_LOG_DEBUG("process is starting - waiting for it to be ready")
 		try
 		{
-			switch(watchCommand())
+			switch(stopRequested ? WATCH_COMMAND_WAS_STOPPED : watchCommand(true))
 			{
 				case WATCH_COMMAND_COMPLETED:
 					// command completed on its own
@@ -432,16 +578,16 @@ void CmdRunner::start() throw (LiteSrvException)
 					{
 						// auto-restart has been set - is the service still running?
 						LOGGER_LOG_DEBUG("auto-restart has been set")
-						if(cmdRunnerData->scmConnector->getScmStatus()==ScmConnector::STATUS_RUNNING)
+						if(isRunning())
 						{
 							// yes, the service is still running - restart the program
 							LOGGER_LOG_DEBUG("auto-restart has been set: will restart service program")
+							stillLooping = true;
 							if(cmdRunnerData->autoRestartInterval>0)
 							{
-								// sleep before restart
-								Sleeper::Sleep(cmdRunnerData->autoRestartInterval,"restart service");
+								// wait before restart (a stop request ends the wait, and the service)
+								stillLooping = delay((DWORD)cmdRunnerData->autoRestartInterval*1000,"restart service");
 							}
-							stillLooping = true;
 						}
 						else
 						{
@@ -451,6 +597,15 @@ void CmdRunner::start() throw (LiteSrvException)
 						}
 					}
 					else
+					if(cmdRunnerData->onDemand&&
+					   (getProcessStatus(cmdRunnerData->hCommandProcess)==PROCESS_STATUS_EXIT_SUCCESS))
+					{
+						// an on-demand command may exit by itself when it is idle -
+						// wait for the next connection (unless shutting down)
+						LOGGER_LOG_DEBUG("on-demand command completed - waiting for the next connection")
+						stillLooping = isRunning();
+					}
+					else
 					{
 						// auto-restart has not been set - exit
 						LOGGER_LOG_DEBUG("auto-restart has not been set - exiting")
@@ -463,14 +618,28 @@ void CmdRunner::start() throw (LiteSrvException)
 					LOGGER_LOG_DEBUG("command was stopped by SCM - exiting")
 					stillLooping = false;
 					break;
+
+				case WATCH_COMMAND_RESTART:
+					// command was killed for a restart or reload request, or by the
+					// watchdog - run it again
+					LOGGER_LOG_DEBUG("command was killed for a restart - restarting")
+					stillLooping = true;
+					break;
+
+				case WATCH_COMMAND_IDLE:
+					// on-demand command was stopped for being idle - wait for the
+					// next connection
+					LOGGER_LOG_DEBUG("command was stopped for being idle - waiting for the next connection")
+					stillLooping = true;
+					break;
 			}
 
 			if(!stillLooping)
 			{
 				// command has completed - notify SCM
 				LOGGER_LOG_DEBUG("command has completed - service is shutting down")
-				cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_STOPPING,true);
-				cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_STOPPED);
+				notifyStatus(ScmConnector::STATUS_STOPPING,true);
+				notifyStatus(ScmConnector::STATUS_STOPPED);
 			}
 
 		}
@@ -784,6 +953,166 @@ char *CmdRunner::getStartupDirectory() const { return cmdRunnerData->startupDire
 CmdRunner::EXECUTION_PRIORITIES
       CmdRunner::getExecutionPriority() const { return cmdRunnerData->executionPriority; }
 
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setCpuAffinity
+//                   CmdRunner::setSchedulingPolicy
+//                   CmdRunner::setIoPriority
+//                   CmdRunner::setMemoryPriority
+//                   CmdRunner::getCpuAffinity
+//                   CmdRunner::getSchedulingPolicy
+//                   CmdRunner::getIoPriority
+//                   CmdRunner::getMemoryPriority
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the placement of the command - the CPUs it
+//                   may run on ("0x<mask>" or a list such as "0-3,6"), the
+//                   scheduling policy (batch runs it in efficiency mode),
+//                   and its I/O and memory priority
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
+//
+// THROWS          : LiteSrvException (setCpuAffinity)
+//
+// ============================================================================
+void CmdRunner::setCpuAffinity
+(
+	const char *ca
+) throw (LiteSrvException)
+{
+	cmdRunnerData->placement.setAffinity(ca);
+}
+
+void CmdRunner::setSchedulingPolicy(SCHEDULING_POLICIES sp) { cmdRunnerData->placement.setThrottled(sp == BATCH_SCHEDULING); }
+void CmdRunner::setIoPriority(IO_PRIORITIES ip) { cmdRunnerData->placement.setIoPriority((int)ip); }
+void CmdRunner::setMemoryPriority(MEMORY_PRIORITIES mp) { cmdRunnerData->placement.setMemoryPriority((int)mp); }
+const char *CmdRunner::getCpuAffinity() const { return cmdRunnerData->placement.getAffinity(); }
+CmdRunner::SCHEDULING_POLICIES
+      CmdRunner::getSchedulingPolicy() const
+{
+	return cmdRunnerData->placement.isThrottled() ? BATCH_SCHEDULING : NORMAL_SCHEDULING;
+}
+CmdRunner::IO_PRIORITIES
+      CmdRunner::getIoPriority() const { return (IO_PRIORITIES)cmdRunnerData->placement.getIoPriority(); }
+CmdRunner::MEMORY_PRIORITIES
+      CmdRunner::getMemoryPriority() const { return (MEMORY_PRIORITIES)cmdRunnerData->placement.getMemoryPriority(); }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setMemoryLimit
+//                   CmdRunner::setMemoryMax
+//                   CmdRunner::setCpuQuota
+//                   CmdRunner::setMaxProcesses
+//                   CmdRunner::getMemoryLimit
+//                   CmdRunner::getMemoryMax
+//                   CmdRunner::getCpuQuota
+//                   CmdRunner::getMaxProcesses
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the resource limits - the memory each process
+//                   may commit and the memory they may commit between them
+//                   (MB), the CPU they may use between them (percent of one
+//                   CPU) and the number of processes (0 = no limit)
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
+//
+// ============================================================================
+void CmdRunner::setMemoryLimit(int ml) { cmdRunnerData->limits.setProcessMemory(ml); }
+void CmdRunner::setMemoryMax(int mm) { cmdRunnerData->limits.setServiceMemory(mm); }
+void CmdRunner::setCpuQuota(int cq) { cmdRunnerData->limits.setCpuQuota(cq); }
+void CmdRunner::setMaxProcesses(int mp) { cmdRunnerData->limits.setProcessCount(mp); }
+int  CmdRunner::getMemoryLimit() const { return cmdRunnerData->limits.getProcessMemory(); }
+int  CmdRunner::getMemoryMax() const { return cmdRunnerData->limits.getServiceMemory(); }
+int  CmdRunner::getCpuQuota() const { return cmdRunnerData->limits.getCpuQuota(); }
+int  CmdRunner::getMaxProcesses() const { return cmdRunnerData->limits.getProcessCount(); }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setSampleInterval
+//                   CmdRunner::setMaxRss
+//                   CmdRunner::setMaxRssSamples
+//                   CmdRunner::getSampleInterval
+//                   CmdRunner::getMaxRss
+//                   CmdRunner::getMaxRssSamples
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get how often the CPU, memory, I/O and handles of
+//                   each process of the command are sampled (seconds, 0 =
+//                   never, unless there is a max_rss), and the working set
+//                   (MB) a process is recycled for staying over for a
+//                   number of samples in a row
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
+//
+// ============================================================================
+void CmdRunner::setSampleInterval(int si) { cmdRunnerData->sampler.setInterval(si); }
+void CmdRunner::setMaxRss(int mr) { cmdRunnerData->sampler.setMemoryThreshold(mr); }
+void CmdRunner::setMaxRssSamples(int ms) { cmdRunnerData->sampler.setThresholdSamples(ms); }
+int  CmdRunner::getSampleInterval() const { return cmdRunnerData->sampler.getInterval(); }
+int  CmdRunner::getMaxRss() const { return cmdRunnerData->sampler.getMemoryThreshold(); }
+int  CmdRunner::getMaxRssSamples() const { return cmdRunnerData->sampler.getThresholdSamples(); }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setShedCpu
+//                   CmdRunner::setShedMemory
+//                   CmdRunner::getShedCpu
+//                   CmdRunner::getShedMemory
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the pressure the command is paused for - the
+//                   CPUs being busier than a percentage (0 = never), or
+//                   memory running low - so that other services keep their
+//                   latency
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
+//
+// ============================================================================
+void CmdRunner::setShedCpu(int sc) { cmdRunnerData->shedder.setCpuThreshold(sc); }
+void CmdRunner::setShedMemory(bool sm) { cmdRunnerData->shedder.setMemoryPressure(sm); }
+int  CmdRunner::getShedCpu() const { return cmdRunnerData->shedder.getCpuThreshold(); }
+bool CmdRunner::getShedMemory() const { return cmdRunnerData->shedder.getMemoryPressure(); }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setMetricsAddress
+//                   CmdRunner::getMetricsAddress
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the address the metrics of the service are
+//                   served on, for Prometheus to scrape
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
+//
+// THROWS          : LiteSrvException (setMetricsAddress)
+//
+// ============================================================================
+void CmdRunner::setMetricsAddress
+(
+	const char *ma
+) throw (LiteSrvException)
+{
+	CHECK_GOOD_STRING("setMetricsAddress",ma)
+	cmdRunnerData->metricsServer.setAddress(ma);
+}
+
+const char *CmdRunner::getMetricsAddress() const { return cmdRunnerData->metricsServer.getAddress(); }
+
 
 // ============================================================================
 //
@@ -809,328 +1138,1882 @@ int  CmdRunner::getAutoRestartInterval() const { return cmdRunnerData->autoResta
 
 // ============================================================================
 //
-// MEMBER FUNCTION : CmdRunner::addEnv
+// MEMBER FUNCTION : CmdRunner::setWatchdogInterval
+//                   CmdRunner::setWatchdogFile
+//                   CmdRunner::setKillTimeout
+//                   CmdRunner::getWatchdogInterval
+//                   CmdRunner::getWatchdogFile
+//                   CmdRunner::getKillTimeout
 //
 // ACCESS SPECIFIER: public
 //
-// DESCRIPTION     : set an environment variable
+// DESCRIPTION     : set / get watchdog properties
 //
-// ARGUMENTS       : nm  IN environment variable name
-//                   val IN environment variable value
+// ARGUMENTS       : property value (set)
 //
-// THROWS          : LiteSrvException
+// RETURNS         : property value (get)
+//
+// THROWS          : LiteSrvException (setWatchdogFile)
 //
 // ============================================================================
-void CmdRunner::addEnv
+void CmdRunner::setWatchdogInterval(int wi) { cmdRunnerData->watchdog.setInterval(wi); }
+void CmdRunner::setKillTimeout(int kt) { cmdRunnerData->killTimeout = kt; }
+
+void CmdRunner::setWatchdogFile
 (
-	const char *nm,
-	const char *val
+	const char *wf
 ) throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG2("CmdRunner::addEnv('%s','%s')",nm,val)
-
-	// check input parameters
-	CHECK_GOOD_STRING("addEnv",nm)
-	CHECK_GOOD_STRING("addEnv",val)
+	CHECK_GOOD_STRING("setWatchdogFile",wf)
+	cmdRunnerData->watchdog.setHeartbeatFile(wf);
+}
 
-	// copy value
-	char *tmp_val = 0;
-	cmdRunnerData->stringSubstituter.stringCopy(tmp_val,val);
+int         CmdRunner::getWatchdogInterval() const { return cmdRunnerData->watchdog.getInterval(); }
+const char *CmdRunner::getWatchdogFile() const { return cmdRunnerData->watchdog.getHeartbeatFile(); }
+int         CmdRunner::getKillTimeout() const { return cmdRunnerData->killTimeout; }
 
-	// perform substitution on environment value
-	cmdRunnerData->stringSubstituter.stringSubstitute(tmp_val);
-	LOGGER_LOG_DEBUG1("value after substitution is '%s')",tmp_val)
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::addLivenessProbe
+//                   CmdRunner::addReadinessProbe
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : add a health probe ("exec <command>", "tcp <port>" or
+//                   "http <port>[/path] [status]")
+//
+// ARGUMENTS       : spec IN probe
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::addLivenessProbe
+(
+	const char *spec
+) throw (LiteSrvException)
+{
+	CHECK_GOOD_STRING("addLivenessProbe",spec)
+	cmdRunnerData->healthProbes.addProbe(HealthProbes::PROBE_LIVENESS,spec);
+}
 
-	// log an informational message
-	LOGGER_LOG_INFO2("SET %s=%s",nm,tmp_val)
-	// set the environment variable
-	SetEnvironmentVariable(nm,tmp_val);
+void CmdRunner::addReadinessProbe
+(
+	const char *spec
+) throw (LiteSrvException)
+{
+	CHECK_GOOD_STRING("addReadinessProbe",spec)
+	cmdRunnerData->healthProbes.addProbe(HealthProbes::PROBE_READINESS,spec);
 }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : CmdRunner::setStartMinimised
-//                   CmdRunner::setStartInNewWindow
+// MEMBER FUNCTION : CmdRunner::setProbeInterval
+//                   CmdRunner::setProbeTimeout
+//                   CmdRunner::setProbeFailureThreshold
+//                   CmdRunner::getProbeInterval
+//                   CmdRunner::getProbeTimeout
+//                   CmdRunner::getProbeFailureThreshold
 //
 // ACCESS SPECIFIER: public
 //
-// DESCRIPTION     : set start profile
+// DESCRIPTION     : set / get health probe schedule
 //
-// ARGUMENTS       : flag
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
 //
 // ============================================================================
-void CmdRunner::setStartMinimised(bool sm) { cmdRunnerData->startMinimised = sm; }
-void CmdRunner::setStartInNewWindow(bool nw) { cmdRunnerData->startInNewWindow = nw; }
+void CmdRunner::setProbeInterval(int pi) { cmdRunnerData->healthProbes.setInterval(pi); }
+void CmdRunner::setProbeTimeout(int pt) { cmdRunnerData->healthProbes.setTimeout(pt); }
+void CmdRunner::setProbeFailureThreshold(int pf) { cmdRunnerData->healthProbes.setFailureThreshold(pf); }
+
+int CmdRunner::getProbeInterval() const { return cmdRunnerData->healthProbes.getInterval(); }
+int CmdRunner::getProbeTimeout() const { return cmdRunnerData->healthProbes.getTimeout(); }
+int CmdRunner::getProbeFailureThreshold() const { return cmdRunnerData->healthProbes.getFailureThreshold(); }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : CmdRunner::~CmdRunner
+// MEMBER FUNCTION : CmdRunner::addListenSocket
 //
 // ACCESS SPECIFIER: public
 //
-// DESCRIPTION     : destructor
+// DESCRIPTION     : add a listening socket for the command to inherit
+//                   ("[name=]tcp [address:]port" or "[name=]unix path")
 //
-// ARGUMENTS       : mode IN start mode
+// ARGUMENTS       : spec IN socket
+//
+// THROWS          : LiteSrvException
 //
 // ============================================================================
-CmdRunner::~CmdRunner()
+void CmdRunner::addListenSocket
+(
+	const char *spec
+) throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG("CmdRunner::~CmdRunner()")
-
-	// delete CmdRunner data
-	delete cmdRunnerData;
-	CloseHandle(stopCallbackEvent);
+	CHECK_GOOD_STRING("addListenSocket",spec)
+	cmdRunnerData->listenSockets.addSocket(spec);
 }
 
 // ============================================================================
 //
-// STATIC MEMBER FUNCTIONS
+// MEMBER FUNCTION : CmdRunner::setRollingRestart
+//                   CmdRunner::setHandoffTimeout
+//                   CmdRunner::setDrainTimeout
+//                   CmdRunner::getRollingRestart
+//                   CmdRunner::getHandoffTimeout
+//                   CmdRunner::getDrainTimeout
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get rolling restart properties (a handoff timeout
+//                   of 0 waits for ever; a drain timeout of 0 uses the kill
+//                   timeout)
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
 //
 // ============================================================================
+void CmdRunner::setRollingRestart(bool rr) { cmdRunnerData->rollingRestart = rr; }
+void CmdRunner::setHandoffTimeout(int ht) { cmdRunnerData->handoffTimeout = (ht > 0) ? ht : 0; }
+void CmdRunner::setDrainTimeout(int dt) { cmdRunnerData->drainTimeout = (dt > 0) ? dt : 0; }
+
+bool CmdRunner::getRollingRestart() const { return cmdRunnerData->rollingRestart; }
+int  CmdRunner::getHandoffTimeout() const { return cmdRunnerData->handoffTimeout; }
+int  CmdRunner::getDrainTimeout() const { return cmdRunnerData->drainTimeout; }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : CmdRunner::stopCallbackFunction
+// MEMBER FUNCTION : CmdRunner::setOnDemand
+//                   CmdRunner::setIdleTimeout
+//                   CmdRunner::getOnDemand
+//                   CmdRunner::getIdleTimeout
 //
-// ACCESS SPECIFIER: public static
+// ACCESS SPECIFIER: public
 //
-// DESCRIPTION     : this function is called by the ScmConnector if the SCM
-//                   sends a STOP request (eg if the user uses Control
-//                   Panel|Services to stop the service).
+// DESCRIPTION     : set / get on-demand properties (an idle timeout of 0
+//                   never stops the command)
 //
-//                   It is NOT needed by the CmdRunner class, but it is included
-//                   for illustrative purposes.
+// ARGUMENTS       : property value (set)
 //
-// ARGUMENTS       : genericPointer  IN generic pointer
+// RETURNS         : property value (get)
 //
 // ============================================================================
-void CmdRunner::stopCallbackFunction
-(
-	void *genericPointer
-)
-{
-	// pointer should point to this object
-	if(genericPointer==0)
-	{
-		// the callback has been called with a null pointer
-		// this should never happen
-		LOGGER_LOG_ERROR("stopCallbackFunction() has been invoked with NULL pointer")
-	}
-	else
-	{
-		// cast the generic pointer
-		CmdRunner *thisObject = static_cast<CmdRunner*>(genericPointer);
-		LOGGER_LOG_DEBUG1("stopCallbackFunction(%s) has been correctly invoked",
-				thisObject->getSrvName())
-	}
-}
+void CmdRunner::setOnDemand(bool od) { cmdRunnerData->onDemand = od; }
+void CmdRunner::setIdleTimeout(int it) { cmdRunnerData->idleTimeout = (it > 0) ? it : 0; }
+
+bool CmdRunner::getOnDemand() const { return cmdRunnerData->onDemand; }
+int  CmdRunner::getIdleTimeout() const { return cmdRunnerData->idleTimeout; }
 
 // ============================================================================
 //
-// PRIVATE MEMBER FUNCTIONS
+// MEMBER FUNCTION : CmdRunner::setReplicas
+//                   CmdRunner::setReplicaCpus
+//                   CmdRunner::setOutputFile
+//                   CmdRunner::getReplicas
+//                   CmdRunner::getReplicaCpus
+//                   CmdRunner::getOutputFile
 //
-// ============================================================================
-
-// ============================================================================
+// ACCESS SPECIFIER: public
 //
-// MEMBER FUNCTION : CmdRunner::startCommand
+// DESCRIPTION     : set / get the number of replicas (1 to MAX_REPLICAS),
+//                   CPUs per replica (0 = not pinned), and the file the
+//                   output of each replica is appended to (%INSTANCE% in
+//                   it is the replica number)
 //
-// ACCESS SPECIFIER: private
+// ARGUMENTS       : property value (set)
 //
-// DESCRIPTION     : start the command
+// RETURNS         : property value (get)
 //
-// THROWS          : LiteSrvException
+// THROWS          : LiteSrvException (setReplicas, setOutputFile)
 //
 // ============================================================================
-void CmdRunner::startCommand() throw (LiteSrvException)
+void CmdRunner::setReplicas
+(
+	int rc
+) throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG("CmdRunner::startCommand()")
+	if((rc < 1)||(rc > MAX_REPLICAS))
+	{
+		LOGGER_LOG_ERROR2("invalid number of replicas %d (at most %d)",rc,MAX_REPLICAS)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"CmdRunner","setReplicas")
+	}
+	cmdRunnerData->replicaCount = rc;
+}
 
-	STARTUPINFO startupInfo;
-	DWORD       creationFlags = 0;
+void CmdRunner::setReplicaCpus(int rc) { cmdRunnerData->replicaCpus = (rc > 0) ? rc : 0; }
 
-	// initialise StartupInfo structure
+void CmdRunner::setOutputFile
+(
+	const char *of
+) throw (LiteSrvException)
+{
+	CHECK_GOOD_STRING("setOutputFile",of)
+	cmdRunnerData->stringSubstituter.stringCopy(cmdRunnerData->outputFile,of);
+}
+
+int   CmdRunner::getReplicas() const { return cmdRunnerData->replicaCount; }
+int   CmdRunner::getReplicaCpus() const { return cmdRunnerData->replicaCpus; }
+char *CmdRunner::getOutputFile() const { return cmdRunnerData->outputFile; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setScaleMetric
+//                   CmdRunner::setMinReplicas
+//                   CmdRunner::setMaxReplicas
+//                   CmdRunner::setScaleUp
+//                   CmdRunner::setScaleDown
+//                   CmdRunner::setScaleInterval
+//                   CmdRunner::setScaleCooldown
+//                   CmdRunner::getMinReplicas
+//                   CmdRunner::getMaxReplicas
+//                   CmdRunner::getScaleUp
+//                   CmdRunner::getScaleDown
+//                   CmdRunner::getScaleInterval
+//                   CmdRunner::getScaleCooldown
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the autoscaling load metric, the limits on
+//                   the number of replicas, the thresholds (load per
+//                   replica) and the schedule (seconds)
+//
+// ARGUMENTS       : property value (set)
+//
+// RETURNS         : property value (get)
+//
+// THROWS          : LiteSrvException (setScaleMetric)
+//
+// ============================================================================
+void CmdRunner::setScaleMetric
+(
+	const char *sm
+) throw (LiteSrvException)
+{
+	cmdRunnerData->autoscaler.setMetric(sm);
+}
+
+void CmdRunner::setMinReplicas(int mr) { cmdRunnerData->autoscaler.setMinimum(mr); }
+void CmdRunner::setMaxReplicas(int mr) { cmdRunnerData->autoscaler.setMaximum(mr); }
+void CmdRunner::setScaleUp(int su) { cmdRunnerData->autoscaler.setScaleUp(su); }
+void CmdRunner::setScaleDown(int sd) { cmdRunnerData->autoscaler.setScaleDown(sd); }
+void CmdRunner::setScaleInterval(int si) { cmdRunnerData->autoscaler.setInterval(si); }
+void CmdRunner::setScaleCooldown(int sc) { cmdRunnerData->autoscaler.setCooldown(sc); }
+int  CmdRunner::getMinReplicas() const { return cmdRunnerData->autoscaler.getMinimum(); }
+int  CmdRunner::getMaxReplicas() const { return cmdRunnerData->autoscaler.getMaximum(); }
+int  CmdRunner::getScaleUp() const { return cmdRunnerData->autoscaler.getScaleUp(); }
+int  CmdRunner::getScaleDown() const { return cmdRunnerData->autoscaler.getScaleDown(); }
+int  CmdRunner::getScaleInterval() const { return cmdRunnerData->autoscaler.getInterval(); }
+int  CmdRunner::getScaleCooldown() const { return cmdRunnerData->autoscaler.getCooldown(); }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::addEnv
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set an environment variable
+//
+// ARGUMENTS       : nm  IN environment variable name
+//                   val IN environment variable value
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::addEnv
+(
+	const char *nm,
+	const char *val
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG2("CmdRunner::addEnv('%s','%s')",nm,val)
+
+	// check input parameters
+	CHECK_GOOD_STRING("addEnv",nm)
+	CHECK_GOOD_STRING("addEnv",val)
+
+	// copy value
+	char *tmp_val = 0;
+	cmdRunnerData->stringSubstituter.stringCopy(tmp_val,val);
+
+	// perform substitution on environment value
+	cmdRunnerData->stringSubstituter.stringSubstitute(tmp_val);
+	LOGGER_LOG_DEBUG1("value after substitution is '%s')",tmp_val)
+
+	// log an informational message
+	LOGGER_LOG_INFO2("SET %s=%s",nm,tmp_val)
+	// set the environment variable
+	SetEnvironmentVariable(nm,tmp_val);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::setStartMinimised
+//                   CmdRunner::setStartInNewWindow
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set start profile
+//
+// ARGUMENTS       : flag
+//
+// ============================================================================
+void CmdRunner::setStartMinimised(bool sm) { cmdRunnerData->startMinimised = sm; }
+void CmdRunner::setStartInNewWindow(bool nw) { cmdRunnerData->startInNewWindow = nw; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::~CmdRunner
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : destructor
+//
+// ARGUMENTS       : mode IN start mode
+//
+// ============================================================================
+CmdRunner::~CmdRunner()
+{
+	LOGGER_LOG_DEBUG("CmdRunner::~CmdRunner()")
+
+	// delete CmdRunner data
+	delete cmdRunnerData;
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::startCommand
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : start the command
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::startCommand() throw (LiteSrvException)
+{
+	startProcess(0,cmdRunnerData->hCommandProcess,cmdRunnerData->dwProcessId);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::startProcess
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : start one instance of the command - %INSTANCE% is its
+//                   number, its output goes to its own output file, and it
+//                   is placed (on its own CPUs, if replicas are pinned)
+//                   before it runs
+//
+// ARGUMENTS       : instance  IN  instance number (0 for a single command)
+//                   hProcess  OUT process handle
+//                   processId OUT process id
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::startProcess
+(
+	int     instance,
+	HANDLE &hProcess,
+	DWORD  &processId
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("CmdRunner::startProcess(%d)",instance)
+
+	STARTUPINFO startupInfo;
+	DWORD       creationFlags = 0;
+
+	// initialise StartupInfo structure
 	memset(&startupInfo,0,sizeof(startupInfo));
 	startupInfo.cb = sizeof(startupInfo);
 
-	// define execution priority of new process
-	switch(cmdRunnerData->executionPriority)
+	// define execution priority of new process
+	switch(cmdRunnerData->executionPriority)
+	{
+		case HIGH_PRIORITY:
+			LOGGER_LOG_DEBUG("command will start at HIGH priority")
+			creationFlags = creationFlags | HIGH_PRIORITY_CLASS;
+			break;
+		case IDLE_PRIORITY:
+			LOGGER_LOG_DEBUG("command will start at IDLE priority")
+			creationFlags = creationFlags | IDLE_PRIORITY_CLASS;
+			break;
+		case REAL_PRIORITY:
+			LOGGER_LOG_DEBUG("command will start at REALTIME priority")
+			creationFlags = creationFlags | REALTIME_PRIORITY_CLASS;
+			break;
+		case ABOVE_NORMAL_PRIORITY:
+			LOGGER_LOG_DEBUG("command will start at ABOVE NORMAL priority")
+			creationFlags = creationFlags | ABOVE_NORMAL_PRIORITY_CLASS;
+			break;
+		case BELOW_NORMAL_PRIORITY:
+			LOGGER_LOG_DEBUG("command will start at BELOW NORMAL priority")
+			creationFlags = creationFlags | BELOW_NORMAL_PRIORITY_CLASS;
+			break;
+		default:
+			LOGGER_LOG_DEBUG("command will start at NORMAL priority")
+			creationFlags = creationFlags | NORMAL_PRIORITY_CLASS;
+			break;
+	}
+
+	// command mode?
+	if(cmdRunnerData->startMode == COMMAND_MODE)
+	{
+		LOGGER_LOG_DEBUG("command will start in new console window")
+		creationFlags = creationFlags | CREATE_NEW_CONSOLE;
+		// new window name
+		LOGGER_LOG_DEBUG1("new window title is '%s'",cmdRunnerData->srvName)
+		startupInfo.lpTitle = cmdRunnerData->srvName;
+		// start new window minimised?
+		if(cmdRunnerData->startMinimised)
+		{
+			LOGGER_LOG_DEBUG("command will start in minimised window")
+			startupInfo.dwFlags = STARTF_USESHOWWINDOW;
+			startupInfo.wShowWindow = SW_MINIMIZE;
+		}
+	}
+
+	// tell the command where to send watchdog keepalives
+	cmdRunnerData->watchdog.prepare();
+
+	// get ready to pause it under pressure
+	cmdRunnerData->shedder.prepare();
+
+	// serve the metrics (from the first start on)
+	cmdRunnerData->metricsServer.open();
+
+	// open the listening sockets (the first time) and pass them on
+	HANDLE inheritHandles[MAX_LISTEN_SOCKETS+1];
+	cmdRunnerData->listenSockets.open();
+	cmdRunnerData->listenSockets.setEnvironment();
+	int inheritCount = cmdRunnerData->listenSockets.getHandles(inheritHandles,MAX_LISTEN_SOCKETS);
+
+	// the instance number, in the environment and in the command
+	char instanceNumber[16];
+	sprintf(instanceNumber,"%d",instance);
+	SetEnvironmentVariable(INSTANCE_NAME,instanceNumber);
+
+	StringSubstituter &ss = cmdRunnerData->stringSubstituter;
+	char *command;
+	char *directory;
+	char *output;
+	ss.stringInit(command);
+	ss.stringInit(directory);
+	ss.stringInit(output);
+	expandInstance(ss,command,cmdRunnerData->startupCommand,instance);
+	expandInstance(ss,directory,cmdRunnerData->startupDirectory,instance);
+	expandInstance(ss,output,cmdRunnerData->outputFile,instance);
+
+	// send the output to the output file
+	HANDLE hOutput = INVALID_HANDLE_VALUE;
+	if((output != 0)&&(output[0] != '\0'))
+	{
+		SECURITY_ATTRIBUTES inheritable = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+		hOutput = CreateFile(output,FILE_APPEND_DATA,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+								&inheritable,OPEN_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+		if(hOutput == INVALID_HANDLE_VALUE)
+		{
+			LOGGER_LOG_ERROR2("failed to open output file '%s', error=%d",output,GetLastError())
+			ss.stringDelete(command);
+			ss.stringDelete(directory);
+			ss.stringDelete(output);
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","startProcess")
+		}
+		LOGGER_LOG_DEBUG2("instance %d output goes to '%s'",instance,output)
+		startupInfo.dwFlags    = startupInfo.dwFlags | STARTF_USESTDHANDLES;
+		startupInfo.hStdInput  = NULL;
+		startupInfo.hStdOutput = hOutput;
+		startupInfo.hStdError  = hOutput;
+		inheritHandles[inheritCount++] = hOutput;
+	}
+
+	// a process to be placed, or limited, starts suspended
+	bool   placed    = cmdRunnerData->placement.isEnabled(cmdRunnerData->replicaCpus);
+	bool   limited   = cmdRunnerData->limits.isEnabled();
+	bool   suspended = placed||limited;
+	HANDLE hThread   = NULL;
+	if(suspended) { creationFlags = creationFlags | CREATE_SUSPENDED; }
+
+	// start the process
+	try
+	{
+		createProcess(command,false,hProcess,&processId,0,directory,
+							creationFlags,&startupInfo,cmdRunnerData->waitInterval,
+							inheritHandles,inheritCount,suspended ? &hThread : 0);
+	}
+	catch(...)
+	{
+		if(hOutput != INVALID_HANDLE_VALUE) { CloseHandle(hOutput); }
+		ss.stringDelete(command);
+		ss.stringDelete(directory);
+		ss.stringDelete(output);
+		throw;
+	}
+	if(hOutput != INVALID_HANDLE_VALUE) { CloseHandle(hOutput); }
+	ss.stringDelete(command);
+	ss.stringDelete(directory);
+	ss.stringDelete(output);
+
+	// place and limit it, then let it run - a process which cannot be placed
+	// or limited never runs
+	if(suspended)
+	{
+		try
+		{
+			if(placed) { cmdRunnerData->placement.apply(hProcess,instance,cmdRunnerData->replicaCpus); }
+			if(limited) { cmdRunnerData->limits.assign(hProcess); }
+		}
+		catch(...)
+		{
+			TerminateProcess(hProcess,1);
+			CloseHandle(hThread);
+			CloseHandle(hProcess);
+			hProcess = 0;
+			throw;
+		}
+		ResumeThread(hThread);
+		CloseHandle(hThread);
+	}
+	cmdRunnerData->metrics.processStarted(instance,processId);
+	publishStatus();
+
+	// return
+	SS_RETURNV("CmdRunner::startProcess()")
+
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::waitForStartup
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : wait for command to finish starting up
+//
+// RETURNS         : false if a stop was requested during the startup delay
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+bool CmdRunner::waitForStartup() throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("CmdRunner::waitForStartup()")
+
+	// what are we waiting for?
+	if(cmdRunnerData->waitCommand[0] != '\0')
+	{
+		// start wait command and wait for it to complete
+		LOGGER_LOG_INFO3(
+"%s is waiting for command '%s' to complete before reporting a 'running' status to the SCM for service '%s'",
+			getApplication(),cmdRunnerData->waitCommand,cmdRunnerData->srvName)
+
+		// run wait command and wait for it to complete
+		HANDLE hWaitProcess;
+		createProcess(cmdRunnerData->waitCommand,true,hWaitProcess);
+		LOGGER_LOG_INFO2("wait command '%s' has now completed for service '%s'",
+					cmdRunnerData->waitCommand,cmdRunnerData->srvName)
+		SS_RETURN("CmdRunner::waitForStartup",true)
+	}
+	else
+	{
+		if(cmdRunnerData->startupDelay>0)
+		{
+			// wait for a specified time period
+			LOGGER_LOG_INFO3(
+	"%s is waiting %d seconds before reporting a 'running' status to the SCM for service '%s'",
+					getApplication(),cmdRunnerData->startupDelay,cmdRunnerData->srvName)
+			// wait for specified time
+			if(!delay((DWORD)cmdRunnerData->startupDelay*1000,"startup delay"))
+			{
+				LOGGER_LOG_INFO1("service '%s' was stopped during its startup delay",cmdRunnerData->srvName)
+				SS_RETURN("CmdRunner::waitForStartup",false)
+			}
+			// we are ready to roll
+			LOGGER_LOG_INFO2("wait period %d has now completed for service '%s'",
+							cmdRunnerData->startupDelay,cmdRunnerData->srvName)
+			SS_RETURN("CmdRunner::waitForStartup",true)
+		}
+		else
+		{
+			SS_RETURN("CmdRunner::waitForStartup",true)
+		}
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::waitForConnection
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : open the listening sockets and wait for a connection to
+//                   any of them (on demand) - the service is reported running
+//                   meanwhile, and the connection is left waiting for the
+//                   command to accept
+//
+// RETURNS         : false if a stop was requested
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+bool CmdRunner::waitForConnection() throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("CmdRunner::waitForConnection()")
+
+	cmdRunnerData->listenSockets.open();
+	HANDLE hConnection = CreateEvent(NULL,TRUE,FALSE,NULL);
+	if(hConnection == NULL)
+	{
+		LOGGER_LOG_ERROR1("waitForConnection: failed to create event, error=%d",GetLastError())
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","waitForConnection")
+	}
+	try { cmdRunnerData->listenSockets.watchConnections(hConnection); }
+	catch(...) { CloseHandle(hConnection); throw; }
+
+	LOGGER_LOG_INFO1("service '%s' is waiting for a connection to start its command",cmdRunnerData->srvName)
+	notifyStatus(ScmConnector::STATUS_RUNNING);
+
+	bool connected = false;
+	bool stopped   = false;
+	while(!connected&&!stopped)
+	{
+		HANDLE waitHandles[2] = { hConnection, cmdRunnerData->controlQueue.getEvent() };
+		DWORD  waitResult = WaitForMultipleObjects(2,waitHandles,FALSE,INFINITE);
+		if(waitResult == WAIT_FAILED)
+		{
+			LOGGER_LOG_ERROR1("waitForConnection: failed to wait, error=%d",GetLastError())
+			cmdRunnerData->listenSockets.unwatchConnections();
+			CloseHandle(hConnection);
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","waitForConnection")
+		}
+		connected = (waitResult == WAIT_OBJECT_0);
+
+		// there is no command to restart or reload
+		ControlCommand command;
+		while(cmdRunnerData->controlQueue.take(command))
+		{
+			if(command.type == ControlCommand::CONTROL_STOP) { stopped = true; }
+			else { LOGGER_LOG_DEBUG2("waitForConnection: ignoring control command %d (code %lu)",command.type,command.code) }
+		}
+	}
+
+	cmdRunnerData->listenSockets.unwatchConnections();
+	CloseHandle(hConnection);
+	if(!stopped) { LOGGER_LOG_INFO1("connection to service '%s' - starting its command",cmdRunnerData->srvName) }
+	SS_RETURN("CmdRunner::waitForConnection",!stopped)
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::watchCommand
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : watch command until it completes (it finishes on its own,
+//                   a STOP, RESTART or RELOAD control command is taken from
+//                   the control queue, or the watchdog or a liveness probe
+//                   finds it has hung, or an on-demand command has been
+//                   idle for the idle timeout) - with rolling restart, a
+//                   RELOAD replaces the command and the watch carries on
+//
+// ARGUMENTS       : reportRunning IN notify the SCM that the service is
+//                                    running once the command is ready
+//
+// RETURNS         : one of:
+//                      WATCH_COMMAND_COMPLETED
+//                      WATCH_COMMAND_WAS_STOPPED
+//                      WATCH_COMMAND_RESTART
+//                      WATCH_COMMAND_IDLE
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+CmdRunner::WATCH_OUTCOMES CmdRunner::watchCommand
+(
+	bool reportRunning
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("watchCommand()")
+
+	// a pause ends with the command it paused
+	pauseCommand(false,0,0,0);
+
+	// start the watchdog and the health probes; without readiness probes,
+	// the command is ready as soon as it has started up
+	cmdRunnerData->watchdog.arm();
+	cmdRunnerData->healthProbes.start();
+	bool ready = !cmdRunnerData->healthProbes.hasProbes(HealthProbes::PROBE_READINESS);
+	if(ready) { cmdRunnerData->metrics.processReady(0); }
+	if(ready&&reportRunning)
+	{
+		notifyStatus(ScmConnector::STATUS_RUNNING);
+	}
+
+	// on demand, look for activity every so often
+	Timer     idleCheck;
+	ULONGLONG activeTime = GetTickCount64();
+	if(cmdRunnerData->onDemand&&(cmdRunnerData->idleTimeout > 0)&&reportRunning)
+	{
+		commandIsActive();
+		cmdRunnerData->timers.schedule(idleCheck,IDLE_CHECK_MS,IDLE_CHECK_SLACK);
+	}
+
+	// sample what the command uses
+	ResourceSampler &sampler = cmdRunnerData->sampler;
+	Timer            sampleTimer;
+	DWORD            sampleMs = (DWORD)sampler.getInterval()*1000;
+	if(sampler.isEnabled())
+	{
+		sampler.sample(&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1);
+		cmdRunnerData->timers.schedule(sampleTimer,sampleMs,sampleMs/DELAY_SLACK_FRACTION);
+	}
+
+	// pause the command while the host is under pressure (and stop the
+	// watchdog and the probes, which it cannot answer while it is paused)
+	LoadShedder &shedder = cmdRunnerData->shedder;
+	Timer        shedTimer;
+	if(shedder.isEnabled())
+	{
+		shedder.check(&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1);
+		if(shedder.isPaused()) { stopMonitoring(); }
+		cmdRunnerData->timers.schedule(shedTimer,SHED_CHECK_MS,SHED_CHECK_MS/DELAY_SLACK_FRACTION);
+	}
+
+	// look for process starts refused at the process limit
+	Timer limitTimer;
+	if(cmdRunnerData->limits.getProcessCount() > 0)
+	{
+		cmdRunnerData->timers.schedule(limitTimer,LIMIT_CHECK_MS,LIMIT_CHECK_MS/DELAY_SLACK_FRACTION);
+	}
+
+	while(true)
+	{
+		// wait for the command to complete, for a control command, for the
+		// watchdog (a keepalive message, or the deadline), for a probe, for
+		// the idle check, for pressure on the host, or for a scrape
+		HANDLE waitHandles[MAXIMUM_WAIT_OBJECTS];
+		DWORD  waitCount = 0;
+		waitHandles[waitCount++] = cmdRunnerData->hCommandProcess;
+		waitHandles[waitCount++] = cmdRunnerData->controlQueue.getEvent();
+		if(cmdRunnerData->watchdog.getEvent() != NULL)
+		{
+			waitHandles[waitCount++] = cmdRunnerData->watchdog.getEvent();
+		}
+		if(shedder.getEvent() != NULL)
+		{
+			waitHandles[waitCount++] = shedder.getEvent();
+		}
+		if(cmdRunnerData->metricsServer.getEvent() != NULL)
+		{
+			waitHandles[waitCount++] = cmdRunnerData->metricsServer.getEvent();
+		}
+		waitCount += cmdRunnerData->healthProbes.getWaitHandles(waitHandles+waitCount,
+																MAXIMUM_WAIT_OBJECTS-waitCount);
+
+		DWORD waitTime = cmdRunnerData->watchdog.getWaitTime();
+		if(cmdRunnerData->healthProbes.getWaitTime() < waitTime)
+		{
+			waitTime = cmdRunnerData->healthProbes.getWaitTime();
+		}
+		if(cmdRunnerData->timers.getWaitTime() < waitTime)
+		{
+			waitTime = cmdRunnerData->timers.getWaitTime();
+		}
+		if(cmdRunnerData->metricsServer.getWaitTime() < waitTime)
+		{
+			waitTime = cmdRunnerData->metricsServer.getWaitTime();
+		}
+
+		DWORD waitResult = WaitForMultipleObjects(waitCount,waitHandles,FALSE,waitTime);
+
+		if(waitResult == WAIT_OBJECT_0)
+		{
+			// process has exited
+			stopMonitoring();
+			ResourceLimits::BREACHES breach = cmdRunnerData->limits.takeBreach(cmdRunnerData->dwProcessId);
+			if(breach != ResourceLimits::BREACH_NONE)
+			{
+				LOGGER_LOG_ERROR1("watchCommand: process has finished after exceeding its %s limit",
+									ResourceLimits::getBreachName(breach))
+			}
+			else if(getProcessStatus(cmdRunnerData->hCommandProcess) == PROCESS_STATUS_EXIT_SUCCESS)
+			{
+				LOGGER_LOG_DEBUG("watchCommand: process has finished ok")
+			}
+			else
+			{
+				LOGGER_LOG_ERROR("watchCommand: process has finished with error")
+			}
+			DWORD exitCode = 0;
+			GetExitCodeProcess(cmdRunnerData->hCommandProcess,&exitCode);
+			cmdRunnerData->metrics.processExited(cmdRunnerData->dwProcessId,exitCode,
+													(breach != ResourceLimits::BREACH_NONE)||(exitCode != 0));
+			publishStatus();
+			SS_RETURN("watchCommand",WATCH_COMMAND_COMPLETED);
+		}
+
+		if(waitResult == WAIT_FAILED)
+		{
+			// failed to wait
+			LOGGER_LOG_ERROR1("watchCommand: failed to wait for process, error=%d",GetLastError())
+			stopMonitoring();
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","watchCommand")
+		}
+
+		// process is still running - act on the control commands
+		ControlCommand command;
+		while(cmdRunnerData->controlQueue.take(command))
+		{
+			switch(command.type)
+			{
+				case ControlCommand::CONTROL_STOP:
+					// notify STOPPING status to SCM
+					LOGGER_LOG_DEBUG("watchCommand: STOP received")
+					notifyStatus(ScmConnector::STATUS_STOPPING);
+
+					// kill the command
+					stopMonitoring();
+					killCommand(cmdRunnerData->killTimeout);
+
+					// command killed ok
+					LOGGER_LOG_DEBUG("command killed ok")
+					SS_RETURN("watchCommand",WATCH_COMMAND_WAS_STOPPED);
+
+				case ControlCommand::CONTROL_RELOAD:
+					if(cmdRunnerData->rollingRestart)
+					{
+						// replace the command alongside itself (running again,
+						// if it is paused, so that it can drain), then carry on
+						// watching whichever command is left running
+						LOGGER_LOG_DEBUG("watchCommand: RELOAD received - rolling restart")
+						if(pauseCommand(false,&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1)&&
+						   !shedder.isPaused())
+						{
+							cmdRunnerData->watchdog.arm();
+							cmdRunnerData->healthProbes.start(ready);
+						}
+						if(rollingRestart(ready) == ROLLOUT_STOPPED)
+						{
+							SS_RETURN("watchCommand",WATCH_COMMAND_WAS_STOPPED);
+						}
+						break;
+					}
+					// otherwise, as for a restart
+
+				case ControlCommand::CONTROL_RESTART:
+					// the command has no way of being told to reload, so restart it
+					LOGGER_LOG_DEBUG1("watchCommand: %s received - restarting command",
+						(command.type == ControlCommand::CONTROL_RESTART) ? "RESTART" : "RELOAD")
+					stopMonitoring();
+					killCommand(cmdRunnerData->killTimeout);
+					SS_RETURN("watchCommand",WATCH_COMMAND_RESTART);
+
+				case ControlCommand::CONTROL_PAUSE:
+				case ControlCommand::CONTROL_CONTINUE:
+					// pause the command, or let it run again (the watchdog and
+					// the probes are stopped while it is paused, as they are
+					// under pressure)
+					if(pauseCommand(command.type == ControlCommand::CONTROL_PAUSE,
+									&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1))
+					{
+						if(shedder.isPaused())
+						{
+							stopMonitoring();
+						}
+						else
+						{
+							cmdRunnerData->watchdog.arm();
+							cmdRunnerData->healthProbes.start(ready);
+						}
+					}
+					break;
+
+				default:
+					// user-defined codes have no meaning for a command
+					LOGGER_LOG_DEBUG2("watchCommand: ignoring control command %d (code %lu)",command.type,command.code)
+					break;
+			}
+		}
+
+		// has the command sent its keepalives?
+		if(!cmdRunnerData->watchdog.check())
+		{
+			// no - it is hung: stop it (forcing it if the shutdown method does
+			// not work within the kill timeout, or the watchdog interval if
+			// there is no kill timeout) and start it again
+			LOGGER_LOG_ERROR2("watchCommand: service '%s' has sent no keepalive for %d seconds - restarting it",
+								cmdRunnerData->srvName,cmdRunnerData->watchdog.getInterval())
+			int killTimeout = cmdRunnerData->watchdog.getInterval();
+			stopMonitoring();
+			killCommand((cmdRunnerData->killTimeout > 0) ? cmdRunnerData->killTimeout : killTimeout);
+			SS_RETURN("watchCommand",WATCH_COMMAND_RESTART);
+		}
+
+		// move the probes on
+		cmdRunnerData->healthProbes.run();
+		if(!cmdRunnerData->healthProbes.isLive())
+		{
+			// a liveness probe has failed too often - restart the command, in
+			// the same way as for the watchdog
+			LOGGER_LOG_ERROR1("watchCommand: service '%s' has failed its liveness probe - restarting it",
+								cmdRunnerData->srvName)
+			int killTimeout = cmdRunnerData->healthProbes.getInterval();
+			stopMonitoring();
+			killCommand((cmdRunnerData->killTimeout > 0) ? cmdRunnerData->killTimeout : killTimeout);
+			SS_RETURN("watchCommand",WATCH_COMMAND_RESTART);
+		}
+		if(cmdRunnerData->healthProbes.isReady() != ready)
+		{
+			// readiness has changed (the SCM has no way of being told that a
+			// running service is no longer ready, so that is only logged)
+			ready = !ready;
+			LOGGER_LOG_INFO2("service '%s' is %s",cmdRunnerData->srvName,ready ? "ready" : "not ready")
+			if(ready) { cmdRunnerData->metrics.processReady(0); }
+			if(ready&&reportRunning)
+			{
+				notifyStatus(ScmConnector::STATUS_RUNNING);
+			}
+		}
+
+		// has an on-demand command been idle for long enough to stop it?
+		cmdRunnerData->timers.run();
+		if(idleCheck.hasExpired())
+		{
+			ULONGLONG now = GetTickCount64();
+			if(shedder.isPaused()||commandIsActive())
+			{
+				activeTime = now;
+			}
+			else if(now-activeTime >= (ULONGLONG)cmdRunnerData->idleTimeout*1000)
+			{
+				LOGGER_LOG_INFO2("service '%s' has been idle for %d seconds - stopping its command until the next connection",
+									cmdRunnerData->srvName,cmdRunnerData->idleTimeout)
+				stopMonitoring();
+				killCommand(cmdRunnerData->killTimeout);
+				SS_RETURN("watchCommand",WATCH_COMMAND_IDLE);
+			}
+			cmdRunnerData->timers.schedule(idleCheck,IDLE_CHECK_MS,IDLE_CHECK_SLACK);
+		}
+
+		// is a sample due?
+		if(sampleTimer.hasExpired())
+		{
+			sampler.sample(&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1);
+			cmdRunnerData->timers.schedule(sampleTimer,sampleMs,sampleMs/DELAY_SLACK_FRACTION);
+
+			// has it stayed over its memory threshold? - recycle it, in the
+			// same way as for the watchdog
+			SIZE_T peak;
+			if(sampler.isOverThreshold(0,peak))
+			{
+				LOGGER_LOG_ERROR3("watchCommand: service '%s' has stayed over %d MB in memory (peak %lu MB) - recycling it",
+									cmdRunnerData->srvName,sampler.getMemoryThreshold(),(DWORD)(peak/(1024*1024)))
+				stopMonitoring();
+				killCommand((cmdRunnerData->killTimeout > 0) ? cmdRunnerData->killTimeout : sampler.getInterval());
+				SS_RETURN("watchCommand",WATCH_COMMAND_RESTART);
+			}
+		}
+
+		// has the pressure on the host come or gone?
+		if(shedTimer.hasExpired()||shedder.isDue())
+		{
+			if(shedder.check(&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1))
+			{
+				if(shedder.isPaused())
+				{
+					stopMonitoring();
+				}
+				else
+				{
+					cmdRunnerData->watchdog.arm();
+					cmdRunnerData->healthProbes.start(ready);
+				}
+			}
+			cmdRunnerData->timers.schedule(shedTimer,SHED_CHECK_MS,SHED_CHECK_MS/DELAY_SLACK_FRACTION);
+		}
+
+		// process starts refused at the process limit
+		if(limitTimer.hasExpired())
+		{
+			int refused = cmdRunnerData->limits.checkService();
+			if(refused > 0)
+			{
+				LOGGER_LOG_ERROR3("watchCommand: service '%s' was refused %d process starts at its limit of %d processes",
+									cmdRunnerData->srvName,refused,cmdRunnerData->limits.getProcessCount())
+			}
+			cmdRunnerData->timers.schedule(limitTimer,LIMIT_CHECK_MS,LIMIT_CHECK_MS/DELAY_SLACK_FRACTION);
+		}
+
+		// scrapes of the metrics
+		if(cmdRunnerData->metricsServer.isDue()) { serveMetrics(&cmdRunnerData->hCommandProcess,1); }
+	}
+
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::runReplicas
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : run the replicas of a service until it is stopped, or
+//                   they have all completed - each one which completes is
+//                   restarted on its own (if auto-restart is set), a
+//                   restart or reload request restarts them all, and the
+//                   autoscaler (if any) adds and removes replicas
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::runReplicas() throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("CmdRunner::runReplicas(%d)",cmdRunnerData->replicaCount)
+
+	// replicas are supervised by their process handles alone
+	if(cmdRunnerData->watchdog.isEnabled()||cmdRunnerData->healthProbes.hasProbes()||
+	   cmdRunnerData->rollingRestart||cmdRunnerData->onDemand)
+	{
+		LOGGER_LOG_ERROR1("service '%s' has replicas, which cannot have a watchdog, health probes, rolling restart or on-demand start",
+							cmdRunnerData->srvName)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"CmdRunner","runReplicas")
+	}
+	Autoscaler &autoscaler = cmdRunnerData->autoscaler;
+	autoscaler.validate(MAX_REPLICAS);
+
+	// a replica is running when its handle is not 0, and waiting to restart
+	// when it is restarting - the first count of them are in use
+	int    count = cmdRunnerData->replicaCount;
+	HANDLE processes[MAX_REPLICAS];
+	DWORD  processIds[MAX_REPLICAS];
+	bool   restarting[MAX_REPLICAS];
+	Timer  restartTimers[MAX_REPLICAS];
+	Timer  scaleTimer;
+	Timer  sampleTimer;
+	DWORD  sampleMs = (DWORD)cmdRunnerData->sampler.getInterval()*1000;
+	Timer  shedTimer;
+	Timer  limitTimer;
+	for(int i=0;i<MAX_REPLICAS;i++)
+	{
+		processes[i]  = 0;
+		processIds[i] = 0;
+		restarting[i] = false;
+	}
+	if(autoscaler.isEnabled())
+	{
+		count = autoscaler.getInitialCount(count);
+		LOGGER_LOG_INFO3("service '%s' is autoscaled, starting with %d of at most %d replicas",
+							cmdRunnerData->srvName,count,autoscaler.getMaximum())
+	}
+
+	bool stopped  = false;
+	bool startAll = true;
+	while(!stopped)
+	{
+		if(startAll)
+		{
+			// (re)start every replica, then wait for them to start up
+			for(int i=0;i<count;i++)
+			{
+				cmdRunnerData->timers.cancel(restartTimers[i]);
+				restarting[i] = false;
+				startProcess(i,processes[i],processIds[i]);
+				LOGGER_LOG_INFO3("service '%s' replica %d is process %lu",cmdRunnerData->srvName,i,processIds[i])
+			}
+			startAll = false;
+			if(!waitForStartup())
+			{
+				stopped = true;
+				break;
+			}
+			notifyStatus(ScmConnector::STATUS_RUNNING);
+			for(int i=0;i<count;i++) { cmdRunnerData->metrics.processReady(i); }
+			if(autoscaler.isEnabled())
+			{
+				DWORD intervalMs = (DWORD)autoscaler.getInterval()*1000;
+				cmdRunnerData->timers.schedule(scaleTimer,intervalMs,intervalMs/DELAY_SLACK_FRACTION);
+			}
+			if(cmdRunnerData->sampler.isEnabled())
+			{
+				cmdRunnerData->sampler.sample(processes,processIds,count);
+				cmdRunnerData->timers.schedule(sampleTimer,sampleMs,sampleMs/DELAY_SLACK_FRACTION);
+			}
+			if(cmdRunnerData->shedder.isEnabled())
+			{
+				cmdRunnerData->shedder.check(processes,processIds,count);
+				cmdRunnerData->timers.schedule(shedTimer,SHED_CHECK_MS,SHED_CHECK_MS/DELAY_SLACK_FRACTION);
+			}
+			if(cmdRunnerData->limits.getProcessCount() > 0)
+			{
+				cmdRunnerData->timers.schedule(limitTimer,LIMIT_CHECK_MS,LIMIT_CHECK_MS/DELAY_SLACK_FRACTION);
+			}
+		}
+
+		// wait for a replica to complete, for a control command, for a
+		// restart or a scaling decision to be due, or for a scrape (if there
+		// is room for it - otherwise scrapes are served at the next wakeup)
+		HANDLE waitHandles[MAX_REPLICAS+1];
+		DWORD  waitCount = 0;
+		bool   anyRestarting = false;
+		waitHandles[waitCount++] = cmdRunnerData->controlQueue.getEvent();
+		for(int i=0;i<count;i++)
+		{
+			if(processes[i] != 0) { waitHandles[waitCount++] = processes[i]; }
+			if(restarting[i]) { anyRestarting = true; }
+		}
+		if((waitCount == 1)&&!anyRestarting)
+		{
+			LOGGER_LOG_DEBUG("runReplicas: every replica has completed")
+			break;
+		}
+		if((cmdRunnerData->metricsServer.getEvent() != NULL)&&(waitCount < MAX_REPLICAS+1))
+		{
+			waitHandles[waitCount++] = cmdRunnerData->metricsServer.getEvent();
+		}
+
+		DWORD waitTime = cmdRunnerData->timers.getWaitTime();
+		if(cmdRunnerData->metricsServer.getWaitTime() < waitTime)
+		{
+			waitTime = cmdRunnerData->metricsServer.getWaitTime();
+		}
+
+		DWORD waitResult = WaitForMultipleObjects(waitCount,waitHandles,FALSE,waitTime);
+		if(waitResult == WAIT_FAILED)
+		{
+			LOGGER_LOG_ERROR1("runReplicas: failed to wait for replicas, error=%d",GetLastError())
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","runReplicas")
+		}
+
+		// replicas which have completed
+		for(int i=0;i<count;i++)
+		{
+			if((processes[i] == 0)||(getProcessStatus(processes[i]) == PROCESS_STATUS_STILL_RUNNING)) { continue; }
+
+			ResourceLimits::BREACHES breach = cmdRunnerData->limits.takeBreach(processIds[i]);
+			if(breach != ResourceLimits::BREACH_NONE)
+			{
+				LOGGER_LOG_ERROR3("service '%s' replica %d has completed after exceeding its %s limit",
+									cmdRunnerData->srvName,i,ResourceLimits::getBreachName(breach))
+			}
+			else
+			{
+				LOGGER_LOG_INFO2("service '%s' replica %d has completed",cmdRunnerData->srvName,i)
+			}
+			DWORD exitCode = 0;
+			GetExitCodeProcess(processes[i],&exitCode);
+			cmdRunnerData->metrics.processExited(processIds[i],exitCode,
+													(breach != ResourceLimits::BREACH_NONE)||(exitCode != 0));
+			publishStatus();
+			CloseHandle(processes[i]);
+			processes[i] = 0;
+			if(cmdRunnerData->autoRestart&&isRunning())
+			{
+				DWORD delayMs = (DWORD)cmdRunnerData->autoRestartInterval*1000;
+				cmdRunnerData->timers.schedule(restartTimers[i],delayMs,delayMs/DELAY_SLACK_FRACTION);
+				restarting[i] = true;
+			}
+		}
+
+		// control commands
+		ControlCommand command;
+		while(cmdRunnerData->controlQueue.take(command))
+		{
+			switch(command.type)
+			{
+				case ControlCommand::CONTROL_STOP:
+					LOGGER_LOG_DEBUG("runReplicas: STOP received")
+					stopped = true;
+					break;
+
+				case ControlCommand::CONTROL_RESTART:
+				case ControlCommand::CONTROL_RELOAD:
+					LOGGER_LOG_DEBUG("runReplicas: RESTART or RELOAD received - restarting every replica")
+					startAll = true;
+					break;
+
+				case ControlCommand::CONTROL_PAUSE:
+				case ControlCommand::CONTROL_CONTINUE:
+					// pause every replica, or let them run again (replicas
+					// restarted while they are paused are paused too)
+					pauseCommand(command.type == ControlCommand::CONTROL_PAUSE,processes,processIds,count);
+					cmdRunnerData->timers.schedule(shedTimer,SHED_CHECK_MS,SHED_CHECK_MS/DELAY_SLACK_FRACTION);
+					break;
+
+				default:
+					LOGGER_LOG_DEBUG2("runReplicas: ignoring control command %d (code %lu)",command.type,command.code)
+					break;
+			}
+		}
+		if(stopped) { break; }
+		if(startAll)
+		{
+			pauseCommand(false,processes,processIds,count);
+			stopReplicas(processes,processIds,count);
+			continue;
+		}
+
+		// restarts which are due
+		cmdRunnerData->timers.run();
+		for(int i=0;i<count;i++)
+		{
+			if(!restarting[i]||!restartTimers[i].hasExpired()) { continue; }
+			restarting[i] = false;
+			startProcess(i,processes[i],processIds[i]);
+			LOGGER_LOG_INFO3("service '%s' replica %d restarted as process %lu",cmdRunnerData->srvName,i,processIds[i])
+		}
+
+		// scaling
+		if(scaleTimer.hasExpired())
+		{
+			count = scaleReplicas(processes,processIds,restarting,restartTimers,count);
+			DWORD intervalMs = (DWORD)autoscaler.getInterval()*1000;
+			cmdRunnerData->timers.schedule(scaleTimer,intervalMs,intervalMs/DELAY_SLACK_FRACTION);
+		}
+
+		// sampling - a replica which has stayed over its memory threshold is
+		// recycled on its own
+		if(sampleTimer.hasExpired())
+		{
+			ResourceSampler &sampler = cmdRunnerData->sampler;
+			sampler.sample(processes,processIds,count);
+			cmdRunnerData->timers.schedule(sampleTimer,sampleMs,sampleMs/DELAY_SLACK_FRACTION);
+			for(int i=0;i<count;i++)
+			{
+				SIZE_T peak;
+				if((processes[i] == 0)||!sampler.isOverThreshold(i,peak)) { continue; }
+
+				LOGGER_LOG_ERROR3("service '%s' replica %d has stayed over its memory threshold (peak %lu MB) - recycling it",
+									cmdRunnerData->srvName,i,(DWORD)(peak/(1024*1024)))
+				int timeout = (cmdRunnerData->killTimeout > 0) ? cmdRunnerData->killTimeout : sampler.getInterval();
+				stopProcesses(&processes[i],&processIds[i],1,timeout);
+				CloseHandle(processes[i]);
+				processes[i] = 0;
+				startProcess(i,processes[i],processIds[i]);
+				LOGGER_LOG_INFO3("service '%s' replica %d recycled as process %lu",cmdRunnerData->srvName,i,processIds[i])
+			}
+		}
+
+		// pressure on the host, or a pause (replicas started while the
+		// others are paused are paused too)
+		if(shedTimer.hasExpired()&&(cmdRunnerData->shedder.isEnabled()||cmdRunnerData->shedder.isHeld()))
+		{
+			cmdRunnerData->shedder.check(processes,processIds,count);
+			cmdRunnerData->timers.schedule(shedTimer,SHED_CHECK_MS,SHED_CHECK_MS/DELAY_SLACK_FRACTION);
+		}
+
+		// process starts refused at the process limit
+		if(limitTimer.hasExpired())
+		{
+			int refused = cmdRunnerData->limits.checkService();
+			if(refused > 0)
+			{
+				LOGGER_LOG_ERROR3("service '%s' was refused %d process starts at its limit of %d processes",
+									cmdRunnerData->srvName,refused,cmdRunnerData->limits.getProcessCount())
+			}
+			cmdRunnerData->timers.schedule(limitTimer,LIMIT_CHECK_MS,LIMIT_CHECK_MS/DELAY_SLACK_FRACTION);
+		}
+
+		// scrapes of the metrics
+		if(cmdRunnerData->metricsServer.isDue()) { serveMetrics(processes,count); }
+	}
+
+	// stop whatever is still running
+	notifyStatus(ScmConnector::STATUS_STOPPING,true);
+	stopReplicas(processes,processIds,count);
+	notifyStatus(ScmConnector::STATUS_STOPPED);
+	SS_RETURNV("CmdRunner::runReplicas")
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::stopReplicas
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : stop the running replicas together
+//
+// ARGUMENTS       : processes  IN/OUT replica process handles (0 when not
+//                                     running, and set to 0)
+//                   processIds IN     replica process ids
+//                   count      IN     number of replicas
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::stopReplicas
+(
+	HANDLE processes[],
+	DWORD  processIds[],
+	int    count
+) throw (LiteSrvException)
+{
+	HANDLE running[MAX_REPLICAS];
+	DWORD  runningIds[MAX_REPLICAS];
+	int    runningCount = 0;
+	for(int i=0;i<count;i++)
+	{
+		if(processes[i] == 0) { continue; }
+		running[runningCount]    = processes[i];
+		runningIds[runningCount] = processIds[i];
+		runningCount++;
+	}
+	if(runningCount > 0) { stopProcesses(running,runningIds,runningCount,cmdRunnerData->killTimeout); }
+
+	for(int i=0;i<count;i++)
+	{
+		if(processes[i] == 0) { continue; }
+		CloseHandle(processes[i]);
+		processes[i] = 0;
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::scaleReplicas
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : let the autoscaler decide how many replicas there
+//                   should be, then start new ones, or stop the last ones
+//                   (giving each the drain timeout, if set, to finish its
+//                   work)
+//
+// ARGUMENTS       : processes     IN/OUT replica process handles
+//                   processIds    IN/OUT replica process ids
+//                   restarting    IN/OUT replicas waiting to restart
+//                   restartTimers IN/OUT their restart timers
+//                   count         IN     number of replicas
+//
+// RETURNS         : new number of replicas
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+int CmdRunner::scaleReplicas
+(
+	HANDLE  processes[],
+	DWORD   processIds[],
+	bool    restarting[],
+	Timer   restartTimers[],
+	int     count
+) throw (LiteSrvException)
+{
+	HANDLE running[MAX_REPLICAS];
+	int    runningCount = 0;
+	for(int i=0;i<count;i++)
+	{
+		if(processes[i] != 0) { running[runningCount++] = processes[i]; }
+	}
+
+	int desired = cmdRunnerData->autoscaler.decide(count,running,runningCount);
+
+	for(;count<desired;count++)
+	{
+		restarting[count] = false;
+		startProcess(count,processes[count],processIds[count]);
+		LOGGER_LOG_INFO3("service '%s' replica %d added as process %lu",cmdRunnerData->srvName,count,processIds[count])
+	}
+
+	int timeout = (cmdRunnerData->drainTimeout > 0) ? cmdRunnerData->drainTimeout : cmdRunnerData->killTimeout;
+	while(count > desired)
+	{
+		count--;
+		cmdRunnerData->timers.cancel(restartTimers[count]);
+		restarting[count] = false;
+		if(processes[count] == 0) { continue; }
+
+		LOGGER_LOG_INFO2("service '%s' replica %d is being removed",cmdRunnerData->srvName,count)
+		stopProcesses(&processes[count],&processIds[count],1,timeout);
+		CloseHandle(processes[count]);
+		processes[count] = 0;
+	}
+	SS_RETURN("CmdRunner::scaleReplicas",count)
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::stopMonitoring
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : stop the watchdog and the health probes (the command is
+//                   about to stop)
+//
+// ============================================================================
+void CmdRunner::stopMonitoring()
+{
+	cmdRunnerData->watchdog.disarm();
+	cmdRunnerData->healthProbes.stop();
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::commandIsActive
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : is the command doing anything - does it have connections
+//                   on the listening sockets, or has it used more than
+//                   1/IDLE_CPU_FRACTION of the time since it was last
+//                   checked on the CPU?
+//
+// ============================================================================
+bool CmdRunner::commandIsActive()
+{
+	int connections = cmdRunnerData->listenSockets.countConnections(cmdRunnerData->dwProcessId);
+
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if(!GetProcessTimes(cmdRunnerData->hCommandProcess,&creationTime,&exitTime,&kernelTime,&userTime))
+	{
+		LOGGER_LOG_ERROR1("failed to get command CPU time, error=%d",GetLastError())
+		return true;
+	}
+	ULONGLONG cpuTime = ((ULONGLONG)kernelTime.dwHighDateTime<<32)+kernelTime.dwLowDateTime+
+						((ULONGLONG)userTime.dwHighDateTime<<32)+userTime.dwLowDateTime;
+	ULONGLONG cpuUsed = cpuTime-cmdRunnerData->idleCpuTime;
+	cmdRunnerData->idleCpuTime = cpuTime;
+
+	// (CPU time is in 100ns units)
+	bool active = (connections > 0)||(cpuUsed > (ULONGLONG)IDLE_CHECK_MS*10000/IDLE_CPU_FRACTION);
+	LOGGER_LOG_DEBUG3("commandIsActive: %d connections, %llums CPU - %s",connections,cpuUsed/10000,active ? "active" : "idle")
+	return active;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::notifyStatus
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : notify a status to the SCM (if there is one), and
+//                   publish the status it is left in
+//
+// ARGUMENTS       : status       IN one of the ScmConnector::SCM_STATUSES
+//                   ignoreErrors IN as for ScmConnector::notifyScmStatus()
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::notifyStatus
+(
+	int  status,
+	bool ignoreErrors
+) throw (LiteSrvException)
+{
+	if(cmdRunnerData->scmConnector != 0)
+	{
+		cmdRunnerData->scmConnector->notifyScmStatus((ScmConnector::SCM_STATUSES)status,ignoreErrors);
+	}
+	publishStatus();
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::publishStatus
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : update the status page (if the service has one)
+//
+// ============================================================================
+void CmdRunner::publishStatus()
+{
+	if(!cmdRunnerData->statusPage.isOpen()) { return; }
+	cmdRunnerData->statusPage.update(getStatus(),cmdRunnerData->metrics);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::getStatus
+//                   CmdRunner::isRunning
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : the status of the service, as the SCM has it - a
+//                   command run from the console has no SCM, and is running
+//                   for as long as it is watched / is it running or paused?
+//
+// RETURNS         : one of the ScmConnector::SCM_STATUSES / true if running
+//
+// ============================================================================
+int CmdRunner::getStatus() const
+{
+	if(cmdRunnerData->scmConnector == 0) { return ScmConnector::STATUS_RUNNING; }
+	return cmdRunnerData->scmConnector->getScmStatus();
+}
+
+bool CmdRunner::isRunning() const
+{
+	int status = getStatus();
+	return (status == ScmConnector::STATUS_RUNNING)||(status == ScmConnector::STATUS_PAUSED);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::pauseCommand
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : pause the processes of the command at the SCM's request
+//                   (a pause control), or let them run again (a continue),
+//                   and notify the SCM
+//
+// ARGUMENTS       : pause      IN pause (true) or continue (false)
+//                   processes  IN process handles (0 = none in that slot)
+//                   processIds IN process ids
+//                   count      IN number of slots
+//
+// RETURNS         : true if the processes have just been paused or resumed
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+bool CmdRunner::pauseCommand
+(
+	bool         pause,
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+) throw (LiteSrvException)
+{
+	LoadShedder &shedder = cmdRunnerData->shedder;
+	if(pause == shedder.isHeld()) { return false; }
+
+	bool changed;
+	if(pause)
 	{
-		case HIGH_PRIORITY:
-			LOGGER_LOG_DEBUG("command will start at HIGH priority")
-			creationFlags = creationFlags | HIGH_PRIORITY_CLASS;
-			break;
-		case IDLE_PRIORITY:
-			LOGGER_LOG_DEBUG("command will start at IDLE priority")
-			creationFlags = creationFlags | IDLE_PRIORITY_CLASS;
-			break;
-		case REAL_PRIORITY:
-			LOGGER_LOG_DEBUG("command will start at REALTIME priority")
-			creationFlags = creationFlags | REALTIME_PRIORITY_CLASS;
-			break;
-		default:
-			LOGGER_LOG_DEBUG("command will start at NORMAL priority")
-			creationFlags = creationFlags | NORMAL_PRIORITY_CLASS;
-			break;
+		LOGGER_LOG_INFO1("service '%s' is paused",cmdRunnerData->srvName)
+		changed = shedder.hold(processes,processIds,count);
+		notifyStatus(ScmConnector::STATUS_PAUSED);
+	}
+	else
+	{
+		LOGGER_LOG_INFO1("service '%s' is continuing",cmdRunnerData->srvName)
+		changed = shedder.release(processes,processIds,count);
+		notifyStatus(ScmConnector::STATUS_RUNNING);
 	}
+	return changed;
+}
 
-	// command mode?
-	if(cmdRunnerData->startMode == COMMAND_MODE)
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::serveMetrics
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : serve the scrapes of the metrics which are waiting
+//
+// ARGUMENTS       : processes IN process handles (0 = none in that slot)
+//                   count     IN number of slots
+//
+// ============================================================================
+void CmdRunner::serveMetrics
+(
+	const HANDLE processes[],
+	int          count
+)
+{
+	cmdRunnerData->metricsServer.serve(cmdRunnerData->metrics,cmdRunnerData->srvName,
+										SCM_STATUS_NAMES,SCM_STATUS_COUNT,
+										getStatus(),processes,count);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::rollingRestart
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : start a new command alongside the running one (sharing
+//                   its listening sockets), and once the new command is
+//                   ready, stop the old one - allowing it the drain timeout
+//                   to finish its work before it is terminated.  If the new
+//                   command fails to become ready, it is stopped and the old
+//                   one carries on.
+//
+// ARGUMENTS       : ready IN the running command is ready
+//
+// RETURNS         : one of:
+//                      ROLLOUT_HANDED_OVER (the new command is now watched)
+//                      ROLLOUT_ABANDONED   (the old command is still watched)
+//                      ROLLOUT_STOPPED     (a stop was requested - both have
+//                                           been stopped)
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+CmdRunner::ROLLOUT_OUTCOMES CmdRunner::rollingRestart
+(
+	bool ready
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("CmdRunner::rollingRestart()")
+
+	// the old command is not watched while the new one starts
+	stopMonitoring();
+	HANDLE hOldProcess  = cmdRunnerData->hCommandProcess;
+	DWORD  oldProcessId = cmdRunnerData->dwProcessId;
+	HANDLE hNewProcess  = 0;
+	DWORD  newProcessId = 0;
+
+	LOGGER_LOG_INFO2("rolling restart of service '%s': starting a new command alongside process %lu",
+						cmdRunnerData->srvName,oldProcessId)
+	ROLLOUT_OUTCOMES outcome;
+	try
 	{
-		LOGGER_LOG_DEBUG("command will start in new console window")
-		creationFlags = creationFlags | CREATE_NEW_CONSOLE;
-		// new window name
-		LOGGER_LOG_DEBUG1("new window title is '%s'",cmdRunnerData->srvName)
-		startupInfo.lpTitle = cmdRunnerData->srvName;
-		// start new window minimised?
-		if(cmdRunnerData->startMinimised)
-		{
-			LOGGER_LOG_DEBUG("command will start in minimised window")
-			startupInfo.dwFlags = STARTF_USESHOWWINDOW;
-			startupInfo.wShowWindow = SW_MINIMIZE;
-		}
+		startCommand();
+		hNewProcess  = cmdRunnerData->hCommandProcess;
+		newProcessId = cmdRunnerData->dwProcessId;
+		outcome = waitForHandoff();
+	}
+	catch(...)
+	{
+		// the old command is still running - keep it
+		LOGGER_LOG_ERROR1("rolling restart of service '%s': failed to start the new command",
+							cmdRunnerData->srvName)
+		outcome = ROLLOUT_ABANDONED;
 	}
 
-	// start the process
-	createProcess(cmdRunnerData->startupCommand,false,cmdRunnerData->hCommandProcess,
-						&(cmdRunnerData->dwProcessId),0,cmdRunnerData->startupDirectory,
-						creationFlags,&startupInfo,cmdRunnerData->waitInterval);
+	// stop the command which is not wanted (killCommand works on the
+	// current process)
+	switch(outcome)
+	{
+		case ROLLOUT_HANDED_OVER:
+			LOGGER_LOG_INFO3("rolling restart of service '%s': process %lu is ready - draining process %lu",
+								cmdRunnerData->srvName,newProcessId,oldProcessId)
+			cmdRunnerData->hCommandProcess = hOldProcess;
+			cmdRunnerData->dwProcessId     = oldProcessId;
+			killCommand((cmdRunnerData->drainTimeout > 0) ? cmdRunnerData->drainTimeout : cmdRunnerData->killTimeout);
+			CloseHandle(hOldProcess);
+
+			cmdRunnerData->hCommandProcess = hNewProcess;
+			cmdRunnerData->dwProcessId     = newProcessId;
+			cmdRunnerData->watchdog.arm();
+			cmdRunnerData->healthProbes.start(true);
+			cmdRunnerData->metrics.processReady(0);
+			LOGGER_LOG_INFO1("rolling restart of service '%s' complete",cmdRunnerData->srvName)
+			break;
 
-	// return
-	SS_RETURNV("CmdRunner::startCommand()")
+		case ROLLOUT_ABANDONED:
+			LOGGER_LOG_ERROR2("rolling restart of service '%s' abandoned - process %lu carries on",
+								cmdRunnerData->srvName,oldProcessId)
+			if(hNewProcess != 0)
+			{
+				killCommand(cmdRunnerData->killTimeout);
+				CloseHandle(hNewProcess);
+			}
+			cmdRunnerData->hCommandProcess = hOldProcess;
+			cmdRunnerData->dwProcessId     = oldProcessId;
+			cmdRunnerData->watchdog.arm();
+			cmdRunnerData->healthProbes.start(ready);
+			break;
+
+		case ROLLOUT_STOPPED:
+			LOGGER_LOG_DEBUG("rollingRestart: STOP received - stopping both commands")
+			notifyStatus(ScmConnector::STATUS_STOPPING);
+			if(hNewProcess != 0)
+			{
+				killCommand(cmdRunnerData->killTimeout);
+				CloseHandle(hNewProcess);
+			}
+			cmdRunnerData->hCommandProcess = hOldProcess;
+			cmdRunnerData->dwProcessId     = oldProcessId;
+			killCommand(cmdRunnerData->killTimeout);
+			break;
+	}
 
+	SS_RETURN("CmdRunner::rollingRestart",outcome)
 }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : CmdRunner::waitForStartup
+// MEMBER FUNCTION : CmdRunner::waitForHandoff
 //
 // ACCESS SPECIFIER: private
 //
-// DESCRIPTION     : wait for command to finish starting up
+// DESCRIPTION     : wait for the new command of a rolling restart to be
+//                   ready - the wait command or startup delay, then (if
+//                   there are any) its readiness probes, which must pass
+//                   within the handoff timeout
+//
+// RETURNS         : one of:
+//                      ROLLOUT_HANDED_OVER (the new command is ready)
+//                      ROLLOUT_ABANDONED   (it exited, or was not ready in
+//                                           time)
+//                      ROLLOUT_STOPPED     (a stop was requested)
 //
 // THROWS          : LiteSrvException
 //
 // ============================================================================
-void CmdRunner::waitForStartup() throw (LiteSrvException)
+CmdRunner::ROLLOUT_OUTCOMES CmdRunner::waitForHandoff() throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG("CmdRunner::waitForStartup()")
+	LOGGER_LOG_DEBUG("CmdRunner::waitForHandoff()")
 
-	// what are we waiting for?
-	if(cmdRunnerData->waitCommand[0] != '\0')
+	// as for a first start
+	if(!waitForStartup())
 	{
-		// start wait command and wait for it to complete
-		LOGGER_LOG_INFO3(
-"%s is waiting for command '%s' to complete before reporting a 'running' status to the SCM for service '%s'",
-			getApplication(),cmdRunnerData->waitCommand,cmdRunnerData->srvName)
+		SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_STOPPED)
+	}
+	if(getProcessStatus(cmdRunnerData->hCommandProcess) != PROCESS_STATUS_STILL_RUNNING)
+	{
+		LOGGER_LOG_ERROR("waitForHandoff: new command exited during its startup")
+		SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_ABANDONED)
+	}
+	if(!cmdRunnerData->healthProbes.hasProbes(HealthProbes::PROBE_READINESS))
+	{
+		SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_HANDED_OVER)
+	}
 
-		// run wait command and wait for it to complete
-		HANDLE hWaitProcess;
-		createProcess(cmdRunnerData->waitCommand,true,hWaitProcess);
-		LOGGER_LOG_INFO2("wait command '%s' has now completed for service '%s'",
-					cmdRunnerData->waitCommand,cmdRunnerData->srvName)
-		SS_RETURNV("CmdRunner::waitForStartup")
+	// run the readiness probes until they pass, the command exits, or the
+	// handoff timeout expires
+	Timer deadline;
+	if(cmdRunnerData->handoffTimeout > 0)
+	{
+		cmdRunnerData->timers.schedule(deadline,(DWORD)cmdRunnerData->handoffTimeout*1000);
 	}
-	else
+	cmdRunnerData->healthProbes.start();
+	while(true)
 	{
-		if(cmdRunnerData->startupDelay>0)
+		HANDLE waitHandles[MAXIMUM_WAIT_OBJECTS];
+		DWORD  waitCount = 0;
+		waitHandles[waitCount++] = cmdRunnerData->hCommandProcess;
+		waitHandles[waitCount++] = cmdRunnerData->controlQueue.getEvent();
+		waitCount += cmdRunnerData->healthProbes.getWaitHandles(waitHandles+waitCount,
+																MAXIMUM_WAIT_OBJECTS-waitCount);
+
+		DWORD waitTime = cmdRunnerData->timers.getWaitTime();
+		if(cmdRunnerData->healthProbes.getWaitTime() < waitTime)
 		{
-			// wait for a specified time period
-			LOGGER_LOG_INFO3(
-	"%s is waiting %d seconds before reporting a 'running' status to the SCM for service '%s'",
-					getApplication(),cmdRunnerData->startupDelay,cmdRunnerData->srvName)
-			// sleep for specified time
-			Sleeper::Sleep(cmdRunnerData->startupDelay,"startup delay");
-			// we are ready to roll
-			LOGGER_LOG_INFO2("wait period %d has now completed for service '%s'",
-							cmdRunnerData->startupDelay,cmdRunnerData->srvName)
-			SS_RETURNV("CmdRunner::waitForStartup")
+			waitTime = cmdRunnerData->healthProbes.getWaitTime();
 		}
-		else
+
+		DWORD waitResult = WaitForMultipleObjects(waitCount,waitHandles,FALSE,waitTime);
+
+		if(waitResult == WAIT_OBJECT_0)
+		{
+			cmdRunnerData->healthProbes.stop();
+			LOGGER_LOG_ERROR("waitForHandoff: new command exited before it was ready")
+			SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_ABANDONED)
+		}
+
+		if(waitResult == WAIT_FAILED)
+		{
+			LOGGER_LOG_ERROR1("waitForHandoff: failed to wait for new command, error=%d",GetLastError())
+			cmdRunnerData->healthProbes.stop();
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","waitForHandoff")
+		}
+
+		// only a stop means anything while a rolling restart is under way
+		ControlCommand command;
+		while(cmdRunnerData->controlQueue.take(command))
 		{
-			SS_RETURNV("CmdRunner::waitForStartup")
+			if(command.type == ControlCommand::CONTROL_STOP)
+			{
+				cmdRunnerData->healthProbes.stop();
+				SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_STOPPED)
+			}
+			LOGGER_LOG_DEBUG2("waitForHandoff: ignoring control command %d (code %lu)",command.type,command.code)
+		}
+
+		cmdRunnerData->timers.run();
+		cmdRunnerData->healthProbes.run();
+		if(cmdRunnerData->healthProbes.isReady())
+		{
+			cmdRunnerData->healthProbes.stop();
+			SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_HANDED_OVER)
+		}
+		if(deadline.hasExpired())
+		{
+			cmdRunnerData->healthProbes.stop();
+			LOGGER_LOG_ERROR1("waitForHandoff: new command was not ready after %d seconds",
+								cmdRunnerData->handoffTimeout)
+			SS_RETURN("CmdRunner::waitForHandoff",ROLLOUT_ABANDONED)
 		}
 	}
 }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : CmdRunner::watchCommand
+// MEMBER FUNCTION : CmdRunner::delay
 //
 // ACCESS SPECIFIER: private
 //
-// DESCRIPTION     : watch command until it completes (it finishes on its own
-//                   or a STOP request is received)
+// DESCRIPTION     : wait, acting on control commands meanwhile - a stop
+//                   ends the wait at once, and a restart or reload cuts it
+//                   short
 //
-// RETURNS         : one of:
-//                      WATCH_COMMAND_COMPLETED
-//                      WATCH_COMMAND_WAS_STOPPED
-//                      WATCH_ERROR
+// ARGUMENTS       : delayMs IN delay
+//                   what    IN what the delay is for
+//
+// RETURNS         : false if a stop was requested
 //
 // THROWS          : LiteSrvException
 //
 // ============================================================================
-CmdRunner::WATCH_OUTCOMES CmdRunner::watchCommand() throw (LiteSrvException)
+bool CmdRunner::delay
+(
+	DWORD       delayMs,
+	const char *what
+) throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG("watchCommand()")
+	LOGGER_LOG_DEBUG2("waiting %lums for %s ...",delayMs,what)
 
-	// wait for command to complete
+	Timer timer;
+	cmdRunnerData->timers.schedule(timer,delayMs,delayMs/DELAY_SLACK_FRACTION);
 	while(true)
 	{
-		// sleep
-		Sleeper::Sleep(cmdRunnerData->waitInterval,"process to complete");
-
-		// get the current status of the command
-		switch(getProcessStatus(cmdRunnerData->hCommandProcess))
+		DWORD waitResult = WaitForSingleObject(cmdRunnerData->controlQueue.getEvent(),
+												cmdRunnerData->timers.getWaitTime());
+		if(waitResult == WAIT_FAILED)
 		{
-			case PROCESS_STATUS_STILL_RUNNING:
-				// process is still running - just continue
-				LOGGER_LOG_DEBUG("watchCommand: process still running - will wait again")
-				break;
-
-			case PROCESS_STATUS_EXIT_SUCCESS:
-				// process has exited successfully - return
-				LOGGER_LOG_DEBUG("watchCommand: process has finished ok")
-				SS_RETURN("watchCommand",WATCH_COMMAND_COMPLETED);
-				break;
+			LOGGER_LOG_ERROR2("failed to wait for %s, error=%d",what,GetLastError())
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"CmdRunner","delay")
+		}
 
-			case PROCESS_STATUS_EXIT_FAILURE:
-				// process has failed - return error
-				LOGGER_LOG_ERROR("watchCommand: process has finished with error")
-				SS_RETURN("watchCommand",WATCH_COMMAND_COMPLETED);
-				break;
+		cmdRunnerData->timers.run();
+		if(timer.hasExpired())
+		{
+			LOGGER_LOG_DEBUG1("... wait for %s complete",what)
+			SS_RETURN("CmdRunner::delay",true)
 		}
 
-		// process is still running - has a stop callback been invoked?
-		if(stopCallbackVar)
+		ControlCommand command;
+		while(cmdRunnerData->controlQueue.take(command))
 		{
-			LOGGER_LOG_DEBUG("watchCommand: STOP callback variable has been set")
-			// this next bit of code is just for illustration - it is not actually needed
-			if(WaitForSingleObject(stopCallbackEvent,0)==WAIT_OBJECT_0)
-			{
-				// this is as expected
-				LOGGER_LOG_DEBUG("watchCommand: STOP callback event has been signalled - OK")
-			}
-			else
+			switch(command.type)
 			{
-				// this is unexpected (but maybe we have got in just too quickly
-				LOGGER_LOG_DEBUG("watchCommand: STOP callback event has NOT been signalled - unexpected")
-			}
-
-			// notify STOPPING status to SCM
-			cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_STOPPING);
+				case ControlCommand::CONTROL_STOP:
+					LOGGER_LOG_DEBUG1("STOP received while waiting for %s",what)
+					SS_RETURN("CmdRunner::delay",false)
 
-			// kill the command
-			killCommand();
-
-			// command killed ok
-			LOGGER_LOG_DEBUG("command killed ok")
-			SS_RETURN("watchCommand",WATCH_COMMAND_WAS_STOPPED);
+				case ControlCommand::CONTROL_RESTART:
+				case ControlCommand::CONTROL_RELOAD:
+					LOGGER_LOG_DEBUG1("RESTART or RELOAD received - cutting short wait for %s",what)
+					SS_RETURN("CmdRunner::delay",true)
 
+				default:
+					LOGGER_LOG_DEBUG2("delay: ignoring control command %d (code %lu)",command.type,command.code)
+					break;
+			}
 		}
-
 	}
-
 }
 
 // ============================================================================
@@ -1141,79 +3024,164 @@ CmdRunner::WATCH_OUTCOMES CmdRunner::watchCommand() throw (LiteSrvException)
 //
 // DESCRIPTION     : stop the running command (service mode only)
 //
+// ARGUMENTS       : killTimeout IN if the shutdown method has not stopped the
+//                                  command after this many seconds, terminate
+//                                  it (0 = wait for ever)
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void CmdRunner::killCommand
+(
+	int killTimeout
+) throw (LiteSrvException)
+{
+	stopProcesses(&cmdRunnerData->hCommandProcess,&cmdRunnerData->dwProcessId,1,killTimeout);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CmdRunner::stopProcesses
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : stop instances of the command together, using the
+//                   shutdown method on each, then waiting for them all
+//
+// ARGUMENTS       : processes   IN process handles
+//                   processIds  IN process ids
+//                   count       IN number of processes (at most
+//                                  MAXIMUM_WAIT_OBJECTS)
+//                   killTimeout IN if the shutdown method has not stopped
+//                                  them after this many seconds, terminate
+//                                  them (0 = wait for ever)
+//
 // THROWS          : LiteSrvException
 //
 // ============================================================================
-void CmdRunner::killCommand() throw (LiteSrvException)
+void CmdRunner::stopProcesses
+(
+	HANDLE processes[],
+	DWORD  processIds[],
+	int    count,
+	int    killTimeout
+) throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG("CmdRunner::killCommand()")
+	LOGGER_LOG_DEBUG1("CmdRunner::stopProcesses(%d)",count)
+	ULONGLONG stopStart = GetTickCount64();
 
-	// notify the SCM that the service is stopping
-	cmdRunnerData->scmConnector->notifyScmStatus(ScmConnector::STATUS_STOPPING);
+	// a paused process cannot answer the shutdown method
+	cmdRunnerData->shedder.resume(processes,processIds,count);
 
-	// is the shutdown method 'command'?
-	if(cmdRunnerData->shutdownMethod==SHUTDOWN_BY_COMMAND)
+	for(int i=0;i<count;i++)
 	{
-		// is there a shutdown command?
-		if(cmdRunnerData->shutdownCommand[0] != '\0')
+		// is the shutdown method 'command'?
+		if(cmdRunnerData->shutdownMethod==SHUTDOWN_BY_COMMAND)
 		{
-			LOGGER_LOG_DEBUG1("using '%s' to shut down process",cmdRunnerData->shutdownCommand)
+			// is there a shutdown command?
+			if(cmdRunnerData->shutdownCommand[0] != '\0')
+			{
+				LOGGER_LOG_DEBUG1("using '%s' to shut down process",cmdRunnerData->shutdownCommand)
 
-			// run the shutdown command for this process and wait for it to complete
-			HANDLE hStopProcess;
-			createProcess(cmdRunnerData->shutdownCommand,true,hStopProcess);
+				// tell it which process (there can be more than one)
+				char processId[16];
+				sprintf(processId,"%lu",processIds[i]);
+				SetEnvironmentVariable(STOP_PID_NAME,processId);
+
+				// run the shutdown command for this process and wait for it to complete
+				HANDLE hStopProcess;
+				createProcess(cmdRunnerData->shutdownCommand,true,hStopProcess);
+			}
+			else
+			{
+				LOGGER_LOG_INFO("Shutdown method of 'command' was specified, but no command was specified.  Will use 'kill' instead.")
+				cmdRunnerData->shutdownMethod=SHUTDOWN_BY_KILL;
+			}
 		}
-		else
+
+		// is the shutdown method 'winmessage'?
+		if(cmdRunnerData->shutdownMethod==SHUTDOWN_BY_WINMESSAGE)
 		{
-			LOGGER_LOG_INFO("Shutdown method of 'command' was specified, but no command was specified.  Will use 'kill' instead.")
-			cmdRunnerData->shutdownMethod=SHUTDOWN_BY_KILL;
-		}
-	}
+			LOGGER_LOG_DEBUG("sending Windows message to shut down process")
 
-	// is the shutdown method 'winmessage'?
-	if(cmdRunnerData->shutdownMethod==SHUTDOWN_BY_WINMESSAGE)
-	{
-		LOGGER_LOG_DEBUG("sending Windows message to shut down process")
+			// find all Windows opened by the process
+			LOGGER_LOG_DEBUG("about to call EnumWindows()")
+			EnumWindows((WNDENUMPROC)sendCloseMessage,(LPARAM)processIds[i]);
+			LOGGER_LOG_DEBUG("call to EnumWindows() completed")
 
-		// find all Windows opened by the process
-		LOGGER_LOG_DEBUG("about to call EnumWindows()")
-		EnumWindows((WNDENUMPROC)sendCloseMessage,(LPARAM)cmdRunnerData->dwProcessId);
-		LOGGER_LOG_DEBUG("call to EnumWindows() completed")
+		}
 
+		// is the shutdown method 'kill'?
+		if(cmdRunnerData->shutdownMethod==SHUTDOWN_BY_KILL)
+		{
+			LOGGER_LOG_DEBUG("using TerminateProcess() to shut down process")
+			// use brute force to terminate the process we have started
+			// NB this "may leave DLLs in an unstable state" according to Microsoft ...
+			// (I haven't seen it myself yet)
+			if(!TerminateProcess(processes[i],0))
+			{
+				// failed to terminate process
+				// it may have already terminated, so just log a message
+				LOGGER_LOG_INFO1("failed to terminate process, error=%d (it may have already stopped)",
+						GetLastError())
+			}
+		}
 	}
 
-	// is the shutdown method 'kill'?
-	if(cmdRunnerData->shutdownMethod==SHUTDOWN_BY_KILL)
+	// whatever the shutdown method, wait for the processes to shut down
+	Timer escalateTimer;
+	Timer warningTimer;
+	bool  escalate = (killTimeout > 0)&&(cmdRunnerData->shutdownMethod != SHUTDOWN_BY_KILL);
+	int   shutdownMinutes = 0;
+	if(escalate) { cmdRunnerData->timers.schedule(escalateTimer,(DWORD)killTimeout*1000); }
+	cmdRunnerData->timers.schedule(warningTimer,SHUTDOWN_WARNING_MS,SHUTDOWN_WARNING_SLACK);
+	while(true)
 	{
-		LOGGER_LOG_DEBUG("using TerminateProcess() to shut down process")
-		// use brute force to terminate the process we have started
-		// NB this "may leave DLLs in an unstable state" according to Microsoft ...
-		// (I haven't seen it myself yet)
-		if(!TerminateProcess(cmdRunnerData->hCommandProcess,0))
+		bool stillRunning = false;
+		for(int i=0;(i<count)&&!stillRunning;i++)
 		{
-			// failed to terminate process
-			// it may have already terminated, so just log a message
-			LOGGER_LOG_INFO1("failed to terminate process, error=%d (it may have already stopped)",
-					GetLastError())
+			stillRunning = (getProcessStatus(processes[i])==PROCESS_STATUS_STILL_RUNNING);
 		}
-	}
+		if(!stillRunning) { break; }
 
-	// whatever the shutdown method, wait for the process to shut down
-	int shutdownCount = 0;
-	while(getProcessStatus(cmdRunnerData->hCommandProcess)==PROCESS_STATUS_STILL_RUNNING)
-	{
-		// sleep one second
-		Sleeper::Sleep(1,"process to complete");
-		if(((++shutdownCount)|60)==0)
+		// wait for the processes, or the next timer
+		WaitForMultipleObjects(count,processes,TRUE,cmdRunnerData->timers.getWaitTime());
+		cmdRunnerData->timers.run();
+		if(escalate&&escalateTimer.hasExpired())
+		{
+			// the shutdown method has not worked - escalate
+			LOGGER_LOG_INFO2("service '%s' has not stopped after %d seconds - terminating it",
+								cmdRunnerData->srvName,killTimeout)
+			for(int i=0;i<count;i++)
+			{
+				if(getProcessStatus(processes[i])!=PROCESS_STATUS_STILL_RUNNING) { continue; }
+				if(!TerminateProcess(processes[i],0))
+				{
+					LOGGER_LOG_INFO1("failed to terminate process, error=%d (it may have already stopped)",
+							GetLastError())
+				}
+			}
+			escalate = false;
+		}
+		if(warningTimer.hasExpired())
 		{
 			// log a warning message
 			LOGGER_LOG_INFO2("WARNING: service '%s' has been shutting down for %d minutes",
-								cmdRunnerData->srvName,shutdownCount/60)
+								cmdRunnerData->srvName,++shutdownMinutes)
+			cmdRunnerData->timers.schedule(warningTimer,SHUTDOWN_WARNING_MS,SHUTDOWN_WARNING_SLACK);
 		}
 	}
+	for(int i=0;i<count;i++)
+	{
+		DWORD exitCode = 0;
+		GetExitCodeProcess(processes[i],&exitCode);
+		cmdRunnerData->metrics.processExited(processIds[i],exitCode,false);
+	}
+	cmdRunnerData->metrics.processesStopped((DWORD)(GetTickCount64()-stopStart));
+	publishStatus();
 
 	// return
-	SS_RETURNV("CmdRunner::killCommand")
+	SS_RETURNV("CmdRunner::stopProcesses")
 }
 
 // ============================================================================
@@ -1238,6 +3206,11 @@ void CmdRunner::killCommand() throw (LiteSrvException)
 //                   startupInfo   IN  startup info (see help for Win32 CreateProcess)
 //                   waitInterval  IN  how often to poll the running process if
 //                                     wait is true
+//                   inheritHandles IN handles for the process to inherit (no
+//                                     others are inherited)
+//                   inheritCount  IN  number of inheritHandles
+//                   hThread       OUT handle to the main thread (may be
+//                                     NULL, when it is closed)
 //
 // THROWS          : LiteSrvException
 //
@@ -1252,7 +3225,10 @@ void createProcess
 	char        *cwd,
 	DWORD        creationFlags,
 	STARTUPINFO *startupInfo,
-	int          waitInterval
+	int          waitInterval,
+	HANDLE      *inheritHandles,
+	int          inheritCount,
+	HANDLE      *hThread
 ) throw (LiteSrvException)
 {
 	LOGGER_LOG_DEBUG1("createProcess '%s'",command)
@@ -1277,24 +3253,54 @@ void createProcess
 		startupInfo = &sin;
 	}
 
+	// limit inheritance to the given handles
+	STARTUPINFOEX startupInfoEx;
+	SIZE_T        attributeListSize = 0;
+	memset(&startupInfoEx,0,sizeof(startupInfoEx));
+	startupInfoEx.StartupInfo = *startupInfo;
+	if(inheritCount > 0)
+	{
+		InitializeProcThreadAttributeList(NULL,1,0,&attributeListSize);
+		startupInfoEx.lpAttributeList = (LPPROC_THREAD_ATTRIBUTE_LIST)HeapAlloc(GetProcessHeap(),0,attributeListSize);
+		if((startupInfoEx.lpAttributeList == NULL)||
+		   (!InitializeProcThreadAttributeList(startupInfoEx.lpAttributeList,1,0,&attributeListSize))||
+		   (!UpdateProcThreadAttribute(startupInfoEx.lpAttributeList,0,PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+						inheritHandles,inheritCount*sizeof(HANDLE),NULL,NULL)))
+		{
+			LOGGER_LOG_ERROR1("createProcess(): failed to set handles to inherit, error=%d",GetLastError())
+			if(startupInfoEx.lpAttributeList != NULL) { HeapFree(GetProcessHeap(),0,startupInfoEx.lpAttributeList); }
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_CREATE_PROCESS_FAILED,"","createProcess")
+		}
+		startupInfoEx.StartupInfo.cb = sizeof(startupInfoEx);
+		creationFlags |= EXTENDED_STARTUPINFO_PRESENT;
+	}
+
 	// start the process
 	LOGGER_LOG_DEBUG1("about to start process with command '%s'",command)
 	PROCESS_INFORMATION startedProcessInfo;
-	if(CreateProcess(
+	BOOL created = CreateProcess(
 			NULL,
 			command,				// command to run
 			&processAttributes,		// process security attributes
 			&threadAttributes,		// main thread security attributes
-			FALSE,					// do not inherit handles
+			inheritCount > 0,		// inherit the given handles only
 			creationFlags,			// creation flags
 			env,					// environment
 			cwd,					// current directory
-			startupInfo,			// startup info
-			&startedProcessInfo)	// returned process info
-			)
+			&startupInfoEx.StartupInfo,	// startup info
+			&startedProcessInfo);	// returned process info
+	if(startupInfoEx.lpAttributeList != NULL)
+	{
+		DeleteProcThreadAttributeList(startupInfoEx.lpAttributeList);
+		HeapFree(GetProcessHeap(),0,startupInfoEx.lpAttributeList);
+	}
+	if(created)
 	{
 		hProcess = startedProcessInfo.hProcess;
 		if(processId!=0) { (*processId) = startedProcessInfo.dwProcessId; }
+		if(hThread!=0) { (*hThread) = startedProcessInfo.hThread; }
+		else { CloseHandle(startedProcessInfo.hThread); }
 		LOGGER_LOG_DEBUG1("process started, id = %d",startedProcessInfo.dwProcessId)
 	}
 	else
@@ -1337,8 +3343,8 @@ void waitForProcessToComplete
 	// wait for command to complete
 	while(true)
 	{
-		// sleep
-		Sleeper::Sleep(waitInterval,"process to complete");
+		// wait for the process to finish, for up to the poll interval
+		WaitForSingleObject(hProcess,1000*waitInterval);
 
 		// get the current status of the command
 		switch(getProcessStatus(hProcess))
@@ -1458,3 +3464,60 @@ BOOL CALLBACK sendCloseMessage
 	return TRUE ;
 
 }
+
+// ============================================================================
+//
+// LOCAL FUNCTION  : expandInstance
+//
+// DESCRIPTION     : copy a string, putting an instance number in place of
+//                   each %INSTANCE% (which was left by the substitutions)
+//
+// ARGUMENTS       : ss       IN  string substituter to allocate with
+//                   expanded OUT copy (0 if str is 0)
+//                   str      IN  string
+//                   instance IN  instance number
+//
+// ============================================================================
+void expandInstance
+(
+	StringSubstituter  &ss,
+	char              *&expanded,
+	const char         *str,
+	int                 instance
+)
+{
+	if(str == 0) { return; }
+
+	char number[16];
+	sprintf(number,"%d",instance);
+
+	// room for every placeholder to be replaced
+	size_t      placeholderLength = strlen(INSTANCE_PLACEHOLDER);
+	int         placeholders = 0;
+	const char *inCh;
+	for(inCh=strstr(str,INSTANCE_PLACEHOLDER);inCh!=0;inCh=strstr(inCh+placeholderLength,INSTANCE_PLACEHOLDER))
+	{
+		placeholders++;
+	}
+	char *buf   = new char[strlen(str)+placeholders*strlen(number)+1];
+	char *outCh = buf;
+
+	inCh = str;
+	while(*inCh != '\0')
+	{
+		if(!strncmp(inCh,INSTANCE_PLACEHOLDER,placeholderLength))
+		{
+			strcpy(outCh,number);
+			outCh += strlen(number);
+			inCh  += placeholderLength;
+		}
+		else
+		{
+			(*outCh++) = (*inCh++);
+		}
+	}
+	(*outCh) = '\0';
+
+	ss.stringCopy(expanded,buf);
+	delete[] buf;
+}
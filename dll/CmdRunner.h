@@ -65,6 +65,9 @@ struct CmdRunnerData;
 // all the DLL classes are defined within the LiteSrv namespace
 namespace LiteSrv {
 
+// forward declarations
+class Timer;
+
 // ============================================================================
 //
 // CmdRunner class
@@ -75,8 +78,14 @@ class LiteSrv_DLL_API CmdRunner
 public:
 	// public types
 	typedef enum START_MODES { COMMAND_MODE, SERVICE_MODE, ANY_MODE,
-								INSTALL_MODE, INSTALL_DESKTOP_MODE, REMOVE_MODE };
-	typedef enum EXECUTION_PRIORITIES {HIGH_PRIORITY, IDLE_PRIORITY, NORMAL_PRIORITY, REAL_PRIORITY };
+								INSTALL_MODE, INSTALL_DESKTOP_MODE, REMOVE_MODE,
+								COMPILE_MODE, VALIDATE_MODE, STATUS_MODE };
+	typedef enum EXECUTION_PRIORITIES {HIGH_PRIORITY, IDLE_PRIORITY, NORMAL_PRIORITY, REAL_PRIORITY,
+										ABOVE_NORMAL_PRIORITY, BELOW_NORMAL_PRIORITY };
+	typedef enum SCHEDULING_POLICIES { NORMAL_SCHEDULING, BATCH_SCHEDULING };
+	typedef enum IO_PRIORITIES { INHERITED_IO_PRIORITY, VERY_LOW_IO_PRIORITY, LOW_IO_PRIORITY, NORMAL_IO_PRIORITY };
+	typedef enum MEMORY_PRIORITIES { INHERITED_MEMORY_PRIORITY, VERY_LOW_MEMORY_PRIORITY, LOW_MEMORY_PRIORITY,
+										MEDIUM_MEMORY_PRIORITY, BELOW_NORMAL_MEMORY_PRIORITY, NORMAL_MEMORY_PRIORITY };
 	typedef enum SHUTDOWN_METHODS { SHUTDOWN_BY_KILL, SHUTDOWN_BY_COMMAND, SHUTDOWN_BY_WINMESSAGE };
 
 	// start
@@ -107,6 +116,48 @@ public:
 	char *getStartupDirectory() const;
 	EXECUTION_PRIORITIES getExecutionPriority() const;
 
+	// placement (CPUs, efficiency mode for batch work, I/O and memory
+	// priority), applied before the command runs
+	void setCpuAffinity(const char *ca) throw (LiteSrvException);
+	void setSchedulingPolicy(SCHEDULING_POLICIES sp);
+	void setIoPriority(IO_PRIORITIES ip);
+	void setMemoryPriority(MEMORY_PRIORITIES mp);
+	const char *getCpuAffinity() const;
+	SCHEDULING_POLICIES getSchedulingPolicy() const;
+	IO_PRIORITIES getIoPriority() const;
+	MEMORY_PRIORITIES getMemoryPriority() const;
+
+	// resource limits (0 = none), on the command and every process it
+	// starts - memory in MB, CPU in percent of one CPU
+	void setMemoryLimit(int ml);
+	void setMemoryMax(int mm);
+	void setCpuQuota(int cq);
+	void setMaxProcesses(int mp);
+	int  getMemoryLimit() const;
+	int  getMemoryMax() const;
+	int  getCpuQuota() const;
+	int  getMaxProcesses() const;
+
+	// resource sampling interval (seconds, 0 = off), and the working set
+	// (MB, 0 = none) the command is recycled for staying over
+	void setSampleInterval(int si);
+	void setMaxRss(int mr);
+	void setMaxRssSamples(int ms);
+	int  getSampleInterval() const;
+	int  getMaxRss() const;
+	int  getMaxRssSamples() const;
+
+	// pressure a low priority command is paused for (CPUs busier than a
+	// percentage, 0 = never; memory running low)
+	void setShedCpu(int sc);
+	void setShedMemory(bool sm);
+	int  getShedCpu() const;
+	bool getShedMemory() const;
+
+	// address the metrics are served on ("tcp [address:]port" or "unix path")
+	void setMetricsAddress(const char *ma) throw (LiteSrvException);
+	const char *getMetricsAddress() const;
+
 	// environment
 	void addEnv(const char *nm,const char *val) throw (LiteSrvException);
 
@@ -122,6 +173,70 @@ public:
 	bool getAutoRestart() const;
 	int  getAutoRestartInterval() const;
 
+	// watchdog (restart a command which stops sending keepalives)
+	void setWatchdogInterval(int wi);
+	void setWatchdogFile(const char *wf) throw (LiteSrvException);
+	void setKillTimeout(int kt);
+	int  getWatchdogInterval() const;
+	const char *getWatchdogFile() const;
+	int  getKillTimeout() const;
+
+	// health probes (restart a command which fails its liveness probes;
+	// report RUNNING once it passes its readiness probes)
+	void addLivenessProbe(const char *spec) throw (LiteSrvException);
+	void addReadinessProbe(const char *spec) throw (LiteSrvException);
+	void setProbeInterval(int pi);
+	void setProbeTimeout(int pt);
+	void setProbeFailureThreshold(int pf);
+	int  getProbeInterval() const;
+	int  getProbeTimeout() const;
+	int  getProbeFailureThreshold() const;
+
+	// listening sockets, opened by LiteSrv and inherited by the command (so
+	// that connections are queued, not refused, while it restarts)
+	void addListenSocket(const char *spec) throw (LiteSrvException);
+
+	// rolling restart (on a reload, start the new command alongside the old
+	// one, and stop the old one once the new one is ready)
+	void setRollingRestart(bool rr);
+	void setHandoffTimeout(int ht);
+	void setDrainTimeout(int dt);
+	bool getRollingRestart() const;
+	int  getHandoffTimeout() const;
+	int  getDrainTimeout() const;
+
+	// on demand (service mode: start the command when the first connection
+	// arrives on a listening socket, and stop it when it has been idle)
+	void setOnDemand(bool od);
+	void setIdleTimeout(int it);
+	bool getOnDemand() const;
+	int  getIdleTimeout() const;
+
+	// replicas (service mode: run several instances of the command, each
+	// restarted on its own), and where their output goes
+	void setReplicas(int rc) throw (LiteSrvException);
+	void setReplicaCpus(int rc);
+	void setOutputFile(const char *of) throw (LiteSrvException);
+	int   getReplicas() const;
+	int   getReplicaCpus() const;
+	char *getOutputFile() const;
+
+	// autoscaling (service mode: vary the number of replicas between a
+	// minimum and a maximum with the load - see Autoscaler)
+	void setScaleMetric(const char *sm) throw (LiteSrvException);
+	void setMinReplicas(int mr);
+	void setMaxReplicas(int mr);
+	void setScaleUp(int su);
+	void setScaleDown(int sd);
+	void setScaleInterval(int si);
+	void setScaleCooldown(int sc);
+	int  getMinReplicas() const;
+	int  getMaxReplicas() const;
+	int  getScaleUp() const;
+	int  getScaleDown() const;
+	int  getScaleInterval() const;
+	int  getScaleCooldown() const;
+
 	// drive mappings
 	void mapLocalDrive(const char driveLetter,const char *drivePath) throw (LiteSrvException);
 	void mapNetworkDrive(const char driveLetter,const char *networkPath) throw (LiteSrvException);
@@ -130,30 +245,58 @@ public:
 	CmdRunner(START_MODES mode = COMMAND_MODE,char *nm = NULL) throw (LiteSrvException);
 	virtual ~CmdRunner();
 
-public:	// stop callbacks - provided for use by ScmConnector ONLY
-
-	// service stop callback variable
-	bool stopCallbackVar;
-
-	// service stop callback event
-	HANDLE stopCallbackEvent;
-
-	// service stop callback function
-	static void stopCallbackFunction(void *thisObject);
-
 private:	// member functions: internals
-	// start the command
+	// start the command, or one instance of it
 	void startCommand() throw (LiteSrvException);
+	void startProcess(int instance,HANDLE &hProcess,DWORD &processId) throw (LiteSrvException);
+
+	// run the replicas of the command
+	void runReplicas() throw (LiteSrvException);
+	void stopReplicas(HANDLE processes[],DWORD processIds[],int count) throw (LiteSrvException);
+	int  scaleReplicas(HANDLE processes[],DWORD processIds[],bool restarting[],Timer restartTimers[],int count)
+						throw (LiteSrvException);
 
 	// wait for command to start
-	void waitForStartup() throw (LiteSrvException);
+	bool waitForStartup() throw (LiteSrvException);
 
-	// watch command while it's running
-	typedef enum WATCH_OUTCOMES { WATCH_COMMAND_COMPLETED, WATCH_COMMAND_WAS_STOPPED };
-	WATCH_OUTCOMES watchCommand() throw (LiteSrvException);
+	// wait for a connection to start the command for (on demand)
+	bool waitForConnection() throw (LiteSrvException);
 
-	// kill the command
-	void killCommand() throw (LiteSrvException);
+	// watch command while it's running
+	typedef enum WATCH_OUTCOMES { WATCH_COMMAND_COMPLETED, WATCH_COMMAND_WAS_STOPPED, WATCH_COMMAND_RESTART,
+									WATCH_COMMAND_IDLE };
+	WATCH_OUTCOMES watchCommand(bool reportRunning) throw (LiteSrvException);
+	void stopMonitoring();
+	bool commandIsActive();
+
+	// serve the scrapes of the metrics
+	void serveMetrics(const HANDLE processes[],int count);
+
+	// notify the SCM of a status (one of the ScmConnector::SCM_STATUSES), and
+	// publish it on the status page
+	void notifyStatus(int status,bool ignoreErrors = false) throw (LiteSrvException);
+	void publishStatus();
+
+	// the status of the service (a command run from the console has no SCM),
+	// and is it running (paused or not)?
+	int  getStatus() const;
+	bool isRunning() const;
+
+	// pause the command at the SCM's request, or let it run again
+	bool pauseCommand(bool pause,const HANDLE processes[],const DWORD processIds[],int count)
+						throw (LiteSrvException);
+
+	// replace the command with a new one without a gap
+	typedef enum ROLLOUT_OUTCOMES { ROLLOUT_HANDED_OVER, ROLLOUT_ABANDONED, ROLLOUT_STOPPED };
+	ROLLOUT_OUTCOMES rollingRestart(bool ready) throw (LiteSrvException);
+	ROLLOUT_OUTCOMES waitForHandoff() throw (LiteSrvException);
+
+	// wait (control commands can end the wait)
+	bool delay(DWORD delayMs,const char *what) throw (LiteSrvException);
+
+	// kill the command, or instances of it
+	void killCommand(int killTimeout) throw (LiteSrvException);
+	void stopProcesses(HANDLE processes[],DWORD processIds[],int count,int killTimeout) throw (LiteSrvException);
 
 private:	// data members - hidden data
 	struct CmdRunnerData *cmdRunnerData;
@@ -0,0 +1,226 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#endif
+#include <new>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ControlQueue.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+//
+// a queued command - on the producers' list (newest first) until it is
+// taken, and then on the consumer's list (oldest first)
+//
+
+struct ControlQueue::ControlQueueNode
+{
+	ControlCommand    command;
+	ControlQueueNode *next;
+};
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ControlQueue::post
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : post a command and wake up the consumer
+//
+// ARGUMENTS       : type IN command
+//                   code IN SCM control code (CONTROL_CUSTOM only)
+//
+// RETURNS         : false if memory could not be allocated
+//
+// ============================================================================
+bool ControlQueue::post
+(
+	ControlCommand::CONTROL_TYPES type,
+	unsigned long                 code
+)
+{
+	LOGGER_LOG_DEBUG2("ControlQueue::post(%d,%lu)",type,code)
+
+	ControlQueueNode *node = new(std::nothrow) ControlQueueNode;
+	if(node == 0)
+	{
+		LOGGER_LOG_ERROR1("failed to allocate control command %d",type)
+		return false;
+	}
+
+	node->command.type = type;
+	node->command.code = code;
+	node->next         = posted.load(std::memory_order_relaxed);
+
+	while(!posted.compare_exchange_weak(node->next,node,std::memory_order_release,std::memory_order_relaxed)) {}
+#if defined(_WIN32)
+	SetEvent(hPostedEvent);
+#endif
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ControlQueue::take
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : take the oldest command (consumer thread only)
+//
+// ARGUMENTS       : command OUT command
+//
+// RETURNS         : false if there are no commands
+//
+// ============================================================================
+bool ControlQueue::take
+(
+	ControlCommand &command
+)
+{
+	if(taken == 0)
+	{
+		// take everything posted so far, and put it in posting order
+		ControlQueueNode *node = posted.exchange(0,std::memory_order_acquire);
+		while(node != 0)
+		{
+			ControlQueueNode *newer = node->next;
+			node->next = taken;
+			taken      = node;
+			node       = newer;
+		}
+	}
+
+	if(taken == 0) { return false; }
+
+	ControlQueueNode *node = taken;
+	taken   = node->next;
+	command = node->command;
+	delete node;
+
+	LOGGER_LOG_DEBUG2("ControlQueue::take() - %d,%lu",command.type,command.code)
+	return true;
+}
+
+#if defined(_WIN32)
+// ============================================================================
+//
+// MEMBER FUNCTION : ControlQueue::getEvent
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : auto-reset event signalled by post
+//
+// ============================================================================
+HANDLE ControlQueue::getEvent() const { return hPostedEvent; }
+#endif
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ControlQueue::ControlQueue
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+ControlQueue::ControlQueue() throw (LiteSrvException)
+	: posted(0)
+{
+	taken        = 0;
+#if defined(_WIN32)
+	hPostedEvent = CreateEvent(NULL,FALSE,FALSE,NULL);
+
+	if(hPostedEvent == NULL)
+	{
+		LOGGER_LOG_ERROR1("failed to create control queue, error=%d",GetLastError())
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"ControlQueue","ControlQueue")
+	}
+#endif
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ControlQueue::~ControlQueue
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : destructor - discard any commands not taken
+//
+// ============================================================================
+ControlQueue::~ControlQueue()
+{
+	freeList(taken);
+	freeList(posted.exchange(0));
+
+#if defined(_WIN32)
+	CloseHandle(hPostedEvent);
+#endif
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ControlQueue::freeList
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : free a list of commands
+//
+// ARGUMENTS       : node IN first node
+//
+// ============================================================================
+void ControlQueue::freeList
+(
+	ControlQueueNode *node
+)
+{
+	while(node != 0)
+	{
+		ControlQueueNode *next = node->next;
+		delete node;
+		node = next;
+	}
+}
+
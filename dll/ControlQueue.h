@@ -0,0 +1,154 @@
+
+// prevent multiple inclusion
+
+#if !defined(__CONTROL_QUEUE_H__)
+#define __CONTROL_QUEUE_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#if !defined(_WIN32)
+// there is no import or export outside Windows
+#define	LiteSrv_DLL_API
+
+#elif defined(LiteSrv_DLL_EXPORT)
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting ControlQueue")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("ControlQueue is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing ControlQueue")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#endif
+#include <atomic>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// user-defined SCM control code which restarts the command
+// (eg "sc control <service> 128")
+const unsigned long CONTROL_CODE_RESTART = 128;
+
+// ============================================================================
+//
+// ControlCommand - a request to the supervision loop
+//
+// ============================================================================
+struct ControlCommand
+{
+	enum CONTROL_TYPES { CONTROL_STOP, CONTROL_RESTART, CONTROL_RELOAD,
+						 CONTROL_PAUSE, CONTROL_CONTINUE, CONTROL_CUSTOM };
+
+	CONTROL_TYPES type;
+	unsigned long code;		// CONTROL_CUSTOM only: the SCM control code
+};
+
+// ============================================================================
+//
+// ControlQueue class
+//
+// A multi-producer, single-consumer queue of control commands. Any thread
+// (the SCM control handler, a console handler, ...) may post; only the
+// supervision loop takes.
+//
+// Posting is lock-free: commands are pushed onto an atomic singly linked
+// list, and the consumer takes the whole list at once and reverses it, so
+// commands are taken in the order they were posted. A push is a release and
+// the take an acquire, so everything a producer wrote before posting is
+// visible to the consumer once it has taken the command. On Windows, each
+// post also signals an auto-reset event, which the consumer can wait on
+// (together with other handles) to wake up at once.
+//
+// ============================================================================
+class LiteSrv_DLL_API ControlQueue
+{
+public:
+	// post a command (any thread)
+	// returns false if memory could not be allocated
+	bool post(ControlCommand::CONTROL_TYPES type,unsigned long code = 0);
+
+	// take the oldest command (consumer thread only)
+	// returns false if the queue is empty
+	bool take(ControlCommand &command);
+
+#if defined(_WIN32)
+	// signalled when a command is posted
+	HANDLE getEvent() const;
+#endif
+
+	// constructor and destructor
+	ControlQueue() throw (LiteSrvException);
+	virtual ~ControlQueue();
+
+private:
+	struct ControlQueueNode;
+
+	// service functions
+	static void freeList(ControlQueueNode *node);
+
+	// private variables
+	std::atomic<ControlQueueNode*> posted;	// pushed by producers (newest first)
+	ControlQueueNode              *taken;	// consumer's list (oldest first)
+#if defined(_WIN32)
+	HANDLE                         hPostedEvent;
+#endif
+
+	// prevent copying
+	ControlQueue(const ControlQueue&);
+	ControlQueue &operator=(const ControlQueue&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__CONTROL_QUEUE_H__)
+
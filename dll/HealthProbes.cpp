@@ -0,0 +1,828 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <winsock2.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "HealthProbes.h"
+#include "LiteSrvProbe.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int   PROBE_SPEC_SIZE              = 1024;
+const int   PROBE_PATH_SIZE              = 256;
+const int   PROBE_REQUEST_SIZE           = PROBE_PATH_SIZE+128;
+const int   PROBE_RESPONSE_SIZE          = 64;
+const int   DEFAULT_PROBE_INTERVAL       = 10;
+const int   DEFAULT_PROBE_TIMEOUT        = 2;
+const int   DEFAULT_PROBE_FAILURES       = 3;
+const int   DEFAULT_HTTP_STATUS          = 200;
+const char *PROBE_ROLE_NAMES[]           = { "liveness", "readiness" };
+const DWORD PLUGIN_UNLOAD_WAIT_MS        = 5000;
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+//
+// one probe, and the state of the check in progress
+//
+
+struct HealthProbes::HealthProbe
+{
+	typedef enum PROBE_TYPES { PROBE_EXEC, PROBE_TCP, PROBE_HTTP, PROBE_PLUGIN };
+
+	// definition
+	PROBE_ROLES    role;
+	PROBE_TYPES    type;
+	char           spec[PROBE_SPEC_SIZE];		// as given (for log messages)
+	char           command[PROBE_SPEC_SIZE];	// exec
+	unsigned short port;						// tcp, http
+	char           path[PROBE_PATH_SIZE];		// http
+	int            expectedStatus;				// http
+	HMODULE        hModule;						// plugin
+	LiteSrvProbeFunction function;				// plugin
+	char           argument[PROBE_SPEC_SIZE];	// plugin
+
+	// schedule
+	bool           inProgress;
+	ULONGLONG      nextRun;
+	ULONGLONG      deadline;
+
+	// check in progress
+	HANDLE         hProcess;					// exec
+	SOCKET         probeSocket;					// tcp, http
+	HANDLE         hNetworkEvent;				// tcp, http
+	char           response[PROBE_RESPONSE_SIZE];
+	int            received;
+	HANDLE         hCallDone;					// plugin: set while no call is running
+	int            callResult;					// plugin
+	char           callMessage[LITESRV_PROBE_MESSAGE_SIZE];
+
+	// results
+	int            failures;					// running
+	bool           passedSinceStart;
+};
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::addProbe
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : add a probe
+//
+// ARGUMENTS       : role IN liveness or readiness
+//                   spec IN "exec <command>", "tcp <port>",
+//                           "http <port>[/path] [status]" or
+//                           "plugin <dll>!<function> [argument]"
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void HealthProbes::addProbe
+(
+	PROBE_ROLES  role,
+	const char  *spec
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG2("HealthProbes::addProbe(%s,'%s')",PROBE_ROLE_NAMES[role],spec)
+
+#define	BAD_PROBE(reason) \
+	{ LOGGER_LOG_ERROR2("invalid health probe '%s': %s",spec,reason) \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_INVALID_PARAMETER,"HealthProbes","addProbe") }
+
+	if((spec == 0)||(strlen(spec) >= PROBE_SPEC_SIZE)) BAD_PROBE("too long")
+	if(numberOfProbes >= MAX_HEALTH_PROBES) BAD_PROBE("too many probes")
+
+	HealthProbe probe;
+	memset(&probe,0,sizeof(probe));
+	probe.role           = role;
+	probe.expectedStatus = DEFAULT_HTTP_STATUS;
+	probe.probeSocket    = INVALID_SOCKET;
+	strcpy(probe.spec,spec);
+
+	// type
+	const char *args = spec;
+	while(*args == ' ') { args++; }
+	if(!_strnicmp(args,"exec ",5))      { probe.type = HealthProbe::PROBE_EXEC; args += 5; }
+	else if(!_strnicmp(args,"tcp ",4))  { probe.type = HealthProbe::PROBE_TCP;  args += 4; }
+	else if(!_strnicmp(args,"http ",5)) { probe.type = HealthProbe::PROBE_HTTP; args += 5; }
+	else if(!_strnicmp(args,"plugin ",7)) { probe.type = HealthProbe::PROBE_PLUGIN; args += 7; }
+	else BAD_PROBE("expected exec, tcp, http or plugin")
+	while(*args == ' ') { args++; }
+
+	if(probe.type == HealthProbe::PROBE_EXEC)
+	{
+		if(*args == '\0') BAD_PROBE("no command")
+		strcpy(probe.command,args);
+	}
+	else if(probe.type == HealthProbe::PROBE_PLUGIN)
+	{
+		// <dll>!<function> (the dll path may contain spaces), then the argument
+		const char *separator = strchr(args,'!');
+		if((separator == 0)||(separator == args)) BAD_PROBE("expected <dll>!<function>")
+		const char *functionEnd = strchr(separator,' ');
+		size_t      length      = (functionEnd == 0) ? strlen(separator+1) : (size_t)(functionEnd-separator-1);
+		if(length == 0) BAD_PROBE("no function")
+
+		char module[PROBE_SPEC_SIZE];
+		char function[PROBE_SPEC_SIZE];
+		memcpy(module,args,separator-args);
+		module[separator-args] = '\0';
+		memcpy(function,separator+1,length);
+		function[length] = '\0';
+		if(functionEnd != 0)
+		{
+			while(*functionEnd == ' ') { functionEnd++; }
+			strcpy(probe.argument,functionEnd);
+		}
+
+		// load the plugin (LoadLibrary counts references, so each probe
+		// loads it for itself)
+		probe.hModule = LoadLibrary(module);
+		if(probe.hModule == NULL)
+		{
+			LOGGER_LOG_ERROR2("failed to load probe plugin '%s', error=%d",module,GetLastError())
+			BAD_PROBE("cannot load plugin")
+		}
+		LiteSrvProbeAbiVersionFunction abiVersion =
+			(LiteSrvProbeAbiVersionFunction)GetProcAddress(probe.hModule,LITESRV_PROBE_ABI_VERSION_FUNCTION);
+		if((abiVersion != NULL)&&((*abiVersion)() != LITESRV_PROBE_ABI_VERSION))
+		{
+			LOGGER_LOG_ERROR3("probe plugin '%s' has ABI version %d, expected %d",
+								module,(*abiVersion)(),LITESRV_PROBE_ABI_VERSION)
+			FreeLibrary(probe.hModule);
+			BAD_PROBE("wrong plugin ABI version")
+		}
+		probe.function = (LiteSrvProbeFunction)GetProcAddress(probe.hModule,function);
+		if(probe.function == NULL)
+		{
+			LOGGER_LOG_ERROR2("probe plugin '%s' has no function '%s'",module,function)
+			FreeLibrary(probe.hModule);
+			BAD_PROBE("no such function")
+		}
+
+		// no call is running
+		probe.hCallDone = CreateEvent(NULL,TRUE,TRUE,NULL);
+		if(probe.hCallDone == NULL)
+		{
+			LOGGER_LOG_ERROR1("failed to create probe event, error=%d",GetLastError())
+			FreeLibrary(probe.hModule);
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"HealthProbes","addProbe")
+		}
+	}
+	else
+	{
+		// port
+		char *end;
+		long  port = strtol(args,&end,10);
+		if((end == args)||(port < 1)||(port > 65535)) BAD_PROBE("invalid port")
+		probe.port = (unsigned short)port;
+		args = end;
+
+		if(probe.type == HealthProbe::PROBE_TCP)
+		{
+			if(*args != '\0') BAD_PROBE("unexpected text after port")
+		}
+		else
+		{
+			// path
+			const char *pathEnd = strchr(args,' ');
+			size_t      length  = (pathEnd == 0) ? strlen(args) : (size_t)(pathEnd-args);
+			if(length >= PROBE_PATH_SIZE) BAD_PROBE("path too long")
+			if(length == 0) { strcpy(probe.path,"/"); }
+			else
+			{
+				if(args[0] != '/') BAD_PROBE("path must start with /")
+				memcpy(probe.path,args,length);
+				probe.path[length] = '\0';
+			}
+
+			// status
+			if(pathEnd != 0)
+			{
+				probe.expectedStatus = (int)strtol(pathEnd,&end,10);
+				if((end == pathEnd)||(*end != '\0')||(probe.expectedStatus < 100)||(probe.expectedStatus > 599))
+					BAD_PROBE("invalid status")
+			}
+		}
+
+		// socket probes need Winsock, and an event for their network events
+		if(!winsockStarted)
+		{
+			WSADATA wsaData;
+			int     error = WSAStartup(MAKEWORD(2,2),&wsaData);
+			if(error != 0)
+			{
+				LOGGER_LOG_ERROR1("failed to start Winsock, error=%d",error)
+				THROW_LiteSrv_EXCEPTION
+					(LiteSrv_EXCEPTION_GENERAL_ERROR,"HealthProbes","addProbe")
+			}
+			winsockStarted = true;
+		}
+		probe.hNetworkEvent = WSACreateEvent();
+		if(probe.hNetworkEvent == WSA_INVALID_EVENT)
+		{
+			LOGGER_LOG_ERROR1("failed to create probe event, error=%d",WSAGetLastError())
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"HealthProbes","addProbe")
+		}
+	}
+
+#undef	BAD_PROBE
+
+	probes[numberOfProbes++] = new HealthProbe(probe);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::setInterval
+//                   HealthProbes::setTimeout
+//                   HealthProbes::setFailureThreshold
+//                   HealthProbes::getInterval
+//                   HealthProbes::getTimeout
+//                   HealthProbes::getFailureThreshold
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get schedule (seconds)
+//
+// ============================================================================
+void HealthProbes::setInterval(int in) { interval = (in > 0) ? in : 1; }
+void HealthProbes::setTimeout(int to) { timeout = (to > 0) ? to : 1; }
+void HealthProbes::setFailureThreshold(int ft) { failureThreshold = (ft > 0) ? ft : 1; }
+
+int HealthProbes::getInterval() const { return interval; }
+int HealthProbes::getTimeout() const { return timeout; }
+int HealthProbes::getFailureThreshold() const { return failureThreshold; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::hasProbes
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : are there any probes (of a given role)?
+//
+// ============================================================================
+bool HealthProbes::hasProbes() const { return numberOfProbes > 0; }
+
+bool HealthProbes::hasProbes
+(
+	PROBE_ROLES role
+) const
+{
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		if(probes[i]->role == role) { return true; }
+	}
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::start
+//                   HealthProbes::stop
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : start probing a newly started command (readiness probes
+//                   at once, liveness probes after one interval) / abandon
+//                   any probes in progress and stop
+//
+// ARGUMENTS       : ready IN the command has already passed its readiness
+//                            probes (carry on probing it after one interval)
+//
+// ============================================================================
+void HealthProbes::start
+(
+	bool ready
+)
+{
+	LOGGER_LOG_DEBUG("HealthProbes::start()")
+
+	stop();
+	ULONGLONG now = GetTickCount64();
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		HealthProbe &probe = *probes[i];
+		probe.failures         = 0;
+		probe.passedSinceStart = ready;
+		probe.nextRun          = ((probe.role == PROBE_READINESS)&&!ready) ? now : now+(ULONGLONG)interval*1000;
+	}
+	running = (numberOfProbes > 0);
+}
+
+void HealthProbes::stop()
+{
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		// abandon the check without counting it
+		if(probes[i]->inProgress) { finishProbe(*probes[i],false,0); }
+	}
+	running = false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::getWaitHandles
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : handles which are signalled when a probe in progress can
+//                   move on
+//
+// ARGUMENTS       : handles    OUT handles
+//                   maxHandles IN  size of handles
+//
+// RETURNS         : number of handles stored
+//
+// ============================================================================
+int HealthProbes::getWaitHandles
+(
+	HANDLE handles[],
+	int    maxHandles
+) const
+{
+	int count = 0;
+	for(int i=0;(i<numberOfProbes)&&(count<maxHandles);i++)
+	{
+		const HealthProbe &probe = *probes[i];
+		if(!probe.inProgress) { continue; }
+		handles[count++] = getWaitHandle(probe);
+	}
+	return count;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::getWaitTime
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : time until the next probe is due or times out
+//
+// ============================================================================
+DWORD HealthProbes::getWaitTime() const
+{
+	if(!running) { return INFINITE; }
+
+	ULONGLONG now  = GetTickCount64();
+	ULONGLONG next = (ULONGLONG)-1;
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		ULONGLONG due = probes[i]->inProgress ? probes[i]->deadline : probes[i]->nextRun;
+		if(due < next) { next = due; }
+	}
+	return (next <= now) ? 0 : (DWORD)(next-now);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::run
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : move each probe in progress on (or time it out), and
+//                   start any which are due
+//
+// ============================================================================
+void HealthProbes::run()
+{
+	if(!running) { return; }
+
+	ULONGLONG now = GetTickCount64();
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		HealthProbe &probe = *probes[i];
+
+		if(probe.inProgress)
+		{
+			if(WaitForSingleObject(getWaitHandle(probe),0) == WAIT_OBJECT_0) { continueProbe(probe); }
+			if(probe.inProgress&&(now >= probe.deadline)) { finishProbe(probe,false,"timed out"); }
+		}
+
+		if((!probe.inProgress)&&(now >= probe.nextRun)) { startProbe(probe,now); }
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::isLive
+//                   HealthProbes::isReady
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : is the command live (no liveness probe has reached the
+//                   failure threshold) / ready (every readiness probe has
+//                   passed, and none has reached the failure threshold)?
+//
+// ============================================================================
+bool HealthProbes::isLive() const
+{
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		const HealthProbe &probe = *probes[i];
+		if((probe.role == PROBE_LIVENESS)&&(probe.failures >= failureThreshold)) { return false; }
+	}
+	return true;
+}
+
+bool HealthProbes::isReady() const
+{
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		const HealthProbe &probe = *probes[i];
+		if(probe.role != PROBE_READINESS) { continue; }
+		if((!probe.passedSinceStart)||(probe.failures >= failureThreshold)) { return false; }
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::HealthProbes
+//                   HealthProbes::~HealthProbes
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+HealthProbes::HealthProbes()
+{
+	numberOfProbes   = 0;
+	interval         = DEFAULT_PROBE_INTERVAL;
+	timeout          = DEFAULT_PROBE_TIMEOUT;
+	failureThreshold = DEFAULT_PROBE_FAILURES;
+	running          = false;
+	winsockStarted   = false;
+}
+
+HealthProbes::~HealthProbes()
+{
+	stop();
+	for(int i=0;i<numberOfProbes;i++)
+	{
+		if(probes[i]->hNetworkEvent != 0) { WSACloseEvent(probes[i]->hNetworkEvent); }
+		if(probes[i]->hModule != NULL)
+		{
+			// a plugin call which has hung keeps its probe, and its plugin
+			if(WaitForSingleObject(probes[i]->hCallDone,PLUGIN_UNLOAD_WAIT_MS) != WAIT_OBJECT_0)
+			{
+				LOGGER_LOG_ERROR1("probe '%s' is still running - leaving its plugin loaded",probes[i]->spec)
+				continue;
+			}
+			CloseHandle(probes[i]->hCallDone);
+			FreeLibrary(probes[i]->hModule);
+		}
+		delete probes[i];
+	}
+	if(winsockStarted) { WSACleanup(); }
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::startProbe
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : start a check - run the command, or begin a non-blocking
+//                   connect to localhost
+//
+// ARGUMENTS       : probe IN/OUT probe
+//                   now   IN     GetTickCount64()
+//
+// ============================================================================
+void HealthProbes::startProbe
+(
+	HealthProbe &probe,
+	ULONGLONG    now
+)
+{
+	LOGGER_LOG_DEBUG2("starting %s probe '%s'",PROBE_ROLE_NAMES[probe.role],probe.spec)
+
+	probe.inProgress = true;
+	probe.nextRun    = now+(ULONGLONG)interval*1000;
+	probe.deadline   = now+(ULONGLONG)timeout*1000;
+	probe.received   = 0;
+
+	if(probe.type == HealthProbe::PROBE_EXEC)
+	{
+		STARTUPINFO         startupInfo;
+		PROCESS_INFORMATION processInfo;
+		char                command[PROBE_SPEC_SIZE];
+		memset(&startupInfo,0,sizeof(startupInfo));
+		startupInfo.cb = sizeof(startupInfo);
+		strcpy(command,probe.command);		// CreateProcess may modify it
+
+		if(!CreateProcess(NULL,command,NULL,NULL,FALSE,CREATE_NO_WINDOW,NULL,NULL,&startupInfo,&processInfo))
+		{
+			LOGGER_LOG_ERROR2("failed to run probe '%s', error=%d",probe.command,GetLastError())
+			finishProbe(probe,false,"cannot run command");
+			return;
+		}
+		CloseHandle(processInfo.hThread);
+		probe.hProcess = processInfo.hProcess;
+		return;
+	}
+
+	if(probe.type == HealthProbe::PROBE_PLUGIN)
+	{
+		// a call which timed out may still be running
+		if(WaitForSingleObject(probe.hCallDone,0) != WAIT_OBJECT_0)
+		{
+			finishProbe(probe,false,"previous call has not returned");
+			return;
+		}
+		ResetEvent(probe.hCallDone);
+		if(!QueueUserWorkItem(runPlugin,&probe,WT_EXECUTEDEFAULT))
+		{
+			LOGGER_LOG_ERROR2("failed to queue probe '%s', error=%d",probe.spec,GetLastError())
+			SetEvent(probe.hCallDone);
+			finishProbe(probe,false,"cannot queue call");
+		}
+		return;
+	}
+
+	// network events signal the probe's event, and make the socket non-blocking
+	probe.probeSocket = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+	if(probe.probeSocket == INVALID_SOCKET)
+	{
+		LOGGER_LOG_ERROR1("failed to create probe socket, error=%d",WSAGetLastError())
+		finishProbe(probe,false,"cannot create socket");
+		return;
+	}
+	WSAResetEvent(probe.hNetworkEvent);
+	if(WSAEventSelect(probe.probeSocket,probe.hNetworkEvent,FD_CONNECT|FD_READ|FD_CLOSE) != 0)
+	{
+		LOGGER_LOG_ERROR1("failed to select probe socket events, error=%d",WSAGetLastError())
+		finishProbe(probe,false,"cannot select socket events");
+		return;
+	}
+
+	sockaddr_in address;
+	memset(&address,0,sizeof(address));
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons(probe.port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if((connect(probe.probeSocket,(sockaddr*)&address,sizeof(address)) != 0)&&
+	   (WSAGetLastError() != WSAEWOULDBLOCK))
+	{
+		finishProbe(probe,false,"connection failed");
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::continueProbe
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : the probe's handle has been signalled - the command has
+//                   finished, or there are network events
+//
+// ARGUMENTS       : probe IN/OUT probe
+//
+// ============================================================================
+void HealthProbes::continueProbe
+(
+	HealthProbe &probe
+)
+{
+	if(probe.type == HealthProbe::PROBE_EXEC)
+	{
+		DWORD exitCode = 1;
+		GetExitCodeProcess(probe.hProcess,&exitCode);
+		finishProbe(probe,exitCode == 0,"command failed");
+		return;
+	}
+
+	if(probe.type == HealthProbe::PROBE_PLUGIN)
+	{
+		char reason[LITESRV_PROBE_MESSAGE_SIZE+32];
+		if(probe.callMessage[0] != '\0') { strcpy(reason,probe.callMessage); }
+		else                              { sprintf(reason,"returned %d",probe.callResult); }
+		finishProbe(probe,probe.callResult == LITESRV_PROBE_PASSED,reason);
+		return;
+	}
+
+	WSANETWORKEVENTS networkEvents;
+	if(WSAEnumNetworkEvents(probe.probeSocket,probe.hNetworkEvent,&networkEvents) != 0)
+	{
+		finishProbe(probe,false,"cannot get socket events");
+		return;
+	}
+
+	if(networkEvents.lNetworkEvents&FD_CONNECT)
+	{
+		if(networkEvents.iErrorCode[FD_CONNECT_BIT] != 0)
+		{
+			finishProbe(probe,false,"connection refused");
+			return;
+		}
+		if(probe.type == HealthProbe::PROBE_TCP)
+		{
+			finishProbe(probe,true,0);
+			return;
+		}
+
+		// the request is small enough for the socket buffer of a new connection
+		char request[PROBE_REQUEST_SIZE];
+		int  length = sprintf(request,"GET %s HTTP/1.1\r\nHost: localhost:%u\r\nConnection: close\r\n\r\n",
+							probe.path,probe.port);
+		if(send(probe.probeSocket,request,length,0) != length)
+		{
+			finishProbe(probe,false,"cannot send request");
+			return;
+		}
+	}
+
+	if(networkEvents.lNetworkEvents&(FD_READ|FD_CLOSE))
+	{
+		// read as far as the status line
+		while(probe.received < PROBE_RESPONSE_SIZE-1)
+		{
+			int length = recv(probe.probeSocket,probe.response+probe.received,
+								PROBE_RESPONSE_SIZE-1-probe.received,0);
+			if(length <= 0) { break; }
+			probe.received += length;
+		}
+		probe.response[probe.received] = '\0';
+
+		int status;
+		if((strchr(probe.response,'\n') != 0)||(probe.received == PROBE_RESPONSE_SIZE-1))
+		{
+			if(sscanf(probe.response,"HTTP/%*d.%*d %d",&status) != 1)
+			{
+				finishProbe(probe,false,"invalid response");
+			}
+			else if(status != probe.expectedStatus)
+			{
+				char reason[PROBE_RESPONSE_SIZE];
+				sprintf(reason,"status %d",status);
+				finishProbe(probe,false,reason);
+			}
+			else
+			{
+				finishProbe(probe,true,0);
+			}
+			return;
+		}
+
+		if(networkEvents.lNetworkEvents&FD_CLOSE)
+		{
+			finishProbe(probe,false,"connection closed");
+		}
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::finishProbe
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : end a check and record its result
+//
+// ARGUMENTS       : probe  IN/OUT probe
+//                   passed IN     result
+//                   reason IN     why it failed (0 if abandoned)
+//
+// ============================================================================
+void HealthProbes::finishProbe
+(
+	HealthProbe &probe,
+	bool         passed,
+	const char  *reason
+)
+{
+	// tidy up
+	if(probe.hProcess != 0)
+	{
+		if(WaitForSingleObject(probe.hProcess,0) != WAIT_OBJECT_0) { TerminateProcess(probe.hProcess,1); }
+		CloseHandle(probe.hProcess);
+		probe.hProcess = 0;
+	}
+	if(probe.probeSocket != INVALID_SOCKET)
+	{
+		closesocket(probe.probeSocket);
+		probe.probeSocket = INVALID_SOCKET;
+	}
+	probe.inProgress = false;
+
+	if(passed)
+	{
+		LOGGER_LOG_DEBUG2("%s probe '%s' passed",PROBE_ROLE_NAMES[probe.role],probe.spec)
+		probe.failures         = 0;
+		probe.passedSinceStart = true;
+		return;
+	}
+
+	if(reason == 0) { return; }
+	probe.failures++;
+	LOGGER_LOG_INFO3("%s probe '%s' failed: %s",PROBE_ROLE_NAMES[probe.role],probe.spec,reason)
+	if(probe.failures == failureThreshold)
+	{
+		LOGGER_LOG_ERROR3("%s probe '%s' has failed %d times running",
+							PROBE_ROLE_NAMES[probe.role],probe.spec,probe.failures)
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::getWaitHandle
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : handle which is signalled when a probe in progress can
+//                   move on
+//
+// ============================================================================
+HANDLE HealthProbes::getWaitHandle
+(
+	const HealthProbe &probe
+)
+{
+	switch(probe.type)
+	{
+		case HealthProbe::PROBE_EXEC:   return probe.hProcess;
+		case HealthProbe::PROBE_PLUGIN: return probe.hCallDone;
+		default:                        return probe.hNetworkEvent;
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : HealthProbes::runPlugin
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : call a plugin probe function (runs on a thread pool
+//                   thread)
+//
+// ARGUMENTS       : context IN probe
+//
+// RETURNS         : 0
+//
+// ============================================================================
+DWORD WINAPI HealthProbes::runPlugin
+(
+	LPVOID context
+)
+{
+	HealthProbe &probe = *(HealthProbe*)context;
+
+	probe.callMessage[0] = '\0';
+	probe.callResult     = (*probe.function)(probe.argument,probe.callMessage,LITESRV_PROBE_MESSAGE_SIZE);
+	probe.callMessage[LITESRV_PROBE_MESSAGE_SIZE-1] = '\0';
+
+	// hands the results back to the supervision loop
+	SetEvent(probe.hCallDone);
+	return 0;
+}
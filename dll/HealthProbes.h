@@ -0,0 +1,171 @@
+
+// prevent multiple inclusion
+
+#if !defined(__HEALTH_PROBES_H__)
+#define __HEALTH_PROBES_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting HealthProbes")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("HealthProbes is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing HealthProbes")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most probes per service
+const int MAX_HEALTH_PROBES = 16;
+
+// ============================================================================
+//
+// HealthProbes class
+//
+// The liveness and readiness probes of a service. Each probe is one of
+//   exec <command>               passes if the command exits with status 0
+//   tcp <port>                   passes if a connection to localhost:port
+//                                is accepted
+//   http <port>[/path] [status]  passes if GET /path on localhost:port
+//                                returns status (default 200)
+//   plugin <dll>!<function> [argument]
+//                                passes if the plugin function (see
+//                                LiteSrvProbe.h) returns LITESRV_PROBE_PASSED
+//
+// Probes are run by the supervision loop, not by threads of their own: a
+// probe in progress is a process, a non-blocking socket whose network
+// events signal an event, or a plugin call on a thread pool thread which
+// signals an event when it returns. The loop waits on getWaitHandles() (as well as
+// its own handles) with a timeout of getWaitTime(), and calls run()
+// whenever it wakes up; run() moves each probe on, and starts any that
+// are due.
+//
+// A liveness probe fails the service once it has failed failureThreshold
+// times running. The service is ready once every readiness probe has
+// passed, and stops being ready when one has failed failureThreshold
+// times running.
+//
+// ============================================================================
+class LiteSrv_DLL_API HealthProbes
+{
+public:
+	typedef enum PROBE_ROLES { PROBE_LIVENESS, PROBE_READINESS };
+
+	// add a probe (see above for the syntax of spec)
+	void addProbe(PROBE_ROLES role,const char *spec) throw (LiteSrvException);
+
+	// schedule (seconds, apply to every probe)
+	void setInterval(int in);
+	void setTimeout(int to);
+	void setFailureThreshold(int ft);
+	int  getInterval() const;
+	int  getTimeout() const;
+	int  getFailureThreshold() const;
+
+	// are there any probes (of a role)?
+	bool hasProbes() const;
+	bool hasProbes(PROBE_ROLES role) const;
+
+	// start probing a newly started command (or one known to be ready,
+	// which is handed over from a rolling restart) / stop probing it
+	void start(bool ready = false);
+	void stop();
+
+	// handles of the probes in progress; returns how many were stored
+	int getWaitHandles(HANDLE handles[],int maxHandles) const;
+
+	// milliseconds until run() must next be called (INFINITE if stopped)
+	DWORD getWaitTime() const;
+
+	// move the probes on
+	void run();
+
+	// results
+	bool isLive() const;
+	bool isReady() const;
+
+	// constructor and destructor
+	HealthProbes();
+	virtual ~HealthProbes();
+
+private:
+	struct HealthProbe;
+
+	// service functions
+	void startProbe(HealthProbe &probe,ULONGLONG now);
+	void continueProbe(HealthProbe &probe);
+	void finishProbe(HealthProbe &probe,bool passed,const char *reason);
+	static HANDLE getWaitHandle(const HealthProbe &probe);
+	static DWORD WINAPI runPlugin(LPVOID context);
+
+	// private variables
+	HealthProbe *probes[MAX_HEALTH_PROBES];
+	int          numberOfProbes;
+	int          interval;			// seconds
+	int          timeout;			// seconds
+	int          failureThreshold;
+	bool         running;
+	bool         winsockStarted;
+
+	// prevent copying
+	HealthProbes(const HealthProbes&);
+	HealthProbes &operator=(const HealthProbes&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__HEALTH_PROBES_H__)
+
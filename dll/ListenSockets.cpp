@@ -0,0 +1,491 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#include <iphlpapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ListenSockets.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int   LISTEN_SPEC_SIZE         = 256;
+const int   LISTEN_PATH_SIZE         = sizeof(((sockaddr_un*)0)->sun_path);
+const char *LISTEN_FDS_NAME          = "LISTEN_FDS";
+const char *LISTEN_FDNAMES_NAME      = "LISTEN_FDNAMES";
+const char *LISTEN_SOCKETS_NAME      = "LISTEN_SOCKETS";
+const char *DEFAULT_LISTEN_NAME      = "unknown";
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+//
+// one socket
+//
+
+struct ListenSockets::ListenSocket
+{
+	typedef enum SOCKET_TYPES { SOCKET_TCP, SOCKET_UNIX };
+
+	// definition
+	SOCKET_TYPES   type;
+	char           spec[LISTEN_SPEC_SIZE];		// as given (for log messages)
+	char           name[LISTEN_SPEC_SIZE];
+	in_addr        address;						// tcp
+	unsigned short port;						// tcp
+	char           path[LISTEN_PATH_SIZE];		// unix
+
+	// socket (INVALID_SOCKET until opened)
+	SOCKET         listenSocket;
+};
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::addSocket
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : add a socket
+//
+// ARGUMENTS       : spec IN "[name=]tcp [address:]port" or
+//                           "[name=]unix path"
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ListenSockets::addSocket
+(
+	const char *spec
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("ListenSockets::addSocket('%s')",spec)
+
+#define	BAD_SOCKET(reason) \
+	{ LOGGER_LOG_ERROR2("invalid listening socket '%s': %s",spec,reason) \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_INVALID_PARAMETER,"ListenSockets","addSocket") }
+
+	if((spec == 0)||(strlen(spec) >= LISTEN_SPEC_SIZE)) BAD_SOCKET("too long")
+	if(numberOfSockets >= MAX_LISTEN_SOCKETS) BAD_SOCKET("too many sockets")
+
+	ListenSocket listenSocket;
+	memset(&listenSocket,0,sizeof(listenSocket));
+	listenSocket.listenSocket = INVALID_SOCKET;
+	strcpy(listenSocket.spec,spec);
+	strcpy(listenSocket.name,DEFAULT_LISTEN_NAME);
+
+	// name
+	const char *args   = spec;
+	while(*args == ' ') { args++; }
+	const char *equals = strchr(args,'=');
+	const char *space  = strchr(args,' ');
+	if((equals != 0)&&((space == 0)||(equals < space)))
+	{
+		if((equals == args)||(memchr(args,':',equals-args) != 0)) BAD_SOCKET("invalid name")
+		memcpy(listenSocket.name,args,equals-args);
+		listenSocket.name[equals-args] = '\0';
+		args = equals+1;
+	}
+
+	// type
+	if(!_strnicmp(args,"tcp ",4))       { listenSocket.type = ListenSocket::SOCKET_TCP;  args += 4; }
+	else if(!_strnicmp(args,"unix ",5)) { listenSocket.type = ListenSocket::SOCKET_UNIX; args += 5; }
+	else BAD_SOCKET("expected tcp or unix")
+	while(*args == ' ') { args++; }
+
+	if(listenSocket.type == ListenSocket::SOCKET_TCP)
+	{
+		// address
+		listenSocket.address.s_addr = htonl(INADDR_ANY);
+		const char *colon = strchr(args,':');
+		if(colon != 0)
+		{
+			char address[LISTEN_SPEC_SIZE];
+			memcpy(address,args,colon-args);
+			address[colon-args] = '\0';
+			if(inet_pton(AF_INET,address,&listenSocket.address) != 1) BAD_SOCKET("invalid address")
+			args = colon+1;
+		}
+
+		// port
+		char *end;
+		long  port = strtol(args,&end,10);
+		if((end == args)||(*end != '\0')||(port < 1)||(port > 65535)) BAD_SOCKET("invalid port")
+		listenSocket.port = (unsigned short)port;
+	}
+	else
+	{
+		if(*args == '\0') BAD_SOCKET("no path")
+		if(strlen(args) >= LISTEN_PATH_SIZE) BAD_SOCKET("path too long")
+		strcpy(listenSocket.path,args);
+	}
+
+#undef	BAD_SOCKET
+
+	sockets[numberOfSockets++] = new ListenSocket(listenSocket);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::hasSockets
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : are there any sockets?
+//
+// ============================================================================
+bool ListenSockets::hasSockets() const { return numberOfSockets > 0; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::open
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : open the sockets which are not open yet (they then stay
+//                   open until LiteSrv exits)
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ListenSockets::open() throw (LiteSrvException)
+{
+	if(numberOfSockets == 0) { return; }
+
+	if(!winsockStarted)
+	{
+		WSADATA wsaData;
+		int     error = WSAStartup(MAKEWORD(2,2),&wsaData);
+		if(error != 0)
+		{
+			LOGGER_LOG_ERROR1("failed to start Winsock, error=%d",error)
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"ListenSockets","open")
+		}
+		winsockStarted = true;
+	}
+
+	for(int i=0;i<numberOfSockets;i++)
+	{
+		if(sockets[i]->listenSocket == INVALID_SOCKET) { openSocket(*sockets[i]); }
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::setEnvironment
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set %LISTEN_FDS%, %LISTEN_FDNAMES% and %LISTEN_SOCKETS%
+//
+// ============================================================================
+void ListenSockets::setEnvironment() const
+{
+	if(numberOfSockets == 0) { return; }
+
+	char count[16];
+	char names[MAX_LISTEN_SOCKETS*LISTEN_SPEC_SIZE];
+	char values[MAX_LISTEN_SOCKETS*24];
+	sprintf(count,"%d",numberOfSockets);
+	names[0]  = '\0';
+	values[0] = '\0';
+	for(int i=0;i<numberOfSockets;i++)
+	{
+		if(i > 0) { strcat(names,":"); }
+		strcat(names,sockets[i]->name);
+		sprintf(values+strlen(values),(i > 0) ? " %llu" : "%llu",(unsigned long long)sockets[i]->listenSocket);
+	}
+
+	LOGGER_LOG_DEBUG3("listening sockets: %s (%s) = %s",count,names,values)
+	SetEnvironmentVariable(LISTEN_FDS_NAME,count);
+	SetEnvironmentVariable(LISTEN_FDNAMES_NAME,names);
+	SetEnvironmentVariable(LISTEN_SOCKETS_NAME,values);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::getHandles
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : handles of the open sockets
+//
+// ARGUMENTS       : handles    OUT handles
+//                   maxHandles IN  size of handles
+//
+// RETURNS         : number of handles stored
+//
+// ============================================================================
+int ListenSockets::getHandles
+(
+	HANDLE handles[],
+	int    maxHandles
+) const
+{
+	int count = 0;
+	for(int i=0;(i<numberOfSockets)&&(count<maxHandles);i++)
+	{
+		if(sockets[i]->listenSocket != INVALID_SOCKET) { handles[count++] = (HANDLE)sockets[i]->listenSocket; }
+	}
+	return count;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::watchConnections
+//                   ListenSockets::unwatchConnections
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : signal an event when a connection is waiting on any of
+//                   the open sockets (it is left for the command to accept)
+//                   / stop, and put the sockets back in blocking mode, which
+//                   WSAEventSelect() takes them out of
+//
+// ARGUMENTS       : hEvent IN manual-reset event
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ListenSockets::watchConnections
+(
+	HANDLE hEvent
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("ListenSockets::watchConnections()")
+
+	ResetEvent(hEvent);
+	for(int i=0;i<numberOfSockets;i++)
+	{
+		if(sockets[i]->listenSocket == INVALID_SOCKET) { continue; }
+		if(WSAEventSelect(sockets[i]->listenSocket,hEvent,FD_ACCEPT) != 0)
+		{
+			LOGGER_LOG_ERROR2("failed to watch listening socket '%s', error=%d",sockets[i]->spec,WSAGetLastError())
+			unwatchConnections();
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"ListenSockets","watchConnections")
+		}
+	}
+}
+
+void ListenSockets::unwatchConnections()
+{
+	LOGGER_LOG_DEBUG("ListenSockets::unwatchConnections()")
+
+	for(int i=0;i<numberOfSockets;i++)
+	{
+		if(sockets[i]->listenSocket == INVALID_SOCKET) { continue; }
+		u_long nonBlocking = 0;
+		WSAEventSelect(sockets[i]->listenSocket,NULL,0);
+		ioctlsocket(sockets[i]->listenSocket,FIONBIO,&nonBlocking);
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::countConnections
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : number of established connections a process has on the
+//                   ports of the tcp sockets (connections to unix sockets
+//                   cannot be counted)
+//
+// ARGUMENTS       : processId IN process
+//
+// RETURNS         : number of connections
+//
+// ============================================================================
+int ListenSockets::countConnections
+(
+	DWORD processId
+) const
+{
+	// the table can grow between the two calls - try again if it has
+	DWORD                   size  = 0;
+	MIB_TCPTABLE_OWNER_PID *table = 0;
+	DWORD                   rc    = ERROR_INSUFFICIENT_BUFFER;
+	for(int attempt=0;(attempt<3)&&(rc == ERROR_INSUFFICIENT_BUFFER);attempt++)
+	{
+		free(table);
+		table = (size > 0) ? (MIB_TCPTABLE_OWNER_PID*)malloc(size) : 0;
+		rc = GetExtendedTcpTable(table,&size,FALSE,AF_INET,TCP_TABLE_OWNER_PID_CONNECTIONS,0);
+	}
+	if(rc != NO_ERROR)
+	{
+		LOGGER_LOG_ERROR1("failed to read the TCP connection table, error=%d",rc)
+		free(table);
+		return 0;
+	}
+
+	int count = 0;
+	for(DWORD row=0;row<table->dwNumEntries;row++)
+	{
+		const MIB_TCPROW_OWNER_PID &connection = table->table[row];
+		if((connection.dwOwningPid != processId)||(connection.dwState != MIB_TCP_STATE_ESTAB)) { continue; }
+		for(int i=0;i<numberOfSockets;i++)
+		{
+			if((sockets[i]->type == ListenSocket::SOCKET_TCP)&&
+			   (ntohs((u_short)connection.dwLocalPort) == sockets[i]->port))
+			{
+				count++;
+				break;
+			}
+		}
+	}
+	free(table);
+	return count;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::ListenSockets
+//                   ListenSockets::~ListenSockets
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+ListenSockets::ListenSockets()
+{
+	numberOfSockets = 0;
+	winsockStarted  = false;
+}
+
+ListenSockets::~ListenSockets()
+{
+	for(int i=0;i<numberOfSockets;i++)
+	{
+		if(sockets[i]->listenSocket != INVALID_SOCKET)
+		{
+			closesocket(sockets[i]->listenSocket);
+			if(sockets[i]->type == ListenSocket::SOCKET_UNIX) { DeleteFile(sockets[i]->path); }
+		}
+		delete sockets[i];
+	}
+	if(winsockStarted) { WSACleanup(); }
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ListenSockets::openSocket
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : create, bind and listen on a socket which the command
+//                   can inherit
+//
+// ARGUMENTS       : listenSocket IN/OUT socket
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ListenSockets::openSocket
+(
+	ListenSocket &listenSocket
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("opening listening socket '%s'",listenSocket.spec)
+
+	SOCKET s = socket((listenSocket.type == ListenSocket::SOCKET_TCP) ? AF_INET : AF_UNIX,SOCK_STREAM,0);
+	if(s == INVALID_SOCKET)
+	{
+		LOGGER_LOG_ERROR2("failed to create listening socket '%s', error=%d",listenSocket.spec,WSAGetLastError())
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"ListenSockets","openSocket")
+	}
+
+	int rc;
+	if(listenSocket.type == ListenSocket::SOCKET_TCP)
+	{
+		// no other process may bind the port while we hold it
+		BOOL exclusive = TRUE;
+		setsockopt(s,SOL_SOCKET,SO_EXCLUSIVEADDRUSE,(const char*)&exclusive,sizeof(exclusive));
+
+		sockaddr_in address;
+		memset(&address,0,sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port   = htons(listenSocket.port);
+		address.sin_addr   = listenSocket.address;
+		rc = bind(s,(sockaddr*)&address,sizeof(address));
+	}
+	else
+	{
+		// a socket file left behind by an earlier run would stop the bind
+		DeleteFile(listenSocket.path);
+
+		sockaddr_un address;
+		memset(&address,0,sizeof(address));
+		address.sun_family = AF_UNIX;
+		strcpy(address.sun_path,listenSocket.path);
+		rc = bind(s,(sockaddr*)&address,sizeof(address));
+	}
+
+	if((rc != 0)||(listen(s,SOMAXCONN) != 0))
+	{
+		LOGGER_LOG_ERROR2("failed to listen on '%s', error=%d",listenSocket.spec,WSAGetLastError())
+		closesocket(s);
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"ListenSockets","openSocket")
+	}
+
+	// the command inherits it
+	if(!SetHandleInformation((HANDLE)s,HANDLE_FLAG_INHERIT,HANDLE_FLAG_INHERIT))
+	{
+		LOGGER_LOG_ERROR2("failed to make listening socket '%s' inheritable, error=%d",listenSocket.spec,GetLastError())
+		closesocket(s);
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"ListenSockets","openSocket")
+	}
+
+	listenSocket.listenSocket = s;
+	LOGGER_LOG_INFO2("listening on '%s' (socket %llu)",listenSocket.spec,(unsigned long long)s)
+}
+
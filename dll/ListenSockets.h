@@ -0,0 +1,143 @@
+
+// prevent multiple inclusion
+
+#if !defined(__LISTEN_SOCKETS_H__)
+#define __LISTEN_SOCKETS_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting ListenSockets")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("ListenSockets is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing ListenSockets")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most listening sockets per service
+const int MAX_LISTEN_SOCKETS = 16;
+
+// ============================================================================
+//
+// ListenSockets class
+//
+// Listening sockets which LiteSrv opens for the command and keeps open
+// across restarts, so that connections are queued by the kernel (not
+// refused) while the command is restarting. Each socket is one of
+//   [name=]tcp [address:]port    TCP on an IPv4 address (all if not given)
+//   [name=]unix path             Unix domain socket
+//
+// The command inherits the sockets, and no other handles, and is told
+// about them in its environment, as systemd does for socket activation:
+//   %LISTEN_FDS%      number of sockets
+//   %LISTEN_FDNAMES%  their names, separated by ':' ("unknown" for a socket
+//                     with no name)
+//   %LISTEN_SOCKETS%  their SOCKET values, separated by ' ' (on Windows
+//                     the values are not the consecutive descriptors from
+//                     3 which LISTEN_FDS implies)
+//
+// ============================================================================
+class LiteSrv_DLL_API ListenSockets
+{
+public:
+	// add a socket (see above for the syntax of spec)
+	void addSocket(const char *spec) throw (LiteSrvException);
+
+	// are there any sockets?
+	bool hasSockets() const;
+
+	// open the sockets which are not open yet
+	void open() throw (LiteSrvException);
+
+	// put the sockets in the environment of commands started from now on
+	void setEnvironment() const;
+
+	// handles for the command to inherit; returns how many were stored
+	int getHandles(HANDLE handles[],int maxHandles) const;
+
+	// signal an event when a connection is waiting to be accepted (while
+	// there is no command to accept it) / stop, and make the sockets
+	// blocking again for the command
+	void watchConnections(HANDLE hEvent) throw (LiteSrvException);
+	void unwatchConnections();
+
+	// established connections a process has on the tcp sockets
+	int countConnections(DWORD processId) const;
+
+	// constructor and destructor
+	ListenSockets();
+	virtual ~ListenSockets();
+
+private:
+	struct ListenSocket;
+
+	// service functions
+	void openSocket(ListenSocket &listenSocket) throw (LiteSrvException);
+
+	// private variables
+	ListenSocket *sockets[MAX_LISTEN_SOCKETS];
+	int           numberOfSockets;
+	bool          winsockStarted;
+
+	// prevent copying
+	ListenSockets(const ListenSockets&);
+	ListenSockets &operator=(const ListenSockets&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__LISTEN_SOCKETS_H__)
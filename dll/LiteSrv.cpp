@@ -13,6 +13,7 @@
 // ============================================================================
 
 // system headers
+#include <string.h>
 #include <string>
 
 // support headers
@@ -28,7 +28,11 @@
 //
 // ============================================================================
 
-#ifdef LiteSrv_DLL_EXPORT
+#if !defined(_WIN32)
+// there is no import or export outside Windows
+#define	LiteSrv_DLL_API
+
+#elif defined(LiteSrv_DLL_EXPORT)
 #define LiteSrv_DLL_API __declspec(dllexport)
 #pragma message("exporting LiteSrv")
 
@@ -0,0 +1,85 @@
+
+// prevent multiple inclusion
+
+#if !defined(__LITESRV_PROBE_H__)
+#define __LITESRV_PROBE_H__
+
+// ============================================================================
+//
+// LiteSrv health probe plugin interface
+//
+// A plugin is a DLL which exports one or more probe functions (with C
+// linkage), used in a probe as
+//
+//   plugin <dll>!<function> [argument]
+//
+// LiteSrv loads the DLL once, when the configuration is read, and calls
+// the function on a thread pool thread each time the probe is due. The
+// function is given the argument (an empty string if there is none) and
+// a buffer for a message explaining a failure, and returns
+// LITESRV_PROBE_PASSED or LITESRV_PROBE_FAILED.
+//
+// A call which takes longer than the probe timeout counts as a failure;
+// the probe is not run again until that call has returned. A function is
+// never called again before its previous call has returned, but calls to
+// different probes may overlap, so a function used by more than one probe
+// must be thread-safe.
+//
+// A plugin may also export LiteSrvProbeAbiVersion, returning the
+// LITESRV_PROBE_ABI_VERSION it was built with; a DLL built with a
+// different version is rejected.
+//
+// This header is plain C, so that plugins can be written in C or C++.
+//
+// ============================================================================
+
+#include <stddef.h>
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+#define	LITESRV_PROBE_ABI_VERSION			1
+
+// probe function results
+#define	LITESRV_PROBE_PASSED				0
+#define	LITESRV_PROBE_FAILED				1
+
+// size of the failure message buffer
+#define	LITESRV_PROBE_MESSAGE_SIZE			256
+
+// name of the (optional) version function
+#define	LITESRV_PROBE_ABI_VERSION_FUNCTION	"LiteSrvProbeAbiVersion"
+
+// declare an exported probe function (or the version function) in a plugin
+#ifdef __cplusplus
+#define	LITESRV_PROBE_EXPORT				extern "C" __declspec(dllexport)
+#else
+#define	LITESRV_PROBE_EXPORT				__declspec(dllexport)
+#endif
+
+// ============================================================================
+//
+// TYPE DEFINITIONS
+//
+// ============================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// probe function:
+//   int __cdecl myProbe(const char *argument,char *message,size_t messageSize)
+typedef int (__cdecl *LiteSrvProbeFunction)(const char *argument,char *message,size_t messageSize);
+
+// version function:
+//   int __cdecl LiteSrvProbeAbiVersion(void)
+typedef int (__cdecl *LiteSrvProbeAbiVersionFunction)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__LITESRV_PROBE_H__)
@@ -0,0 +1,135 @@
+
+// prevent multiple inclusion
+
+#if !defined(__LITESRV_STATUS_H__)
+#define __LITESRV_STATUS_H__
+
+// ============================================================================
+//
+// LiteSrv status page
+//
+// Each service run by LiteSrv publishes its status in a named file mapping
+// (shared memory), so that monitoring tools can read it with plain memory
+// loads - no call to the SCM, and no system call per read once the page
+// is mapped. The mapping is named
+//
+//   Global\LiteSrv.Status.<service>
+//
+// (Local\... if LiteSrv could not create it in the global namespace), and
+// holds one LiteSrvStatus. Any authenticated user may map it for reading
+// (FILE_MAP_READ); only LiteSrv writes it, on every change of state and
+// every start and exit of a process.
+//
+// The page is protected by a sequence lock: the sequence is odd while an
+// update is in progress, and changes with every update. A reader copies
+// the page, and uses the copy if the sequence was even and did not change
+// while it copied - LiteSrvReadStatus() does this. A tool which reads many
+// services keeps each page mapped and calls LiteSrvReadStatus() on it.
+//
+// The page goes when LiteSrv exits, so a page which cannot be opened
+// means that the service is not running under LiteSrv.
+//
+// This header is plain C, so that tools can be written in C or C++.
+//
+// ============================================================================
+
+#include <windows.h>
+#include <string.h>
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+#define	LITESRV_STATUS_MAGIC				0x5453534CU		// "LSST"
+#define	LITESRV_STATUS_VERSION				1
+
+// mapping names (sprintf formats, given the service name)
+#define	LITESRV_STATUS_GLOBAL_NAME			"Global\\LiteSrv.Status.%s"
+#define	LITESRV_STATUS_LOCAL_NAME			"Local\\LiteSrv.Status.%s"
+
+// service states (the same values as ScmConnector::SCM_STATUSES), and
+// their names
+#define	LITESRV_STATE_INITIALISING			0
+#define	LITESRV_STATE_STARTING				1
+#define	LITESRV_STATE_RUNNING				2
+#define	LITESRV_STATE_STOPPING				3
+#define	LITESRV_STATE_STOPPED				4
+#define	LITESRV_STATE_MUST_START_AS_CONSOLE	5
+#define	LITESRV_STATE_FAILED				6
+#define	LITESRV_STATE_PAUSED				7
+#define	LITESRV_STATE_COUNT					8
+#define	LITESRV_STATE_NAMES					{ "initialising","starting","running","stopping", \
+											  "stopped","must_start_as_console","failed","paused" }
+
+// times a read is tried while the page is being updated
+#define	LITESRV_STATUS_READ_ATTEMPTS		1000
+
+// ============================================================================
+//
+// TYPE DEFINITIONS
+//
+// ============================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the page (times are FILETIMEs - 100ns units since 1601, UTC - and 0 if
+// there is no such time)
+typedef struct LiteSrvStatus
+{
+	unsigned int          magic;			// LITESRV_STATUS_MAGIC
+	unsigned int          version;			// LITESRV_STATUS_VERSION
+	volatile unsigned int sequence;			// odd while being updated
+	unsigned int          state;			// LITESRV_STATE_...
+	unsigned int          supervisorId;		// process id of LiteSrv
+	unsigned int          processId;		// the command (the first replica running), 0 = none
+	unsigned int          processCount;		// processes (replicas) running
+	unsigned int          lastExitCode;		// of the last process to exit
+	unsigned long long    starts;			// processes started
+	unsigned long long    restarts;			// processes started again in the same slot
+	unsigned long long    crashes;			// exited with a failure status without being stopped
+	unsigned long long    supervisorTime;	// when LiteSrv started
+	unsigned long long    processTime;		// when processId started
+	unsigned long long    lastExitTime;		// when the last process exited
+	unsigned long long    updateTime;		// when the page was last updated
+} LiteSrvStatus;
+
+// ============================================================================
+//
+// FUNCTION        : LiteSrvReadStatus
+//
+// DESCRIPTION     : take a consistent copy of a mapped status page
+//
+// ARGUMENTS       : page   IN  mapped page
+//                   status OUT copy
+//
+// RETURNS         : 1 if copied, 0 if the page is not a status page, or
+//                   kept changing
+//
+// ============================================================================
+static __inline int LiteSrvReadStatus(const volatile LiteSrvStatus *page,LiteSrvStatus *status)
+{
+	int attempt;
+	for(attempt=0;attempt<LITESRV_STATUS_READ_ATTEMPTS;attempt++)
+	{
+		unsigned int sequence = page->sequence;
+		MemoryBarrier();
+		if((sequence&1) != 0) { YieldProcessor(); continue; }
+
+		memcpy(status,(const void*)page,sizeof(*status));
+		MemoryBarrier();
+		if(page->sequence != sequence) { continue; }
+
+		return (status->magic == LITESRV_STATUS_MAGIC)&&(status->version == LITESRV_STATUS_VERSION);
+	}
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__LITESRV_STATUS_H__)
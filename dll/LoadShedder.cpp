@@ -0,0 +1,426 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "LoadShedder.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// NtSuspendProcess and NtResumeProcess (Windows has no SIGSTOP)
+typedef LONG (NTAPI *NtProcessFunction)(HANDLE);
+const char *NT_SUSPEND_PROCESS = "NtSuspendProcess";
+const char *NT_RESUME_PROCESS  = "NtResumeProcess";
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::setCpuThreshold
+//                   LoadShedder::setMemoryPressure
+//                   LoadShedder::getCpuThreshold
+//                   LoadShedder::getMemoryPressure
+//                   LoadShedder::isEnabled
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the pressure the service yields to - the CPUs
+//                   being busier than a percentage (0 = never), and memory
+//                   running low
+//
+// ============================================================================
+void LoadShedder::setCpuThreshold(int percent) { cpuThreshold = (percent < 0) ? 0 : (percent > 100) ? 100 : percent; }
+void LoadShedder::setMemoryPressure(bool mp) { memoryPressure = mp; }
+int  LoadShedder::getCpuThreshold() const { return cpuThreshold; }
+bool LoadShedder::getMemoryPressure() const { return memoryPressure; }
+bool LoadShedder::isEnabled() const { return (cpuThreshold > 0)||memoryPressure; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::prepare
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : find the functions which pause and resume a process (a
+//                   pause control needs them, even with no pressure to
+//                   yield to), and create the low memory notification
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void LoadShedder::prepare() throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("LoadShedder::prepare()")
+
+	if(ntSuspendProcess != 0) { return; }
+
+	HMODULE hNtdll   = GetModuleHandle("ntdll.dll");
+	void   *suspend  = (hNtdll == NULL) ? 0 : (void*)GetProcAddress(hNtdll,NT_SUSPEND_PROCESS);
+	void   *resume   = (hNtdll == NULL) ? 0 : (void*)GetProcAddress(hNtdll,NT_RESUME_PROCESS);
+	if((suspend == 0)||(resume == 0))
+	{
+		LOGGER_LOG_ERROR1("cannot pause processes, error=%d",GetLastError())
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"LoadShedder","prepare")
+	}
+
+	if(memoryPressure&&(hLowMemory == NULL))
+	{
+		hLowMemory = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+		if(hLowMemory == NULL)
+		{
+			LOGGER_LOG_ERROR1("failed to create low memory notification, error=%d",GetLastError())
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"LoadShedder","prepare")
+		}
+	}
+
+	ntSuspendProcess = suspend;
+	ntResumeProcess  = resume;
+	getCpuBusy();
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::getEvent
+//                   LoadShedder::isDue
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : event signalled while memory is low (NULL while the
+//                   processes are paused, or memory pressure is not
+//                   watched) / is it signalled?
+//
+// ============================================================================
+HANDLE LoadShedder::getEvent() const { return paused ? NULL : hLowMemory; }
+
+bool LoadShedder::isDue() const
+{
+	HANDLE hEvent = getEvent();
+	return (hEvent != NULL)&&(WaitForSingleObject(hEvent,0) == WAIT_OBJECT_0);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::check
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : check the pressure - pause the processes when there is
+//                   some, and resume them once there has been none for
+//                   SHED_RESUME_CHECKS checks in a row (held processes
+//                   stay paused, and new ones are paused too)
+//
+// ARGUMENTS       : processes  IN process handles (0 = none in that slot)
+//                   processIds IN process ids
+//                   count      IN number of slots
+//
+// RETURNS         : true if the processes have just been paused or resumed
+//
+// ============================================================================
+bool LoadShedder::check
+(
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+)
+{
+	if(ntSuspendProcess == 0) { return false; }
+
+	if(held)
+	{
+		pause(processes,processIds,count);
+		return false;
+	}
+
+	bool low      = (hLowMemory != NULL)&&isMemoryLow();
+	int  busy     = (cpuThreshold > 0) ? getCpuBusy() : 0;
+	bool pressure = low||((cpuThreshold > 0)&&(busy >= cpuThreshold));
+
+	if(pressure)
+	{
+		clearChecks = 0;
+		memoryLow   = low;
+		bool pausing = !paused;
+		if(pausing)
+		{
+			LOGGER_LOG_INFO2("host is under pressure (memory %s, CPUs %d%% busy) - pausing",
+								memoryLow ? "low" : "ok",busy)
+			paused = true;
+		}
+		pause(processes,processIds,count);
+		return pausing;
+	}
+
+	if(!paused||(++clearChecks < SHED_RESUME_CHECKS)) { return false; }
+
+	LOGGER_LOG_INFO1("host has been without pressure for %d checks - resuming",clearChecks)
+	resume(processes,processIds,count);
+	pausedCount = 0;
+	paused      = false;
+	memoryLow   = false;
+	return true;
+}
+
+bool LoadShedder::isPaused() const { return paused; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::hold
+//                   LoadShedder::release
+//                   LoadShedder::isHeld
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : hold the processes paused at the SCM's request / let
+//                   them run again (if the host is still under pressure, the
+//                   next check pauses them again) / are they held?
+//
+// ARGUMENTS       : processes  IN process handles (0 = none in that slot)
+//                   processIds IN process ids
+//                   count      IN number of slots
+//
+// RETURNS         : true if the processes have just been paused or resumed
+//
+// ============================================================================
+bool LoadShedder::hold
+(
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+)
+{
+	if(held||(ntSuspendProcess == 0)) { return false; }
+
+	held        = true;
+	clearChecks = 0;
+	bool pausing = !paused;
+	paused = true;
+	pause(processes,processIds,count);
+	return pausing;
+}
+
+bool LoadShedder::release
+(
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+)
+{
+	if(!held) { return false; }
+
+	resume(processes,processIds,count);
+	held        = false;
+	pausedCount = 0;
+	paused      = false;
+	memoryLow   = false;
+	clearChecks = 0;
+	return true;
+}
+
+bool LoadShedder::isHeld() const { return held; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::resume
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : let the processes which were paused run again
+//
+// ARGUMENTS       : processes  IN process handles (0 = none in that slot)
+//                   processIds IN process ids
+//                   count      IN number of slots
+//
+// ============================================================================
+void LoadShedder::resume
+(
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+)
+{
+	for(int i=0;(i<count)&&(pausedCount>0);i++)
+	{
+		if(processes[i] == 0) { continue; }
+
+		for(int j=0;j<pausedCount;j++)
+		{
+			if(pausedIds[j] != processIds[i]) { continue; }
+
+			LONG status = (*(NtProcessFunction)ntResumeProcess)(processes[i]);
+			if(status < 0) { LOGGER_LOG_ERROR2("failed to resume process %lu, status=0x%08lx",processIds[i],status) }
+			pausedIds[j] = pausedIds[--pausedCount];
+			break;
+		}
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::LoadShedder
+//                   LoadShedder::~LoadShedder
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+LoadShedder::LoadShedder()
+{
+	cpuThreshold     = 0;
+	memoryPressure   = false;
+	hLowMemory       = NULL;
+	ntSuspendProcess = 0;
+	ntResumeProcess  = 0;
+	idleTime         = 0;
+	totalTime        = 0;
+	paused           = false;
+	held             = false;
+	memoryLow        = false;
+	clearChecks      = 0;
+	pausedCount      = 0;
+}
+
+LoadShedder::~LoadShedder()
+{
+	if(hLowMemory != NULL) { CloseHandle(hLowMemory); }
+}
+
+// ============================================================================
+//
+// PROTECTED MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::getCpuBusy
+//
+// ACCESS SPECIFIER: protected
+//
+// DESCRIPTION     : how busy the CPUs have been since the last call
+//
+// RETURNS         : percent busy (0 the first time)
+//
+// ============================================================================
+int LoadShedder::getCpuBusy()
+{
+	FILETIME idle, kernel, user;
+	if(!GetSystemTimes(&idle,&kernel,&user)) { return 0; }
+
+	// kernel time includes idle time
+	ULARGE_INTEGER idleNow, kernelNow, userNow;
+	idleNow.LowPart    = idle.dwLowDateTime;
+	idleNow.HighPart   = idle.dwHighDateTime;
+	kernelNow.LowPart  = kernel.dwLowDateTime;
+	kernelNow.HighPart = kernel.dwHighDateTime;
+	userNow.LowPart    = user.dwLowDateTime;
+	userNow.HighPart   = user.dwHighDateTime;
+	ULONGLONG totalNow = kernelNow.QuadPart+userNow.QuadPart;
+
+	int busy = 0;
+	if((totalTime != 0)&&(totalNow > totalTime))
+	{
+		ULONGLONG total = totalNow-totalTime;
+		busy = (int)((total-(idleNow.QuadPart-idleTime))*100/total);
+	}
+	idleTime  = idleNow.QuadPart;
+	totalTime = totalNow;
+	return busy;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::isMemoryLow
+//
+// ACCESS SPECIFIER: protected
+//
+// DESCRIPTION     : is memory low now?
+//
+// RETURNS         : the state of the low memory notification
+//
+// ============================================================================
+bool LoadShedder::isMemoryLow()
+{
+	BOOL low = FALSE;
+	return QueryMemoryResourceNotification(hLowMemory,&low)&&(low != FALSE);
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : LoadShedder::pause
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : pause the processes which are not paused yet (trimming
+//                   their working sets when memory is low)
+//
+// ARGUMENTS       : processes  IN process handles (0 = none in that slot)
+//                   processIds IN process ids
+//                   count      IN number of slots
+//
+// ============================================================================
+void LoadShedder::pause
+(
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+)
+{
+	for(int i=0;(i<count)&&(pausedCount<MAX_SHED_PROCESSES);i++)
+	{
+		if(processes[i] == 0) { continue; }
+
+		bool alreadyPaused = false;
+		for(int j=0;(j<pausedCount)&&!alreadyPaused;j++) { alreadyPaused = (pausedIds[j] == processIds[i]); }
+		if(alreadyPaused) { continue; }
+
+		LONG status = (*(NtProcessFunction)ntSuspendProcess)(processes[i]);
+		if(status < 0)
+		{
+			LOGGER_LOG_ERROR2("failed to pause process %lu, status=0x%08lx",processIds[i],status)
+			continue;
+		}
+		pausedIds[pausedCount++] = processIds[i];
+		if(memoryLow) { SetProcessWorkingSetSize(processes[i],(SIZE_T)-1,(SIZE_T)-1); }
+		LOGGER_LOG_DEBUG1("paused process %lu",processIds[i])
+	}
+}
+
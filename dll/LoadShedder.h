@@ -0,0 +1,168 @@
+
+// prevent multiple inclusion
+
+#if !defined(__LOAD_SHEDDER_H__)
+#define __LOAD_SHEDDER_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting LoadShedder")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("LoadShedder is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing LoadShedder")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most processes paused, how often the pressure is checked (ms), and the
+// checks in a row without pressure before they run again
+const int   MAX_SHED_PROCESSES = MAXIMUM_WAIT_OBJECTS;
+const DWORD SHED_CHECK_MS      = 1000;
+const int   SHED_RESUME_CHECKS = 10;
+
+// ============================================================================
+//
+// LoadShedder class
+//
+// Pauses the processes of a low priority service while the host is under
+// pressure - while Windows reports that memory is low, or while the CPUs
+// are busier than a threshold - and lets them run again once the pressure
+// has been gone for SHED_RESUME_CHECKS checks. Processes paused for memory
+// have their working sets trimmed, so that their pages are the first to
+// go.
+//
+// The low memory notification can be waited on (while nothing is paused),
+// so that the service yields as soon as memory runs low; the CPU is
+// checked every SHED_CHECK_MS.
+//
+// The processes can also be held paused at the SCM's request (a pause
+// control), until they are released (a continue): while they are held,
+// they are paused as though the host were under pressure.
+//
+// ============================================================================
+class LiteSrv_DLL_API LoadShedder
+{
+public:
+	// pressure to yield to (CPU: percent busy, 0 = none)
+	void setCpuThreshold(int percent);
+	void setMemoryPressure(bool mp);
+	int  getCpuThreshold() const;
+	bool getMemoryPressure() const;
+	bool isEnabled() const;
+
+	// get ready to check the pressure (once)
+	void prepare() throw (LiteSrvException);
+
+	// low memory notification (NULL while paused: it stays signalled while
+	// memory is low) / has it been signalled?
+	HANDLE getEvent() const;
+	bool   isDue() const;
+
+	// check the pressure, and pause or resume the processes - new processes
+	// are paused if the others are
+	bool check(const HANDLE processes[],const DWORD processIds[],int count);
+	bool isPaused() const;
+
+	// let processes run again (before they are stopped)
+	void resume(const HANDLE processes[],const DWORD processIds[],int count);
+
+	// hold the processes paused at the SCM's request, or release them -
+	// returns true if they have just been paused or resumed
+	bool hold(const HANDLE processes[],const DWORD processIds[],int count);
+	bool release(const HANDLE processes[],const DWORD processIds[],int count);
+	bool isHeld() const;
+
+	// constructor and destructor
+	LoadShedder();
+	virtual ~LoadShedder();
+
+protected:
+	// how busy the CPUs have been since the last call (percent), and
+	// whether memory is low now (the system's readings - a test may set
+	// them)
+	virtual int  getCpuBusy();
+	virtual bool isMemoryLow();
+
+private:
+	// service functions
+	void pause(const HANDLE processes[],const DWORD processIds[],int count);
+
+	// private variables
+	int       cpuThreshold;
+	bool      memoryPressure;
+	HANDLE    hLowMemory;
+	void     *ntSuspendProcess;
+	void     *ntResumeProcess;
+	ULONGLONG idleTime;				// the last GetSystemTimes() reading
+	ULONGLONG totalTime;
+	bool      paused;
+	bool      held;
+	bool      memoryLow;
+	int       clearChecks;			// in a row without pressure
+
+	// processes paused
+	DWORD     pausedIds[MAX_SHED_PROCESSES];
+	int       pausedCount;
+
+	// prevent copying
+	LoadShedder(const LoadShedder&);
+	LoadShedder &operator=(const LoadShedder&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__LOAD_SHEDDER_H__)
@@ -0,0 +1,756 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#include <psapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ServiceMetrics.h"
+#include "MetricsServer.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int       METRICS_REQUEST_SIZE  = 1024;
+const int       METRICS_RESPONSE_SIZE = 65536;
+const int       METRICS_HEADER_SIZE   = 256;		// kept free before the body
+const int       METRICS_LINE_SIZE     = 512;
+const ULONGLONG METRICS_CLIENT_MS     = 5000;		// a scrape is dropped after this
+const int       METRICS_LISTEN_QUEUE  = 8;
+
+const char *METRICS_OK_HEADER =
+	"HTTP/1.0 200 OK\r\n"
+	"Content-Type: text/plain; version=0.0.4\r\n"
+	"Content-Length: %d\r\n"
+	"Connection: close\r\n\r\n";
+const char *METRICS_NOT_FOUND =
+	"HTTP/1.0 404 Not Found\r\n"
+	"Content-Length: 0\r\n"
+	"Connection: close\r\n\r\n";
+const char *METRICS_BAD_REQUEST =
+	"HTTP/1.0 400 Bad Request\r\n"
+	"Content-Length: 0\r\n"
+	"Connection: close\r\n\r\n";
+
+// ============================================================================
+//
+// MetricsServer::Client - a scrape in progress (the request is read until
+// the blank line after its headers, then the response is sent)
+//
+// ============================================================================
+struct MetricsServer::Client
+{
+	SOCKET    clientSocket;			// INVALID_SOCKET = slot free
+	ULONGLONG deadline;
+	char      request[METRICS_REQUEST_SIZE];
+	int       requestLength;
+	char      response[METRICS_RESPONSE_SIZE];
+	int       responseStart;		// next byte to send
+	int       responseEnd;			// 0 = not responding yet
+};
+
+// ============================================================================
+//
+// FUNCTION        : appendLine
+//
+// DESCRIPTION     : append a line to a buffer, if the whole line fits (so
+//                   that a response which is too big stays well-formed)
+//
+// ARGUMENTS       : buffer IN/OUT buffer
+//                   size   IN     size of buffer
+//                   length IN/OUT length of the text in buffer
+//                   format IN     printf format, and its arguments
+//
+// ============================================================================
+static void appendLine
+(
+	char       *buffer,
+	int         size,
+	int        &length,
+	const char *format,
+	...
+)
+{
+	char    line[METRICS_LINE_SIZE];
+	va_list arguments;
+	va_start(arguments,format);
+	int lineLength = vsnprintf(line,sizeof(line),format,arguments);
+	va_end(arguments);
+
+	if((lineLength < 0)||(lineLength >= (int)sizeof(line))||(length+lineLength >= size)) { return; }
+	memcpy(buffer+length,line,lineLength);
+	length += lineLength;
+	buffer[length] = '\0';
+}
+
+// ============================================================================
+//
+// FUNCTION        : appendHistogram
+//
+// DESCRIPTION     : append a latency histogram (cumulative buckets, in
+//                   seconds)
+//
+// ============================================================================
+static void appendHistogram
+(
+	char                   *buffer,
+	int                     size,
+	int                    &length,
+	const char             *name,
+	const char             *help,
+	const char             *service,
+	const LatencyHistogram &histogram
+)
+{
+	appendLine(buffer,size,length,"# HELP %s %s\n# TYPE %s histogram\n",name,help,name);
+
+	ULONGLONG cumulative = 0;
+	for(int i=0;i<LATENCY_BUCKETS;i++)
+	{
+		cumulative += histogram.counts[i];
+		DWORD limit = ServiceMetrics::getBucketLimit(i);
+		if(limit == INFINITE)
+		{
+			appendLine(buffer,size,length,"%s_bucket{service=\"%s\",le=\"+Inf\"} %llu\n",name,service,cumulative);
+		}
+		else
+		{
+			appendLine(buffer,size,length,"%s_bucket{service=\"%s\",le=\"%lu.%03lu\"} %llu\n",
+						name,service,limit/1000,limit%1000,cumulative);
+		}
+	}
+	appendLine(buffer,size,length,"%s_sum{service=\"%s\"} %llu.%03llu\n",
+				name,service,histogram.sumMs/1000,histogram.sumMs%1000);
+	appendLine(buffer,size,length,"%s_count{service=\"%s\"} %llu\n",name,service,histogram.count);
+}
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::setAddress
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set the address to serve the metrics on
+//
+// ARGUMENTS       : spec IN "tcp [address:]port" or "unix path"
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void MetricsServer::setAddress
+(
+	const char *spec
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("MetricsServer::setAddress('%s')",spec)
+
+#define	BAD_ADDRESS(reason) \
+	{ LOGGER_LOG_ERROR2("invalid metrics address '%s': %s",spec,reason) \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_INVALID_PARAMETER,"MetricsServer","setAddress") }
+
+	if((spec == 0)||(strlen(spec) >= METRICS_SPEC_SIZE)) BAD_ADDRESS("too long")
+	if(listenSocket != INVALID_SOCKET) BAD_ADDRESS("already serving")
+
+	// type
+	const char *args = spec;
+	while(*args == ' ') { args++; }
+	bool isUnix;
+	if(!_strnicmp(args,"tcp ",4))       { isUnix = false; args += 4; }
+	else if(!_strnicmp(args,"unix ",5)) { isUnix = true;  args += 5; }
+	else BAD_ADDRESS("expected tcp or unix")
+	while(*args == ' ') { args++; }
+
+	if(!isUnix)
+	{
+		// address (only this host can scrape, unless another is given)
+		in_addr hostAddress;
+		hostAddress.s_addr = htonl(INADDR_LOOPBACK);
+		const char *colon = strchr(args,':');
+		if(colon != 0)
+		{
+			char text[METRICS_SPEC_SIZE];
+			memcpy(text,args,colon-args);
+			text[colon-args] = '\0';
+			if(inet_pton(AF_INET,text,&hostAddress) != 1) BAD_ADDRESS("invalid address")
+			args = colon+1;
+		}
+
+		// port
+		char *end;
+		long  number = strtol(args,&end,10);
+		if((end == args)||(*end != '\0')||(number < 1)||(number > 65535)) BAD_ADDRESS("invalid port")
+		address = hostAddress.s_addr;
+		port    = (USHORT)number;
+	}
+	else
+	{
+		if(*args == '\0') BAD_ADDRESS("no path")
+		strcpy(path,args);
+	}
+
+#undef	BAD_ADDRESS
+
+	unixSocket = isUnix;
+	strcpy(this->spec,spec);
+}
+
+const char *MetricsServer::getAddress() const { return spec; }
+bool MetricsServer::isEnabled() const { return spec[0] != '\0'; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::open
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : start listening (the socket then stays open until
+//                   LiteSrv exits)
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void MetricsServer::open() throw (LiteSrvException)
+{
+	if(!isEnabled()||(listenSocket != INVALID_SOCKET)) { return; }
+
+	LOGGER_LOG_DEBUG1("MetricsServer::open('%s')",spec)
+
+	if(!winsockStarted)
+	{
+		WSADATA wsaData;
+		int     error = WSAStartup(MAKEWORD(2,2),&wsaData);
+		if(error != 0)
+		{
+			LOGGER_LOG_ERROR1("failed to start Winsock, error=%d",error)
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"MetricsServer","open")
+		}
+		winsockStarted = true;
+	}
+
+	// the scrape slots (allocated once, so that a scrape allocates nothing)
+	for(int i=0;i<MAX_METRICS_CLIENTS;i++)
+	{
+		if(clients[i] != 0) { continue; }
+		clients[i] = new Client;
+		clients[i]->clientSocket = INVALID_SOCKET;
+	}
+
+	SOCKET s = socket(unixSocket ? AF_UNIX : AF_INET,SOCK_STREAM,0);
+	if(s == INVALID_SOCKET)
+	{
+		LOGGER_LOG_ERROR2("failed to create metrics socket '%s', error=%d",spec,WSAGetLastError())
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"MetricsServer","open")
+	}
+
+	int rc;
+	if(!unixSocket)
+	{
+		BOOL exclusive = TRUE;
+		setsockopt(s,SOL_SOCKET,SO_EXCLUSIVEADDRUSE,(const char*)&exclusive,sizeof(exclusive));
+
+		sockaddr_in tcpAddress;
+		memset(&tcpAddress,0,sizeof(tcpAddress));
+		tcpAddress.sin_family      = AF_INET;
+		tcpAddress.sin_port        = htons(port);
+		tcpAddress.sin_addr.s_addr = address;
+		rc = bind(s,(sockaddr*)&tcpAddress,sizeof(tcpAddress));
+	}
+	else
+	{
+		// a socket file left behind by an earlier run would stop the bind
+		DeleteFile(path);
+
+		sockaddr_un unixAddress;
+		memset(&unixAddress,0,sizeof(unixAddress));
+		unixAddress.sun_family = AF_UNIX;
+		strcpy(unixAddress.sun_path,path);
+		rc = bind(s,(sockaddr*)&unixAddress,sizeof(unixAddress));
+	}
+
+	// non-blocking (WSAEventSelect() makes it so), signalling the event
+	if((rc != 0)||(listen(s,METRICS_LISTEN_QUEUE) != 0)||
+	   (WSAEventSelect(s,hEvent,FD_ACCEPT) != 0))
+	{
+		LOGGER_LOG_ERROR2("failed to serve metrics on '%s', error=%d",spec,WSAGetLastError())
+		closesocket(s);
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"MetricsServer","open")
+	}
+
+	listenSocket = (UINT_PTR)s;
+	LOGGER_LOG_INFO1("serving metrics on '%s'",spec)
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::getEvent
+//                   MetricsServer::isDue
+//                   MetricsServer::getWaitTime
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : event signalled when there is something to serve (NULL
+//                   if not serving) / has it been signalled, or has a
+//                   scrape run out of time? / milliseconds until the first
+//                   scrape in progress runs out of time (INFINITE if none)
+//
+// ============================================================================
+HANDLE MetricsServer::getEvent() const { return (listenSocket == INVALID_SOCKET) ? NULL : hEvent; }
+
+bool MetricsServer::isDue() const
+{
+	if(listenSocket == INVALID_SOCKET) { return false; }
+	return (WaitForSingleObject(hEvent,0) == WAIT_OBJECT_0)||(getWaitTime() == 0);
+}
+
+DWORD MetricsServer::getWaitTime() const
+{
+	if(listenSocket == INVALID_SOCKET) { return INFINITE; }
+
+	ULONGLONG now      = GetTickCount64();
+	DWORD     waitTime = INFINITE;
+	for(int i=0;i<MAX_METRICS_CLIENTS;i++)
+	{
+		const Client &client = *clients[i];
+		if(client.clientSocket == INVALID_SOCKET) { continue; }
+		if(client.deadline <= now) { return 0; }
+		if(client.deadline-now < waitTime) { waitTime = (DWORD)(client.deadline-now); }
+	}
+	return waitTime;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::serve
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : move each scrape on as far as it can go without
+//                   blocking - accept new ones, read requests, render the
+//                   metrics for a complete request, and send responses
+//
+// ARGUMENTS       : metrics    IN metrics of the service
+//                   service    IN service name
+//                   states     IN names of the states of the service
+//                   stateCount IN number of states
+//                   state      IN the state it is in
+//                   processes  IN process handles (0 = none in that slot)
+//                   count      IN number of slots
+//
+// ============================================================================
+void MetricsServer::serve
+(
+	const ServiceMetrics &metrics,
+	const char           *service,
+	const char * const    states[],
+	int                   stateCount,
+	int                   state,
+	const HANDLE          processes[],
+	int                   count
+)
+{
+	if(listenSocket == INVALID_SOCKET) { return; }
+
+	// drop the scrapes which have taken too long first, so that their slots
+	// are free for those waiting to be accepted
+	ULONGLONG now = GetTickCount64();
+	for(int i=0;i<MAX_METRICS_CLIENTS;i++)
+	{
+		Client &client = *clients[i];
+		if((client.clientSocket != INVALID_SOCKET)&&(now >= client.deadline))
+		{
+			LOGGER_LOG_DEBUG("dropping metrics scrape which has taken too long")
+			closeClient(client);
+		}
+	}
+
+	// everything is retried below until it would block, which re-enables
+	// the events that signal it again
+	WSAResetEvent(hEvent);
+	acceptClients();
+
+	for(int i=0;i<MAX_METRICS_CLIENTS;i++)
+	{
+		Client &client = *clients[i];
+		if(client.clientSocket == INVALID_SOCKET) { continue; }
+
+		if((client.responseEnd == 0)&&readRequest(client))
+		{
+			char *body = client.response+METRICS_HEADER_SIZE;
+			int   bodySize = METRICS_RESPONSE_SIZE-METRICS_HEADER_SIZE;
+			const char *error = 0;
+			if(strncmp(client.request,"GET ",4) != 0)
+			{
+				error = METRICS_BAD_REQUEST;
+			}
+			else if((strncmp(client.request+4,"/metrics",8) != 0)&&(strncmp(client.request+4,"/ ",2) != 0))
+			{
+				error = METRICS_NOT_FOUND;
+			}
+
+			if(error != 0)
+			{
+				strcpy(client.response,error);
+				client.responseStart = 0;
+				client.responseEnd   = (int)strlen(error);
+			}
+			else
+			{
+				int  bodyLength = render(body,bodySize,metrics,service,states,stateCount,state,processes,count);
+				char header[METRICS_HEADER_SIZE];
+				int  headerLength = snprintf(header,sizeof(header),METRICS_OK_HEADER,bodyLength);
+				client.responseStart = METRICS_HEADER_SIZE-headerLength;
+				client.responseEnd   = METRICS_HEADER_SIZE+bodyLength;
+				memcpy(client.response+client.responseStart,header,headerLength);
+			}
+		}
+
+		if(client.responseEnd > 0) { sendResponse(client); }
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::MetricsServer
+//                   MetricsServer::~MetricsServer
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+MetricsServer::MetricsServer()
+{
+	spec[0]        = '\0';
+	unixSocket     = false;
+	path[0]        = '\0';
+	address        = 0;
+	port           = 0;
+	listenSocket   = INVALID_SOCKET;
+	hEvent         = CreateEvent(NULL,TRUE,FALSE,NULL);
+	winsockStarted = false;
+	for(int i=0;i<MAX_METRICS_CLIENTS;i++) { clients[i] = 0; }
+}
+
+MetricsServer::~MetricsServer()
+{
+	for(int i=0;i<MAX_METRICS_CLIENTS;i++)
+	{
+		if(clients[i] == 0) { continue; }
+		if(clients[i]->clientSocket != INVALID_SOCKET) { closeClient(*clients[i]); }
+		delete clients[i];
+	}
+	if(listenSocket != INVALID_SOCKET)
+	{
+		closesocket((SOCKET)listenSocket);
+		if(unixSocket) { DeleteFile(path); }
+	}
+	if(hEvent != NULL) { CloseHandle(hEvent); }
+	if(winsockStarted) { WSACleanup(); }
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::acceptClients
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : accept the scrapes waiting (closing those there is no
+//                   free slot for)
+//
+// ============================================================================
+void MetricsServer::acceptClients()
+{
+	while(true)
+	{
+		SOCKET s = accept((SOCKET)listenSocket,NULL,NULL);
+		if(s == INVALID_SOCKET)
+		{
+			if(WSAGetLastError() != WSAEWOULDBLOCK)
+			{
+				LOGGER_LOG_ERROR1("failed to accept metrics scrape, error=%d",WSAGetLastError())
+			}
+			return;
+		}
+
+		Client *client = 0;
+		for(int i=0;(i<MAX_METRICS_CLIENTS)&&(client==0);i++)
+		{
+			if(clients[i]->clientSocket == INVALID_SOCKET) { client = clients[i]; }
+		}
+		if((client == 0)||(WSAEventSelect(s,hEvent,FD_READ|FD_WRITE|FD_CLOSE) != 0))
+		{
+			LOGGER_LOG_DEBUG("refusing metrics scrape - too many at once")
+			closesocket(s);
+			continue;
+		}
+
+		client->clientSocket  = s;
+		client->deadline      = GetTickCount64()+METRICS_CLIENT_MS;
+		client->requestLength = 0;
+		client->responseStart = 0;
+		client->responseEnd   = 0;
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::readRequest
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : read what has arrived of a request
+//
+// ARGUMENTS       : client IN/OUT scrape
+//
+// RETURNS         : true if the request is complete (or too long to be one
+//                   we serve - it then fails to match)
+//
+// ============================================================================
+bool MetricsServer::readRequest
+(
+	Client &client
+)
+{
+	while(client.requestLength < METRICS_REQUEST_SIZE-1)
+	{
+		int received = recv(client.clientSocket,client.request+client.requestLength,
+							METRICS_REQUEST_SIZE-1-client.requestLength,0);
+		if(received == 0)
+		{
+			closeClient(client);
+			return false;
+		}
+		if(received < 0)
+		{
+			if(WSAGetLastError() != WSAEWOULDBLOCK) { closeClient(client); }
+			break;
+		}
+		client.requestLength += received;
+		client.request[client.requestLength] = '\0';
+		if((strstr(client.request,"\r\n\r\n") != 0)||(strstr(client.request,"\n\n") != 0)) { return true; }
+	}
+	if(client.clientSocket == INVALID_SOCKET) { return false; }
+
+	// a request too long for the buffer is not one of ours
+	if(client.requestLength >= METRICS_REQUEST_SIZE-1)
+	{
+		client.request[0] = '\0';
+		return true;
+	}
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::sendResponse
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : send what can be sent of a response, closing the
+//                   connection once it has all gone
+//
+// ARGUMENTS       : client IN/OUT scrape
+//
+// ============================================================================
+void MetricsServer::sendResponse
+(
+	Client &client
+)
+{
+	while(client.responseStart < client.responseEnd)
+	{
+		int sent = send(client.clientSocket,client.response+client.responseStart,
+						client.responseEnd-client.responseStart,0);
+		if(sent < 0)
+		{
+			if(WSAGetLastError() != WSAEWOULDBLOCK) { closeClient(client); }
+			return;
+		}
+		client.responseStart += sent;
+	}
+	shutdown(client.clientSocket,SD_SEND);
+	closeClient(client);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::closeClient
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : close a scrape, freeing its slot
+//
+// ARGUMENTS       : client IN/OUT scrape
+//
+// ============================================================================
+void MetricsServer::closeClient
+(
+	Client &client
+)
+{
+	closesocket(client.clientSocket);
+	client.clientSocket = INVALID_SOCKET;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : MetricsServer::render
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : write the metrics in the Prometheus text format (the
+//                   CPU and memory of each process are read now)
+//
+// ARGUMENTS       : buffer     OUT text
+//                   size       IN  size of buffer
+//                   others     IN  as for serve()
+//
+// RETURNS         : length of the text
+//
+// ============================================================================
+int MetricsServer::render
+(
+	char                 *buffer,
+	int                   size,
+	const ServiceMetrics &metrics,
+	const char           *service,
+	const char * const    states[],
+	int                   stateCount,
+	int                   state,
+	const HANDLE          processes[],
+	int                   count
+) const
+{
+	// the service name, as a label value
+	char label[METRICS_SPEC_SIZE];
+	int  labelLength = 0;
+	for(const char *c=service;(*c!='\0')&&(labelLength<(int)sizeof(label)-3);c++)
+	{
+		if((*c == '\\')||(*c == '"')) { label[labelLength++] = '\\'; label[labelLength++] = *c; }
+		else if(*c == '\n')           { label[labelLength++] = '\\'; label[labelLength++] = 'n'; }
+		else                          { label[labelLength++] = *c; }
+	}
+	label[labelLength] = '\0';
+
+	int length = 0;
+	buffer[0] = '\0';
+
+	// what the supervisor has done
+	appendLine(buffer,size,length,
+		"# HELP litesrv_process_starts_total Processes started.\n"
+		"# TYPE litesrv_process_starts_total counter\n"
+		"litesrv_process_starts_total{service=\"%s\"} %llu\n",label,metrics.getStarts());
+	appendLine(buffer,size,length,
+		"# HELP litesrv_process_restarts_total Processes started again in the same slot.\n"
+		"# TYPE litesrv_process_restarts_total counter\n"
+		"litesrv_process_restarts_total{service=\"%s\"} %llu\n",label,metrics.getRestarts());
+	appendLine(buffer,size,length,
+		"# HELP litesrv_process_crashes_total Processes which exited with a failure status without being stopped.\n"
+		"# TYPE litesrv_process_crashes_total counter\n"
+		"litesrv_process_crashes_total{service=\"%s\"} %llu\n",label,metrics.getCrashes());
+
+	// state of the service
+	appendLine(buffer,size,length,
+		"# HELP litesrv_service_state Current state of the service (1 for the state it is in).\n"
+		"# TYPE litesrv_service_state gauge\n");
+	for(int i=0;i<stateCount;i++)
+	{
+		appendLine(buffer,size,length,"litesrv_service_state{service=\"%s\",state=\"%s\"} %d\n",
+					label,states[i],(i == state) ? 1 : 0);
+	}
+
+	// latencies
+	appendHistogram(buffer,size,length,"litesrv_ready_latency_seconds",
+					"Time from starting a process to it being ready.",label,metrics.getReadyLatency());
+	appendHistogram(buffer,size,length,"litesrv_stop_latency_seconds",
+					"Time taken to stop processes.",label,metrics.getStopLatency());
+
+	// each running process
+	ULONGLONG now = GetTickCount64();
+	appendLine(buffer,size,length,
+		"# HELP litesrv_process_uptime_seconds Time since the process was started.\n"
+		"# TYPE litesrv_process_uptime_seconds gauge\n");
+	for(int i=0;i<count;i++)
+	{
+		if((processes[i] == 0)||(WaitForSingleObject(processes[i],0) != WAIT_TIMEOUT)) { continue; }
+		ULONGLONG uptimeMs = now-metrics.getStartTime(i);
+		appendLine(buffer,size,length,"litesrv_process_uptime_seconds{service=\"%s\",instance=\"%d\"} %llu.%03llu\n",
+					label,i,uptimeMs/1000,uptimeMs%1000);
+	}
+	appendLine(buffer,size,length,
+		"# HELP litesrv_process_cpu_seconds_total CPU time used by the process.\n"
+		"# TYPE litesrv_process_cpu_seconds_total counter\n");
+	for(int i=0;i<count;i++)
+	{
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if((processes[i] == 0)||!GetProcessTimes(processes[i],&creationTime,&exitTime,&kernelTime,&userTime)) { continue; }
+		ULARGE_INTEGER kernel, user;
+		kernel.LowPart  = kernelTime.dwLowDateTime;
+		kernel.HighPart = kernelTime.dwHighDateTime;
+		user.LowPart    = userTime.dwLowDateTime;
+		user.HighPart   = userTime.dwHighDateTime;
+		ULONGLONG cpuMs = (kernel.QuadPart+user.QuadPart)/10000;
+		appendLine(buffer,size,length,"litesrv_process_cpu_seconds_total{service=\"%s\",instance=\"%d\"} %llu.%03llu\n",
+					label,i,cpuMs/1000,cpuMs%1000);
+	}
+	appendLine(buffer,size,length,
+		"# HELP litesrv_process_resident_memory_bytes Working set of the process.\n"
+		"# TYPE litesrv_process_resident_memory_bytes gauge\n");
+	for(int i=0;i<count;i++)
+	{
+		PROCESS_MEMORY_COUNTERS memory;
+		memory.cb = sizeof(memory);
+		if((processes[i] == 0)||!GetProcessMemoryInfo(processes[i],&memory,sizeof(memory))) { continue; }
+		appendLine(buffer,size,length,"litesrv_process_resident_memory_bytes{service=\"%s\",instance=\"%d\"} %llu\n",
+					label,i,(ULONGLONG)memory.WorkingSetSize);
+	}
+
+	return length;
+}
+
@@ -0,0 +1,152 @@
+
+// prevent multiple inclusion
+
+#if !defined(__METRICS_SERVER_H__)
+#define __METRICS_SERVER_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting MetricsServer")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("MetricsServer is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing MetricsServer")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+class ServiceMetrics;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most scrapes served at once, and longest address
+const int MAX_METRICS_CLIENTS = 4;
+const int METRICS_SPEC_SIZE   = MAX_PATH;
+
+// ============================================================================
+//
+// MetricsServer class
+//
+// A small HTTP server for the metrics of a service, in the Prometheus text
+// format, on one of
+//   tcp [address:]port    TCP on an IPv4 address (127.0.0.1 if not given)
+//   unix path             Unix domain socket
+//
+// It runs on the thread which supervises the service: its event is
+// signalled when a scraper connects or sends, and serve() then moves each
+// scrape on as far as it can without blocking. A scrape which takes too
+// long is dropped, so the loop waits no longer than getWaitTime(). The
+// response is written into a buffer which each scrape slot has from the
+// start, so a scrape allocates nothing.
+//
+// ============================================================================
+class LiteSrv_DLL_API MetricsServer
+{
+public:
+	// address (see above for the syntax of spec)
+	void setAddress(const char *spec) throw (LiteSrvException);
+	const char *getAddress() const;
+	bool isEnabled() const;
+
+	// start listening (once)
+	void open() throw (LiteSrvException);
+
+	// event signalled when there is something to serve / has it been, or
+	// has a scrape run out of time? / milliseconds until one does
+	// (INFINITE if none is in progress)
+	HANDLE getEvent() const;
+	bool   isDue() const;
+	DWORD  getWaitTime() const;
+
+	// serve the scrapes - the metrics, the state of the service (one of
+	// stateCount states), and the processes (handle 0 = none in that slot)
+	void serve(const ServiceMetrics &metrics,const char *service,
+				const char * const states[],int stateCount,int state,
+				const HANDLE processes[],int count);
+
+	// constructor and destructor
+	MetricsServer();
+	virtual ~MetricsServer();
+
+private:
+	struct Client;
+
+	// service functions
+	void acceptClients();
+	bool readRequest(Client &client);
+	void sendResponse(Client &client);
+	void closeClient(Client &client);
+	int  render(char *buffer,int size,const ServiceMetrics &metrics,const char *service,
+				const char * const states[],int stateCount,int state,
+				const HANDLE processes[],int count) const;
+
+	// private variables
+	char      spec[METRICS_SPEC_SIZE];
+	bool      unixSocket;
+	char      path[METRICS_SPEC_SIZE];
+	ULONG     address;				// network byte order
+	USHORT    port;
+	UINT_PTR  listenSocket;			// a SOCKET
+	HANDLE    hEvent;
+	bool      winsockStarted;
+	Client   *clients[MAX_METRICS_CLIENTS];
+
+	// prevent copying
+	MetricsServer(const MetricsServer&);
+	MetricsServer &operator=(const MetricsServer&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__METRICS_SERVER_H__)
@@ -0,0 +1,324 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ProcessPlacement.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int   MAX_AFFINITY_CPUS   = (int)sizeof(DWORD_PTR)*8;
+const int   MAX_IO_PRIORITY     = 3;
+const int   MAX_MEMORY_PRIORITY = 5;
+
+// NtSetInformationProcess, and its I/O priority class (the I/O priority is
+// an IO_PRIORITY_HINT, from IoPriorityVeryLow = 0)
+typedef LONG (NTAPI *NtSetInformationProcessFunction)(HANDLE,ULONG,PVOID,ULONG);
+const char *NT_SET_INFORMATION_PROCESS = "NtSetInformationProcess";
+const ULONG PROCESS_IO_PRIORITY_CLASS  = 33;
+
+const char *IO_PRIORITY_NAMES[]     = { "inherited", "very low", "low", "normal" };
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ProcessPlacement::setAffinity
+//                   ProcessPlacement::getAffinity
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the CPUs the command may run on
+//
+// ARGUMENTS       : spec IN "0x<mask>", a list of CPUs and ranges of CPUs
+//                           ("0-3,6"), or "" for every CPU
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ProcessPlacement::setAffinity
+(
+	const char *spec
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("ProcessPlacement::setAffinity('%s')",spec)
+
+#define	BAD_AFFINITY(reason) \
+	{ LOGGER_LOG_ERROR2("invalid CPU affinity '%s': %s",spec,reason) \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_INVALID_PARAMETER,"ProcessPlacement","setAffinity") }
+
+	if((spec == 0)||(strlen(spec) >= AFFINITY_SPEC_SIZE)) BAD_AFFINITY("too long")
+
+	DWORD_PTR   mask = 0;
+	const char *next = spec;
+	char       *end;
+	while(*next == ' ') { next++; }
+	if(!_strnicmp(next,"0x",2))
+	{
+		mask = (DWORD_PTR)_strtoui64(next+2,&end,16);
+		if((end == next+2)||(*end != '\0')) BAD_AFFINITY("invalid mask")
+	}
+	else
+	{
+		while(*next != '\0')
+		{
+			long first = strtol(next,&end,10);
+			long last  = first;
+			if(end == next) BAD_AFFINITY("expected a CPU number")
+			if(*end == '-')
+			{
+				next = end+1;
+				last = strtol(next,&end,10);
+				if(end == next) BAD_AFFINITY("expected a CPU number")
+			}
+			if((first < 0)||(last < first)||(last >= MAX_AFFINITY_CPUS)) BAD_AFFINITY("invalid CPU range")
+			for(long cpu=first;cpu<=last;cpu++) { mask |= (DWORD_PTR)1<<cpu; }
+
+			next = end;
+			if(*next == ',')
+			{
+				next++;
+				if(*next == '\0') BAD_AFFINITY("expected a CPU number")
+			}
+			else if(*next != '\0') BAD_AFFINITY("expected ','")
+		}
+	}
+
+	// every CPU must be one we may run on
+	DWORD_PTR processMask,systemMask;
+	if((mask != 0)&&GetProcessAffinityMask(GetCurrentProcess(),&processMask,&systemMask)&&
+	   ((mask&~systemMask) != 0))
+		BAD_AFFINITY("not every CPU is in this machine")
+
+#undef	BAD_AFFINITY
+
+	affinity = mask;
+	strcpy(affinitySpec,spec);
+}
+
+const char *ProcessPlacement::getAffinity() const { return affinitySpec; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ProcessPlacement::setThrottled
+//                   ProcessPlacement::setIoPriority
+//                   ProcessPlacement::setMemoryPriority
+//                   ProcessPlacement::isThrottled
+//                   ProcessPlacement::getIoPriority
+//                   ProcessPlacement::getMemoryPriority
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get efficiency mode, the I/O priority and the
+//                   memory priority (out of range values are inherited)
+//
+// ============================================================================
+void ProcessPlacement::setThrottled(bool th) { throttled = th; }
+void ProcessPlacement::setIoPriority(int ip) { ioPriority = ((ip > 0)&&(ip <= MAX_IO_PRIORITY)) ? ip : 0; }
+void ProcessPlacement::setMemoryPriority(int mp) { memoryPriority = ((mp > 0)&&(mp <= MAX_MEMORY_PRIORITY)) ? mp : 0; }
+bool ProcessPlacement::isThrottled() const { return throttled; }
+int  ProcessPlacement::getIoPriority() const { return ioPriority; }
+int  ProcessPlacement::getMemoryPriority() const { return memoryPriority; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ProcessPlacement::isEnabled
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : does a command need placing?
+//
+// ARGUMENTS       : instanceCpus IN CPUs per instance (0 = not pinned)
+//
+// ============================================================================
+bool ProcessPlacement::isEnabled
+(
+	int instanceCpus
+) const
+{
+	return (affinity != 0)||throttled||(ioPriority != 0)||(memoryPriority != 0)||(instanceCpus > 0);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ProcessPlacement::apply
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : place a process which has not started running yet
+//
+// ARGUMENTS       : hProcess     IN process
+//                   instance     IN instance number
+//                   instanceCpus IN CPUs of its own (0 = not pinned)
+//
+// THROWS          : LiteSrvException (the process cannot be placed)
+//
+// ============================================================================
+void ProcessPlacement::apply
+(
+	HANDLE hProcess,
+	int    instance,
+	int    instanceCpus
+) const throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG2("ProcessPlacement::apply(%d,%d)",instance,instanceCpus)
+
+#define	CANNOT_PLACE(what,error) \
+	{ LOGGER_LOG_ERROR3("failed to set the %s of instance %d, error=%d",what,instance,error) \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_GENERAL_ERROR,"ProcessPlacement","apply") }
+
+	// CPUs
+	DWORD_PTR mask = (instanceCpus > 0) ? getInstanceAffinity(instance,instanceCpus) : affinity;
+	if(mask != 0)
+	{
+		if(!SetProcessAffinityMask(hProcess,mask)) CANNOT_PLACE("CPU affinity",GetLastError())
+		LOGGER_LOG_INFO2("instance %d runs on CPU mask 0x%llx",instance,(ULONGLONG)mask)
+	}
+
+	// efficiency mode
+	if(throttled)
+	{
+		PROCESS_POWER_THROTTLING_STATE throttling;
+		memset(&throttling,0,sizeof(throttling));
+		throttling.Version     = PROCESS_POWER_THROTTLING_CURRENT_VERSION;
+		throttling.ControlMask = PROCESS_POWER_THROTTLING_EXECUTION_SPEED;
+		throttling.StateMask   = PROCESS_POWER_THROTTLING_EXECUTION_SPEED;
+		if(!SetProcessInformation(hProcess,ProcessPowerThrottling,&throttling,sizeof(throttling)))
+			CANNOT_PLACE("efficiency mode",GetLastError())
+		LOGGER_LOG_INFO1("instance %d runs in efficiency mode",instance)
+	}
+
+	// memory priority
+	if(memoryPriority != 0)
+	{
+		MEMORY_PRIORITY_INFORMATION memoryPriorityInformation;
+		memoryPriorityInformation.MemoryPriority = (ULONG)memoryPriority;
+		if(!SetProcessInformation(hProcess,ProcessMemoryPriority,&memoryPriorityInformation,
+									sizeof(memoryPriorityInformation)))
+			CANNOT_PLACE("memory priority",GetLastError())
+		LOGGER_LOG_INFO2("instance %d has memory priority %d",instance,memoryPriority)
+	}
+
+	// I/O priority
+	if(ioPriority != 0)
+	{
+		NtSetInformationProcessFunction ntSetInformationProcess = (NtSetInformationProcessFunction)
+				GetProcAddress(GetModuleHandle("ntdll.dll"),NT_SET_INFORMATION_PROCESS);
+		if(ntSetInformationProcess == NULL) CANNOT_PLACE("I/O priority",GetLastError())
+
+		ULONG hint   = (ULONG)(ioPriority-1);
+		LONG  status = (*ntSetInformationProcess)(hProcess,PROCESS_IO_PRIORITY_CLASS,&hint,sizeof(hint));
+		if(status < 0) CANNOT_PLACE("I/O priority",status)
+		LOGGER_LOG_INFO2("instance %d has %s I/O priority",instance,IO_PRIORITY_NAMES[ioPriority])
+	}
+
+#undef	CANNOT_PLACE
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ProcessPlacement::ProcessPlacement
+//                   ProcessPlacement::~ProcessPlacement
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+ProcessPlacement::ProcessPlacement()
+{
+	affinitySpec[0] = '\0';
+	affinity        = 0;
+	throttled       = false;
+	ioPriority      = 0;
+	memoryPriority  = 0;
+}
+
+ProcessPlacement::~ProcessPlacement()
+{
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ProcessPlacement::getInstanceAffinity
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : CPUs for an instance of the command, from those it may
+//                   run on - instance n has the instanceCpus CPUs after the
+//                   (n*instanceCpus)th, wrapping round
+//
+// ARGUMENTS       : instance     IN instance number
+//                   instanceCpus IN CPUs per instance
+//
+// RETURNS         : affinity mask
+//
+// ============================================================================
+DWORD_PTR ProcessPlacement::getInstanceAffinity
+(
+	int instance,
+	int instanceCpus
+) const
+{
+	// the CPUs the command may run on
+	DWORD_PTR allowed = affinity;
+	if(allowed == 0)
+	{
+		DWORD_PTR processMask;
+		if(!GetProcessAffinityMask(GetCurrentProcess(),&processMask,&allowed)) { allowed = 1; }
+	}
+
+	int cpus[MAX_AFFINITY_CPUS];
+	int cpuCount = 0;
+	for(int cpu=0;cpu<MAX_AFFINITY_CPUS;cpu++)
+	{
+		if((allowed&((DWORD_PTR)1<<cpu)) != 0) { cpus[cpuCount++] = cpu; }
+	}
+	if(instanceCpus > cpuCount) { instanceCpus = cpuCount; }
+
+	DWORD_PTR mask = 0;
+	for(int i=0;i<instanceCpus;i++)
+	{
+		mask |= (DWORD_PTR)1<<cpus[(instance*instanceCpus+i)%cpuCount];
+	}
+	return mask;
+}
+
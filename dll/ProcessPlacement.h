@@ -0,0 +1,134 @@
+
+// prevent multiple inclusion
+
+#if !defined(__PROCESS_PLACEMENT_H__)
+#define __PROCESS_PLACEMENT_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting ProcessPlacement")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("ProcessPlacement is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing ProcessPlacement")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// longest CPU affinity spec
+const int AFFINITY_SPEC_SIZE = 256;
+
+// ============================================================================
+//
+// ProcessPlacement class
+//
+// Where and how a command runs, beyond its priority class: the CPUs it may
+// run on (and the CPUs of each replica among them), efficiency mode
+// (EcoQoS, for batch work), its I/O priority and its memory priority. The
+// command is created suspended and placed before it runs any code.
+//
+// The I/O priority is set through NtSetInformationProcess, as Windows has
+// no documented call to set it for another process.
+//
+// ============================================================================
+class LiteSrv_DLL_API ProcessPlacement
+{
+public:
+	// CPUs the command may run on - a mask ("0x0f") or a list ("0-3,6"),
+	// empty for every CPU
+	void setAffinity(const char *spec) throw (LiteSrvException);
+	const char *getAffinity() const;
+
+	// efficiency mode, I/O priority (0 = inherited, 1 = very low, 2 = low,
+	// 3 = normal) and memory priority (0 = inherited, 1 = very low to
+	// 5 = normal)
+	void setThrottled(bool th);
+	void setIoPriority(int ip);
+	void setMemoryPriority(int mp);
+	bool isThrottled() const;
+	int  getIoPriority() const;
+	int  getMemoryPriority() const;
+
+	// does a command started with instanceCpus CPUs per instance need placing?
+	bool isEnabled(int instanceCpus) const;
+
+	// place a suspended process - an instance of the command with instanceCpus
+	// CPUs of its own (0 = not pinned)
+	void apply(HANDLE hProcess,int instance,int instanceCpus) const throw (LiteSrvException);
+
+	// constructor and destructor
+	ProcessPlacement();
+	virtual ~ProcessPlacement();
+
+private:
+	// service functions
+	DWORD_PTR getInstanceAffinity(int instance,int instanceCpus) const;
+
+	// private variables
+	char      affinitySpec[AFFINITY_SPEC_SIZE];
+	DWORD_PTR affinity;					// 0 = every CPU
+	bool      throttled;
+	int       ioPriority;
+	int       memoryPriority;
+
+	// prevent copying
+	ProcessPlacement(const ProcessPlacement&);
+	ProcessPlacement &operator=(const ProcessPlacement&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__PROCESS_PLACEMENT_H__)
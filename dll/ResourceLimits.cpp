@@ -0,0 +1,378 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ResourceLimits.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const SIZE_T MEGABYTE     = 1024*1024;
+const DWORD  MAX_CPU_RATE = 10000;		// the whole machine, in 1/100ths of a percent
+
+const char *BREACH_NAMES[] = { "no", "process memory", "service memory" };
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::setProcessMemory
+//                   ResourceLimits::setServiceMemory
+//                   ResourceLimits::setCpuQuota
+//                   ResourceLimits::setProcessCount
+//                   ResourceLimits::getProcessMemory
+//                   ResourceLimits::getServiceMemory
+//                   ResourceLimits::getCpuQuota
+//                   ResourceLimits::getProcessCount
+//                   ResourceLimits::isEnabled
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the limits (0 = none) - they apply to the
+//                   processes started after they are set
+//
+// ============================================================================
+void ResourceLimits::setProcessMemory(int mb) { processMemory = (mb > 0) ? mb : 0; }
+void ResourceLimits::setServiceMemory(int mb) { serviceMemory = (mb > 0) ? mb : 0; }
+void ResourceLimits::setCpuQuota(int percent) { cpuQuota = (percent > 0) ? percent : 0; }
+void ResourceLimits::setProcessCount(int count) { processCount = (count > 0) ? count : 0; }
+int  ResourceLimits::getProcessMemory() const { return processMemory; }
+int  ResourceLimits::getServiceMemory() const { return serviceMemory; }
+int  ResourceLimits::getCpuQuota() const { return cpuQuota; }
+int  ResourceLimits::getProcessCount() const { return processCount; }
+
+bool ResourceLimits::isEnabled() const
+{
+	return (processMemory > 0)||(serviceMemory > 0)||(cpuQuota > 0)||(processCount > 0);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::assign
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : put a process which has not started running yet in the
+//                   job, creating the job the first time
+//
+// ARGUMENTS       : hProcess IN process
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ResourceLimits::assign
+(
+	HANDLE hProcess
+) throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("ResourceLimits::assign()")
+
+	if(hJob == NULL) { createJob(); }
+
+	if(!AssignProcessToJobObject(hJob,hProcess))
+	{
+		LOGGER_LOG_ERROR1("failed to put the command in its job, error=%d",GetLastError())
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_GENERAL_ERROR,"ResourceLimits","assign")
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::takeBreach
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : the breach made by a process since it was last asked
+//                   about
+//
+// ARGUMENTS       : processId IN process
+//
+// RETURNS         : the breach, or BREACH_NONE
+//
+// ============================================================================
+ResourceLimits::BREACHES ResourceLimits::takeBreach
+(
+	DWORD processId
+)
+{
+	readMessages();
+
+	int found = -1;
+	for(int i=0;(i<breachCount)&&(found<0);i++)
+	{
+		if(breachProcessIds[i] == processId) { found = i; }
+	}
+	if(found < 0) { return BREACH_NONE; }
+
+	BREACHES breach = breaches[found];
+	for(int i=found+1;i<breachCount;i++)
+	{
+		breachProcessIds[i-1] = breachProcessIds[i];
+		breaches[i-1]         = breaches[i];
+	}
+	breachCount--;
+	return breach;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::checkService
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : the process starts refused at the process limit since
+//                   the last check - they are forgotten
+//
+// RETURNS         : how many
+//
+// ============================================================================
+int ResourceLimits::checkService()
+{
+	readMessages();
+
+	int refused = serviceBreaches;
+	serviceBreaches = 0;
+	return refused;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::getBreachName
+//
+// ACCESS SPECIFIER: public static
+//
+// DESCRIPTION     : the limit a breach was of (for log messages)
+//
+// ============================================================================
+const char *ResourceLimits::getBreachName(BREACHES breach) { return BREACH_NAMES[breach]; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::ResourceLimits
+//                   ResourceLimits::~ResourceLimits
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor - closing the job kills any
+//                   process still in it
+//
+// ============================================================================
+ResourceLimits::ResourceLimits()
+{
+	processMemory   = 0;
+	serviceMemory   = 0;
+	cpuQuota        = 0;
+	processCount    = 0;
+	hJob            = NULL;
+	hPort           = NULL;
+	breachCount     = 0;
+	serviceBreaches = 0;
+}
+
+ResourceLimits::~ResourceLimits()
+{
+	if(hJob != NULL) { CloseHandle(hJob); }
+	if(hPort != NULL) { CloseHandle(hPort); }
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::createJob
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : create the job, with the limits, and the completion port
+//                   its notifications are sent to
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ResourceLimits::createJob() throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("ResourceLimits::createJob()")
+
+#define	JOB_FAILED(what) \
+	{ LOGGER_LOG_ERROR2("failed to %s, error=%d",what,GetLastError()) \
+	  if(hJob != NULL) { CloseHandle(hJob); hJob = NULL; } \
+	  if(hPort != NULL) { CloseHandle(hPort); hPort = NULL; } \
+	  THROW_LiteSrv_EXCEPTION(LiteSrv_EXCEPTION_GENERAL_ERROR,"ResourceLimits","createJob") }
+
+	hJob = CreateJobObject(NULL,NULL);
+	if(hJob == NULL) JOB_FAILED("create the job")
+
+	// memory and process count
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+	memset(&limits,0,sizeof(limits));
+	limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+	if(processMemory > 0)
+	{
+		limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_PROCESS_MEMORY;
+		limits.ProcessMemoryLimit = (SIZE_T)processMemory*MEGABYTE;
+	}
+	if(serviceMemory > 0)
+	{
+		limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+		limits.JobMemoryLimit = (SIZE_T)serviceMemory*MEGABYTE;
+	}
+	if(processCount > 0)
+	{
+		limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_ACTIVE_PROCESS;
+		limits.BasicLimitInformation.ActiveProcessLimit = (DWORD)processCount;
+	}
+	if(!SetInformationJobObject(hJob,JobObjectExtendedLimitInformation,&limits,sizeof(limits)))
+		JOB_FAILED("set the job limits")
+
+	// CPU, as a share of the whole machine
+	if(cpuQuota > 0)
+	{
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		DWORD rate = (DWORD)cpuQuota*100/systemInfo.dwNumberOfProcessors;
+		if(rate < 1) { rate = 1; }
+		if(rate > MAX_CPU_RATE) { rate = MAX_CPU_RATE; }
+
+		JOBOBJECT_CPU_RATE_CONTROL_INFORMATION cpuRate;
+		memset(&cpuRate,0,sizeof(cpuRate));
+		cpuRate.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE|JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+		cpuRate.CpuRate      = rate;
+		if(!SetInformationJobObject(hJob,JobObjectCpuRateControlInformation,&cpuRate,sizeof(cpuRate)))
+			JOB_FAILED("set the job CPU quota")
+	}
+
+	// notifications
+	hPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE,NULL,0,1);
+	if(hPort == NULL) JOB_FAILED("create the job completion port")
+	JOBOBJECT_ASSOCIATE_COMPLETION_PORT port;
+	port.CompletionKey  = hJob;
+	port.CompletionPort = hPort;
+	if(!SetInformationJobObject(hJob,JobObjectAssociateCompletionPortInformation,&port,sizeof(port)))
+		JOB_FAILED("set the job completion port")
+
+#undef	JOB_FAILED
+
+	LOGGER_LOG_INFO3("command limits: %d MB per process, %d MB in all, %d%% of a CPU",
+						processMemory,serviceMemory,cpuQuota)
+	LOGGER_LOG_INFO1("command limits: %d processes",processCount)
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::readMessages
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : take the notifications waiting on the completion port,
+//                   and remember the breaches (those at the process limit
+//                   are counted for the service, whatever process tried
+//                   to start one)
+//
+// ============================================================================
+void ResourceLimits::readMessages()
+{
+	if(hPort == NULL) { return; }
+
+	DWORD        message;
+	ULONG_PTR    key;
+	LPOVERLAPPED overlapped;
+	while(GetQueuedCompletionStatus(hPort,&message,&key,&overlapped,0))
+	{
+		// the process id comes in place of the OVERLAPPED
+		DWORD processId = (DWORD)(ULONG_PTR)overlapped;
+		switch(message)
+		{
+			case JOB_OBJECT_MSG_PROCESS_MEMORY_LIMIT:
+				addBreach(processId,BREACH_PROCESS_MEMORY);
+				break;
+			case JOB_OBJECT_MSG_JOB_MEMORY_LIMIT:
+				addBreach(processId,BREACH_SERVICE_MEMORY);
+				break;
+			case JOB_OBJECT_MSG_ACTIVE_PROCESS_LIMIT:
+				serviceBreaches++;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceLimits::addBreach
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : remember a breach (the latest one for each process,
+//                   forgetting the oldest when there are too many)
+//
+// ARGUMENTS       : processId IN process
+//                   breach    IN breach
+//
+// ============================================================================
+void ResourceLimits::addBreach
+(
+	DWORD    processId,
+	BREACHES breach
+)
+{
+	LOGGER_LOG_ERROR2("process %lu breached the %s limit",processId,BREACH_NAMES[breach])
+
+	for(int i=0;i<breachCount;i++)
+	{
+		if(breachProcessIds[i] == processId)
+		{
+			breaches[i] = breach;
+			return;
+		}
+	}
+	if(breachCount == MAX_LIMIT_BREACHES)
+	{
+		for(int i=1;i<breachCount;i++)
+		{
+			breachProcessIds[i-1] = breachProcessIds[i];
+			breaches[i-1]         = breaches[i];
+		}
+		breachCount--;
+	}
+	breachProcessIds[breachCount] = processId;
+	breaches[breachCount]         = breach;
+	breachCount++;
+}
+
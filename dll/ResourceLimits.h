@@ -0,0 +1,155 @@
+
+// prevent multiple inclusion
+
+#if !defined(__RESOURCE_LIMITS_H__)
+#define __RESOURCE_LIMITS_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting ResourceLimits")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("ResourceLimits is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing ResourceLimits")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most limit breaches remembered until the process which made them exits
+const int MAX_LIMIT_BREACHES = 64;
+
+// how often the service as a whole is checked for breaches
+const DWORD LIMIT_CHECK_MS   = 1000;
+
+// ============================================================================
+//
+// ResourceLimits class
+//
+// Limits on the command, and every process it starts: the memory each
+// process may commit, the memory they may commit between them, the CPU
+// they may use between them (a hard cap, in percent of one CPU) and the
+// number of processes. The processes are put in a job object (one per
+// service) while they are suspended, so there is no escaping it, and the
+// job kills them if LiteSrv goes away.
+//
+// Windows fails an allocation beyond a memory limit, or a process start
+// beyond the process limit, rather than killing the process. The memory
+// breaches are remembered, so that the exit of a process which made one
+// can be reported as such. A process start refused at the process limit
+// cannot be put down to any one process: the supervision loop calls
+// checkService() every LIMIT_CHECK_MS, and reports those as they happen.
+//
+// ============================================================================
+class LiteSrv_DLL_API ResourceLimits
+{
+public:
+	// limit breaches
+	typedef enum BREACHES { BREACH_NONE, BREACH_PROCESS_MEMORY, BREACH_SERVICE_MEMORY };
+
+	// limits (0 = none) - memory in MB
+	void setProcessMemory(int mb);
+	void setServiceMemory(int mb);
+	void setCpuQuota(int percent);
+	void setProcessCount(int count);
+	int  getProcessMemory() const;
+	int  getServiceMemory() const;
+	int  getCpuQuota() const;
+	int  getProcessCount() const;
+	bool isEnabled() const;
+
+	// put a suspended process in the job (created the first time)
+	void assign(HANDLE hProcess) throw (LiteSrvException);
+
+	// the breach made by a process since it was last asked about - it is
+	// forgotten
+	BREACHES takeBreach(DWORD processId);
+
+	// process starts refused at the process limit since the last check
+	int checkService();
+	static const char *getBreachName(BREACHES breach);
+
+	// constructor and destructor
+	ResourceLimits();
+	virtual ~ResourceLimits();
+
+private:
+	// service functions
+	void createJob() throw (LiteSrvException);
+	void readMessages();
+	void addBreach(DWORD processId,BREACHES breach);
+
+	// private variables
+	int      processMemory;
+	int      serviceMemory;
+	int      cpuQuota;
+	int      processCount;
+	HANDLE   hJob;
+	HANDLE   hPort;					// job notifications
+
+	// breaches not yet taken, oldest first
+	DWORD    breachProcessIds[MAX_LIMIT_BREACHES];
+	BREACHES breaches[MAX_LIMIT_BREACHES];
+	int      breachCount;
+	int      serviceBreaches;		// not yet checked
+
+	// prevent copying
+	ResourceLimits(const ResourceLimits&);
+	ResourceLimits &operator=(const ResourceLimits&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__RESOURCE_LIMITS_H__)
@@ -0,0 +1,344 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <psapi.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ResourceSampler.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const SIZE_T MEGABYTE = 1024*1024;
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::setInterval
+//                   ResourceSampler::getInterval
+//                   ResourceSampler::isEnabled
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the sampling interval (seconds, 0 = off -
+//                   but a memory threshold needs samples, so then it is
+//                   DEFAULT_SAMPLE_INTERVAL)
+//
+// ============================================================================
+void ResourceSampler::setInterval(int seconds) { interval = (seconds > 0) ? seconds : 0; }
+int  ResourceSampler::getInterval() const
+{
+	return (interval > 0) ? interval : (memoryThreshold > 0) ? DEFAULT_SAMPLE_INTERVAL : 0;
+}
+bool ResourceSampler::isEnabled() const { return getInterval() > 0; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::setMemoryThreshold
+//                   ResourceSampler::setThresholdSamples
+//                   ResourceSampler::getMemoryThreshold
+//                   ResourceSampler::getThresholdSamples
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the working set (MB, 0 = none) a process may
+//                   not stay over, and for how many samples in a row
+//
+// ============================================================================
+void ResourceSampler::setMemoryThreshold(int mb) { memoryThreshold = (mb > 0) ? mb : 0; }
+void ResourceSampler::setThresholdSamples(int samples)
+{
+	thresholdSamples = (samples < 1) ? 1 : (samples > SAMPLE_HISTORY) ? SAMPLE_HISTORY : samples;
+}
+int  ResourceSampler::getMemoryThreshold() const { return memoryThreshold; }
+int  ResourceSampler::getThresholdSamples() const { return thresholdSamples; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::sample
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : take a sample of each process
+//
+// ARGUMENTS       : processes  IN process handles (0 = none in that slot)
+//                   processIds IN process ids
+//                   count      IN number of slots
+//
+// ============================================================================
+void ResourceSampler::sample
+(
+	const HANDLE processes[],
+	const DWORD  processIds[],
+	int          count
+)
+{
+	if(count > MAX_SAMPLED_PROCESSES) { count = MAX_SAMPLED_PROCESSES; }
+
+	ULONGLONG now = GetTickCount64();
+	for(int i=0;i<count;i++)
+	{
+		if(processes[i] == 0)
+		{
+			this->processes[i].processId = 0;
+			continue;
+		}
+		sampleProcess(this->processes[i],processes[i],processIds[i],now);
+	}
+	for(int i=count;i<MAX_SAMPLED_PROCESSES;i++) { this->processes[i].processId = 0; }
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::getLatest
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : latest sample of the process in a slot
+//
+// ARGUMENTS       : slot   IN  slot
+//                   latest OUT sample
+//
+// RETURNS         : false if there is none
+//
+// ============================================================================
+bool ResourceSampler::getLatest
+(
+	int             slot,
+	ResourceSample &latest
+) const
+{
+	if((slot < 0)||(slot >= MAX_SAMPLED_PROCESSES)) { return false; }
+
+	const Process &process = processes[slot];
+	if((process.processId == 0)||(process.sampleCount == 0)) { return false; }
+	latest = process.samples[(process.next+SAMPLE_HISTORY-1)%SAMPLE_HISTORY];
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::getHistory
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : the samples of the process in a slot, oldest first
+//
+// ARGUMENTS       : slot       IN  slot
+//                   history    OUT samples
+//                   maxSamples IN  size of history
+//
+// RETURNS         : number of samples
+//
+// ============================================================================
+int ResourceSampler::getHistory
+(
+	int            slot,
+	ResourceSample history[],
+	int            maxSamples
+) const
+{
+	if((slot < 0)||(slot >= MAX_SAMPLED_PROCESSES)) { return 0; }
+
+	const Process &process = processes[slot];
+	if(process.processId == 0) { return 0; }
+
+	int count = (process.sampleCount < maxSamples) ? process.sampleCount : maxSamples;
+	int first = (process.next+SAMPLE_HISTORY-count)%SAMPLE_HISTORY;
+	for(int i=0;i<count;i++) { history[i] = process.samples[(first+i)%SAMPLE_HISTORY]; }
+	return count;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::getProcessId
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : process sampled in a slot (0 = none)
+//
+// ============================================================================
+DWORD ResourceSampler::getProcessId
+(
+	int slot
+) const
+{
+	return ((slot < 0)||(slot >= MAX_SAMPLED_PROCESSES)) ? 0 : processes[slot].processId;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::isOverThreshold
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : has the working set of the process in a slot been over
+//                   the memory threshold for the last thresholdSamples
+//                   samples?
+//
+// ARGUMENTS       : slot IN  slot
+//                   peak OUT largest working set of the process (bytes)
+//
+// RETURNS         : true if the process is due to be recycled
+//
+// ============================================================================
+bool ResourceSampler::isOverThreshold
+(
+	int     slot,
+	SIZE_T &peak
+) const
+{
+	if((memoryThreshold == 0)||(slot < 0)||(slot >= MAX_SAMPLED_PROCESSES)) { return false; }
+
+	const Process &process = processes[slot];
+	if((process.processId == 0)||(process.sampleCount < thresholdSamples)) { return false; }
+
+	SIZE_T threshold = (SIZE_T)memoryThreshold*MEGABYTE;
+	for(int i=1;i<=thresholdSamples;i++)
+	{
+		if(process.samples[(process.next+SAMPLE_HISTORY-i)%SAMPLE_HISTORY].workingSet <= threshold) { return false; }
+	}
+	peak = process.peakWorkingSet;
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::ResourceSampler
+//                   ResourceSampler::~ResourceSampler
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+ResourceSampler::ResourceSampler()
+{
+	interval         = 0;
+	memoryThreshold  = 0;
+	thresholdSamples = DEFAULT_THRESHOLD_SAMPLES;
+	for(int i=0;i<MAX_SAMPLED_PROCESSES;i++)
+	{
+		processes[i].processId      = 0;
+		processes[i].next           = 0;
+		processes[i].sampleCount    = 0;
+		processes[i].peakWorkingSet = 0;
+	}
+}
+
+ResourceSampler::~ResourceSampler()
+{
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ResourceSampler::sampleProcess
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : read the counters of a process - the first reading of a
+//                   process only sets the baseline for its deltas
+//
+// ARGUMENTS       : process   IN/OUT sampled process
+//                   hProcess  IN     process handle
+//                   processId IN     process id
+//                   now       IN     GetTickCount64()
+//
+// ============================================================================
+void ResourceSampler::sampleProcess
+(
+	Process   &process,
+	HANDLE     hProcess,
+	DWORD      processId,
+	ULONGLONG  now
+)
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	IO_COUNTERS io;
+	PROCESS_MEMORY_COUNTERS_EX memory;
+	DWORD handleCount = 0;
+	memory.cb = sizeof(memory);
+	if(!GetProcessTimes(hProcess,&creationTime,&exitTime,&kernelTime,&userTime)||
+	   !GetProcessIoCounters(hProcess,&io)||
+	   !GetProcessMemoryInfo(hProcess,(PROCESS_MEMORY_COUNTERS*)&memory,sizeof(memory))||
+	   !GetProcessHandleCount(hProcess,&handleCount))
+	{
+		LOGGER_LOG_DEBUG2("failed to sample process %lu, error=%d",processId,GetLastError())
+		return;
+	}
+
+	ULARGE_INTEGER kernel, user;
+	kernel.LowPart  = kernelTime.dwLowDateTime;
+	kernel.HighPart = kernelTime.dwHighDateTime;
+	user.LowPart    = userTime.dwLowDateTime;
+	user.HighPart   = userTime.dwHighDateTime;
+	ULONGLONG cpuTime = kernel.QuadPart+user.QuadPart;
+
+	// a new process starts a new history
+	if(process.processId != processId)
+	{
+		process.processId   = processId;
+		process.next           = 0;
+		process.sampleCount    = 0;
+		process.peakWorkingSet = 0;
+	}
+	else
+	{
+		ResourceSample &sample = process.samples[process.next];
+		sample.time         = now;
+		sample.elapsedMs    = (DWORD)(now-process.time);
+		sample.cpuTime      = cpuTime-process.cpuTime;
+		sample.readBytes    = io.ReadTransferCount-process.readBytes;
+		sample.writeBytes   = io.WriteTransferCount-process.writeBytes;
+		sample.workingSet   = memory.WorkingSetSize;
+		sample.privateBytes = memory.PrivateUsage;
+		sample.handleCount  = handleCount;
+		process.next = (process.next+1)%SAMPLE_HISTORY;
+		if(process.sampleCount < SAMPLE_HISTORY) { process.sampleCount++; }
+		if(sample.workingSet > process.peakWorkingSet) { process.peakWorkingSet = sample.workingSet; }
+
+		LOGGER_LOG_DEBUG4("process %lu: %llu00ns CPU, %lu KB in memory, %lu handles",processId,
+							sample.cpuTime,(DWORD)(sample.workingSet/1024),handleCount)
+	}
+	process.time       = now;
+	process.cpuTime    = cpuTime;
+	process.readBytes  = io.ReadTransferCount;
+	process.writeBytes = io.WriteTransferCount;
+}
+
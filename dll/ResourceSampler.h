@@ -0,0 +1,176 @@
+
+// prevent multiple inclusion
+
+#if !defined(__RESOURCE_SAMPLER_H__)
+#define __RESOURCE_SAMPLER_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting ResourceSampler")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("ResourceSampler is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing ResourceSampler")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most processes sampled, and samples kept for each one
+const int MAX_SAMPLED_PROCESSES = MAXIMUM_WAIT_OBJECTS;
+const int SAMPLE_HISTORY        = 60;
+
+// sampling interval (seconds) when only a memory threshold asks for it,
+// and samples over the threshold before a process is recycled
+const int DEFAULT_SAMPLE_INTERVAL   = 10;
+const int DEFAULT_THRESHOLD_SAMPLES = 3;
+
+// ============================================================================
+//
+// ResourceSample - what a process used between two samples (the deltas)
+// and what it held at the second one
+//
+// ============================================================================
+struct ResourceSample
+{
+	ULONGLONG time;					// GetTickCount64() when taken
+	DWORD     elapsedMs;			// since the previous sample
+	ULONGLONG cpuTime;				// kernel + user, in 100ns units
+	ULONGLONG readBytes;
+	ULONGLONG writeBytes;
+	SIZE_T    workingSet;			// bytes in memory
+	SIZE_T    privateBytes;			// bytes committed
+	DWORD     handleCount;
+};
+
+// ============================================================================
+//
+// ResourceSampler class
+//
+// Samples the CPU, memory, I/O and handles of each process of a service
+// (the command, or each replica) every interval, keeping the last
+// SAMPLE_HISTORY samples of each in a ring. A process is known by its slot
+// (the replica number); a new process in a slot starts a new history.
+//
+// A process whose working set has been over the memory threshold for the
+// last few samples in a row is due to be recycled (a slow leak is caught
+// before it takes the host into swap).
+//
+// Sampling reads the counters through the process handles the supervisor
+// already holds, into fixed buffers - nothing is opened or allocated.
+//
+// ============================================================================
+class LiteSrv_DLL_API ResourceSampler
+{
+public:
+	// interval (seconds, 0 = off - unless there is a memory threshold)
+	void setInterval(int seconds);
+	int  getInterval() const;
+	bool isEnabled() const;
+
+	// memory threshold (MB, 0 = none) and samples in a row over it
+	void setMemoryThreshold(int mb);
+	void setThresholdSamples(int samples);
+	int  getMemoryThreshold() const;
+	int  getThresholdSamples() const;
+
+	// take a sample of each process (handle 0 = none in that slot)
+	void sample(const HANDLE processes[],const DWORD processIds[],int count);
+
+	// latest sample / the history, oldest first, of the process in a slot
+	bool getLatest(int slot,ResourceSample &latest) const;
+	int  getHistory(int slot,ResourceSample history[],int maxSamples) const;
+	DWORD getProcessId(int slot) const;
+
+	// is the process in a slot due to be recycled? (peak: its largest
+	// working set while it has been sampled)
+	bool isOverThreshold(int slot,SIZE_T &peak) const;
+
+	// constructor and destructor
+	ResourceSampler();
+	virtual ~ResourceSampler();
+
+private:
+	// a sampled process
+	struct Process
+	{
+		DWORD          processId;			// 0 = none
+		ULONGLONG      time;				// of the last reading
+		ULONGLONG      cpuTime;				// the last reading
+		ULONGLONG      readBytes;
+		ULONGLONG      writeBytes;
+		ResourceSample samples[SAMPLE_HISTORY];
+		int            next;				// where the next sample goes
+		int            sampleCount;
+		SIZE_T         peakWorkingSet;
+	};
+
+	// service functions
+	void sampleProcess(Process &process,HANDLE hProcess,DWORD processId,ULONGLONG now);
+
+	// private variables
+	int     interval;
+	int     memoryThreshold;
+	int     thresholdSamples;
+	Process processes[MAX_SAMPLED_PROCESSES];
+
+	// prevent copying
+	ResourceSampler(const ResourceSampler&);
+	ResourceSampler &operator=(const ResourceSampler&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__RESOURCE_SAMPLER_H__)
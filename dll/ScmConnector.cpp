@@ -13,16 +13,29 @@
 // ============================================================================
 
 // system headers
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
 #include <windows.h>
-#include <process.h>
+#endif
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
 
 // support headers
 #include <logger.h>
 
 // class headers
-#include "Sleeper.h"
 #include "ScmConnector.h"
+#include "ControlQueue.h"
+#if defined(_WIN32)
+#include "Win32ServiceControlBackend.h"
+#else
+#include "SystemdServiceControlBackend.h"
+#endif
 
 // ============================================================================
 //
@@ -38,7 +51,12 @@ using namespace LiteSrv;
 //
 // ============================================================================
 
-const int SERVICE_MAIN_WAIT_SECONDS = 1;
+// while a start or stop is pending, it is re-reported to the SCM this often
+const unsigned long SERVICE_PENDING_REPORT_MS = 1000;
+// the wait hint given with a pending status (must exceed the report interval)
+const unsigned long SERVICE_PENDING_WAIT_HINT_MS = 3*SERVICE_PENDING_REPORT_MS;
+// wait for a status event without a timeout
+const unsigned long STATUS_EVENT_INFINITE = (unsigned long)-1;
 
 // ============================================================================
 //
@@ -47,10 +65,17 @@ const int SERVICE_MAIN_WAIT_SECONDS = 1;
 // ============================================================================
 
 void threadMain(void *arg);
-void WINAPI serviceMain(DWORD argc,LPTSTR *argv);
-void WINAPI serviceCtrlHandler(DWORD opcode);
-void reportServiceStatus(DWORD status,DWORD checkPoint=0,DWORD waitHint=0) throw(LiteSrvException);
+void serviceMain();
+void serviceCtrlHandler(ServiceControlBackend::SERVICE_CONTROL_REQUESTS request,unsigned long code);
+void reportServiceStatus(ServiceControlBackend::SERVICE_CONTROL_STATES state,unsigned long checkPoint=0,
+							unsigned long waitHint=0)
+	throw(LiteSrvException);
+bool isValidStatusTransition(ScmConnector::SCM_STATUSES from,ScmConnector::SCM_STATUSES to);
+ServiceControlBackend::SERVICE_CONTROL_STATES toServiceState(ScmConnector::SCM_STATUSES scmStatus);
+ServiceControlBackend &getServiceControlBackend();
+#if defined(_WIN32)
 BOOL WINAPI shutdownHandler(DWORD ctrlType);
+#endif
 
 // ============================================================================
 //
@@ -68,6 +93,54 @@ BOOL WINAPI shutdownHandler(DWORD ctrlType);
 //
 // ============================================================================
 
+//
+// an event which threads can wait for, as a Win32 event but built on the
+// standard library so that the connector runs on any platform: a
+// manual-reset event stays signalled, an auto-reset one is reset by the
+// wait which it ends
+//
+
+class StatusEvent
+{
+public:
+	StatusEvent(bool manualReset) : _manualReset(manualReset), _signalled(false) {}
+
+	void set()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_signalled = true;
+		}
+		_signalledCondition.notify_all();
+	}
+
+	// returns false if timed out
+	bool wait(unsigned long timeoutMs)
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		if(timeoutMs == STATUS_EVENT_INFINITE)
+		{
+			_signalledCondition.wait(lock,[this] { return _signalled; });
+		}
+		else if(!_signalledCondition.wait_for(lock,std::chrono::milliseconds(timeoutMs),[this] { return _signalled; }))
+		{
+			return false;
+		}
+		if(!_manualReset) { _signalled = false; }
+		return true;
+	}
+
+private:
+	bool                    _manualReset;
+	bool                    _signalled;
+	std::mutex              _lock;
+	std::condition_variable _signalledCondition;
+
+	// prevent copying
+	StatusEvent(const StatusEvent&);
+	StatusEvent &operator=(const StatusEvent&);
+};
+
 //
 // we use the local class ThreadMainData for several reasons
 //  - it vastly simplifies the ScmConnector interface
@@ -75,6 +148,10 @@ BOOL WINAPI shutdownHandler(DWORD ctrlType);
 //  - we have to store our internal data in a global variable, so that the Win32
 //    service management functions (serviceMain and serviceCtrlHandler) can access it
 //
+// the status is a state machine shared by several threads (the caller, serviceMain
+// and the SCM's control handler thread): it is only changed by setScmStatus, which
+// rejects invalid transitions and reports each change to the SCM as it happens
+//
 
 class ThreadMainData
 {
@@ -85,59 +162,100 @@ public:	// member functions
 	// constructor //
 	// =========== //
 	ThreadMainData(char *svcName,bool allowConnectErrors)
+		: _initialisedEvent(true),_statusChangedEvent(false)
 	{
 		// parameters
 		_svcName = new char[strlen(svcName)+1];
 		strcpy(_svcName,svcName);
 		_allowConnectErrors = allowConnectErrors;
-		// callbacks
-		_stopRequestedVar      = 0;
-		_stopRequestedEvent    = 0;
-		_stopRequestedFunction = 0;
-		_genericPointer        = 0;
+		// control requests
+		_controlQueue = 0;
 		// internals
-		_scmStatus  = ScmConnector::STATUS_INITIALISING;
-		_checkPoint = 0;
+		_scmStatus      = ScmConnector::STATUS_INITIALISING;
+		_connected      = false;
+		_checkPoint     = 0;
 	}
 
 	// ========== //
 	// destructor //
 	// ========== //
-	~ThreadMainData() { delete _svcName; }
-
-	// =================== //
-	// callbacks - install //
-	// =================== //
-	void installStopCallback(bool *stopRequestedVar)
+	~ThreadMainData()
 	{
-		LOGGER_LOG_DEBUG1("installStopCallback(bool @%p)",stopRequestedVar)
-		_stopRequestedVar = stopRequestedVar;
-		(*_stopRequestedVar) = false;
+		delete _svcName;
 	}
-	void installStopCallback(HANDLE *stopRequestedEvent)
+
+	// ================ //
+	// control requests //
+	// ================ //
+	void installControlQueue(ControlQueue *controlQueue) { _controlQueue = controlQueue; }
+	ControlQueue *getControlQueue() const { return _controlQueue; }
+
+	// ================= //
+	// status transition //
+	// ================= //
+	// change status; if report is true and we are connected, report the new
+	// status to the SCM before any other thread can change it again
+	// returns false (and leaves the status alone) if the transition is invalid
+	bool setScmStatus(ScmConnector::SCM_STATUSES scmStatus,bool report=false) throw(LiteSrvException)
 	{
-		_stopRequestedEvent = stopRequestedEvent;
+		std::lock_guard<std::recursive_mutex> lock(_statusLock);
+		ScmConnector::SCM_STATUSES            oldStatus = _scmStatus;
+
+		if((scmStatus != oldStatus)&&(!isValidStatusTransition(oldStatus,scmStatus)))
+		{
+			LOGGER_LOG_DEBUG2("ignoring status change from %d to %d",oldStatus,scmStatus)
+			return false;
+		}
+
+		if(scmStatus != oldStatus)
+		{
+			LOGGER_LOG_DEBUG2("status changed from %d to %d",oldStatus,scmStatus)
+			_scmStatus  = scmStatus;
+			_checkPoint = 0;
+		}
+		else if(scmStatus == ScmConnector::STATUS_STOPPED)
+		{
+			// never report "stopped" twice - it really upsets NT
+			return true;
+		}
+
+		// report before waking up serviceMain and (the first time) the
+		// ScmConnector constructor, so that serviceMain cannot return (and
+		// the dispatcher disconnect) before "stopped" has been reported
+		try
+		{
+			if(report&&_connected) { reportLocked(); }
+		}
+		catch(...)
+		{
+			if(scmStatus != oldStatus) { signalStatusChanged(); }
+			throw;
+		}
+		if(scmStatus != oldStatus) { signalStatusChanged(); }
+		return true;
 	}
-	void installStopCallback(ScmConnector::STOP_HANDLER_FUNCTION *stopRequestedFunction,void *genericPointer)
+
+	// report the current status to the SCM (a pending status is reported with
+	// the next checkpoint)
+	void reportScmStatus() throw(LiteSrvException)
 	{
-		_stopRequestedFunction = stopRequestedFunction;
-		_genericPointer        = genericPointer;
+		std::lock_guard<std::recursive_mutex> lock(_statusLock);
+		reportLocked();
 	}
 
+	// report the current status again if it is still pending (it may have
+	// changed, and been reported, since the caller looked)
+	void reportPendingScmStatus() throw(LiteSrvException)
+	{
+		std::lock_guard<std::recursive_mutex> lock(_statusLock);
+		if(isScmStatusPending()) { reportLocked(); }
+	}
 
-	// =============== //
-	// callbacks - get //
-	// =============== //
-	bool *getStopCallbackVar() const { return _stopRequestedVar; }
-	HANDLE *getStopCallbackEvent() const { return _stopRequestedEvent; }
-	ScmConnector::STOP_HANDLER_FUNCTION *getStopCallbackFunction() const { return _stopRequestedFunction; }
-	void *getCallbackGenericPointer() const { return _genericPointer; }
-
-	// ============== //
-	// set properties //
-	// ============== //
-	void setScmStatus(ScmConnector::SCM_STATUSES scmStatus) { _scmStatus = scmStatus; }
-	void setServiceStatusHandle(SERVICE_STATUS_HANDLE hServiceStatus) { _hServiceStatus = hServiceStatus; }
+	void setConnected(bool connected)
+	{
+		std::lock_guard<std::recursive_mutex> lock(_statusLock);
+		_connected = connected;
+	}
 
 	// ============== //
 	// get properties //
@@ -145,24 +263,56 @@ public:	// member functions
 	char *getSvcName() const { return _svcName; }
 	bool allowConnectErrors() const { return _allowConnectErrors; }
 	ScmConnector::SCM_STATUSES getScmStatus() const { return _scmStatus; }
-	SERVICE_STATUS_HANDLE getServiceStatusHandle() const { return _hServiceStatus; }
-	int getAndIncrementCheckpoint() { return ++_checkPoint; }
+	bool isScmStatusPending() const
+	{
+		ScmConnector::SCM_STATUSES scmStatus = _scmStatus;
+		return (scmStatus == ScmConnector::STATUS_STARTING)||(scmStatus == ScmConnector::STATUS_STOPPING);
+	}
+	bool isConnected() const { return _connected; }
+	StatusEvent &getInitialisedEvent() { return _initialisedEvent; }
+	StatusEvent &getStatusChangedEvent() { return _statusChangedEvent; }
+
+private:	// member functions
+	// wake up the threads waiting for a status change
+	void signalStatusChanged()
+	{
+		_statusChangedEvent.set();
+		_initialisedEvent.set();
+	}
+
+	// report the current status (the caller holds _statusLock)
+	void reportLocked() throw(LiteSrvException)
+	{
+		ServiceControlBackend::SERVICE_CONTROL_STATES serviceState = toServiceState(_scmStatus);
+		if((serviceState == ServiceControlBackend::SCS_START_PENDING)||
+		   (serviceState == ServiceControlBackend::SCS_STOP_PENDING))
+		{
+			reportServiceStatus(serviceState,++_checkPoint,SERVICE_PENDING_WAIT_HINT_MS);
+		}
+		else
+		{
+			reportServiceStatus(serviceState);
+		}
+	}
 
 private:	// data members
 	// parameters
 	char *_svcName;
 	bool _allowConnectErrors;
 
-	// callbacks
-	bool *_stopRequestedVar;
-	HANDLE *_stopRequestedEvent;
-	ScmConnector::STOP_HANDLER_FUNCTION *_stopRequestedFunction;
-	void *_genericPointer; // generic pointer supplied to installStopCallback
+	// control requests
+	ControlQueue *volatile _controlQueue;
 
 	// internals
-	ScmConnector::SCM_STATUSES _scmStatus;
-	SERVICE_STATUS_HANDLE _hServiceStatus;
-	int _checkPoint;
+	std::recursive_mutex _statusLock;	// guards _scmStatus and _checkPoint
+	std::atomic<ScmConnector::SCM_STATUSES> _scmStatus;	// may be read without the lock
+	bool _connected;	// control handler registered (status can be reported)
+	unsigned long _checkPoint;
+	// signalled when the status leaves "initialising" (manual reset, so that
+	// it stays signalled)
+	StatusEvent _initialisedEvent;
+	// signalled on every status change (wakes serviceMain)
+	StatusEvent _statusChangedEvent;
 
 	// prevent default constructor
 	ThreadMainData();
@@ -180,6 +330,10 @@ private:	// data members
 //  (what about Win32 Thread Local Storage??)
 ThreadMainData *G_threadMainData;
 
+// service controller installed by ScmConnector::setServiceControlBackend (0
+// for the platform default)
+ServiceControlBackend *G_serviceControlBackend = 0;
+
 // ============================================================================
 //
 // PUBLIC MEMBER FUNCTIONS
@@ -214,12 +368,13 @@ throw (LiteSrvException)
 	G_threadMainData = new ThreadMainData(srvName,allowConnectErrors);
 
 	// straight away, start a thread to try and connect to SCM
-	unsigned long serviceMainThread  = _beginthread(threadMain,0,NULL);
-
-	// check if created ok
-	if(serviceMainThread<0)
+	try
+	{
+		std::thread(threadMain,(void*)G_threadMainData).detach();
+	}
+	catch(const std::system_error &error)
 	{
-		LOGGER_LOG_ERROR1("failed to create service thread, error = %d",serviceMainThread)
+		LOGGER_LOG_ERROR1("failed to create service thread, error = %d",error.code().value())
 		G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
 		THROW_LiteSrv_EXCEPTION
 			(LiteSrv_EXCEPTION_GENERAL_ERROR,"ScmConnector","ScmConnector")
@@ -228,19 +383,10 @@ throw (LiteSrvException)
 	// wait for thread status to change from "initialising"
 	//  - for a successful connect, serviceMain changes it to "starting"
 	//  - for a failed connect, threadMain changes it to "start as console"
-	while(true)
-	{
-		// sleep for one second
-		Sleeper::Sleep(1,"SCM connection");
-
-		// are we still initialising?
-		if(G_threadMainData->getScmStatus()!=STATUS_INITIALISING)
-		{
-			// something has happened
-			LOGGER_LOG_DEBUG("status is no longer STATUS_INITIALISING")
-			break;
-		}
-	}
+	// (setScmStatus signals the event, so we return as soon as either happens)
+	LOGGER_LOG_DEBUG("waiting for SCM connection")
+	(void)G_threadMainData->getInitialisedEvent().wait(STATUS_EVENT_INFINITE);
+	LOGGER_LOG_DEBUG1("status is no longer STATUS_INITIALISING (%d)",G_threadMainData->getScmStatus())
 
 }
 
@@ -270,6 +416,7 @@ ScmConnector::~ScmConnector()
 // ARGUMENTS       : status        IN status, one of:
 //                                      STATUS_STARTING
 //                                      STATUS_RUNNING
+//                                      STATUS_PAUSED
 //                                      STATUS_STOPPING
 //                                      STATUS_STOPPED
 //                   ignoreErrors  IN if true, do not throw an exception if error
@@ -287,53 +434,39 @@ throw (LiteSrvException)
 {
 	LOGGER_LOG_DEBUG("ScmConnector::notifyScmStatus()")
 
-	// set internal status
-	G_threadMainData->setScmStatus(scmStatus);
-
-#define	RETHROW_IF_NOT_IGNORE_ERRORS	\
-	catch (...) { if(!ignoreErrors) { throw; } }
-
 	switch(scmStatus)
 	{
 		case STATUS_INITIALISING:
-		case STATUS_STARTING:
-			// report starting status to SCM
-			LOGGER_LOG_DEBUG1("notifying status %d (SERVICE_START_PENDING)",SERVICE_START_PENDING)
-			try
-			{
-				reportServiceStatus(SERVICE_START_PENDING,G_threadMainData->getAndIncrementCheckpoint(),SERVICE_MAIN_WAIT_SECONDS);
-			}
-			RETHROW_IF_NOT_IGNORE_ERRORS
+			// treated as "starting"
+			scmStatus = STATUS_STARTING;
 			break;
 
+		case STATUS_STARTING:
 		case STATUS_RUNNING:
-			// report running status to SCM
-			LOGGER_LOG_DEBUG1("notifying status %d (SERVICE_RUNNING)",SERVICE_RUNNING)
-			try { reportServiceStatus(SERVICE_RUNNING); }
-			RETHROW_IF_NOT_IGNORE_ERRORS
-			break;
-
+		case STATUS_PAUSED:
 		case STATUS_STOPPING:
-			// report stopping status to SCM
-			LOGGER_LOG_DEBUG1("notifying status %d (SERVICE_STOP_PENDING)",SERVICE_STOP_PENDING)
-			try { reportServiceStatus(SERVICE_STOP_PENDING); }
-			RETHROW_IF_NOT_IGNORE_ERRORS
-			break;
-
 		case STATUS_STOPPED:
-			// report stopping status to SCM
-			LOGGER_LOG_DEBUG1("notifying status %d (SERVICE_STOPPED)",SERVICE_STOPPED)
-			try { reportServiceStatus(SERVICE_STOPPED); }
-			RETHROW_IF_NOT_IGNORE_ERRORS
 			break;
 
 		default:
-			// error - ignore
+			// error
 			LOGGER_LOG_ERROR1("ScmConnector::notifyScmStatus() called with invalid status %d",scmStatus)
 			THROW_LiteSrv_EXCEPTION
 				(LiteSrv_EXCEPTION_NOTIFY_FAILED,"ScmConnector","notifyScmStatus")
 			break;
 	}
+
+	// change the status and report it to the SCM
+	//  - a change which is not allowed (eg "running" after the SCM has asked us to
+	//    stop) is ignored: the status already reported stands
+	try
+	{
+		if(!G_threadMainData->setScmStatus(scmStatus,true))
+		{
+			LOGGER_LOG_DEBUG2("status %d not notified (status is %d)",scmStatus,G_threadMainData->getScmStatus())
+		}
+	}
+	catch (...) { if(!ignoreErrors) { throw; } }
 }
 
 // ============================================================================
@@ -360,126 +493,166 @@ ScmConnector::SCM_STATUSES ScmConnector::getScmStatus() const
 
 // ============================================================================
 //
-// MEMBER FUNCTION : ScmConnector::installStopCallback
+// MEMBER FUNCTION : ScmConnector::installControlQueue
 //
 // ACCESS SPECIFIER: public
 //
-// DESCRIPTION     : install "stop" callback (boolean)
+// DESCRIPTION     : install the queue to which requests from the SCM (stop,
+//                   reload, user-defined control codes) are posted
 //
-// ARGUMENTS       : stopRequested IN pointer to global boolean
+// ARGUMENTS       : controlQueue IN queue
 //
 // THROWS          : LiteSrvException
 //
 // ============================================================================
-void ScmConnector::installStopCallback
+void ScmConnector::installControlQueue
 (
-	bool *stopRequestedVar
+	ControlQueue *controlQueue
 ) throw (LiteSrvException)
 {
-	LOGGER_LOG_DEBUG("ScmConnector::installStopCallback(bool)")
+	LOGGER_LOG_DEBUG("ScmConnector::installControlQueue()")
 
 	// is the supplied pointer ok?
-	if(stopRequestedVar != 0)
+	if(controlQueue != 0)
 	{
-		// copy the location of the variable and set it to false
-		G_threadMainData->installStopCallback(stopRequestedVar);
-		(*stopRequestedVar) = false;
+		G_threadMainData->installControlQueue(controlQueue);
 	}
 	else
 	{
 		// NULL pointer exception
-		LOGGER_LOG_ERROR("installStopCallback(bool): NULL callback pointer")
+		LOGGER_LOG_ERROR("installControlQueue: NULL queue pointer")
 		THROW_LiteSrv_EXCEPTION
-			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"ScmConnector","installStopCallback")
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"ScmConnector","installControlQueue")
 	}
 }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : ScmConnector::installStopCallback
+// MEMBER FUNCTION : ScmConnector::setServiceControlBackend
 //
-// ACCESS SPECIFIER: public
+// ACCESS SPECIFIER: public static
 //
-// DESCRIPTION     : install "stop" callback (event handle)
+// DESCRIPTION     : use a different service controller (eg a fake one for
+//                   testing); must be called before an ScmConnector is
+//                   constructed. The caller keeps ownership of the backend.
 //
-// ARGUMENTS       : stopRequestedEvent IN pointer to event handle (NB event
-//                                         must already have been created using
-//                                         Win32 CreateEvent)
-//
-// THROWS          : LiteSrvException
+// ARGUMENTS       : backend IN service controller, or 0 for the platform
+//                              default
 //
 // ============================================================================
-void ScmConnector::installStopCallback
+void ScmConnector::setServiceControlBackend
 (
-	HANDLE *stopRequestedEvent
-) throw (LiteSrvException)
+	ServiceControlBackend *backend
+)
 {
-	LOGGER_LOG_DEBUG("ScmConnector::installStopCallback(HANDLE)")
+	LOGGER_LOG_DEBUG1("ScmConnector::setServiceControlBackend(%s)",(backend != 0) ? backend->getName() : "default")
 
-	// is the supplied pointer ok?
-	if(stopRequestedEvent != 0)
-	{
-		// copy the location of the event handle
-		G_threadMainData->installStopCallback(stopRequestedEvent);
-	}
-	else
-	{
-		// NULL pointer exception
-		LOGGER_LOG_ERROR("installStopCallback(HANDLE): NULL callback pointer")
-		THROW_LiteSrv_EXCEPTION
-			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"ScmConnector","installStopCallback")
-	}
+	G_serviceControlBackend = backend;
 }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : ScmConnector::installStopCallback
+// PRIVATE MEMBER FUNCTIONS
 //
-// ACCESS SPECIFIER: public
+// ============================================================================
+
+// ============================================================================
 //
-// DESCRIPTION     : install "stop" callback
+// LOCAL UTILITY FUNCTIONS
 //
-// ARGUMENTS       : stopRequestedEvent IN pointer to function
-//                   genericPointer     IN pointer which will be passed to
-//                                      (*stopRequestedEvent) when it is called
+// ============================================================================
+
+// ============================================================================
 //
-// THROWS          : LiteSrvException
+// LOCAL FUNCTION  : isValidStatusTransition
+//
+// DESCRIPTION     : the status state machine:
+//
+//                   INITIALISING -> STARTING | MUST_START_AS_CONSOLE | FAILED
+//                   STARTING     -> RUNNING | STOPPING | STOPPED | FAILED
+//                   RUNNING      -> PAUSED | STOPPING | STOPPED | FAILED
+//                   PAUSED       -> RUNNING | STOPPING | STOPPED | FAILED
+//                   STOPPING     -> STOPPED | FAILED
+//                   FAILED       -> STOPPED
+//
+// ARGUMENTS       : from IN current status
+//                   to   IN new status
+//
+// RETURNS         : true if the status may change from 'from' to 'to'
 //
 // ============================================================================
-void ScmConnector::installStopCallback
+bool isValidStatusTransition
 (
-	STOP_HANDLER_FUNCTION *stopRequestedFunction,
-	void                  *genericPointer
-) throw (LiteSrvException)
+	ScmConnector::SCM_STATUSES from,
+	ScmConnector::SCM_STATUSES to
+)
 {
-	LOGGER_LOG_DEBUG("ScmConnector::installStopCallback(STOP_HANDLER_FUNCTION)")
-
-	// is the supplied function pointer ok?
-	if(stopRequestedFunction != 0)
+	switch(from)
 	{
-		// copy the location of the function
-		G_threadMainData->installStopCallback(stopRequestedFunction,genericPointer);
-	}
-	else
-	{
-		// NULL pointer exception
-		LOGGER_LOG_ERROR("installStopCallback(STOP_HANDLER_FUNCTION): NULL callback pointer")
-		THROW_LiteSrv_EXCEPTION
-			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"ScmConnector","installStopCallback")
+		case ScmConnector::STATUS_INITIALISING:
+			return (to==ScmConnector::STATUS_STARTING)||(to==ScmConnector::STATUS_MUST_START_AS_CONSOLE)||
+					(to==ScmConnector::STATUS_FAILED);
+
+		case ScmConnector::STATUS_STARTING:
+			return (to==ScmConnector::STATUS_RUNNING)||(to==ScmConnector::STATUS_STOPPING)||
+					(to==ScmConnector::STATUS_STOPPED)||(to==ScmConnector::STATUS_FAILED);
+
+		case ScmConnector::STATUS_RUNNING:
+			return (to==ScmConnector::STATUS_PAUSED)||(to==ScmConnector::STATUS_STOPPING)||
+					(to==ScmConnector::STATUS_STOPPED)||(to==ScmConnector::STATUS_FAILED);
+
+		case ScmConnector::STATUS_PAUSED:
+			return (to==ScmConnector::STATUS_RUNNING)||(to==ScmConnector::STATUS_STOPPING)||
+					(to==ScmConnector::STATUS_STOPPED)||(to==ScmConnector::STATUS_FAILED);
+
+		case ScmConnector::STATUS_STOPPING:
+			return (to==ScmConnector::STATUS_STOPPED)||(to==ScmConnector::STATUS_FAILED);
+
+		case ScmConnector::STATUS_FAILED:
+			return (to==ScmConnector::STATUS_STOPPED);
+
+		default:
+			// STOPPED and MUST_START_AS_CONSOLE are final
+			return false;
 	}
 }
 
 // ============================================================================
 //
-// PRIVATE MEMBER FUNCTIONS
+// LOCAL FUNCTION  : toServiceState
 //
-// ============================================================================
-
-// ============================================================================
+// DESCRIPTION     : the service state which corresponds to a status
 //
-// LOCAL UTILITY FUNCTIONS
+// ARGUMENTS       : scmStatus IN status
+//
+// RETURNS         : SCS_START_PENDING, SCS_RUNNING, SCS_PAUSED,
+//                   SCS_STOP_PENDING or SCS_STOPPED
 //
 // ============================================================================
+ServiceControlBackend::SERVICE_CONTROL_STATES toServiceState
+(
+	ScmConnector::SCM_STATUSES scmStatus
+)
+{
+	switch(scmStatus)
+	{
+		case ScmConnector::STATUS_INITIALISING:
+		case ScmConnector::STATUS_STARTING:
+			return ServiceControlBackend::SCS_START_PENDING;
+
+		case ScmConnector::STATUS_RUNNING:
+			return ServiceControlBackend::SCS_RUNNING;
+
+		case ScmConnector::STATUS_PAUSED:
+			return ServiceControlBackend::SCS_PAUSED;
+
+		case ScmConnector::STATUS_STOPPING:
+			return ServiceControlBackend::SCS_STOP_PENDING;
+
+		default:
+			return ServiceControlBackend::SCS_STOPPED;
+	}
+}
 
 // ============================================================================
 //
@@ -489,7 +662,9 @@ void ScmConnector::installStopCallback
 //                   object.  This thread performs all of the interactions
 //                   with the SCM.
 //
-// ARGUMENTS       : arg IN void pointer to the ThreadMainData object
+// ARGUMENTS       : arg IN void pointer to the ThreadMainData object (this
+//                          thread's own, even if another ScmConnector has
+//                          been constructed since)
 //
 // ============================================================================
 void threadMain
@@ -499,36 +674,38 @@ void threadMain
 {
 	LOGGER_LOG_DEBUG("threadMain()")
 
-	LOGGER_LOG_DEBUG1("trying to connecting to SCM for service '%s'",G_threadMainData->getSvcName())
+	ThreadMainData        *threadMainData = (ThreadMainData*)arg;
+	ServiceControlBackend &backend        = getServiceControlBackend();
+	LOGGER_LOG_DEBUG2("trying to connect to %s for service '%s'",backend.getName(),threadMainData->getSvcName())
 
-	// fill in service details
-	SERVICE_TABLE_ENTRY	DispatchTable[2];
-	DispatchTable[0].lpServiceName = TEXT(G_threadMainData->getSvcName());
-	DispatchTable[0].lpServiceProc = serviceMain;
-	DispatchTable[1].lpServiceName = NULL;
-	DispatchTable[1].lpServiceProc = NULL;
-
-	// connect to the Service Control Manager
-	// if we are not running as a service, this will time out
-	if(!StartServiceCtrlDispatcher(DispatchTable))
+	// connect to the service controller, which calls serviceMain
+	// if we are not running as a service, this will fail
+	if(!backend.runDispatcher(threadMainData->getSvcName(),serviceMain))
 	{
-		LOGGER_LOG_DEBUG("failed in call to StartServiceCtrlDispatcher")
+		LOGGER_LOG_DEBUG("failed to run service dispatcher")
 		// failed to connect to Service Control Manager
-		if(G_threadMainData->allowConnectErrors())
+		if(threadMainData->allowConnectErrors())
 		{
 			// failure allowed - assume running from the console
-			LOGGER_LOG_INFO1("failed to connect to SCM for service %s (assuming console)",G_threadMainData->getSvcName())
-			G_threadMainData->setScmStatus(ScmConnector::STATUS_MUST_START_AS_CONSOLE);
+			LOGGER_LOG_INFO1("failed to connect to SCM for service %s (assuming console)",threadMainData->getSvcName())
+			threadMainData->setScmStatus(ScmConnector::STATUS_MUST_START_AS_CONSOLE);
 		}
 		else
 		{
 			// this is an error - report it
-			LOGGER_LOG_ERROR2("failed to connect to SCM for service %s, error=%u",G_threadMainData->getSvcName(),GetLastError())
+			LOGGER_LOG_ERROR2("failed to connect to %s for service %s",backend.getName(),threadMainData->getSvcName())
 			// return with a failure status
-			G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
+			threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
 		}
 	}
 
+	// make sure the ScmConnector constructor is not left waiting
+	if(threadMainData->getScmStatus() == ScmConnector::STATUS_INITIALISING)
+	{
+		LOGGER_LOG_ERROR1("service dispatcher for %s returned without starting the service",threadMainData->getSvcName())
+		threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
+	}
+
 	// this thread can just terminate now
 	LOGGER_LOG_DEBUG("threadMain is terminating")
 	return;
@@ -539,110 +716,62 @@ void threadMain
 // LOCAL FUNCTION  : serviceMain
 //
 // DESCRIPTION     : thread entry point for service thread
-//
-// ARGUMENTS       : argc, argv IN command-line arguments (not used)
+//                   Status changes are reported to the SCM by whichever
+//                   thread makes them; this thread only wakes up to re-report
+//                   a pending start or stop (with the next checkpoint), and
+//                   returns once the service has stopped.
 //
 // ============================================================================
-void WINAPI serviceMain
-(
-	DWORD   argc,
-	LPTSTR *argv
-)
+void serviceMain()
 {
 	LOGGER_LOG_DEBUG("serviceMain()")
 
 	// register the service's Service Control Handler (SCH)
 	// the SCH will handle all requests passed to it by the Service Control Manager (SCM)
 	LOGGER_LOG_DEBUG1("registering SCH for service '%s'",G_threadMainData->getSvcName())
-	G_threadMainData->setServiceStatusHandle(
-			RegisterServiceCtrlHandler(G_threadMainData->getSvcName(),serviceCtrlHandler));
-
-	if (G_threadMainData->getServiceStatusHandle() == 0)
+	if (!getServiceControlBackend().registerControlHandler(G_threadMainData->getSvcName(),serviceCtrlHandler))
 	{
 		// failed to register Service Control Handler
-		LOGGER_LOG_ERROR1("failed to register SCH, error=%d",GetLastError())
-		// return with a failure status
+		// return with a failure status (it cannot be reported without a handler)
 		G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
-		// report a "start pending" status
-		reportServiceStatus(SERVICE_STOPPED);
 		return;
 	}
+	G_threadMainData->setConnected(true);
 
 	// we have connected - change our status from "initialising" to "starting"
-	G_threadMainData->setScmStatus(ScmConnector::STATUS_STARTING);
-
-	// report a "start pending" status
-	try
-	{
-		reportServiceStatus(SERVICE_START_PENDING,G_threadMainData->getAndIncrementCheckpoint(),SERVICE_MAIN_WAIT_SECONDS);
-	}
+	// and report a "start pending" status
+	try { G_threadMainData->setScmStatus(ScmConnector::STATUS_STARTING,true); }
 	CATCH_AND_RETURN("serviceMain")
 
+#if defined(_WIN32)
 	// install the console control handler to trap shutdown signals
 	LOGGER_LOG_DEBUG("about to install console control (shutdown) handler")
 	if(SetConsoleCtrlHandler(shutdownHandler,TRUE)==0)
 	{
 		LOGGER_LOG_ERROR1("failed to install console control (shutdown) handler, error = %d",GetLastError())
-		G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
+		try { G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED,true); }
+		CATCH_AND_RETURN("serviceMain")
 		return;
 	}
- 
+#endif
+
 	// wait for things to happen
-	int waitCount = 0;
+	int pendingReports = 0;
 	while(true)
 	{
-		// sleep
-		Sleeper::Sleep(SERVICE_MAIN_WAIT_SECONDS,"service event");
-
 		// get current status of program
 		ScmConnector::SCM_STATUSES LiteSrvStatus = G_threadMainData->getScmStatus();
 
 		switch(LiteSrvStatus)
 		{
 			case ScmConnector::STATUS_STARTING:
-				// the service is still starting up
-				LOGGER_LOG_DEBUG("serviceMain wait: service has not started yet")
-				// we need to keep reporting this status to the SCM
-				try
-				{
-					reportServiceStatus(SERVICE_START_PENDING,
-										G_threadMainData->getAndIncrementCheckpoint(),SERVICE_MAIN_WAIT_SECONDS);
-				}
-				CATCH_AND_RETURN("serviceMain")
-
-				// warn if we have been here too long
-				if(((++waitCount)|60)==0)
-				{
-					// log a warning message
-					LOGGER_LOG_INFO2("WARNING: service '%s' has been starting for %d minutes",
-										G_threadMainData->getSvcName(),waitCount/60)
-				}
-				break;
-
-			case ScmConnector::STATUS_RUNNING:
-				// the service has started
-				// its status has already been reported to the SCM
-				LOGGER_LOG_DEBUG("serviceMain wait: service is running")
-				// clear wait count
-				waitCount = 0;
-				break;
-
 			case ScmConnector::STATUS_STOPPING:
-				// the service is stopping
-				LOGGER_LOG_DEBUG("serviceMain wait: service is stopping")
-				// we need to keep reporting this status to the SCM
-				try { reportServiceStatus(SERVICE_STOP_PENDING); }
-				CATCH_AND_RETURN("serviceMain")
-				// warn if we have been here too long
-				if(((waitCount++)|60)==0)
-				{
-					// log a warning message
-					LOGGER_LOG_INFO2("WARNING: service '%s' has been stopping for %d minutes",
-										G_threadMainData->getSvcName(),waitCount/60)
-				}
+			case ScmConnector::STATUS_RUNNING:
+			case ScmConnector::STATUS_PAUSED:
 				break;
 
 			case ScmConnector::STATUS_STOPPED:
+			case ScmConnector::STATUS_FAILED:
 				// the service has stopped
 				// its status has already been reported to the SCM
 				LOGGER_LOG_DEBUG("serviceMain wait: service has stopped")
@@ -652,10 +781,35 @@ void WINAPI serviceMain
 
 			default:
 				LOGGER_LOG_ERROR1("global wait status %d - invalid",LiteSrvStatus)
-				G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED);
-				try { reportServiceStatus(SERVICE_STOPPED); }
+				try { G_threadMainData->setScmStatus(ScmConnector::STATUS_FAILED,true); }
 				CATCH_AND_RETURN("serviceMain")
-				break;
+				return;
+		}
+
+		// a pending status must be re-reported regularly; otherwise there is
+		// nothing to do until the status changes
+		bool pending = G_threadMainData->isScmStatusPending();
+		if(G_threadMainData->getStatusChangedEvent().wait(pending ? SERVICE_PENDING_REPORT_MS : STATUS_EVENT_INFINITE))
+		{
+			// the status has changed (and has already been reported)
+			LOGGER_LOG_DEBUG1("serviceMain wait: status is now %d",G_threadMainData->getScmStatus())
+			pendingReports = 0;
+		}
+		else
+		{
+			// still starting or stopping - tell the SCM we are making progress
+			try { G_threadMainData->reportPendingScmStatus(); }
+			CATCH_AND_RETURN("serviceMain")
+
+			// warn if we have been here too long
+			if(((++pendingReports)%60)==0)
+			{
+				// log a warning message
+				LOGGER_LOG_INFO3("WARNING: service '%s' has been %s for %d minutes",
+									G_threadMainData->getSvcName(),
+									(G_threadMainData->getScmStatus()==ScmConnector::STATUS_STOPPING) ? "stopping" : "starting",
+									pendingReports/60)
+			}
 		}
 	}
 
@@ -666,123 +820,94 @@ void WINAPI serviceMain
 // LOCAL FUNCTION  : serviceCtrlHandler
 //
 // DESCRIPTION     : service control handler (responds to service status
-//                   requests from SCM)
+//                   requests from SCM); anything which the command has to act
+//                   on is posted to the installed control queue
 //
-// ARGUMENTS       : opcode IN request from SCM (stop, status)
+// ARGUMENTS       : request IN request from SCM (stop, status, ...)
+//                   code    IN SCM control code
 //
 // ============================================================================
-void WINAPI serviceCtrlHandler
+void serviceCtrlHandler
 (
-	DWORD opcode
+	ServiceControlBackend::SERVICE_CONTROL_REQUESTS request,
+	unsigned long                                   code
 )
 {
-	LOGGER_LOG_DEBUG1("serviceCtrlHandler: opcode is %d",opcode)
+	LOGGER_LOG_DEBUG2("serviceCtrlHandler: request is %d (code %lu)",request,code)
 
-	ScmConnector::SCM_STATUSES svcStatus;
-	bool stopActionTaken;
+	ControlQueue *controlQueue = G_threadMainData->getControlQueue();
 
 	// act on the supplied opcode
-	switch(opcode)
+	switch(request)
 	{
-		case SERVICE_CONTROL_SHUTDOWN:
-		case SERVICE_CONTROL_STOP:
+		case ServiceControlBackend::SCR_SHUTDOWN:
+		case ServiceControlBackend::SCR_STOP:
 			// STOP SERVICE requested, or system is shutting down
 			LOGGER_LOG_DEBUG("serviceCtrlHandler: STOP requested")
-			stopActionTaken = false;
-
-			// tell everybody we are shutting down
-			G_threadMainData->setScmStatus(ScmConnector::STATUS_STOPPING);
-			// report "stopping" status to SCM
-			try { reportServiceStatus(SERVICE_STOP_PENDING); }
-			CATCH_AND_RETURN("serviceCtrlHandler")
 
-			// take appropriate action according to installed callbacks
-			if(G_threadMainData->getStopCallbackVar() != 0)
-			{
-				// we need to set the supplied variable to true
-				LOGGER_LOG_DEBUG("serviceCtrlHandler: setting stop variable true")
-				(*G_threadMainData->getStopCallbackVar()) = true;
-				stopActionTaken = true;
-			}
-
-			if(G_threadMainData->getStopCallbackEvent() != 0)
+			// tell everybody we are shutting down, and report "stopping" status to SCM
+			try
 			{
-				// we need to notify the supplied event
-				LOGGER_LOG_DEBUG("serviceCtrlHandler: notifying stop event")
-				
-				if(!SetEvent(*G_threadMainData->getStopCallbackEvent()))
+				if(!G_threadMainData->setScmStatus(ScmConnector::STATUS_STOPPING,true))
 				{
-					// failed to notify event
-					LOGGER_LOG_ERROR2("failed to notify stop event for service %s, error=%u",
-						G_threadMainData->getSvcName(),GetLastError())
-
+					// too late - the service has already stopped
+					LOGGER_LOG_DEBUG("serviceCtrlHandler: service has already stopped")
+					break;
 				}
-				LOGGER_LOG_DEBUG("serviceCtrlHandler: stop event notified")
-				stopActionTaken = true;
-			}
-
-
-			if(G_threadMainData->getStopCallbackFunction() != 0)
-			{
-				// we need to call the supplied function
-				LOGGER_LOG_DEBUG("serviceCtrlHandler: call stop function")
-				// pass the previously-supplied generic pointer as argument
-				(*G_threadMainData->getStopCallbackFunction())(G_threadMainData->getCallbackGenericPointer());
-				LOGGER_LOG_DEBUG("serviceCtrlHandler: stop function called")
-				stopActionTaken = true;
 			}
+			CATCH_AND_RETURN("serviceCtrlHandler")
 
 			// make sure we have done something!
-			if(!stopActionTaken)
+			if((controlQueue == 0)||(!controlQueue->post(ControlCommand::CONTROL_STOP)))
 			{
 				// issue a warning message
 				LOGGER_LOG_ERROR1("WARNING: there is no stop action for service '%s'",G_threadMainData->getSvcName())
 			}
-
 			break;
 
-		case SERVICE_CONTROL_INTERROGATE:
+		case ServiceControlBackend::SCR_INTERROGATE:
 			// INTERROGATE STATUS requested
 			LOGGER_LOG_DEBUG("serviceCtrlHandler: INTERROGATE requested")
 
-			// get current status of started process
-			svcStatus = G_threadMainData->getScmStatus();
+			// report current status of started process
+			try { G_threadMainData->reportScmStatus(); }
+			CATCH_AND_RETURN("serviceCtrlHandler")
+			break;
 
-			switch(svcStatus)
+		case ServiceControlBackend::SCR_PARAMCHANGE:
+		case ServiceControlBackend::SCR_PAUSE:
+		case ServiceControlBackend::SCR_CONTINUE:
+		case ServiceControlBackend::SCR_CUSTOM:
+			// pass on to the command
+			if(controlQueue == 0)
 			{
-				case ScmConnector::STATUS_STARTING:
-					// the service is starting
-					LOGGER_LOG_DEBUG("service is starting")
-					try { reportServiceStatus(SERVICE_START_PENDING); }
-					CATCH_AND_RETURN("serviceCtrlHandler")
-					break;
-
-				case ScmConnector::STATUS_RUNNING:
-					// the service is running
-					LOGGER_LOG_DEBUG("service is running")
-					try { reportServiceStatus(SERVICE_RUNNING); }
-					CATCH_AND_RETURN("serviceCtrlHandler")
-					break;
-
-				case ScmConnector::STATUS_STOPPING:
-					// the service is stopping
-					LOGGER_LOG_DEBUG("service is stopping")
-					try { reportServiceStatus(SERVICE_STOP_PENDING); }
-					CATCH_AND_RETURN("serviceCtrlHandler")
-					break;
-
-				default:
-					// the service has stopped or something bad has happened
-					LOGGER_LOG_DEBUG("service has stopped")
-					try { reportServiceStatus(SERVICE_STOPPED); }
-					CATCH_AND_RETURN("serviceCtrlHandler")
-					break;
+				LOGGER_LOG_ERROR1("serviceCtrlHandler: no control queue for request %d",request)
+			}
+			else if(request == ServiceControlBackend::SCR_PARAMCHANGE)
+			{
+				controlQueue->post(ControlCommand::CONTROL_RELOAD);
+			}
+			else if(request == ServiceControlBackend::SCR_PAUSE)
+			{
+				controlQueue->post(ControlCommand::CONTROL_PAUSE);
+			}
+			else if(request == ServiceControlBackend::SCR_CONTINUE)
+			{
+				controlQueue->post(ControlCommand::CONTROL_CONTINUE);
+			}
+			else if(code == CONTROL_CODE_RESTART)
+			{
+				controlQueue->post(ControlCommand::CONTROL_RESTART);
+			}
+			else
+			{
+				controlQueue->post(ControlCommand::CONTROL_CUSTOM,code);
 			}
 			break;
 
 		default:
 			// unsupported or unknown opcode
-			LOGGER_LOG_ERROR1("serviceCtrlHandler: unsupported or unknown op code %d",opcode)
+			LOGGER_LOG_ERROR1("serviceCtrlHandler: unsupported or unknown request %d",request)
 			;
 	}
 
@@ -792,6 +917,7 @@ void WINAPI serviceCtrlHandler
 
 }
 
+#if defined(_WIN32)
 // ============================================================================
 //
 // LOCAL FUNCTION  : shutdownHandler
@@ -812,7 +938,8 @@ BOOL WINAPI shutdownHandler
 	if(ctrlType==CTRL_SHUTDOWN_EVENT)
 	{
 		LOGGER_LOG_DEBUG1("shutdownHandler: ctrlType is %d - shutting down",ctrlType)
-		G_threadMainData->setScmStatus(ScmConnector::STATUS_STOPPING);
+		try { G_threadMainData->setScmStatus(ScmConnector::STATUS_STOPPING,true); }
+		catch(...) { LOGGER_LOG_ERROR("shutdownHandler(): caught exception") }
 	}
 	else
 	{
@@ -821,83 +948,81 @@ BOOL WINAPI shutdownHandler
 
 	return FALSE;
 }
+#endif // defined(_WIN32)
 
 // ============================================================================
 //
 // LOCAL FUNCTION : LiteSrvThread::reportServiceStatus
 //
-// DESCRIPTION    : report current status of service to SCM
+// DESCRIPTION    : report current status of service to the service
+//                  controller
 //
-// ARGUMENTS      : status     IN status to report (see Win32 SetServiceStatus
-//                                for valid values)
-//                  checkpoint IN checkpoint, used during startup only
-//                  waitHint   IN wait hint, used during startup only
+// ARGUMENTS      : state      IN state to report
+//                  checkpoint IN checkpoint, used while pending only
+//                  waitHint   IN wait hint (ms), used while pending only
 //
 // THROWS          : LiteSrvException
 //
 // ============================================================================
 void reportServiceStatus
 (
-	DWORD status,
-	DWORD checkPoint,
-	DWORD waitHint
+	ServiceControlBackend::SERVICE_CONTROL_STATES state,
+	unsigned long                                 checkPoint,
+	unsigned long                                 waitHint
 ) throw (LiteSrvException)
 {
-	SERVICE_STATUS serviceStatus;
-
-	switch(status)
+	switch(state)
 	{
-		case SERVICE_STOPPED:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_STOPPED)",status)
-			break;
-
-		case SERVICE_START_PENDING:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_START_PENDING)",status)
+		case ServiceControlBackend::SCS_STOPPED:
+			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_STOPPED)",state)
 			break;
 
-		case SERVICE_STOP_PENDING:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_STOP_PENDING)",status)
+		case ServiceControlBackend::SCS_START_PENDING:
+			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_START_PENDING)",state)
 			break;
 
-		case SERVICE_RUNNING:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_RUNNING)",status)
+		case ServiceControlBackend::SCS_STOP_PENDING:
+			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_STOP_PENDING)",state)
 			break;
 
-		case SERVICE_CONTINUE_PENDING:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_CONTINUE_PENDING)",status)
+		case ServiceControlBackend::SCS_RUNNING:
+			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_RUNNING)",state)
 			break;
 
-		case SERVICE_PAUSE_PENDING:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_PAUSE_PENDING)",status)
-			break;
-
-		case SERVICE_PAUSED:
-			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_PAUSED)",status)
+		case ServiceControlBackend::SCS_PAUSED:
+			LOGGER_LOG_DEBUG1("Reporting status %d (SERVICE_PAUSED)",state)
 			break;
 
 		default:
-			LOGGER_LOG_DEBUG1("Reporting status %d (?)",status)
+			LOGGER_LOG_DEBUG1("Reporting status %d (?)",state)
 			break;
 	}
 
-	// initialise service status information
-	// type of service:  Win32 service running in its own process
-	serviceStatus.dwServiceType             = SERVICE_WIN32;
-	// current state
-	serviceStatus.dwCurrentState            = status;
-	// what control codes will be accepted: stop
-	serviceStatus.dwControlsAccepted        = SERVICE_ACCEPT_STOP;
-	// other status information
-	serviceStatus.dwWin32ExitCode           = 0;
-	serviceStatus.dwServiceSpecificExitCode = 0;
-	serviceStatus.dwCheckPoint              = checkPoint;
-	serviceStatus.dwWaitHint                = waitHint;
-
-	if (!SetServiceStatus(G_threadMainData->getServiceStatusHandle(),&serviceStatus))
+	if (!getServiceControlBackend().reportStatus(state,checkPoint,waitHint))
 	{
-		// failed to report service status
-		LOGGER_LOG_ERROR2("failed to report status %d, error=%u",status,GetLastError())
+		// failed to report service status (the backend has logged why)
 		THROW_LiteSrv_EXCEPTION
 			(LiteSrv_EXCEPTION_NOTIFY_FAILED,"","reportServiceStatus")
 	}
 }
+
+// ============================================================================
+//
+// LOCAL FUNCTION : getServiceControlBackend
+//
+// DESCRIPTION    : the service controller: the one installed with
+//                  ScmConnector::setServiceControlBackend, or the platform's
+//                  own (Win32 SCM or systemd)
+//
+// ============================================================================
+ServiceControlBackend &getServiceControlBackend()
+{
+	if(G_serviceControlBackend != 0) { return *G_serviceControlBackend; }
+
+#if defined(_WIN32)
+	static Win32ServiceControlBackend defaultBackend;
+#else
+	static SystemdServiceControlBackend defaultBackend;
+#endif
+	return defaultBackend;
+}
@@ -23,7 +23,11 @@
 // -------------------------------------------------------------
 //
 
-#ifdef LiteSrv_DLL_EXPORT
+#if !defined(_WIN32)
+// there is no import or export outside Windows
+#define	LiteSrv_DLL_API
+
+#elif defined(LiteSrv_DLL_EXPORT)
 #define LiteSrv_DLL_API __declspec(dllexport)
 #pragma message("exporting ScmConnector")
 
@@ -48,6 +52,8 @@
 // ============================================================================
 // namespace header
 #include "LiteSrv.h"
+// service controller interface
+#include "ServiceControlBackend.h"
 
 // ============================================================================
 //
@@ -57,6 +63,9 @@
 
 // all the DLL classes are defined within the LiteSrv namespace
 namespace LiteSrv {
+
+// forward declarations
+class ControlQueue;
 	
 // ============================================================================
 //
@@ -67,8 +76,8 @@ class LiteSrv_DLL_API ScmConnector
 {
 public:
 	// supported statuses
-	typedef enum SCM_STATUSES { STATUS_INITIALISING,STATUS_STARTING,STATUS_RUNNING,STATUS_STOPPING,
-								STATUS_STOPPED,STATUS_MUST_START_AS_CONSOLE,STATUS_FAILED };
+	enum SCM_STATUSES { STATUS_INITIALISING,STATUS_STARTING,STATUS_RUNNING,STATUS_STOPPING,
+						STATUS_STOPPED,STATUS_MUST_START_AS_CONSOLE,STATUS_FAILED,STATUS_PAUSED };
 
 	// constructor
 	ScmConnector(char *svcName,bool allowConnectErrors = false) throw (LiteSrvException);
@@ -80,12 +89,12 @@ public:
 	void notifyScmStatus(SCM_STATUSES scmStatus,bool ignoreErrors = false) throw (LiteSrvException);
 	SCM_STATUSES getScmStatus() const;
 
-	// action to take if STOP requested by SCM
-	typedef void STOP_HANDLER_FUNCTION(void*);
-	void installStopCallback(bool *stopRequestedVar) throw (LiteSrvException);
-	void installStopCallback(HANDLE *stopRequestedEvent) throw (LiteSrvException);
-	void installStopCallback(STOP_HANDLER_FUNCTION *stopRequestedFunction,void *genericPointer)
-		throw (LiteSrvException);
+	// requests from the SCM (stop etc) are posted to this queue
+	void installControlQueue(ControlQueue *controlQueue) throw (LiteSrvException);
+
+	// service controller (the Win32 SCM, or systemd on Linux, unless another
+	// is installed before the ScmConnector is constructed)
+	static void setServiceControlBackend(ServiceControlBackend *backend);
 
 private: // no default constructor
 	ScmConnector();
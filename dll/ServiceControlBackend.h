@@ -0,0 +1,70 @@
+
+// prevent multiple inclusion
+
+#if !defined(__SERVICE_CONTROL_BACKEND_H__)
+#define __SERVICE_CONTROL_BACKEND_H__
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// ServiceControlBackend class
+//
+// The service controller which ScmConnector talks to. The Win32 SCM is the
+// default; other controllers (a scripted fake for tests, systemd) implement
+// the same interface and are installed with
+// ScmConnector::setServiceControlBackend() before the ScmConnector is
+// constructed.
+//
+// This header is deliberately free of Win32 types so that backends can be
+// built on other platforms.
+//
+// ============================================================================
+class ServiceControlBackend
+{
+public:
+	// service states reported to the controller
+	enum SERVICE_CONTROL_STATES { SCS_START_PENDING,SCS_RUNNING,SCS_STOP_PENDING,SCS_STOPPED,SCS_PAUSED };
+
+	// requests made by the controller
+	enum SERVICE_CONTROL_REQUESTS { SCR_STOP,SCR_SHUTDOWN,SCR_INTERROGATE,SCR_PARAMCHANGE,
+									SCR_PAUSE,SCR_CONTINUE,SCR_CUSTOM,SCR_UNKNOWN };
+
+	// called on the dispatcher thread once the controller has started the service;
+	// returns when the service has stopped
+	typedef void SERVICE_MAIN_FUNCTION();
+
+	// called (on a controller thread) for each request; code is the
+	// controller's own request code (for SCR_CUSTOM, the user-defined code)
+	typedef void CONTROL_HANDLER_FUNCTION(SERVICE_CONTROL_REQUESTS request,unsigned long code);
+
+	// connect to the controller and run serviceMain; blocks until the service
+	// has stopped. Returns false at once if we are not running under this
+	// controller (or cannot connect to it)
+	virtual bool runDispatcher(const char *svcName,SERVICE_MAIN_FUNCTION *serviceMain) = 0;
+
+	// register the handler for controller requests (called from serviceMain)
+	virtual bool registerControlHandler(const char *svcName,CONTROL_HANDLER_FUNCTION *controlHandler) = 0;
+
+	// report a state; checkPoint and waitHint (milliseconds) are only used
+	// for the pending states
+	virtual bool reportStatus(SERVICE_CONTROL_STATES state,unsigned long checkPoint,unsigned long waitHint) = 0;
+
+	// name, for log messages
+	virtual const char *getName() const = 0;
+
+	// destructor
+	virtual ~ServiceControlBackend() {}
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__SERVICE_CONTROL_BACKEND_H__)
+
@@ -20,7 +20,6 @@
 #include <logger.h>
 
 // class headers
-#include "Sleeper.h"
 #include "StringSubstituter.h"
 #include "ScmConnector.h"
 #include "CmdRunner.h"
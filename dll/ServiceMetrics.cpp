@@ -0,0 +1,216 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ServiceMetrics.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// upper limits of the latency buckets (ms)
+const DWORD BUCKET_LIMITS[LATENCY_BUCKETS] = { 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000, INFINITE };
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceMetrics::processStarted
+//                   ServiceMetrics::processReady
+//                   ServiceMetrics::processExited
+//                   ServiceMetrics::processesStopped
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : a process has been started in a slot (a restart if one
+//                   has been started there before) / has become ready (the
+//                   first time since it was started) / has exited, on its
+//                   own or by being stopped / processes have been stopped
+//
+// ARGUMENTS       : instance  IN slot
+//                   processId IN process id
+//                   exitCode  IN exit code
+//                   crashed   IN did it exit with a failure status without
+//                                being asked to?
+//                   elapsedMs IN time taken to stop them
+//
+// ============================================================================
+void ServiceMetrics::processStarted
+(
+	int   instance,
+	DWORD processId
+)
+{
+	if((instance < 0)||(instance >= MAX_METRICS_INSTANCES)) { return; }
+
+	starts++;
+	if(started[instance]) { restarts++; }
+	started[instance]      = true;
+	startTimes[instance]   = GetTickCount64();
+	readyPending[instance] = true;
+	processIds[instance]   = processId;
+}
+
+void ServiceMetrics::processReady
+(
+	int instance
+)
+{
+	if((instance < 0)||(instance >= MAX_METRICS_INSTANCES)||!readyPending[instance]) { return; }
+
+	readyPending[instance] = false;
+	observe(readyLatency,(DWORD)(GetTickCount64()-startTimes[instance]));
+}
+
+void ServiceMetrics::processExited
+(
+	DWORD processId,
+	DWORD exitCode,
+	bool  crashed
+)
+{
+	for(int i=0;i<MAX_METRICS_INSTANCES;i++)
+	{
+		if((processIds[i] != processId)||(processId == 0)) { continue; }
+		readyPending[i] = false;
+		processIds[i]   = 0;
+	}
+	lastExitCode = exitCode;
+	lastExitTime = GetTickCount64();
+	if(crashed) { crashes++; }
+}
+
+void ServiceMetrics::processesStopped(DWORD elapsedMs) { observe(stopLatency,elapsedMs); }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceMetrics::getStarts
+//                   ServiceMetrics::getRestarts
+//                   ServiceMetrics::getCrashes
+//                   ServiceMetrics::getStartTime
+//                   ServiceMetrics::getProcessId
+//                   ServiceMetrics::getLastExitCode
+//                   ServiceMetrics::getLastExitTime
+//                   ServiceMetrics::getReadyLatency
+//                   ServiceMetrics::getStopLatency
+//                   ServiceMetrics::getBucketLimit
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : the metrics
+//
+// ============================================================================
+ULONGLONG ServiceMetrics::getStarts() const { return starts; }
+ULONGLONG ServiceMetrics::getRestarts() const { return restarts; }
+ULONGLONG ServiceMetrics::getCrashes() const { return crashes; }
+
+ULONGLONG ServiceMetrics::getStartTime(int instance) const
+{
+	return ((instance < 0)||(instance >= MAX_METRICS_INSTANCES)) ? 0 : startTimes[instance];
+}
+
+DWORD ServiceMetrics::getProcessId(int instance) const
+{
+	return ((instance < 0)||(instance >= MAX_METRICS_INSTANCES)) ? 0 : processIds[instance];
+}
+
+DWORD     ServiceMetrics::getLastExitCode() const { return lastExitCode; }
+ULONGLONG ServiceMetrics::getLastExitTime() const { return lastExitTime; }
+
+const LatencyHistogram &ServiceMetrics::getReadyLatency() const { return readyLatency; }
+const LatencyHistogram &ServiceMetrics::getStopLatency() const { return stopLatency; }
+DWORD ServiceMetrics::getBucketLimit(int bucket) { return BUCKET_LIMITS[bucket]; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceMetrics::ServiceMetrics
+//                   ServiceMetrics::~ServiceMetrics
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+ServiceMetrics::ServiceMetrics()
+{
+	starts   = 0;
+	restarts = 0;
+	crashes  = 0;
+	for(int i=0;i<MAX_METRICS_INSTANCES;i++)
+	{
+		startTimes[i]   = 0;
+		started[i]      = false;
+		readyPending[i] = false;
+		processIds[i]   = 0;
+	}
+	lastExitCode = 0;
+	lastExitTime = 0;
+	memset(&readyLatency,0,sizeof(readyLatency));
+	memset(&stopLatency,0,sizeof(stopLatency));
+}
+
+ServiceMetrics::~ServiceMetrics()
+{
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceMetrics::observe
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : add a latency to a histogram
+//
+// ARGUMENTS       : histogram IN/OUT histogram
+//                   elapsedMs IN     latency
+//
+// ============================================================================
+void ServiceMetrics::observe
+(
+	LatencyHistogram &histogram,
+	DWORD             elapsedMs
+)
+{
+	int bucket = 0;
+	while(elapsedMs > BUCKET_LIMITS[bucket]) { bucket++; }
+	histogram.counts[bucket]++;
+	histogram.sumMs += elapsedMs;
+	histogram.count++;
+}
+
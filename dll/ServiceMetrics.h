@@ -0,0 +1,157 @@
+
+// prevent multiple inclusion
+
+#if !defined(__SERVICE_METRICS_H__)
+#define __SERVICE_METRICS_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting ServiceMetrics")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("ServiceMetrics is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing ServiceMetrics")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// most instances (the command, or its replicas), and latency histogram
+// buckets (the last has no limit)
+const int MAX_METRICS_INSTANCES = MAXIMUM_WAIT_OBJECTS;
+const int LATENCY_BUCKETS       = 10;
+
+// ============================================================================
+//
+// LatencyHistogram - how many latencies fell in each bucket (not
+// cumulative), and their sum
+//
+// ============================================================================
+struct LatencyHistogram
+{
+	ULONGLONG counts[LATENCY_BUCKETS];
+	ULONGLONG sumMs;
+	ULONGLONG count;
+};
+
+// ============================================================================
+//
+// ServiceMetrics class
+//
+// What the supervisor has done with the processes of a service: how many
+// it has started, restarted (started again in the same slot) and seen
+// crash (exit with a failure status without being asked to), which are
+// running and when each one started, how the last one to exit did, how
+// long each took from being started to being ready, and how long stopping
+// them took.
+//
+// ============================================================================
+class LiteSrv_DLL_API ServiceMetrics
+{
+public:
+	// events
+	void processStarted(int instance,DWORD processId);
+	void processReady(int instance);
+	void processExited(DWORD processId,DWORD exitCode,bool crashed);
+	void processesStopped(DWORD elapsedMs);
+
+	// counters
+	ULONGLONG getStarts() const;
+	ULONGLONG getRestarts() const;
+	ULONGLONG getCrashes() const;
+
+	// GetTickCount64() when the process in a slot was started (0 = never)
+	ULONGLONG getStartTime(int instance) const;
+
+	// process id in a slot (0 = none running), and the exit code of the
+	// last process to exit and GetTickCount64() when it did (0 = none has)
+	DWORD     getProcessId(int instance) const;
+	DWORD     getLastExitCode() const;
+	ULONGLONG getLastExitTime() const;
+
+	// latencies (and the upper limit of each bucket, INFINITE for the last)
+	const LatencyHistogram &getReadyLatency() const;
+	const LatencyHistogram &getStopLatency() const;
+	static DWORD getBucketLimit(int bucket);
+
+	// constructor and destructor
+	ServiceMetrics();
+	virtual ~ServiceMetrics();
+
+private:
+	// service functions
+	static void observe(LatencyHistogram &histogram,DWORD elapsedMs);
+
+	// private variables
+	ULONGLONG        starts;
+	ULONGLONG        restarts;
+	ULONGLONG        crashes;
+	ULONGLONG        startTimes[MAX_METRICS_INSTANCES];
+	bool             started[MAX_METRICS_INSTANCES];
+	bool             readyPending[MAX_METRICS_INSTANCES];
+	DWORD            processIds[MAX_METRICS_INSTANCES];
+	DWORD            lastExitCode;
+	ULONGLONG        lastExitTime;
+	LatencyHistogram readyLatency;
+	LatencyHistogram stopLatency;
+
+	// prevent copying
+	ServiceMetrics(const ServiceMetrics&);
+	ServiceMetrics &operator=(const ServiceMetrics&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__SERVICE_METRICS_H__)
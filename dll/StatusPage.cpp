@@ -0,0 +1,284 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <sddl.h>
+#include <stdio.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ScmConnector.h"
+#include "ServiceMetrics.h"
+#include "StatusPage.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// LocalSystem and administrators have full access, other users can read
+const char *STATUS_PAGE_SDDL = "D:(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;AU)";
+
+static_assert((LITESRV_STATE_FAILED == ScmConnector::STATUS_FAILED)&&
+			  (LITESRV_STATE_PAUSED == ScmConnector::STATUS_PAUSED),
+				"LITESRV_STATE_... must match ScmConnector::SCM_STATUSES");
+
+// ============================================================================
+//
+// FUNCTION        : toFileTime
+//
+// DESCRIPTION     : convert a GetTickCount64() time to a FILETIME
+//
+// ARGUMENTS       : tick    IN time (0 = none)
+//                   nowTick IN GetTickCount64() now
+//                   now     IN FILETIME now
+//
+// RETURNS         : FILETIME, as one number (0 = none)
+//
+// ============================================================================
+static ULONGLONG toFileTime
+(
+	ULONGLONG tick,
+	ULONGLONG nowTick,
+	ULONGLONG now
+)
+{
+	return (tick == 0) ? 0 : now-(nowTick-tick)*10000;
+}
+
+// ============================================================================
+//
+// FUNCTION        : getFileTimeNow
+//
+// DESCRIPTION     : the time now, as a FILETIME in one number
+//
+// ============================================================================
+static ULONGLONG getFileTimeNow()
+{
+	FILETIME       fileTime;
+	ULARGE_INTEGER now;
+	GetSystemTimeAsFileTime(&fileTime);
+	now.LowPart  = fileTime.dwLowDateTime;
+	now.HighPart = fileTime.dwHighDateTime;
+	return now.QuadPart;
+}
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : StatusPage::open
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : create the page for a service - in the global namespace,
+//                   so that tools in any session can see it, or if that is
+//                   not allowed, in the local one
+//
+// ARGUMENTS       : service IN service name
+//
+// ============================================================================
+void StatusPage::open
+(
+	const char *service
+)
+{
+	if(page != 0) { return; }
+
+	LOGGER_LOG_DEBUG1("StatusPage::open('%s')",service)
+
+	SECURITY_ATTRIBUTES  security = { sizeof(SECURITY_ATTRIBUTES), NULL, FALSE };
+	PSECURITY_DESCRIPTOR descriptor = NULL;
+	if(ConvertStringSecurityDescriptorToSecurityDescriptor(STATUS_PAGE_SDDL,SDDL_REVISION_1,&descriptor,NULL))
+	{
+		security.lpSecurityDescriptor = descriptor;
+	}
+
+	char name[MAX_PATH];
+	const char *formats[] = { LITESRV_STATUS_GLOBAL_NAME, LITESRV_STATUS_LOCAL_NAME };
+	for(int i=0;(i<2)&&(hMapping==NULL);i++)
+	{
+		if(strlen(service)+strlen(formats[i]) >= sizeof(name)) { break; }
+		sprintf(name,formats[i],service);
+		hMapping = CreateFileMapping(INVALID_HANDLE_VALUE,&security,PAGE_READWRITE,0,sizeof(LiteSrvStatus),name);
+		if((hMapping != NULL)&&(GetLastError() == ERROR_ALREADY_EXISTS))
+		{
+			// another LiteSrv is running the service - leave its page alone
+			LOGGER_LOG_ERROR1("status page %s is already in use",name)
+			CloseHandle(hMapping);
+			hMapping = NULL;
+			break;
+		}
+	}
+	if(descriptor != NULL) { LocalFree(descriptor); }
+
+	if(hMapping == NULL)
+	{
+		LOGGER_LOG_ERROR2("failed to create status page for service '%s', error=%d - it will not be published",
+							service,GetLastError())
+		return;
+	}
+
+	page = (LiteSrvStatus*)MapViewOfFile(hMapping,FILE_MAP_WRITE,0,0,sizeof(LiteSrvStatus));
+	if(page == 0)
+	{
+		LOGGER_LOG_ERROR2("failed to map status page for service '%s', error=%d - it will not be published",
+							service,GetLastError())
+		CloseHandle(hMapping);
+		hMapping = NULL;
+		return;
+	}
+
+	// a new mapping is zeroed, so readers see no magic until this is done
+	page->version        = LITESRV_STATUS_VERSION;
+	page->state          = LITESRV_STATE_INITIALISING;
+	page->supervisorId   = GetCurrentProcessId();
+	page->supervisorTime = getFileTimeNow();
+	page->updateTime     = page->supervisorTime;
+	MemoryBarrier();
+	page->magic          = LITESRV_STATUS_MAGIC;
+	LOGGER_LOG_DEBUG1("published status page %s",name)
+}
+
+bool StatusPage::isOpen() const { return page != 0; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : StatusPage::update
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : publish the status - the sequence is odd while the
+//                   page is being written (the interlocked increments are
+//                   full barriers, so the writes stay between them)
+//
+// ARGUMENTS       : state   IN one of the ScmConnector::SCM_STATUSES
+//                   metrics IN what has been done with the processes
+//
+// ============================================================================
+void StatusPage::update
+(
+	int                   state,
+	const ServiceMetrics &metrics
+)
+{
+	if(page == 0) { return; }
+
+	// the command is the first process running
+	DWORD        processId    = 0;
+	ULONGLONG    processTick  = 0;
+	unsigned int processCount = 0;
+	for(int i=0;i<MAX_METRICS_INSTANCES;i++)
+	{
+		if(metrics.getProcessId(i) == 0) { continue; }
+		if(processCount++ == 0)
+		{
+			processId   = metrics.getProcessId(i);
+			processTick = metrics.getStartTime(i);
+		}
+	}
+	ULONGLONG nowTick = GetTickCount64();
+	ULONGLONG now     = getFileTimeNow();
+
+	InterlockedIncrement((volatile LONG*)&page->sequence);
+	page->state        = (unsigned int)state;
+	page->processId    = processId;
+	page->processCount = processCount;
+	page->lastExitCode = metrics.getLastExitCode();
+	page->starts       = metrics.getStarts();
+	page->restarts     = metrics.getRestarts();
+	page->crashes      = metrics.getCrashes();
+	page->processTime  = toFileTime(processTick,nowTick,now);
+	page->lastExitTime = toFileTime(metrics.getLastExitTime(),nowTick,now);
+	page->updateTime   = now;
+	InterlockedIncrement((volatile LONG*)&page->sequence);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : StatusPage::read
+//
+// ACCESS SPECIFIER: public static
+//
+// DESCRIPTION     : read the page of a service (global first, then local)
+//
+// ARGUMENTS       : service IN  service name
+//                   status  OUT the status
+//
+// RETURNS         : false if the service has no page (it is not running
+//                   under LiteSrv), or it could not be read
+//
+// ============================================================================
+bool StatusPage::read
+(
+	const char    *service,
+	LiteSrvStatus &status
+)
+{
+	char name[MAX_PATH];
+	const char *formats[] = { LITESRV_STATUS_GLOBAL_NAME, LITESRV_STATUS_LOCAL_NAME };
+	for(int i=0;i<2;i++)
+	{
+		if(strlen(service)+strlen(formats[i]) >= sizeof(name)) { return false; }
+		sprintf(name,formats[i],service);
+		HANDLE hPage = OpenFileMapping(FILE_MAP_READ,FALSE,name);
+		if(hPage == NULL) { continue; }
+
+		const LiteSrvStatus *view = (const LiteSrvStatus*)MapViewOfFile(hPage,FILE_MAP_READ,0,0,sizeof(LiteSrvStatus));
+		bool ok = (view != 0)&&LiteSrvReadStatus(view,&status);
+		if(view != 0) { UnmapViewOfFile(view); }
+		CloseHandle(hPage);
+		if(ok) { return true; }
+		LOGGER_LOG_DEBUG1("status page %s could not be read",name)
+	}
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : StatusPage::StatusPage
+//                   StatusPage::~StatusPage
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+StatusPage::StatusPage()
+{
+	hMapping = NULL;
+	page     = 0;
+}
+
+StatusPage::~StatusPage()
+{
+	if(page != 0) { UnmapViewOfFile(page); }
+	if(hMapping != NULL) { CloseHandle(hMapping); }
+}
+
@@ -0,0 +1,111 @@
+
+// prevent multiple inclusion
+
+#if !defined(__STATUS_PAGE_H__)
+#define __STATUS_PAGE_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting StatusPage")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("StatusPage is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing StatusPage")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// status page layout
+#include "LiteSrvStatus.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+class ServiceMetrics;
+
+// ============================================================================
+//
+// StatusPage class
+//
+// Publishes the status of a service in shared memory, for monitoring tools
+// (see LiteSrvStatus.h for the layout and how to read it), and reads it
+// back for "LiteSrv status". The page is only updated by the thread which
+// supervises the service; a failure to create it is logged, and the
+// service runs without it.
+//
+// ============================================================================
+class LiteSrv_DLL_API StatusPage
+{
+public:
+	// create the page for a service (once)
+	void open(const char *service);
+	bool isOpen() const;
+
+	// publish the state of the service (one of the ScmConnector::SCM_STATUSES)
+	// and what has been done with its processes
+	void update(int state,const ServiceMetrics &metrics);
+
+	// read the page of a service - false if there is none
+	static bool read(const char *service,LiteSrvStatus &status);
+
+	// constructor and destructor
+	StatusPage();
+	virtual ~StatusPage();
+
+private:
+	// private variables
+	HANDLE         hMapping;
+	LiteSrvStatus *page;
+
+	// prevent copying
+	StatusPage(const StatusPage&);
+	StatusPage &operator=(const StatusPage&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__STATUS_PAGE_H__)
@@ -0,0 +1,372 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// class headers
+#include "SystemdServiceControlBackend.h"
+
+#if defined(__linux__)
+
+// system headers
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+
+// support headers
+#include <logger.h>
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int  SYSTEMD_MESSAGE_SIZE = 256;
+const char SIGNAL_PIPE_STOP     = 's';	// SIGTERM received
+const char SIGNAL_PIPE_RELOAD   = 'r';	// SIGHUP received
+const char SIGNAL_PIPE_QUIT     = 'q';	// dispatcher has finished
+
+// ============================================================================
+//
+// STATIC MEMBER VARIABLES
+//
+// ============================================================================
+
+int SystemdServiceControlBackend::_signalPipe[2] = { -1,-1 };
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::runDispatcher
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : connect to the systemd notify socket, trap SIGTERM and
+//                   SIGHUP and run the service on this thread
+//
+// ARGUMENTS       : svcName     IN service name
+//                   serviceMain IN service entry point
+//
+// RETURNS         : false if we were not started by systemd (no
+//                   $NOTIFY_SOCKET) or the socket cannot be used
+//
+// ============================================================================
+bool SystemdServiceControlBackend::runDispatcher
+(
+	const char            *svcName,
+	SERVICE_MAIN_FUNCTION *serviceMain
+)
+{
+	LOGGER_LOG_DEBUG1("SystemdServiceControlBackend::runDispatcher(%s)",svcName)
+
+	// were we started by systemd?
+	const char *socketPath = getenv("NOTIFY_SOCKET");
+	if((socketPath == 0)||(socketPath[0] == '\0'))
+	{
+		LOGGER_LOG_DEBUG("NOTIFY_SOCKET is not set - not running under systemd")
+		return false;
+	}
+	if(strlen(socketPath) >= sizeof(_notifyAddress.sun_path))
+	{
+		LOGGER_LOG_ERROR1("NOTIFY_SOCKET '%s' is too long",socketPath)
+		return false;
+	}
+
+	// address ('@' means an abstract socket)
+	memset(&_notifyAddress,0,sizeof(_notifyAddress));
+	_notifyAddress.sun_family = AF_UNIX;
+	memcpy(_notifyAddress.sun_path,socketPath,strlen(socketPath));
+	if(socketPath[0] == '@') { _notifyAddress.sun_path[0] = '\0'; }
+	_notifyAddressLength = (socklen_t)(offsetof(struct sockaddr_un,sun_path)+strlen(socketPath));
+
+	_notifySocket = socket(AF_UNIX,SOCK_DGRAM|SOCK_CLOEXEC,0);
+	if(_notifySocket < 0)
+	{
+		LOGGER_LOG_ERROR1("failed to create notify socket, error=%d",errno)
+		return false;
+	}
+
+	// trap SIGTERM and SIGHUP
+	if(pipe2(_signalPipe,O_CLOEXEC) != 0)
+	{
+		LOGGER_LOG_ERROR1("failed to create signal pipe, error=%d",errno)
+		close(_notifySocket);
+		_notifySocket = -1;
+		return false;
+	}
+
+	struct sigaction action;
+	struct sigaction oldTermAction;
+	struct sigaction oldHupAction;
+	memset(&action,0,sizeof(action));
+	action.sa_handler = signalHandler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGTERM,&action,&oldTermAction);
+	sigaction(SIGHUP,&action,&oldHupAction);
+
+	thread signalThread(&SystemdServiceControlBackend::runSignalThread,this);
+
+	// run the service
+	(*serviceMain)();
+
+	// tidy up
+	sigaction(SIGTERM,&oldTermAction,0);
+	sigaction(SIGHUP,&oldHupAction,0);
+	char quit = SIGNAL_PIPE_QUIT;
+	if(write(_signalPipe[1],&quit,1) != 1)
+	{
+		LOGGER_LOG_ERROR1("failed to stop signal thread, error=%d",errno)
+	}
+	signalThread.join();
+
+	close(_signalPipe[0]);
+	close(_signalPipe[1]);
+	_signalPipe[0] = _signalPipe[1] = -1;
+	close(_notifySocket);
+	_notifySocket = -1;
+
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::registerControlHandler
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : register the handler for stop requests (a SIGTERM which
+//                   arrived before now is passed on straight away)
+//
+// ARGUMENTS       : svcName        IN service name
+//                   controlHandler IN handler
+//
+// RETURNS         : true
+//
+// ============================================================================
+bool SystemdServiceControlBackend::registerControlHandler
+(
+	const char               *svcName,
+	CONTROL_HANDLER_FUNCTION *controlHandler
+)
+{
+	LOGGER_LOG_DEBUG1("SystemdServiceControlBackend::registerControlHandler(%s)",svcName)
+
+	bool stopPending;
+	{
+		lock_guard<mutex> lock(_lock);
+		_controlHandler = controlHandler;
+		stopPending     = _stopPending;
+		_stopPending    = false;
+	}
+
+	if(stopPending) { (*controlHandler)(SCR_STOP,SIGTERM); }
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::reportStatus
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : send a state to systemd
+//                    - a pending state extends systemd's start/stop timeout by
+//                      the wait hint
+//                    - running is READY=1 (and paused is still ready)
+//
+// ARGUMENTS       : state      IN state
+//                   checkPoint IN checkpoint (not used)
+//                   waitHint   IN wait hint (ms)
+//
+// RETURNS         : false on error
+//
+// ============================================================================
+bool SystemdServiceControlBackend::reportStatus
+(
+	SERVICE_CONTROL_STATES state,
+	unsigned long          ,
+	unsigned long          waitHint
+)
+{
+	char message[SYSTEMD_MESSAGE_SIZE];
+
+	switch(state)
+	{
+		case SCS_START_PENDING:
+			snprintf(message,sizeof(message),"STATUS=starting\nEXTEND_TIMEOUT_USEC=%lu",waitHint*1000UL);
+			break;
+
+		case SCS_RUNNING:
+			snprintf(message,sizeof(message),"READY=1\nSTATUS=running\nMAINPID=%d",(int)getpid());
+			break;
+
+		case SCS_PAUSED:
+			snprintf(message,sizeof(message),"STATUS=paused");
+			break;
+
+		case SCS_STOP_PENDING:
+			snprintf(message,sizeof(message),"STOPPING=1\nSTATUS=stopping\nEXTEND_TIMEOUT_USEC=%lu",waitHint*1000UL);
+			break;
+
+		default:
+			snprintf(message,sizeof(message),"STATUS=stopped");
+			break;
+	}
+
+	return notify(message);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::getName
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : name of backend
+//
+// ============================================================================
+const char *SystemdServiceControlBackend::getName() const { return "systemd"; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::SystemdServiceControlBackend
+//                   SystemdServiceControlBackend::~SystemdServiceControlBackend
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+SystemdServiceControlBackend::SystemdServiceControlBackend()
+{
+	_notifySocket        = -1;
+	_notifyAddressLength = 0;
+	_controlHandler      = 0;
+	_stopPending         = false;
+	memset(&_notifyAddress,0,sizeof(_notifyAddress));
+}
+
+SystemdServiceControlBackend::~SystemdServiceControlBackend() {}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::notify
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : send one sd_notify message
+//
+// ARGUMENTS       : message IN newline-separated assignments
+//
+// RETURNS         : false on error
+//
+// ============================================================================
+bool SystemdServiceControlBackend::notify
+(
+	const char *message
+)
+{
+	LOGGER_LOG_DEBUG1("notifying systemd: %s",message)
+
+	if(sendto(_notifySocket,message,strlen(message),MSG_NOSIGNAL,
+				(struct sockaddr*)&_notifyAddress,_notifyAddressLength) < 0)
+	{
+		LOGGER_LOG_ERROR1("failed to notify systemd, error=%d",errno)
+		return false;
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::signalHandler
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : SIGTERM/SIGHUP handler - only async-signal-safe calls
+//                   here, so just wake up the signal thread
+//
+// ============================================================================
+void SystemdServiceControlBackend::signalHandler
+(
+	int signal
+)
+{
+	int  savedErrno = errno;
+	char received   = (signal == SIGHUP) ? SIGNAL_PIPE_RELOAD : SIGNAL_PIPE_STOP;
+	if(write(_signalPipe[1],&received,1) != 1) { /* nothing can be done here */ }
+	errno = savedErrno;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : SystemdServiceControlBackend::runSignalThread
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : pass each SIGTERM to the control handler as a stop
+//                   request, and each SIGHUP as a parameter change, until
+//                   the dispatcher finishes
+//
+// ============================================================================
+void SystemdServiceControlBackend::runSignalThread()
+{
+	while(true)
+	{
+		char    received;
+		ssize_t length = read(_signalPipe[0],&received,1);
+		if((length < 0)&&(errno == EINTR)) { continue; }
+		if((length <= 0)||(received == SIGNAL_PIPE_QUIT)) { return; }
+
+		bool stop = (received == SIGNAL_PIPE_STOP);
+		LOGGER_LOG_DEBUG1("%s received",stop ? "SIGTERM" : "SIGHUP")
+		CONTROL_HANDLER_FUNCTION *controlHandler;
+		{
+			lock_guard<mutex> lock(_lock);
+			controlHandler = _controlHandler;
+			if((controlHandler == 0)&&stop) { _stopPending = true; }
+		}
+		if(controlHandler != 0)
+		{
+			if(stop) { (*controlHandler)(SCR_STOP,SIGTERM); }
+			else     { (*controlHandler)(SCR_PARAMCHANGE,SIGHUP); }
+		}
+	}
+}
+
+#endif // defined(__linux__)
+
@@ -0,0 +1,119 @@
+
+// prevent multiple inclusion
+
+#if !defined(__SYSTEMD_SERVICE_CONTROL_BACKEND_H__)
+#define __SYSTEMD_SERVICE_CONTROL_BACKEND_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#if !defined(_WIN32)
+// there is no import or export outside Windows
+#define	LiteSrv_DLL_API
+
+#elif defined(LiteSrv_DLL_EXPORT)
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting SystemdServiceControlBackend")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("SystemdServiceControlBackend is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing SystemdServiceControlBackend")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+#if defined(__linux__)
+// system headers
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <mutex>
+#endif
+// interface
+#include "ServiceControlBackend.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+#if defined(__linux__)
+
+// ============================================================================
+//
+// SystemdServiceControlBackend class
+//
+// systemd (Type=notify) as the service controller: state changes are sent
+// as sd_notify messages on the datagram socket named by $NOTIFY_SOCKET.
+// SIGTERM is passed to the control handler as a stop request, and SIGHUP
+// (systemctl reload) as a parameter change.
+//
+// ============================================================================
+class LiteSrv_DLL_API SystemdServiceControlBackend : public ServiceControlBackend
+{
+public:
+	// ServiceControlBackend
+	bool runDispatcher(const char *svcName,SERVICE_MAIN_FUNCTION *serviceMain);
+	bool registerControlHandler(const char *svcName,CONTROL_HANDLER_FUNCTION *controlHandler);
+	bool reportStatus(SERVICE_CONTROL_STATES state,unsigned long checkPoint,unsigned long waitHint);
+	const char *getName() const;
+
+	// constructor and destructor
+	SystemdServiceControlBackend();
+	virtual ~SystemdServiceControlBackend();
+
+private:
+	// service functions
+	bool notify(const char *message);
+	static void signalHandler(int signal);
+	void runSignalThread();
+
+	// private variables
+	int                       _notifySocket;
+	struct sockaddr_un        _notifyAddress;
+	socklen_t                 _notifyAddressLength;
+	CONTROL_HANDLER_FUNCTION *_controlHandler;
+	bool                      _stopPending;		// SIGTERM before a handler was registered
+	std::mutex                _lock;			// guards _controlHandler and _stopPending
+
+	// signals are passed from the signal handler to _signalThread through a pipe
+	static int                _signalPipe[2];
+};
+
+#endif // defined(__linux__)
+
+} // namespace LiteSrv
+
+#endif // !defined(__SYSTEMD_SERVICE_CONTROL_BACKEND_H__)
+
@@ -0,0 +1,458 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "TimerWheel.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int FIRST_LEVEL_SLOTS = 1<<TIMER_WHEEL_FIRST_BITS;
+const int FIRST_LEVEL_MASK  = FIRST_LEVEL_SLOTS-1;
+const int LEVEL_SLOTS       = 1<<TIMER_WHEEL_LEVEL_BITS;
+const int LEVEL_MASK        = LEVEL_SLOTS-1;
+
+// ============================================================================
+//
+// Timer PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Timer::isPending
+//                   Timer::hasExpired
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : state of the timer
+//
+// ============================================================================
+bool Timer::isPending() const { return wheel != 0; }
+bool Timer::hasExpired() const { return expired; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Timer::Timer
+//                   Timer::~Timer
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+Timer::Timer()
+{
+	wheel    = 0;
+	slot     = 0;
+	previous = 0;
+	next     = 0;
+	expiry   = 0;
+	expired  = false;
+}
+
+Timer::~Timer()
+{
+	if(wheel != 0) { wheel->cancel(*this); }
+}
+
+// ============================================================================
+//
+// TimerWheel PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::schedule
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : schedule a timer
+//
+// ARGUMENTS       : timer   IN/OUT timer
+//                   delayMs IN     delay
+//                   slackMs IN     how much later than the delay the timer
+//                                  may expire
+//
+// ============================================================================
+void TimerWheel::schedule
+(
+	Timer &timer,
+	DWORD  delayMs,
+	DWORD  slackMs
+)
+{
+	if(timer.wheel != 0) { timer.wheel->cancel(timer); }
+
+	// an idle wheel has nothing to catch up on
+	ULONGLONG now = getTickCount();
+	if(pendingCount == 0) { nextTick = now; }
+
+	timer.expiry  = applySlack(now+delayMs,slackMs);
+	timer.expired = false;
+	timer.wheel   = this;
+	add(timer);
+	pendingCount++;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::cancel
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : cancel a timer
+//
+// ARGUMENTS       : timer IN/OUT timer
+//
+// ============================================================================
+void TimerWheel::cancel
+(
+	Timer &timer
+)
+{
+	if(timer.wheel != this) { return; }
+	unlink(timer);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::getWaitTime
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : time until the next timer expires, or until the next
+//                   slot of a higher level is moved down (whichever is
+//                   sooner - the timers of that slot may expire later)
+//
+// ============================================================================
+DWORD TimerWheel::getWaitTime() const
+{
+	if(pendingCount == 0) { return INFINITE; }
+
+	ULONGLONG due = (ULONGLONG)-1;
+
+	// the rest of the current turn of the first level
+	for(ULONGLONG tick=nextTick;;tick++)
+	{
+		if(slots[tick&FIRST_LEVEL_MASK] != 0) { due = tick; break; }
+		if(((tick+1)&FIRST_LEVEL_MASK) == 0) { break; }
+	}
+
+	// the next slot to be moved down from each of the other levels - a slot
+	// starting at nextTick has not been moved down yet, and may hold timers
+	// due before anything on the first level
+	for(int level=1;level<TIMER_WHEEL_LEVELS;level++)
+	{
+		int       shift     = levelShift(level);
+		int       turnShift = levelShift(level+1);
+		ULONGLONG slotStart = ((nextTick+((ULONGLONG)1<<shift)-1)>>shift)<<shift;
+		for(;(slotStart < due)&&((slotStart>>turnShift) == (nextTick>>turnShift));slotStart+=(ULONGLONG)1<<shift)
+		{
+			if(slots[levelBase(level)+(int)((slotStart>>shift)&LEVEL_MASK)] != 0)
+			{
+				due = slotStart;
+				break;
+			}
+		}
+	}
+
+	// the next turn of the last level (the overflow is moved down then)
+	if((overflow != 0)||(due == (ULONGLONG)-1))
+	{
+		int       turnShift = levelShift(TIMER_WHEEL_LEVELS);
+		ULONGLONG turnStart = ((nextTick+((ULONGLONG)1<<turnShift)-1)>>turnShift)<<turnShift;
+		if(turnStart < due) { due = turnStart; }
+	}
+
+	ULONGLONG now = getTickCount();
+	if(due <= now) { return 0; }
+	return (due-now >= INFINITE) ? INFINITE-1 : (DWORD)(due-now);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::run
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : run every tick up to now - move down the slots of the
+//                   higher levels which start at the tick, then expire the
+//                   timers of the tick
+//
+// RETURNS         : number of timers expired
+//
+// ============================================================================
+int TimerWheel::run()
+{
+	ULONGLONG now     = getTickCount();
+	int       expired = 0;
+
+	while(nextTick <= now)
+	{
+		if(pendingCount == 0) { break; }
+
+		if((nextTick&FIRST_LEVEL_MASK) == 0) { cascade(nextTick); }
+
+		Timer **slot = &slots[nextTick&FIRST_LEVEL_MASK];
+		while(*slot != 0)
+		{
+			Timer &timer = **slot;
+			unlink(timer);
+			timer.expired = true;
+			expired++;
+		}
+		nextTick++;
+
+		// skip the empty slots in the rest of the turn
+		while((nextTick <= now)&&((nextTick&FIRST_LEVEL_MASK) != 0)&&(slots[nextTick&FIRST_LEVEL_MASK] == 0))
+		{
+			nextTick++;
+		}
+	}
+	if(pendingCount == 0) { nextTick = now+1; }
+
+	if(expired > 0) { LOGGER_LOG_DEBUG1("TimerWheel::run() - %d timers expired",expired) }
+	return expired;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::TimerWheel
+//                   TimerWheel::~TimerWheel
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+TimerWheel::TimerWheel()
+{
+	for(int i=0;i<TIMER_WHEEL_SLOTS;i++) { slots[i] = 0; }
+	overflow     = 0;
+	nextTick     = GetTickCount64();
+	pendingCount = 0;
+}
+
+TimerWheel::~TimerWheel()
+{
+	// timers outlive the wheel
+	for(int i=0;i<TIMER_WHEEL_SLOTS;i++)
+	{
+		while(slots[i] != 0) { unlink(*slots[i]); }
+	}
+	while(overflow != 0) { unlink(*overflow); }
+}
+
+// ============================================================================
+//
+// TimerWheel PROTECTED MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::getTickCount
+//
+// ACCESS SPECIFIER: protected
+//
+// DESCRIPTION     : the time now
+//
+// RETURNS         : GetTickCount64()
+//
+// ============================================================================
+ULONGLONG TimerWheel::getTickCount() const { return GetTickCount64(); }
+
+// ============================================================================
+//
+// TimerWheel PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::add
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : put a timer in its slot - on the lowest level whose
+//                   current turn includes its expiry
+//
+// ARGUMENTS       : timer IN/OUT timer
+//
+// ============================================================================
+void TimerWheel::add
+(
+	Timer &timer
+)
+{
+	ULONGLONG expiry = (timer.expiry < nextTick) ? nextTick : timer.expiry;
+
+	Timer **slot = &overflow;
+	for(int level=0;level<TIMER_WHEEL_LEVELS;level++)
+	{
+		int turnShift = levelShift(level+1);
+		if((expiry>>turnShift) == (nextTick>>turnShift))
+		{
+			int mask = (level == 0) ? FIRST_LEVEL_MASK : LEVEL_MASK;
+			slot = &slots[levelBase(level)+(int)((expiry>>levelShift(level))&mask)];
+			break;
+		}
+	}
+
+	timer.slot     = slot;
+	timer.previous = 0;
+	timer.next     = *slot;
+	if(*slot != 0) { (*slot)->previous = &timer; }
+	*slot = &timer;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::unlink
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : take a pending timer off the wheel
+//
+// ARGUMENTS       : timer IN/OUT timer
+//
+// ============================================================================
+void TimerWheel::unlink
+(
+	Timer &timer
+)
+{
+	if(timer.previous != 0) { timer.previous->next = timer.next; }
+	else                    { *timer.slot = timer.next; }
+	if(timer.next != 0) { timer.next->previous = timer.previous; }
+
+	timer.wheel    = 0;
+	timer.slot     = 0;
+	timer.previous = 0;
+	timer.next     = 0;
+	pendingCount--;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::cascade
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : move down the timers of each higher level slot which
+//                   starts at this tick (highest level first, so that a
+//                   timer can move down more than one level)
+//
+// ARGUMENTS       : tick IN first level tick (the start of a turn)
+//
+// ============================================================================
+void TimerWheel::cascade
+(
+	ULONGLONG tick
+)
+{
+	for(int level=TIMER_WHEEL_LEVELS;level>0;level--)
+	{
+		int shift = levelShift(level);
+		if((tick&(((ULONGLONG)1<<shift)-1)) != 0) { continue; }
+
+		Timer **slot = (level == TIMER_WHEEL_LEVELS) ?
+							&overflow : &slots[levelBase(level)+(int)((tick>>shift)&LEVEL_MASK)];
+		Timer *timers = *slot;
+		*slot = 0;
+		while(timers != 0)
+		{
+			Timer *timer = timers;
+			timers = timer->next;
+			add(*timer);
+		}
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::applySlack
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : the time in [expiry, expiry+slack] with the most
+//                   trailing zero bits
+//
+// ARGUMENTS       : expiry  IN earliest expiry
+//                   slackMs IN slack
+//
+// RETURNS         : expiry to use
+//
+// ============================================================================
+ULONGLONG TimerWheel::applySlack
+(
+	ULONGLONG expiry,
+	DWORD     slackMs
+)
+{
+	if(slackMs == 0) { return expiry; }
+
+	// keep the bits above the highest one which differs, and set that one
+	ULONGLONG latest    = expiry+slackMs;
+	ULONGLONG differing = expiry^latest;
+	ULONGLONG highest   = 1;
+	while((differing >>= 1) != 0) { highest <<= 1; }
+	return latest&~(highest-1);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : TimerWheel::levelShift
+//                   TimerWheel::levelBase
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : log2 of the length of a slot of a level (for the level
+//                   after the last, of the whole wheel) / index of the first
+//                   slot of a level
+//
+// ============================================================================
+int TimerWheel::levelShift
+(
+	int level
+)
+{
+	return (level == 0) ? 0 : TIMER_WHEEL_FIRST_BITS+(level-1)*TIMER_WHEEL_LEVEL_BITS;
+}
+
+int TimerWheel::levelBase
+(
+	int level
+)
+{
+	return (level == 0) ? 0 : FIRST_LEVEL_SLOTS+(level-1)*LEVEL_SLOTS;
+}
+
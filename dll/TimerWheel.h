@@ -0,0 +1,188 @@
+
+// prevent multiple inclusion
+
+#if !defined(__TIMER_WHEEL_H__)
+#define __TIMER_WHEEL_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#if !defined(_WIN32)
+// there is no import or export outside Windows
+#define	LiteSrv_DLL_API
+
+#elif defined(LiteSrv_DLL_EXPORT)
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting TimerWheel")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("TimerWheel is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing TimerWheel")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// wheel levels: the first has 256 one-millisecond slots, each of the
+// others 64 slots, each slot as long as a turn of the level below
+const int TIMER_WHEEL_LEVELS      = 5;
+const int TIMER_WHEEL_FIRST_BITS  = 8;
+const int TIMER_WHEEL_LEVEL_BITS  = 6;
+const int TIMER_WHEEL_SLOTS       = (1<<TIMER_WHEEL_FIRST_BITS)+(TIMER_WHEEL_LEVELS-1)*(1<<TIMER_WHEEL_LEVEL_BITS);
+
+class TimerWheel;
+
+// ============================================================================
+//
+// Timer class
+//
+// A timer owned by its user and scheduled on a TimerWheel. A timer which
+// is destroyed while it is pending is cancelled.
+//
+// ============================================================================
+class LiteSrv_DLL_API Timer
+{
+public:
+	// scheduled and not yet expired or cancelled?
+	bool isPending() const;
+
+	// expired since it was last scheduled?
+	bool hasExpired() const;
+
+	// constructor and destructor
+	Timer();
+	virtual ~Timer();
+
+private:
+	friend class TimerWheel;
+
+	// private variables
+	TimerWheel *wheel;			// while pending
+	Timer     **slot;			// list the timer is in
+	Timer      *previous;
+	Timer      *next;
+	ULONGLONG   expiry;			// GetTickCount64()
+	bool        expired;
+
+	// prevent copying
+	Timer(const Timer&);
+	Timer &operator=(const Timer&);
+};
+
+// ============================================================================
+//
+// TimerWheel class
+//
+// A hierarchical timing wheel with millisecond resolution. Scheduling and
+// cancelling a timer take constant time, and a timer is moved down a
+// level at most once per level, so the cost of running the wheel does not
+// grow with the number of timers.
+//
+// A timer may be given some slack: it expires at the time in
+// [delay, delay+slack] with the most trailing zero bits, so that timers
+// whose slack overlaps expire on the same tick, and waking up for one
+// wakes up for all of them.
+//
+// The wheel is driven by the supervision loop, not by a thread of its
+// own: the loop waits (on its own handles) with a timeout of
+// getWaitTime(), and calls run() whenever it wakes up; run() marks the
+// timers which are due as expired. It is not thread-safe.
+//
+// ============================================================================
+class LiteSrv_DLL_API TimerWheel
+{
+public:
+	// schedule a timer (a pending timer is rescheduled)
+	void schedule(Timer &timer,DWORD delayMs,DWORD slackMs = 0);
+
+	// cancel a timer (nothing happens if it is not pending)
+	void cancel(Timer &timer);
+
+	// milliseconds until run() must next be called (INFINITE if no timer
+	// is pending)
+	DWORD getWaitTime() const;
+
+	// expire the timers which are due
+	// returns how many expired
+	int run();
+
+	// constructor and destructor
+	TimerWheel();
+	virtual ~TimerWheel();
+
+protected:
+	// the time now, in milliseconds (GetTickCount64() - a test may set it)
+	virtual ULONGLONG getTickCount() const;
+
+private:
+	// service functions
+	void add(Timer &timer);
+	void unlink(Timer &timer);
+	void cascade(ULONGLONG tick);
+	static ULONGLONG applySlack(ULONGLONG expiry,DWORD slackMs);
+	static int levelShift(int level);
+	static int levelBase(int level);
+
+	// private variables
+	Timer     *slots[TIMER_WHEEL_SLOTS];
+	Timer     *overflow;		// beyond the last level
+	ULONGLONG  nextTick;		// first tick not yet run
+	int        pendingCount;
+
+	// prevent copying
+	TimerWheel(const TimerWheel&);
+	TimerWheel &operator=(const TimerWheel&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__TIMER_WHEEL_H__)
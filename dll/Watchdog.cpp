@@ -0,0 +1,363 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "Watchdog.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const char *WATCHDOG_MAILSLOT_FORMAT  = "\\\\.\\mailslot\\LiteSrv\\watchdog\\%lu";
+const char *WATCHDOG_KEEPALIVE        = "WATCHDOG=1";
+const char *NOTIFY_SOCKET_NAME        = "NOTIFY_SOCKET";
+const char *WATCHDOG_USEC_NAME        = "WATCHDOG_USEC";
+const DWORD HEARTBEAT_POLL_MS         = 1000;
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::setInterval
+//                   Watchdog::getInterval
+//                   Watchdog::isEnabled
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get keepalive interval (seconds, 0 = off)
+//
+// ============================================================================
+void Watchdog::setInterval(int seconds) { interval = (seconds > 0) ? seconds : 0; }
+int  Watchdog::getInterval() const { return interval; }
+bool Watchdog::isEnabled() const { return interval > 0; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::setHeartbeatFile
+//                   Watchdog::getHeartbeatFile
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set / get the heartbeat file
+//
+// ARGUMENTS       : path IN file name
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void Watchdog::setHeartbeatFile
+(
+	const char *path
+) throw (LiteSrvException)
+{
+	if((path == 0)||(strlen(path) >= sizeof(heartbeatFile)))
+	{
+		LOGGER_LOG_ERROR1("invalid heartbeat file '%s'",(path == 0) ? "" : path)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"Watchdog","setHeartbeatFile")
+	}
+	strcpy(heartbeatFile,path);
+}
+
+const char *Watchdog::getHeartbeatFile() const { return heartbeatFile; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::prepare
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : create the mailslot (once) and set %NOTIFY_SOCKET% and
+//                   %WATCHDOG_USEC% for the command
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void Watchdog::prepare() throw (LiteSrvException)
+{
+	LOGGER_LOG_DEBUG("Watchdog::prepare()")
+
+	if(!isEnabled()) { return; }
+
+	char value[MAX_PATH];
+	sprintf(value,"%llu",(ULONGLONG)interval*1000000);
+	SetEnvironmentVariable(WATCHDOG_USEC_NAME,value);
+
+	// the heartbeat file needs no mailslot
+	if(heartbeatFile[0] != '\0') { return; }
+
+	sprintf(value,WATCHDOG_MAILSLOT_FORMAT,GetCurrentProcessId());
+	if(hMailslot == INVALID_HANDLE_VALUE)
+	{
+		// reads must wait, so that an overlapped read of an empty mailslot
+		// is left pending (with a timeout of 0 it fails at once)
+		hMailslot = CreateMailslot(value,WATCHDOG_MESSAGE_SIZE,MAILSLOT_WAIT_FOREVER,NULL);
+		if(hMailslot == INVALID_HANDLE_VALUE)
+		{
+			LOGGER_LOG_ERROR2("failed to create watchdog mailslot %s, error=%d",value,GetLastError())
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"Watchdog","prepare")
+		}
+		LOGGER_LOG_DEBUG1("created watchdog mailslot %s",value)
+	}
+	SetEnvironmentVariable(NOTIFY_SOCKET_NAME,value);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::arm
+//                   Watchdog::disarm
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : start the deadline (keepalives left over from an
+//                   earlier command are discarded) / stop it
+//
+// ============================================================================
+void Watchdog::arm()
+{
+	if(!isEnabled()) { return; }
+
+	LOGGER_LOG_DEBUG1("Watchdog::arm() - interval %d seconds",interval)
+	armed = false;
+	readMessages();
+	if(heartbeatFile[0] != '\0') { heartbeatFileTouched(); }
+	armed = true;
+	kick();
+}
+
+void Watchdog::disarm() { armed = false; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::getEvent
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : event signalled when a read from the mailslot completes
+//                   (NULL while disarmed: a read which completes then is
+//                   only taken when the watchdog is armed again, and would
+//                   otherwise leave the event signalled)
+//
+// ============================================================================
+HANDLE Watchdog::getEvent() const
+{
+	return ((hMailslot == INVALID_HANDLE_VALUE)||!armed) ? NULL : readOverlapped.hEvent;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::getWaitTime
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : time until check() is next due - the deadline, or the
+//                   next look at the heartbeat file if that is sooner
+//
+// ============================================================================
+DWORD Watchdog::getWaitTime() const
+{
+	if(!armed) { return INFINITE; }
+
+	ULONGLONG now      = GetTickCount64();
+	DWORD     waitTime = (now >= deadline) ? 0 : (DWORD)(deadline-now);
+	if((heartbeatFile[0] != '\0')&&(waitTime > HEARTBEAT_POLL_MS)) { waitTime = HEARTBEAT_POLL_MS; }
+	return waitTime;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::check
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : take any keepalives, then check the deadline
+//
+// RETURNS         : false if the deadline has passed without a keepalive
+//
+// ============================================================================
+bool Watchdog::check()
+{
+	if(!armed) { return true; }
+
+	if(readMessages()) { kick(); }
+	if((heartbeatFile[0] != '\0')&&heartbeatFileTouched()) { kick(); }
+
+	if(GetTickCount64() < deadline) { return true; }
+
+	LOGGER_LOG_ERROR1("watchdog: no keepalive for %d seconds",interval)
+	armed = false;
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::Watchdog
+//                   Watchdog::~Watchdog
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+Watchdog::Watchdog()
+{
+	interval         = 0;
+	heartbeatFile[0] = '\0';
+	armed            = false;
+	deadline         = 0;
+	hMailslot        = INVALID_HANDLE_VALUE;
+	readPending      = false;
+	memset(&heartbeatTime,0,sizeof(heartbeatTime));
+	memset(&readOverlapped,0,sizeof(readOverlapped));
+	readOverlapped.hEvent = CreateEvent(NULL,TRUE,FALSE,NULL);
+}
+
+Watchdog::~Watchdog()
+{
+	if(hMailslot != INVALID_HANDLE_VALUE)
+	{
+		if(readPending)
+		{
+			DWORD bytesRead;
+			CancelIo(hMailslot);
+			GetOverlappedResult(hMailslot,&readOverlapped,&bytesRead,TRUE);
+		}
+		CloseHandle(hMailslot);
+	}
+	if(readOverlapped.hEvent != NULL) { CloseHandle(readOverlapped.hEvent); }
+}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::readMessages
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : read every message waiting in the mailslot, and leave a
+//                   read pending (which signals the event when the next
+//                   message arrives)
+//
+// RETURNS         : true if a keepalive was read
+//
+// ============================================================================
+bool Watchdog::readMessages()
+{
+	if(hMailslot == INVALID_HANDLE_VALUE) { return false; }
+
+	bool  keepalive = false;
+	DWORD bytesRead;
+	while(true)
+	{
+		if(!readPending)
+		{
+			if(ReadFile(hMailslot,message,WATCHDOG_MESSAGE_SIZE,NULL,&readOverlapped))
+			{
+				readPending = true;
+			}
+			else if(GetLastError() == ERROR_IO_PENDING)
+			{
+				// nothing waiting - the event is signalled by the next message
+				readPending = true;
+				break;
+			}
+			else
+			{
+				LOGGER_LOG_ERROR1("failed to read watchdog mailslot, error=%d",GetLastError())
+				break;
+			}
+		}
+
+		if(!GetOverlappedResult(hMailslot,&readOverlapped,&bytesRead,FALSE))
+		{
+			if(GetLastError() != ERROR_IO_INCOMPLETE)
+			{
+				LOGGER_LOG_ERROR1("failed to read watchdog mailslot, error=%d",GetLastError())
+				readPending = false;
+			}
+			break;
+		}
+		readPending = false;
+
+		// one or more newline-separated assignments
+		message[bytesRead] = '\0';
+		LOGGER_LOG_DEBUG1("watchdog message '%s'",message)
+		for(char *line=strtok(message,"\r\n");line!=0;line=strtok(0,"\r\n"))
+		{
+			if(!strcmp(line,WATCHDOG_KEEPALIVE)) { keepalive = true; }
+		}
+	}
+	return keepalive;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::heartbeatFileTouched
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : has the heartbeat file been written since we last looked?
+//
+// ============================================================================
+bool Watchdog::heartbeatFileTouched()
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(!GetFileAttributesEx(heartbeatFile,GetFileExInfoStandard,&attributes)) { return false; }
+
+	if(CompareFileTime(&attributes.ftLastWriteTime,&heartbeatTime) == 0) { return false; }
+	heartbeatTime = attributes.ftLastWriteTime;
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Watchdog::kick
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : a keepalive has been received - move the deadline on
+//
+// ============================================================================
+void Watchdog::kick()
+{
+	deadline = GetTickCount64()+(ULONGLONG)interval*1000;
+	LOGGER_LOG_DEBUG1("watchdog kicked - next keepalive due within %d seconds",interval)
+}
+
@@ -0,0 +1,151 @@
+
+// prevent multiple inclusion
+
+#if !defined(__WATCHDOG_H__)
+#define __WATCHDOG_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting Watchdog")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("Watchdog is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing Watchdog")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// namespace header
+#include "LiteSrv.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// longest keepalive message
+const int WATCHDOG_MESSAGE_SIZE = 512;
+
+// ============================================================================
+//
+// Watchdog class
+//
+// Detects a command which is still running but no longer working. The
+// command must send a keepalive at least once every interval, either
+//  - by writing "WATCHDOG=1" to the mailslot named in its %NOTIFY_SOCKET%
+//    (%WATCHDOG_USEC% holds the interval, as for a systemd service), or
+//  - by touching a heartbeat file.
+//
+// The supervision loop waits on getEvent() (a keepalive message has
+// arrived) with a timeout of getWaitTime(), and calls check() whenever
+// either happens; check() returns false once the deadline has passed
+// without a keepalive.
+//
+// ============================================================================
+class LiteSrv_DLL_API Watchdog
+{
+public:
+	// keepalive interval in seconds (0 switches the watchdog off)
+	void setInterval(int seconds);
+	int  getInterval() const;
+	bool isEnabled() const;
+
+	// heartbeat file (if set, the file is watched instead of the mailslot)
+	void setHeartbeatFile(const char *path) throw (LiteSrvException);
+	const char *getHeartbeatFile() const;
+
+	// create the mailslot and put its name in the environment of commands
+	// started from now on
+	void prepare() throw (LiteSrvException);
+
+	// start / stop the deadline (the command has started / stopped)
+	void arm();
+	void disarm();
+
+	// signalled when a keepalive message may have arrived (NULL if there
+	// is no mailslot, or while disarmed)
+	HANDLE getEvent() const;
+
+	// milliseconds until check() must next be called (INFINITE if disarmed)
+	DWORD getWaitTime() const;
+
+	// take any keepalives and move the deadline on
+	// returns false if the deadline has passed
+	bool check();
+
+	// constructor and destructor
+	Watchdog();
+	virtual ~Watchdog();
+
+private:
+	// service functions
+	bool readMessages();
+	bool heartbeatFileTouched();
+	void kick();
+
+	// private variables
+	int        interval;		// seconds
+	char       heartbeatFile[MAX_PATH];
+	FILETIME   heartbeatTime;	// last write time of the heartbeat file
+	bool       armed;
+	ULONGLONG  deadline;		// GetTickCount64()
+
+	HANDLE     hMailslot;
+	OVERLAPPED readOverlapped;
+	bool       readPending;
+	char       message[WATCHDOG_MESSAGE_SIZE+1];
+
+	// prevent copying
+	Watchdog(const Watchdog&);
+	Watchdog &operator=(const Watchdog&);
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__WATCHDOG_H__)
+
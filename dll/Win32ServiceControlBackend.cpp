@@ -0,0 +1,250 @@
+
+
+// we are exporting the class
+#define	LiteSrv_DLL_EXPORT
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "Win32ServiceControlBackend.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+
+// ============================================================================
+//
+// STATIC MEMBER VARIABLES
+//
+// ============================================================================
+
+ServiceControlBackend::SERVICE_MAIN_FUNCTION    *Win32ServiceControlBackend::_serviceMain    = 0;
+ServiceControlBackend::CONTROL_HANDLER_FUNCTION *Win32ServiceControlBackend::_controlHandler = 0;
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Win32ServiceControlBackend::runDispatcher
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : connect to the Service Control Manager, which calls
+//                   serviceMain on a new thread
+//
+// ARGUMENTS       : svcName     IN service name
+//                   serviceMain IN service entry point
+//
+// RETURNS         : false if we are not running as a service
+//
+// ============================================================================
+bool Win32ServiceControlBackend::runDispatcher
+(
+	const char            *svcName,
+	SERVICE_MAIN_FUNCTION *serviceMain
+)
+{
+	LOGGER_LOG_DEBUG1("Win32ServiceControlBackend::runDispatcher(%s)",svcName)
+
+	_serviceMain = serviceMain;
+
+	// fill in service details
+	SERVICE_TABLE_ENTRY	DispatchTable[2];
+	DispatchTable[0].lpServiceName = const_cast<char*>(svcName);
+	DispatchTable[0].lpServiceProc = win32ServiceMain;
+	DispatchTable[1].lpServiceName = NULL;
+	DispatchTable[1].lpServiceProc = NULL;
+
+	// connect to the Service Control Manager
+	// if we are not running as a service, this will fail
+	if(!StartServiceCtrlDispatcher(DispatchTable))
+	{
+		LOGGER_LOG_DEBUG1("failed in call to StartServiceCtrlDispatcher, error=%u",GetLastError())
+		return false;
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Win32ServiceControlBackend::registerControlHandler
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : register the Service Control Handler
+//
+// ARGUMENTS       : svcName        IN service name
+//                   controlHandler IN handler
+//
+// RETURNS         : false on error
+//
+// ============================================================================
+bool Win32ServiceControlBackend::registerControlHandler
+(
+	const char               *svcName,
+	CONTROL_HANDLER_FUNCTION *controlHandler
+)
+{
+	_controlHandler = controlHandler;
+	_hServiceStatus = RegisterServiceCtrlHandler(svcName,win32ControlHandler);
+	if(_hServiceStatus == 0)
+	{
+		LOGGER_LOG_ERROR1("failed to register SCH, error=%d",GetLastError())
+		return false;
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Win32ServiceControlBackend::reportStatus
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : report current status of service to SCM
+//
+// ARGUMENTS       : state      IN state to report
+//                   checkPoint IN checkpoint, used while pending only
+//                   waitHint   IN wait hint (ms), used while pending only
+//
+// RETURNS         : false on error
+//
+// ============================================================================
+bool Win32ServiceControlBackend::reportStatus
+(
+	SERVICE_CONTROL_STATES state,
+	unsigned long          checkPoint,
+	unsigned long          waitHint
+)
+{
+	SERVICE_STATUS serviceStatus;
+
+	// initialise service status information
+	// type of service:  Win32 service running in its own process
+	serviceStatus.dwServiceType             = SERVICE_WIN32;
+	// what control codes will be accepted: stop, parameter change (reload),
+	// pause and continue (user-defined codes are always accepted)
+	serviceStatus.dwControlsAccepted        = SERVICE_ACCEPT_STOP|SERVICE_ACCEPT_PARAMCHANGE|
+											 SERVICE_ACCEPT_PAUSE_CONTINUE;
+	// other status information
+	serviceStatus.dwWin32ExitCode           = 0;
+	serviceStatus.dwServiceSpecificExitCode = 0;
+	serviceStatus.dwCheckPoint              = checkPoint;
+	serviceStatus.dwWaitHint                = waitHint;
+
+	// current state
+	switch(state)
+	{
+		case SCS_START_PENDING: serviceStatus.dwCurrentState = SERVICE_START_PENDING; break;
+		case SCS_RUNNING:       serviceStatus.dwCurrentState = SERVICE_RUNNING;       break;
+		case SCS_PAUSED:        serviceStatus.dwCurrentState = SERVICE_PAUSED;        break;
+		case SCS_STOP_PENDING:  serviceStatus.dwCurrentState = SERVICE_STOP_PENDING;  break;
+		default:                serviceStatus.dwCurrentState = SERVICE_STOPPED;       break;
+	}
+
+	if (!SetServiceStatus(_hServiceStatus,&serviceStatus))
+	{
+		// failed to report service status
+		LOGGER_LOG_ERROR2("failed to report status %d, error=%u",serviceStatus.dwCurrentState,GetLastError())
+		return false;
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Win32ServiceControlBackend::getName
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : name of backend
+//
+// ============================================================================
+const char *Win32ServiceControlBackend::getName() const { return "Win32 SCM"; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Win32ServiceControlBackend::Win32ServiceControlBackend
+//                   Win32ServiceControlBackend::~Win32ServiceControlBackend
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+Win32ServiceControlBackend::Win32ServiceControlBackend() { _hServiceStatus = 0; }
+
+Win32ServiceControlBackend::~Win32ServiceControlBackend() {}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : Win32ServiceControlBackend::win32ServiceMain
+//                   Win32ServiceControlBackend::win32ControlHandler
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : SCM entry points - pass on to the registered functions
+//
+// ============================================================================
+void WINAPI Win32ServiceControlBackend::win32ServiceMain
+(
+	DWORD   ,
+	LPTSTR *
+)
+{
+	(*_serviceMain)();
+}
+
+void WINAPI Win32ServiceControlBackend::win32ControlHandler
+(
+	DWORD opcode
+)
+{
+	switch(opcode)
+	{
+		case SERVICE_CONTROL_STOP:        (*_controlHandler)(SCR_STOP,opcode);        break;
+		case SERVICE_CONTROL_SHUTDOWN:    (*_controlHandler)(SCR_SHUTDOWN,opcode);    break;
+		case SERVICE_CONTROL_INTERROGATE: (*_controlHandler)(SCR_INTERROGATE,opcode); break;
+		case SERVICE_CONTROL_PARAMCHANGE: (*_controlHandler)(SCR_PARAMCHANGE,opcode); break;
+		case SERVICE_CONTROL_PAUSE:       (*_controlHandler)(SCR_PAUSE,opcode);       break;
+		case SERVICE_CONTROL_CONTINUE:    (*_controlHandler)(SCR_CONTINUE,opcode);    break;
+		default:
+			if((opcode >= 128)&&(opcode <= 255))
+			{
+				// user-defined control code
+				(*_controlHandler)(SCR_CUSTOM,opcode);
+			}
+			else
+			{
+				LOGGER_LOG_DEBUG1("unsupported SCM op code %d",opcode)
+				(*_controlHandler)(SCR_UNKNOWN,opcode);
+			}
+			break;
+	}
+}
+
@@ -0,0 +1,97 @@
+
+// prevent multiple inclusion
+
+#if !defined(__WIN32_SERVICE_CONTROL_BACKEND_H__)
+#define __WIN32_SERVICE_CONTROL_BACKEND_H__
+
+// ============================================================================
+//
+// IMPORT / EXPORT
+//
+// ============================================================================
+
+//
+// if LiteSrv_DLL_EXPORT is #defined, then we are building the DLL
+//  and exporting the classes
+//
+// otherwise, we are building an executable which will link with the DLL at run-time
+//
+// -------------------------------------------------------------
+// APART FROM THE DLL ITSELF,
+//  ANY SOURCE FILE WHICH #includes THIS ONE SHOULD ENSURE THAT
+//  LiteSrv_DLL_EXPORT is not #defined
+// -------------------------------------------------------------
+//
+
+#ifdef LiteSrv_DLL_EXPORT
+#define LiteSrv_DLL_API __declspec(dllexport)
+#pragma message("exporting Win32ServiceControlBackend")
+
+#else
+
+#ifdef	LiteSrv_DLL_LOCAL
+#pragma message("Win32ServiceControlBackend is local")
+#define	LiteSrv_DLL_API
+
+#else
+
+#define LiteSrv_DLL_API __declspec(dllimport)
+#pragma message("importing Win32ServiceControlBackend")
+
+#endif
+#endif
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// namespace header
+#include "LiteSrv.h"
+// interface
+#include "ServiceControlBackend.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// Win32ServiceControlBackend class
+//
+// The Windows Service Control Manager (the default backend)
+//
+// ============================================================================
+class LiteSrv_DLL_API Win32ServiceControlBackend : public ServiceControlBackend
+{
+public:
+	// ServiceControlBackend
+	bool runDispatcher(const char *svcName,SERVICE_MAIN_FUNCTION *serviceMain);
+	bool registerControlHandler(const char *svcName,CONTROL_HANDLER_FUNCTION *controlHandler);
+	bool reportStatus(SERVICE_CONTROL_STATES state,unsigned long checkPoint,unsigned long waitHint);
+	const char *getName() const;
+
+	// constructor and destructor
+	Win32ServiceControlBackend();
+	virtual ~Win32ServiceControlBackend();
+
+private:
+	// the SCM only supports one service per process here, so the functions
+	// it calls back are held statically
+	static SERVICE_MAIN_FUNCTION    *_serviceMain;
+	static CONTROL_HANDLER_FUNCTION *_controlHandler;
+	static void WINAPI win32ServiceMain(DWORD argc,LPTSTR *argv);
+	static void WINAPI win32ControlHandler(DWORD opcode);
+
+	SERVICE_STATUS_HANDLE _hServiceStatus;
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__WIN32_SERVICE_CONTROL_BACKEND_H__)
+
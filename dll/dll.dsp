@@ -130,10 +130,6 @@ SOURCE=.\ServiceManager.h
 # End Source File
 # Begin Source File
 
-SOURCE=.\Sleeper.h
-# End Source File
-# Begin Source File
-
 SOURCE=.\SrvStart.h
 # End Source File
 # Begin Source File
@@ -0,0 +1,770 @@
+
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ConfigurationFile.h"
+#include "CompiledConfiguration.h"
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+//
+// snapshot layout - the file is:
+//   header
+//   section table (sorted by section name)
+//   directive records
+//   string table (null-terminated strings; offset 0 is the empty string)
+//
+
+const char SNAPSHOT_MAGIC[4] = { 'L', 'S', 'C', 'C' };
+
+struct SnapshotHeader
+{
+	char         magic[4];
+	unsigned int version;
+	unsigned int directiveTableSignature;
+	unsigned int totalSize;
+	// source file
+	ULONGLONG    sourceModified;
+	ULONGLONG    sourceSize;
+	ULONGLONG    sourceHash;
+	char         sourcePath[MAX_PATH];
+	// contents
+	unsigned int unsectionedFirst;
+	unsigned int unsectionedCount;
+	unsigned int sectionCount;
+	unsigned int recordCount;
+	unsigned int sectionsOffset;
+	unsigned int recordsOffset;
+	unsigned int stringsOffset;
+};
+
+struct SnapshotSection
+{
+	unsigned int nameOffset;
+	unsigned int firstRecord;
+	unsigned int recordCount;
+};
+
+struct SnapshotRecord
+{
+	int          directiveId;
+	unsigned int directiveOffset;
+	unsigned int valueOffset;
+	unsigned int envNameOffset;		// 0 unless an env directive with a name
+	unsigned int envValueOffset;
+};
+
+//
+// helpers used while compiling
+//
+
+class SnapshotStrings
+{
+public:
+	SnapshotStrings() { strings.push_back('\0'); }
+
+	unsigned int add(const char *text,int length)
+	{
+		if(length==0) { return 0; }
+		unsigned int offset = (unsigned int)strings.size();
+		strings.insert(strings.end(),text,text+length);
+		strings.push_back('\0');
+		return offset;
+	}
+
+	vector<char> strings;
+};
+
+struct SnapshotSectionName
+{
+	ConfigurationText name;
+	int               fileIdx;
+	bool operator<(const SnapshotSectionName &other) const
+	{
+		int rc = memcmp(name.text,other.name.text,min(name.length,other.name.length));
+		return (rc!=0) ? (rc<0) : (name.length<other.name.length);
+	}
+};
+
+// ============================================================================
+//
+// LOCAL MACROS
+//
+// ============================================================================
+
+#define	SNAPSHOT_STRING(o)	(snapshot+((const SnapshotHeader*)snapshot)->stringsOffset+(o))
+#define	SNAPSHOT_RECORDS	((const SnapshotRecord*)(snapshot+((const SnapshotHeader*)snapshot)->recordsOffset))
+#define	SNAPSHOT_SECTIONS	((const SnapshotSection*)(snapshot+((const SnapshotHeader*)snapshot)->sectionsOffset))
+
+// ============================================================================
+//
+// LOCAL FUNCTION
+//
+// ============================================================================
+
+// ============================================================================
+//
+// FUNCTION        : addRecords
+//
+// DESCRIPTION     : add the directives of the requested section to the
+//                   snapshot records
+//
+// ARGUMENTS       : cf             IN  configuration file, section already requested
+//                   skip           IN  number of leading (unsectioned) directives to skip
+//                   count          IN  most directives to add
+//                   lookup         IN  directive lookup function
+//                   envDirectiveId IN  id of the env directive
+//                   strings        OUT string table
+//                   records        OUT records
+//
+// ============================================================================
+static void addRecords
+(
+	ConfigurationFile                              &cf,
+	int                                             skip,
+	int                                             count,
+	CompiledConfiguration::LOOKUP_FUNCTION         *lookup,
+	int                                             envDirectiveId,
+	SnapshotStrings                                &strings,
+	vector<SnapshotRecord>                         &records
+)
+{
+	ConfigurationDirective directive;
+	char                   directiveName[CFGFILE_DIRECTIVE_SIZE];
+	int                    directiveIdx = 0;
+
+	while((directiveIdx-skip < count)&&cf.getNextConfigurationDirective(directive))
+	{
+		if((directiveIdx++) < skip) { continue; }
+
+		SnapshotRecord record;
+		memset(&record,0,sizeof(record));
+
+		int nameLength = min(directive.directive.length,CFGFILE_DIRECTIVE_SIZE-1);
+		memcpy(directiveName,directive.directive.text,nameLength);
+		directiveName[nameLength] = '\0';
+
+		record.directiveId     = (*lookup)(directiveName);
+		record.directiveOffset = strings.add(directiveName,nameLength);
+		record.valueOffset     = strings.add(directive.value.text,directive.value.length);
+
+		// split env values into name and value now rather than at every startup
+		if(record.directiveId == envDirectiveId)
+		{
+			const char *equals = (const char*)memchr(directive.value.text,'=',directive.value.length);
+			if((equals != 0)&&(equals != directive.value.text))
+			{
+				int envNameLength     = (int)(equals-directive.value.text);
+				record.envNameOffset  = strings.add(directive.value.text,envNameLength);
+				record.envValueOffset = strings.add(equals+1,directive.value.length-envNameLength-1);
+			}
+		}
+		records.push_back(record);
+	}
+}
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::setEnvDirectiveId
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : identify the env directive, whose values are stored
+//                   pre-split into name and value
+//
+// ARGUMENTS       : envDirectiveId IN id of the env directive
+//
+// ============================================================================
+void CompiledConfiguration::setEnvDirectiveId(int envDirectiveId) { _envDirectiveId = envDirectiveId; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::compile
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : compile a control file to a binary snapshot
+//
+//                   the snapshot is written to a temporary file and then
+//                   moved into place, so a running service never maps a
+//                   half-written snapshot
+//
+// ARGUMENTS       : configPath              IN path of control file
+//                   snapshotPath            IN path of snapshot to write
+//                   lookup                  IN directive lookup function
+//                   directiveTableSignature IN signature of the directive table
+//
+// RETURNS         : true if successful, false otherwise
+//
+// ============================================================================
+bool CompiledConfiguration::compile
+(
+	char             configPath[],
+	char             snapshotPath[],
+	LOOKUP_FUNCTION *lookup,
+	unsigned int     directiveTableSignature
+)
+{
+	LOGGER_LOG_DEBUG2("compiling '%s' to '%s'",configPath,snapshotPath)
+
+	SnapshotHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,SNAPSHOT_MAGIC,sizeof(header.magic));
+	header.version                 = CMPCFG_VERSION;
+	header.directiveTableSignature = directiveTableSignature;
+
+	// identify the source file
+	if((!getSourceDetails(configPath,header.sourcePath,header.sourceModified,header.sourceSize))||
+	   (!hashSource(configPath,header.sourceHash)))
+	{
+		LOGGER_LOG_ERROR1("failed to read control file '%s'",configPath)
+		return false;
+	}
+
+	// parse the source file
+	ConfigurationFile cf;
+	if(!cf.openConfigurationFile(configPath))
+	{
+		LOGGER_LOG_ERROR1("failed to open control file '%s'",configPath)
+		return false;
+	}
+
+	SnapshotStrings         strings;
+	vector<SnapshotRecord>  records;
+	vector<SnapshotSection> sections;
+
+	// unsectioned directives (returned first for every section)
+	header.unsectionedFirst = 0;
+	header.unsectionedCount = (unsigned int)cf.getNumberOfUnsectionedDirectives();
+	char allSections[] = "";
+	cf.setRequestedSection(allSections);
+	addRecords(cf,0,(int)header.unsectionedCount,lookup,_envDirectiveId,strings,records);
+
+	// sections, sorted by name so that they can be found with a binary search
+	vector<SnapshotSectionName> sectionNames;
+	for(int i=0;i<cf.getNumberOfSections();i++)
+	{
+		SnapshotSectionName sectionName = { cf.getSectionName(i), i };
+		sectionNames.push_back(sectionName);
+	}
+	sort(sectionNames.begin(),sectionNames.end());
+
+	char section[CFGFILE_SECTION_SIZE];
+	for(size_t i=0;i<sectionNames.size();i++)
+	{
+		int sectionLength = min(sectionNames[i].name.length,CFGFILE_SECTION_SIZE-1);
+		memcpy(section,sectionNames[i].name.text,sectionLength);
+		section[sectionLength] = '\0';
+
+		SnapshotSection snapshotSection;
+		snapshotSection.nameOffset  = strings.add(section,sectionLength);
+		snapshotSection.firstRecord = (unsigned int)records.size();
+
+		cf.setRequestedSection(section);
+		addRecords(cf,(int)header.unsectionedCount,INT_MAX,lookup,_envDirectiveId,strings,records);
+
+		snapshotSection.recordCount = (unsigned int)records.size()-snapshotSection.firstRecord;
+		sections.push_back(snapshotSection);
+	}
+
+	// lay out the file
+	header.sectionCount   = (unsigned int)sections.size();
+	header.recordCount    = (unsigned int)records.size();
+	header.sectionsOffset = sizeof(header);
+	header.recordsOffset  = header.sectionsOffset + header.sectionCount*sizeof(SnapshotSection);
+	header.stringsOffset  = header.recordsOffset + header.recordCount*sizeof(SnapshotRecord);
+	header.totalSize      = header.stringsOffset + (unsigned int)strings.strings.size();
+
+	// write it to a temporary file, then move it into place
+	string tmpPath(snapshotPath);
+	tmpPath += ".tmp";
+	HANDLE hSnapshot = CreateFile(tmpPath.c_str(),GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(hSnapshot == INVALID_HANDLE_VALUE)
+	{
+		LOGGER_LOG_ERROR2("failed to create snapshot '%s', error=%d",tmpPath.c_str(),GetLastError())
+		return false;
+	}
+
+	DWORD written;
+	bool  ok = true;
+#define	WRITE_BLOCK(p,n)	\
+	if(ok&&((n)>0)) { ok = (WriteFile(hSnapshot,(p),(DWORD)(n),&written,NULL)!=0)&&(written==(DWORD)(n)); }
+
+	WRITE_BLOCK(&header,sizeof(header))
+	WRITE_BLOCK(sections.data(),sections.size()*sizeof(SnapshotSection))
+	WRITE_BLOCK(records.data(),records.size()*sizeof(SnapshotRecord))
+	WRITE_BLOCK(strings.strings.data(),strings.strings.size())
+	CloseHandle(hSnapshot);
+
+	if(!ok)
+	{
+		LOGGER_LOG_ERROR2("failed to write snapshot '%s', error=%d",tmpPath.c_str(),GetLastError())
+		DeleteFile(tmpPath.c_str());
+		return false;
+	}
+
+	if(!MoveFileEx(tmpPath.c_str(),snapshotPath,MOVEFILE_REPLACE_EXISTING))
+	{
+		LOGGER_LOG_ERROR2("failed to replace snapshot '%s', error=%d",snapshotPath,GetLastError())
+		DeleteFile(tmpPath.c_str());
+		return false;
+	}
+
+	LOGGER_LOG_INFO3("compiled %d sections (%d directives) to '%s'",
+						header.sectionCount,header.recordCount,snapshotPath)
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::open
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : map a snapshot and check that it is still valid for the
+//                   given control file
+//
+// ARGUMENTS       : configPath              IN path of control file
+//                   snapshotPath            IN path of snapshot
+//                   directiveTableSignature IN signature of the directive table
+//
+// RETURNS         : true if the snapshot can be used, false if the caller
+//                   should fall back to the control file
+//
+// ============================================================================
+bool CompiledConfiguration::open
+(
+	char         configPath[],
+	char         snapshotPath[],
+	unsigned int directiveTableSignature
+)
+{
+	LOGGER_LOG_DEBUG2("opening snapshot '%s' for '%s'",snapshotPath,configPath)
+	close();
+
+	// map the snapshot
+	hSnapshotFile = CreateFile(snapshotPath,GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_DELETE,NULL,
+								OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(hSnapshotFile == INVALID_HANDLE_VALUE)
+	{
+		LOGGER_LOG_DEBUG1("no snapshot '%s'",snapshotPath)
+		hSnapshotFile = 0;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if((!GetFileSizeEx(hSnapshotFile,&fileSize))||(fileSize.QuadPart < (LONGLONG)sizeof(SnapshotHeader)))
+	{
+		LOGGER_LOG_INFO1("snapshot '%s' is truncated - ignoring it",snapshotPath)
+		close();
+		return false;
+	}
+
+	hSnapshotMapping = CreateFileMapping(hSnapshotFile,NULL,PAGE_READONLY,0,0,NULL);
+	if(hSnapshotMapping != 0)
+	{
+		snapshot = (const char*)MapViewOfFile(hSnapshotMapping,FILE_MAP_READ,0,0,0);
+	}
+	if(snapshot == 0)
+	{
+		LOGGER_LOG_INFO2("failed to map snapshot '%s', error=%d - ignoring it",snapshotPath,GetLastError())
+		close();
+		return false;
+	}
+
+	// is it a snapshot we understand?
+	const SnapshotHeader *header = (const SnapshotHeader*)snapshot;
+	if((memcmp(header->magic,SNAPSHOT_MAGIC,sizeof(header->magic))!=0)||
+	   (header->version != CMPCFG_VERSION)||
+	   ((ULONGLONG)header->totalSize != (ULONGLONG)fileSize.QuadPart))
+	{
+		LOGGER_LOG_INFO1("snapshot '%s' is not a valid snapshot for this version - ignoring it",snapshotPath)
+		close();
+		return false;
+	}
+	if(!isWellFormed())
+	{
+		LOGGER_LOG_INFO1("snapshot '%s' is corrupt - ignoring it",snapshotPath)
+		close();
+		return false;
+	}
+	if(header->directiveTableSignature != directiveTableSignature)
+	{
+		LOGGER_LOG_INFO1("snapshot '%s' was compiled with different directives - ignoring it",snapshotPath)
+		close();
+		return false;
+	}
+
+	// is it a snapshot of this control file, as it is now? (if the file has
+	// been written without changing its size - eg touched, or checked out
+	// again - its contents decide)
+	char      sourcePath[MAX_PATH];
+	ULONGLONG sourceModified,sourceSize,sourceHash;
+	if(!getSourceDetails(configPath,sourcePath,sourceModified,sourceSize))
+	{
+		close();
+		return false;
+	}
+	bool current = (_stricmp(sourcePath,header->sourcePath)==0)&&(sourceSize == header->sourceSize);
+	if(current&&(sourceModified != header->sourceModified))
+	{
+		LOGGER_LOG_DEBUG1("'%s' has been written since it was compiled - checking its contents",configPath)
+		current = hashSource(configPath,sourceHash)&&(sourceHash == header->sourceHash);
+	}
+	if(!current)
+	{
+		LOGGER_LOG_INFO2("snapshot '%s' is out of date for '%s' - ignoring it",snapshotPath,configPath)
+		close();
+		return false;
+	}
+
+	LOGGER_LOG_DEBUG1("snapshot '%s' is valid",snapshotPath)
+	setRequestedSection("");
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::setRequestedSection
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : set the name of the requested section: only directives in
+//                   this section or in no section will be returned
+//
+// ARGUMENTS       : requestedSection IN requested section
+//
+// ============================================================================
+void CompiledConfiguration::setRequestedSection
+(
+	const char requestedSection[]
+)
+{
+	unsectionedIdx = unsectionedEnd = sectionIdx = sectionEnd = 0;
+	if(snapshot == 0) { return; }
+
+	const SnapshotHeader *header = (const SnapshotHeader*)snapshot;
+	unsectionedIdx = header->unsectionedFirst;
+	unsectionedEnd = header->unsectionedFirst + header->unsectionedCount;
+
+	// binary search of the section table
+	int low = 0, high = (int)header->sectionCount-1;
+	while(low <= high)
+	{
+		int mid = (low+high)/2;
+		int rc  = strcmp(requestedSection,SNAPSHOT_STRING(SNAPSHOT_SECTIONS[mid].nameOffset));
+		if(rc == 0)
+		{
+			sectionIdx = SNAPSHOT_SECTIONS[mid].firstRecord;
+			sectionEnd = sectionIdx + SNAPSHOT_SECTIONS[mid].recordCount;
+			return;
+		}
+		if(rc < 0) { high = mid-1; } else { low = mid+1; }
+	}
+	LOGGER_LOG_DEBUG1("section '%s' not found in snapshot",requestedSection)
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::getNextConfigurationDirective
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : get next directive in the requested section
+//
+// ARGUMENTS       : directiveId OUT directive id (as returned by the lookup)
+//                   directive   OUT directive name
+//                   value       OUT directive value
+//                   envName     OUT env variable name (env directives only)
+//                   envValue    OUT env variable value (env directives only)
+//
+// RETURNS         : false if there are no more directives
+//
+// ============================================================================
+bool CompiledConfiguration::getNextConfigurationDirective
+(
+	int         &directiveId,
+	const char *&directive,
+	const char *&value,
+	const char *&envName,
+	const char *&envValue
+)
+{
+	const SnapshotRecord *record;
+	if(unsectionedIdx < unsectionedEnd)
+	{
+		record = SNAPSHOT_RECORDS + (unsectionedIdx++);
+	}
+	else if(sectionIdx < sectionEnd)
+	{
+		record = SNAPSHOT_RECORDS + (sectionIdx++);
+	}
+	else
+	{
+		return false;
+	}
+
+	directiveId = record->directiveId;
+	directive   = SNAPSHOT_STRING(record->directiveOffset);
+	value       = SNAPSHOT_STRING(record->valueOffset);
+	envName     = (record->envNameOffset != 0) ? SNAPSHOT_STRING(record->envNameOffset) : 0;
+	envValue    = (record->envNameOffset != 0) ? SNAPSHOT_STRING(record->envValueOffset) : 0;
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::CompiledConfiguration
+//                   CompiledConfiguration::~CompiledConfiguration
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+CompiledConfiguration::CompiledConfiguration()
+{
+	_envDirectiveId  = -1;
+	hSnapshotFile    = 0;
+	hSnapshotMapping = 0;
+	snapshot         = 0;
+	unsectionedIdx   = unsectionedEnd = sectionIdx = sectionEnd = 0;
+}
+
+CompiledConfiguration::~CompiledConfiguration() { close(); }
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::close
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : release the mapped snapshot
+//
+// ============================================================================
+void CompiledConfiguration::close()
+{
+	if(snapshot != 0)
+	{
+		UnmapViewOfFile(snapshot);
+		snapshot = 0;
+	}
+	if(hSnapshotMapping != 0)
+	{
+		CloseHandle(hSnapshotMapping);
+		hSnapshotMapping = 0;
+	}
+	if(hSnapshotFile != 0)
+	{
+		CloseHandle(hSnapshotFile);
+		hSnapshotFile = 0;
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::isWellFormed
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : check that every table and every string offset in the
+//                   mapped snapshot lies within it, and that the string table
+//                   ends with a null, so that a truncated or damaged snapshot
+//                   is never read outside the mapping (the header has been
+//                   checked, and totalSize is the size of the file)
+//
+// RETURNS         : true if the snapshot can be read safely
+//
+// ============================================================================
+bool CompiledConfiguration::isWellFormed() const
+{
+	const SnapshotHeader *header = (const SnapshotHeader*)snapshot;
+
+	// the source path is compared as a string
+	if(memchr(header->sourcePath,'\0',sizeof(header->sourcePath)) == 0) { return false; }
+
+	// the tables follow the header, are aligned for their records, and are
+	// followed by the strings (the sums are 64-bit, so they cannot wrap)
+	ULONGLONG sectionsEnd = (ULONGLONG)header->sectionsOffset + (ULONGLONG)header->sectionCount*sizeof(SnapshotSection);
+	ULONGLONG recordsEnd  = (ULONGLONG)header->recordsOffset + (ULONGLONG)header->recordCount*sizeof(SnapshotRecord);
+	if((header->sectionsOffset < sizeof(SnapshotHeader))||(header->sectionsOffset%sizeof(unsigned int) != 0)||
+	   (header->recordsOffset%sizeof(unsigned int) != 0)||
+	   (sectionsEnd > header->totalSize)||(recordsEnd > header->totalSize)||
+	   (header->stringsOffset < sectionsEnd)||(header->stringsOffset < recordsEnd)||
+	   (header->stringsOffset >= header->totalSize)||
+	   ((ULONGLONG)header->unsectionedFirst+header->unsectionedCount > header->recordCount))
+	{
+		return false;
+	}
+
+	// every string offset is inside a string table which ends with a null,
+	// so every string ends inside it
+	unsigned int stringsSize = header->totalSize-header->stringsOffset;
+	if(snapshot[header->totalSize-1] != '\0') { return false; }
+
+	for(unsigned int i=0;i<header->sectionCount;i++)
+	{
+		const SnapshotSection &section = SNAPSHOT_SECTIONS[i];
+		if((section.nameOffset >= stringsSize)||
+		   ((ULONGLONG)section.firstRecord+section.recordCount > header->recordCount))
+		{
+			return false;
+		}
+	}
+	for(unsigned int i=0;i<header->recordCount;i++)
+	{
+		const SnapshotRecord &record = SNAPSHOT_RECORDS[i];
+		if((record.directiveOffset >= stringsSize)||(record.valueOffset >= stringsSize)||
+		   (record.envNameOffset >= stringsSize)||(record.envValueOffset >= stringsSize))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::getSourceDetails
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : get the details which identify a particular version of a
+//                   control file: its full path, last write time and size
+//
+// ARGUMENTS       : configPath IN  path of control file
+//                   fullPath   OUT full path (MAX_PATH characters)
+//                   modified   OUT last write time
+//                   size       OUT size in bytes
+//
+// RETURNS         : true if successful, false otherwise
+//
+// ============================================================================
+bool CompiledConfiguration::getSourceDetails
+(
+	char       configPath[],
+	char       fullPath[],
+	ULONGLONG &modified,
+	ULONGLONG &size
+)
+{
+	memset(fullPath,0,MAX_PATH);
+	if(GetFullPathName(configPath,MAX_PATH,fullPath,NULL)==0)
+	{
+		strncpy(fullPath,configPath,MAX_PATH-1);
+	}
+
+	HANDLE hSource = CreateFile(configPath,GENERIC_READ,FILE_SHARE_READ,NULL,
+								OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(hSource == INVALID_HANDLE_VALUE)
+	{
+		LOGGER_LOG_DEBUG2("failed to open '%s', error=%d",configPath,GetLastError())
+		return false;
+	}
+
+	FILETIME      lastWrite;
+	LARGE_INTEGER fileSize;
+	if((!GetFileTime(hSource,NULL,NULL,&lastWrite))||(!GetFileSizeEx(hSource,&fileSize)))
+	{
+		LOGGER_LOG_DEBUG2("failed to get details of '%s', error=%d",configPath,GetLastError())
+		CloseHandle(hSource);
+		return false;
+	}
+	ULARGE_INTEGER lastWriteTime;
+	lastWriteTime.LowPart  = lastWrite.dwLowDateTime;
+	lastWriteTime.HighPart = lastWrite.dwHighDateTime;
+	modified = lastWriteTime.QuadPart;
+	size     = (ULONGLONG)fileSize.QuadPart;
+
+	CloseHandle(hSource);
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : CompiledConfiguration::hashSource
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : FNV-1a hash of the contents of a control file
+//
+// ARGUMENTS       : configPath IN  path of control file
+//                   hash       OUT content hash
+//
+// RETURNS         : true if successful, false otherwise
+//
+// ============================================================================
+bool CompiledConfiguration::hashSource
+(
+	char       configPath[],
+	ULONGLONG &hash
+)
+{
+	HANDLE hSource = CreateFile(configPath,GENERIC_READ,FILE_SHARE_READ,NULL,
+								OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	LARGE_INTEGER fileSize;
+	if((hSource == INVALID_HANDLE_VALUE)||(!GetFileSizeEx(hSource,&fileSize)))
+	{
+		LOGGER_LOG_DEBUG2("failed to read '%s', error=%d",configPath,GetLastError())
+		if(hSource != INVALID_HANDLE_VALUE) { CloseHandle(hSource); }
+		return false;
+	}
+	ULONGLONG size = (ULONGLONG)fileSize.QuadPart;
+
+	hash = 14695981039346656037ULL;
+	if(size > 0)
+	{
+		HANDLE      hMapping = CreateFileMapping(hSource,NULL,PAGE_READONLY,0,0,NULL);
+		const unsigned char *text = 0;
+		if(hMapping != 0)
+		{
+			text = (const unsigned char*)MapViewOfFile(hMapping,FILE_MAP_READ,0,0,0);
+		}
+		if(text == 0)
+		{
+			LOGGER_LOG_DEBUG2("failed to map '%s', error=%d",configPath,GetLastError())
+			if(hMapping != 0) { CloseHandle(hMapping); }
+			CloseHandle(hSource);
+			return false;
+		}
+		for(ULONGLONG i=0;i<size;i++) { hash = (hash^text[i])*1099511628211ULL; }
+		UnmapViewOfFile(text);
+		CloseHandle(hMapping);
+	}
+
+	CloseHandle(hSource);
+	return true;
+}
+
@@ -0,0 +1,96 @@
+
+// prevent multiple inclusion
+
+#if !defined(__COMPILED_CONFIGURATION_H__)
+#define __COMPILED_CONFIGURATION_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// default snapshot name is the control file name with this suffix
+const char CMPCFG_SNAPSHOT_SUFFIX[] = ".lsc";
+
+// bump this whenever the snapshot layout changes
+const unsigned int CMPCFG_VERSION   = 1;
+
+// ============================================================================
+//
+// CompiledConfiguration class
+//
+// A compiled configuration is a binary snapshot of a control file:
+//  - every section's directives, already looked up in the directive table
+//  - env directives already split into name and value
+//  - the path, modification time, size and content hash of the source file
+//
+// It is loaded with a single file mapping, and is rejected (so the caller can
+// fall back to the text parser) if it is corrupt, or if the source file or the
+// directive table has changed since it was compiled. The source file is only
+// hashed if its modification time has changed but its size has not.
+//
+// ============================================================================
+class CompiledConfiguration
+{
+public:
+
+	// directive lookup supplied by the caller: returns the directive id, or a
+	// negative value if the directive is not recognised
+	typedef int LOOKUP_FUNCTION(const char *directive);
+
+	// env directive id, so that its values can be split when compiling
+	void setEnvDirectiveId(int envDirectiveId);
+
+	// compile a control file to a snapshot
+	bool compile(char configPath[],char snapshotPath[],LOOKUP_FUNCTION *lookup,
+					unsigned int directiveTableSignature);
+
+	// open a snapshot - fails if it is missing, corrupt or stale
+	bool open(char configPath[],char snapshotPath[],unsigned int directiveTableSignature);
+
+	// set requested section
+	void setRequestedSection(const char requestedSection[]);
+
+	// get next directive: all strings point into the snapshot and are null-terminated
+	// envName / envValue are only set for env directives
+	bool getNextConfigurationDirective(int &directiveId,const char *&directive,const char *&value,
+					const char *&envName,const char *&envValue);
+
+	// constructor and destructor
+	CompiledConfiguration();
+	virtual ~CompiledConfiguration();
+
+private:
+	// service functions
+	void close();
+	bool isWellFormed() const;
+	static bool getSourceDetails(char configPath[],char fullPath[],ULONGLONG &modified,
+					ULONGLONG &size);
+	static bool hashSource(char configPath[],ULONGLONG &hash);
+
+	// private variables
+	int         _envDirectiveId;
+
+	// mapped snapshot
+	HANDLE      hSnapshotFile;
+	HANDLE      hSnapshotMapping;
+	const char *snapshot;
+
+	// where we are in the requested section
+	int         unsectionedIdx;
+	int         unsectionedEnd;
+	int         sectionIdx;
+	int         sectionEnd;
+
+};
+
+#endif // !defined(__COMPILED_CONFIGURATION_H__)
+
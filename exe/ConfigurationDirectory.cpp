@@ -0,0 +1,371 @@
+
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <stdlib.h>
+#include <string.h>
+#include <process.h>
+#include <algorithm>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "ConfigurationDirectory.h"
+#include "CompiledConfiguration.h"
+#include "XmlConfigurationFile.h"
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+//
+// finds the service name of an XML configuration file
+//
+class XmlServiceNameHandler : public XmlConfigurationHandler
+{
+public:
+	void startElement(const char[],XmlAttribute[],int) {}
+	void endElement(const char path[],char text[])
+	{
+		if((!strcmp(path,"ServiceConfiguration/Service/n"))||
+		   (!strcmp(path,"ServiceConfiguration/Service/Name")))
+		{
+			serviceName = text;
+		}
+	}
+
+	string serviceName;
+};
+
+// ============================================================================
+//
+// LOCAL FUNCTION
+//
+// ============================================================================
+
+// should a file in a configuration directory be ignored?
+static bool isIgnoredFile(const WIN32_FIND_DATA &findData)
+{
+	if(findData.dwFileAttributes&(FILE_ATTRIBUTE_DIRECTORY|FILE_ATTRIBUTE_HIDDEN)) { return true; }
+	if(findData.cFileName[0] == '.') { return true; }
+
+	// compiled snapshots and their temporary files
+	const char *extension = strrchr(findData.cFileName,'.');
+	return (extension != 0)&&((_stricmp(extension,CMPCFG_SNAPSHOT_SUFFIX) == 0)||(_stricmp(extension,".tmp") == 0));
+}
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::load
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : load all the configuration files in a directory (or a
+//                   single configuration file) and index their sections
+//
+// ARGUMENTS       : path IN directory or file
+//
+// RETURNS         : false if any file could not be loaded, or if a section
+//                   is defined in more than one file (the errors are added
+//                   to the files' errors, for the caller to report)
+//
+// ============================================================================
+bool ConfigurationDirectory::load
+(
+	char path[]
+)
+{
+	LOGGER_LOG_DEBUG1("ConfigurationDirectory::load(%s)",path)
+
+	files.clear();
+	sectionFiles.clear();
+
+	DWORD attributes = GetFileAttributes(path);
+	if(attributes == INVALID_FILE_ATTRIBUTES)
+	{
+		LOGGER_LOG_ERROR1("Configuration file or directory '%s' not found",path)
+		return false;
+	}
+
+	if(attributes&FILE_ATTRIBUTE_DIRECTORY)
+	{
+		// enumerate the directory
+		string          pattern = string(path)+"\\*";
+		WIN32_FIND_DATA findData;
+		HANDLE          hFind = FindFirstFile(pattern.c_str(),&findData);
+		if(hFind != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if(isIgnoredFile(findData)) { continue; }
+				unique_ptr<ConfigurationDirectoryFile> file(new ConfigurationDirectoryFile);
+				file->path = string(path)+"\\"+findData.cFileName;
+				files.push_back(move(file));
+			}
+			while(FindNextFile(hFind,&findData));
+			FindClose(hFind);
+		}
+
+		// in name order, so that results do not depend on the file system
+		sort(files.begin(),files.end(),
+				[](const unique_ptr<ConfigurationDirectoryFile> &a,const unique_ptr<ConfigurationDirectoryFile> &b)
+				{ return _stricmp(a->path.c_str(),b->path.c_str()) < 0; });
+		LOGGER_LOG_DEBUG2("%d files in configuration directory '%s'",(int)files.size(),path)
+	}
+	else
+	{
+		unique_ptr<ConfigurationDirectoryFile> file(new ConfigurationDirectoryFile);
+		file->path = path;
+		files.push_back(move(file));
+	}
+
+	// load the files in parallel
+	forEachFile(loadFile,0);
+
+	// index the sections (a section defined again in a later file is an
+	// error in that file)
+	bool                      ok = true;
+	unordered_map<string,int> firstFiles;
+	for(int i=0;i<(int)files.size();i++)
+	{
+		ConfigurationDirectoryFile &file = *files[i];
+		if(!file.loaded)
+		{
+			LOGGER_LOG_DEBUG1("failed to load configuration file '%s'",file.path.c_str())
+			ok = false;
+			continue;
+		}
+
+		for(size_t s=0;s<file.sections.size();s++)
+		{
+			unordered_map<string,int>::iterator found = sectionFiles.find(file.sections[s]);
+			if(found == sectionFiles.end())
+			{
+				sectionFiles[file.sections[s]] = i;
+				firstFiles[file.sections[s]]   = i;
+			}
+			else if(firstFiles[file.sections[s]] != i)
+			{
+				const string &firstPath = files[firstFiles[file.sections[s]]]->path;
+				file.errors.push_back(file.path+": ["+file.sections[s]+"] is already defined in "+firstPath);
+				found->second = -1;
+				ok = false;
+			}
+		}
+	}
+
+	return ok;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::forEachFile
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : run a function on every file, in parallel on a pool of
+//                   worker threads (each file is handled by one thread)
+//
+// ARGUMENTS       : function IN function to run
+//                   context  IN passed to function
+//
+// ============================================================================
+void ConfigurationDirectory::forEachFile
+(
+	FILE_FUNCTION *function,
+	void          *context
+)
+{
+	_function = function;
+	_context  = context;
+	nextFile  = -1;
+
+	// one thread per processor, up to the number of files
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	int numberOfThreads = min((int)systemInfo.dwNumberOfProcessors,CFGDIR_MAX_THREADS);
+	numberOfThreads     = min(numberOfThreads,(int)files.size()-1);
+
+	// this thread works too
+	HANDLE threads[CFGDIR_MAX_THREADS];
+	int    startedThreads = 0;
+	for(int i=0;i<numberOfThreads;i++)
+	{
+		threads[startedThreads] = (HANDLE)_beginthreadex(NULL,0,workerThread,this,0,NULL);
+		if(threads[startedThreads] != 0) { startedThreads++; }
+	}
+	workerThread(this);
+
+	if(startedThreads > 0)
+	{
+		WaitForMultipleObjects(startedThreads,threads,TRUE,INFINITE);
+		for(int i=0;i<startedThreads;i++) { CloseHandle(threads[i]); }
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::findSection
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : find the file which defines a section
+//
+// ARGUMENTS       : section   IN  section name
+//                   duplicate OUT set if more than one file defines it
+//
+// RETURNS         : path of file, or 0 if not found or duplicated
+//
+// ============================================================================
+const char *ConfigurationDirectory::findSection
+(
+	const char  section[],
+	bool       &duplicate
+) const
+{
+	unordered_map<string,int>::const_iterator found = sectionFiles.find(section);
+	duplicate = (found != sectionFiles.end())&&(found->second < 0);
+	return ((found != sectionFiles.end())&&(!duplicate)) ? files[found->second]->path.c_str() : 0;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::getNumberOfFiles
+//                   ConfigurationDirectory::getFile
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : files loaded
+//
+// ============================================================================
+int ConfigurationDirectory::getNumberOfFiles() const { return (int)files.size(); }
+
+ConfigurationDirectoryFile &ConfigurationDirectory::getFile(int fileIdx) { return *files[fileIdx]; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::ConfigurationDirectory
+//                   ConfigurationDirectory::~ConfigurationDirectory
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+ConfigurationDirectory::ConfigurationDirectory()
+{
+	_function = 0;
+	_context  = 0;
+	nextFile  = -1;
+}
+
+ConfigurationDirectory::~ConfigurationDirectory() {}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::workerThread
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : take files until there are none left
+//
+// ARGUMENTS       : arg IN ConfigurationDirectory
+//
+// ============================================================================
+unsigned int __stdcall ConfigurationDirectory::workerThread
+(
+	void *arg
+)
+{
+	ConfigurationDirectory *directory = (ConfigurationDirectory*)arg;
+	LONG                    fileIdx;
+
+	while((fileIdx = InterlockedIncrement(&directory->nextFile)) < (LONG)directory->files.size())
+	{
+		(*directory->_function)(*directory->files[fileIdx],directory->_context);
+	}
+	return 0;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationDirectory::loadFile
+//
+// ACCESS SPECIFIER: private static
+//
+// DESCRIPTION     : load one file and find its sections (runs on a worker
+//                   thread)
+//
+// ARGUMENTS       : file    IN/OUT file
+//                   context IN     unused
+//
+// ============================================================================
+void ConfigurationDirectory::loadFile
+(
+	ConfigurationDirectoryFile &file,
+	void                       *
+)
+{
+	char *path = const_cast<char*>(file.path.c_str());
+
+	file.isXml  = XmlConfigurationFile::isXmlConfigurationFile(path);
+	file.loaded = false;
+
+	if(file.isXml)
+	{
+		// an XML file defines one service
+		XmlConfigurationFile  xcf;
+		XmlServiceNameHandler handler;
+		if(!xcf.parse(path,handler))
+		{
+			file.errors.push_back(file.path+": not a well-formed XML configuration file");
+			return;
+		}
+
+		// if it is not named, the service is named after the file
+		if(handler.serviceName.empty())
+		{
+			const char *name      = strrchr(path,'\\');
+			handler.serviceName   = (name != 0) ? name+1 : path;
+			size_t      extension = handler.serviceName.rfind('.');
+			if(extension != string::npos) { handler.serviceName.erase(extension); }
+		}
+		file.sections.push_back(handler.serviceName);
+	}
+	else
+	{
+		if(!file.configurationFile.openConfigurationFile(path))
+		{
+			file.errors.push_back(file.path+": cannot be opened");
+			return;
+		}
+		for(int i=0;i<file.configurationFile.getNumberOfSections();i++)
+		{
+			ConfigurationText section = file.configurationFile.getSectionName(i);
+			file.sections.push_back(string(section.text,section.length));
+		}
+	}
+
+	file.loaded = true;
+}
+
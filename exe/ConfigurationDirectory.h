@@ -0,0 +1,98 @@
+
+// prevent multiple inclusion
+
+#if !defined(__CONFIGURATION_DIRECTORY_H__)
+#define __CONFIGURATION_DIRECTORY_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ConfigurationFile.h"
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int CFGDIR_MAX_THREADS = 16;		// most worker threads used to parse files
+
+// ============================================================================
+//
+// ConfigurationDirectoryFile - one file of a configuration directory
+//
+// ============================================================================
+struct ConfigurationDirectoryFile
+{
+	string            path;
+	bool              isXml;
+	bool              loaded;			// opened (and for XML, parsed) successfully
+	ConfigurationFile configurationFile;	// control files only
+	vector<string>    sections;			// sections (for XML, the service name)
+	vector<string>    errors;			// errors found, reported by the caller
+};
+
+// ============================================================================
+//
+// ConfigurationDirectory class
+//
+// A configuration directory holds any number of control files and XML
+// configuration files, each defining one or more services (sections). All
+// the files are loaded in parallel on a pool of worker threads, and a section
+// may only be defined in one file.
+//
+// A single configuration file can be loaded the same way, so that callers
+// need not distinguish between the two.
+//
+// ============================================================================
+class ConfigurationDirectory
+{
+public:
+
+	// function run on each file by forEachFile
+	typedef void FILE_FUNCTION(ConfigurationDirectoryFile &file,void *context);
+
+	// load a directory (or a single file)
+	// returns false if any file could not be loaded or a section is duplicated
+	bool load(char path[]);
+
+	// run function on every file, in parallel
+	void forEachFile(FILE_FUNCTION *function,void *context);
+
+	// find the file defining a section (0 if none); duplicate is set if
+	// more than one file defines it
+	const char *findSection(const char section[],bool &duplicate) const;
+
+	// files
+	int getNumberOfFiles() const;
+	ConfigurationDirectoryFile &getFile(int fileIdx);
+
+	// constructor and destructor
+	ConfigurationDirectory();
+	virtual ~ConfigurationDirectory();
+
+private:
+	// service functions
+	static unsigned int __stdcall workerThread(void *arg);
+	static void loadFile(ConfigurationDirectoryFile &file,void *context);
+
+	// private variables
+	vector<unique_ptr<ConfigurationDirectoryFile>> files;
+	unordered_map<string,int>                      sectionFiles;	// section -> file, or -1 if duplicated
+
+	// current forEachFile job
+	FILE_FUNCTION *_function;
+	void          *_context;
+	volatile LONG  nextFile;
+};
+
+#endif // !defined(__CONFIGURATION_DIRECTORY_H__)
+
@@ -8,6 +8,7 @@
 
 // system headers
 #include <stdlib.h>
+#include <ctype.h>
 #include <string>
 #include <algorithm>
 
@@ -32,6 +33,10 @@
 //
 // DESCRIPTION     : open named configuration file
 //
+//                   the file is mapped into memory and indexed by section in a
+//                   single pass; the directives returned later are views onto
+//                   the mapped file, so nothing is copied until the caller asks
+//
 // ARGUMENTS       : configPath IN path name of configuration file
 //
 // RETURNS         : true if successful, false otherwise
@@ -44,8 +49,47 @@ bool ConfigurationFile::openConfigurationFile
 {
 	// open configuration file
 	LOGGER_LOG_DEBUG1("opening configuration file '%s'",configPath)
-	configFile = new ifstream(configPath);
-	return (configFile->is_open()!=0);
+	closeConfigurationFile();
+
+	hConfigFile = CreateFile(configPath,GENERIC_READ,FILE_SHARE_READ,NULL,
+								OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(hConfigFile == INVALID_HANDLE_VALUE)
+	{
+		LOGGER_LOG_DEBUG2("failed to open configuration file '%s', error=%d",configPath,GetLastError())
+		hConfigFile = 0;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(hConfigFile,&fileSize))
+	{
+		LOGGER_LOG_DEBUG2("failed to get size of configuration file '%s', error=%d",configPath,GetLastError())
+		closeConfigurationFile();
+		return false;
+	}
+	configLength = (int)fileSize.QuadPart;
+
+	// an empty file cannot be mapped, but it is still a valid (empty) configuration
+	if(configLength > 0)
+	{
+		hConfigMapping = CreateFileMapping(hConfigFile,NULL,PAGE_READONLY,0,0,NULL);
+		if(hConfigMapping != 0)
+		{
+			configText = (const char*)MapViewOfFile(hConfigMapping,FILE_MAP_READ,0,0,0);
+		}
+		if(configText == 0)
+		{
+			LOGGER_LOG_DEBUG2("failed to map configuration file '%s', error=%d",configPath,GetLastError())
+			closeConfigurationFile();
+			return false;
+		}
+	}
+
+	configOpen = true;
+	buildIndex();
+	LOGGER_LOG_DEBUG3("configuration file '%s' has %d directives in %d sections",
+						configPath,(int)directives.size(),(int)sectionNames.size())
+	return true;
 }
 
 // ============================================================================
@@ -66,75 +110,109 @@ void ConfigurationFile::getNextConfigurationDirective
 	char value[]
 )
 {
-	char *line,*ch;
-	char  section[CFGFILE_SECTION_SIZE];
-	bool  rightSection = true;
+	ConfigurationDirective next;
 
 	directive[0] = '\0';
 	value[0]     = '\0';
 
+	if(!getNextConfigurationDirective(next))
+	{
+		return;
+	}
+
+	// copy out the directive and value
+	int directiveLength = min(next.directive.length,CFGFILE_DIRECTIVE_SIZE-1);
+	memcpy(directive,next.directive.text,directiveLength);
+	directive[directiveLength] = '\0';
 
-	LOGGER_LOG_DEBUG1("searching for next directive in section '%s'",_requestedSection)
+	int valueLength = min(next.value.length,CFGFILE_MAX_LINE_LENGTH-1);
+	memcpy(value,next.value.text,valueLength);
+	value[valueLength] = '\0';
+}
 
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationFile::getNextConfigurationDirective
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : get next configuration directive from currently-open file,
+//                   without copying it
+//
+// ARGUMENTS       : directive OUT directive / value views
+//
+// RETURNS         : false if there are no more directives
+//
+// ============================================================================
+bool ConfigurationFile::getNextConfigurationDirective
+(
+	ConfigurationDirective &directive
+)
+{
 	// have we opened the configuration file yet?
-	if(configFile->is_open()==0)
+	if(!configOpen)
 	{
 		LOGGER_LOG_DEBUG("configuration file not open ... returning")
-		return;
+		return false;
 	}
 
-	// get the next directive / value pair
-	while(true)
+	// no section requested: every directive in the file
+	if(allDirectives)
 	{
-		line = readNextRealLine();
-		switch(*line)
+		if(nextDirective >= (int)directives.size())
 		{
-			case '\0':
-				// end of file reached
-				LOGGER_LOG_DEBUG("reached end of configuration file")
-				return;
-
-			case CFGFILE_SECTION_OPEN:
-				// new section
-				ch = section;
-				line++;
-				LOGGER_LOG_DEBUG1("found section '%s'",line)
-
-				while(((*line)!=CFGFILE_SECTION_CLOSE)&&((*line)!='\0')) { (*ch++) = (*line++); }
-				(*ch) = '\0';
-				// if not our section, ignore
-				if(_requestedSection[0]!='\0')
-				{
-					rightSection = (strcmp(section,_requestedSection) == 0);
-				}
-				else
-				{
-					rightSection = true;
-				}
-				break;
-
-			default:
-				// a directive / value pair
-				if(rightSection)
-				{
-					// extract the directive
-					ch = directive;
-					while(((*line)!='=')&&((*line)!='\0')) { (*ch++) = (*line++); }
-					(*ch) = '\0'; if((*line)=='='){ line++; }
-					// LOGGER_LOG_DEBUG1("extracted directive '%s'",directive)
-
-					// extract the value
-					ch = value;
-					while((*line)!='\0') { (*ch++) = (*line++); }
-					(*ch) = '\0';
-					// LOGGER_LOG_DEBUG1("extracted value '%s'",value)
-
-					return;
-				}
+			LOGGER_LOG_DEBUG("reached end of configuration file")
+			return false;
 		}
+		directive = directives[nextDirective++];
+		return true;
+	}
+
+	// directives in no section come first
+	if(nextUnsectioned < (int)unsectioned.size())
+	{
+		directive = directives[unsectioned[nextUnsectioned++]];
+		return true;
+	}
+
+	// then the directives in the requested section
+	if((requestedDirectives != 0)&&(nextDirective < (int)requestedDirectives->size()))
+	{
+		directive = directives[(*requestedDirectives)[nextDirective++]];
+		return true;
 	}
+
+	LOGGER_LOG_DEBUG("reached end of configuration file")
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationFile::hasSection
+//                   ConfigurationFile::getNumberOfSections
+//                   ConfigurationFile::getSectionName
+//                   ConfigurationFile::getNumberOfUnsectionedDirectives
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : query the sections in the currently-open file
+//
+// ARGUMENTS       : section    IN name of section
+//                   sectionIdx IN index of section (0..getNumberOfSections()-1)
+//
+// ============================================================================
+bool ConfigurationFile::hasSection(const char section[]) const
+{
+	ConfigurationText key = { section, (int)strlen(section) };
+	return sectionIndex.find(key) != sectionIndex.end();
 }
 
+int ConfigurationFile::getNumberOfSections() const { return (int)sectionNames.size(); }
+
+ConfigurationText ConfigurationFile::getSectionName(int sectionIdx) const { return sectionNames[sectionIdx]; }
+
+int ConfigurationFile::getNumberOfUnsectionedDirectives() const { return (int)unsectioned.size(); }
+
 // ============================================================================
 //
 // MEMBER FUNCTION : ConfigurationFile::setCommentCharacters
@@ -157,6 +235,12 @@ void ConfigurationFile::setCommentCharacters
 	}
 	_commentCharacters = new char[strlen(commentCharacters)+1];
 	strcpy(_commentCharacters,commentCharacters);
+
+	// comments are recognised while indexing, so re-index an open file
+	if(configOpen)
+	{
+		buildIndex();
+	}
 }
 
 // ============================================================================
@@ -176,8 +260,33 @@ void ConfigurationFile::setRequestedSection
 	char requestedSection[]
 )
 {
-	strcpy(_requestedSection,requestedSection);
+	// (buildIndex passes _requestedSection itself)
+	if(requestedSection != _requestedSection)
+	{
+		strncpy(_requestedSection,requestedSection,sizeof(_requestedSection)-1);
+		_requestedSection[sizeof(_requestedSection)-1] = '\0';
+	}
 	LOGGER_LOG_DEBUG1("setRequestedSection '%s'",_requestedSection)
+
+	// look up the section in the index
+	allDirectives       = (_requestedSection[0]=='\0');
+	requestedDirectives = 0;
+	nextUnsectioned     = 0;
+	nextDirective       = 0;
+
+	if(!allDirectives)
+	{
+		ConfigurationText key = { _requestedSection, (int)strlen(_requestedSection) };
+		SectionIndex::const_iterator section = sectionIndex.find(key);
+		if(section != sectionIndex.end())
+		{
+			requestedDirectives = &(section->second);
+		}
+		else
+		{
+			LOGGER_LOG_DEBUG1("section '%s' not found",_requestedSection)
+		}
+	}
 }
 
 // ============================================================================
@@ -196,9 +305,19 @@ void ConfigurationFile::setRequestedSection
 ConfigurationFile::ConfigurationFile()
 {
 	_requestedSection[0] = '\0';
-	configFile           = 0;
 	_commentCharacters   = new char[strlen(CFGFILE_DEFAULT_COMMENT_CHARACTERS)+1];
 	strcpy(_commentCharacters,CFGFILE_DEFAULT_COMMENT_CHARACTERS);
+
+	hConfigFile    = 0;
+	hConfigMapping = 0;
+	configText     = 0;
+	configLength   = 0;
+	configOpen     = false;
+
+	allDirectives       = true;
+	requestedDirectives = 0;
+	nextUnsectioned     = 0;
+	nextDirective       = 0;
 }
 
 // ============================================================================
@@ -216,61 +335,131 @@ ConfigurationFile::~ConfigurationFile()
 	{
 		delete [] _commentCharacters;
 	}
-	if(configFile != 0)
-	{
-		if(configFile->is_open()!=0)
-		{
-			configFile->close();
-		}
-		delete configFile;
-	}
+	closeConfigurationFile();
 }
 
 // ============================================================================
 //
-// MEMBER FUNCTION : ConfigurationFile::readNextRealLine
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationFile::buildIndex
 //
 // ACCESS SPECIFIER: private
 //
-// DESCRIPTION     : read next line from input file which is not blank or a comment
+// DESCRIPTION     : scan the mapped file once, recording every directive and
+//                   the directives belonging to each section
 //
-// RETURNS         : pointer to line read
+//                   blank lines, lines of white space and lines starting with
+//                   a comment character are skipped, as before
 //
 // ============================================================================
-char *ConfigurationFile::readNextRealLine()
+void ConfigurationFile::buildIndex()
 {
+	directives.clear();
+	unsectioned.clear();
+	sectionIndex.clear();
+	sectionNames.clear();
 
-	while(!configFile->eof())
-	{
-		// remove any leading spaces or tabs
-		configFile->getline(configLine,CFGFILE_MAX_LINE_LENGTH);
+	DirectiveList *currentSection = &unsectioned;
+	const char    *line           = configText;
+	const char    *end            = configText + configLength;
 
-		// is it a blank line?
-		if(configLine[0]=='\0')
+	while(line < end)
+	{
+		// find the end of this line, and the start of the next one
+		const char *eol = (const char*)memchr(line,'\n',end-line);
+		const char *next;
+		if(eol == 0) { eol = end; next = end; } else { next = eol+1; }
+
+		// the file may have DOS line endings
+		if((eol > line)&&(*(eol-1)=='\r')) { eol--; }
+
+		// is it a blank line, a line of white space, or a comment?
+		const char *ch = line;
+		while((ch < eol)&&isspace((unsigned char)*ch)) { ch++; }
+		if((ch == eol)||(strchr(_commentCharacters,*line)!=0))
 		{
-			// LOGGER_LOG_DEBUG("blank line")
+			line = next;
 			continue;
 		}
 
-		if (all_of(begin(configLine), end(configLine), [](char c) {return iswspace(c); }))
-			continue;
-
-		// is it a comment?
-		if(strchr(_commentCharacters,configLine[0])!=0)
+		if(*line == CFGFILE_SECTION_OPEN)
 		{
-			// LOGGER_LOG_DEBUG1("comment line '%s'",configLine)
-			continue;
+			// new section
+			ConfigurationText section;
+			section.text = line+1;
+			ch           = section.text;
+			while((ch < eol)&&((*ch)!=CFGFILE_SECTION_CLOSE)) { ch++; }
+			section.length = (int)(ch-section.text);
+
+			SectionIndex::iterator entry = sectionIndex.find(section);
+			if(entry == sectionIndex.end())
+			{
+				entry = sectionIndex.insert(SectionIndex::value_type(section,DirectiveList())).first;
+				sectionNames.push_back(section);
+			}
+			currentSection = &(entry->second);
+		}
+		else
+		{
+			// a directive / value pair
+			ConfigurationDirective directive;
+			directive.directive.text = line;
+			ch                       = line;
+			while((ch < eol)&&((*ch)!='=')) { ch++; }
+			directive.directive.length = (int)(ch-line);
+			if(ch < eol) { ch++; }
+			directive.value.text   = ch;
+			directive.value.length = (int)(eol-ch);
+
+			currentSection->push_back((int)directives.size());
+			directives.push_back(directive);
 		}
 
-		// non-blank line - return the line
-		// LOGGER_LOG_DEBUG1("non-blank line '%s'",configLine)
-		return configLine;
-
+		line = next;
 	}
 
-	// end of file reached
-	configLine[0] = '\0';
-	// LOGGER_LOG_DEBUG("end of file reached")
-	return configLine;
+	// the section lookup must be repeated against the new index
+	setRequestedSection(_requestedSection);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ConfigurationFile::closeConfigurationFile
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : release the mapped file and its index
+//
+// ============================================================================
+void ConfigurationFile::closeConfigurationFile()
+{
+	directives.clear();
+	unsectioned.clear();
+	sectionIndex.clear();
+	sectionNames.clear();
+	requestedDirectives = 0;
 
+	if(configText != 0)
+	{
+		UnmapViewOfFile(configText);
+		configText = 0;
+	}
+	if(hConfigMapping != 0)
+	{
+		CloseHandle(hConfigMapping);
+		hConfigMapping = 0;
+	}
+	if(hConfigFile != 0)
+	{
+		CloseHandle(hConfigFile);
+		hConfigFile = 0;
+	}
+	configLength = 0;
+	configOpen   = false;
 }
+
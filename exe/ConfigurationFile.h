@@ -8,7 +8,11 @@
 #pragma once
 #endif // _MSC_VER > 1000
 
-#include <fstream>
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
 using namespace std;
 // ============================================================================
 //
@@ -17,13 +21,51 @@ using namespace std;
 // ============================================================================
 
 const int  CFGFILE_SECTION_SIZE                 = 128;
+const int  CFGFILE_DIRECTIVE_SIZE               = 128;
 const int  CFGFILE_MAX_LINE_LENGTH              = 5000;
 const char CFGFILE_DEFAULT_COMMENT_CHARACTERS[] = "#;";
 const char CFGFILE_SECTION_OPEN                 = '[';
 const char CFGFILE_SECTION_CLOSE                = ']';
 const char CFGFILE_BLANKS[]                     = "		"; // space or tab
 
-class ConfigurationFile  
+// ============================================================================
+//
+// ConfigurationText - a view onto the mapped configuration file
+//
+// NB the text is NOT null-terminated, and is only valid while the
+//    ConfigurationFile which returned it is open
+//
+// ============================================================================
+struct ConfigurationText
+{
+	const char *text;
+	int         length;
+
+	bool operator==(const ConfigurationText &other) const
+	{
+		return (length==other.length)&&(memcmp(text,other.text,length)==0);
+	}
+};
+
+// FNV-1a hash of a ConfigurationText, used for the section index
+struct ConfigurationTextHash
+{
+	size_t operator()(const ConfigurationText &t) const
+	{
+		unsigned int h = 2166136261u;
+		for(int i=0;i<t.length;i++) { h = (h^(unsigned char)t.text[i])*16777619u; }
+		return h;
+	}
+};
+
+// a directive / value pair
+struct ConfigurationDirective
+{
+	ConfigurationText directive;
+	ConfigurationText value;
+};
+
+class ConfigurationFile
 {
 public:
 
@@ -35,6 +77,13 @@ public:
 
 	// get next configuration directive
 	void getNextConfigurationDirective(char directive[],char value[]);
+	bool getNextConfigurationDirective(ConfigurationDirective &directive);
+
+	// sections in the file
+	bool hasSection(const char section[]) const;
+	int  getNumberOfSections() const;
+	int  getNumberOfUnsectionedDirectives() const;
+	ConfigurationText getSectionName(int sectionIdx) const;
 
 	// which characters are used for comments
 	void setCommentCharacters(char commentCharacters[]);
@@ -45,14 +94,37 @@ public:
 
 private:
 	// service functions
-	char *readNextRealLine();
+	void buildIndex();
+	void closeConfigurationFile();
+
+	// section index entry: directives belonging to one (possibly repeated) section
+	typedef vector<int> DirectiveList;
+	typedef unordered_map<ConfigurationText,DirectiveList,ConfigurationTextHash> SectionIndex;
 
 	// private variables
 	char      _requestedSection[CFGFILE_SECTION_SIZE];
-	ifstream *configFile;
-	char      configLine[CFGFILE_MAX_LINE_LENGTH];
 	char     *_commentCharacters;
 
+	// mapped file
+	HANDLE      hConfigFile;
+	HANDLE      hConfigMapping;
+	const char *configText;
+	int         configLength;
+	bool        configOpen;
+
+	// index
+	vector<ConfigurationDirective> directives;	// all directives, in file order
+	DirectiveList                  unsectioned;	// directives before the first section
+	SectionIndex                   sectionIndex;	// section name -> directives
+	vector<ConfigurationText>      sectionNames;	// section names, in file order
+
+	// where we are in the requested section
+	bool                 allDirectives;			// no section requested
+	const DirectiveList *requestedDirectives;
+	int                  nextUnsectioned;
+	int                  nextDirective;
+
 };
 
 #endif // !defined(__CONFIGURATION_FILE_H__)
+
@@ -0,0 +1,274 @@
+
+// prevent multiple inclusion
+
+#if !defined(__DIRECTIVE_REGISTRY_H__)
+#define __DIRECTIVE_REGISTRY_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <string.h>
+#include "../dll/CmdRunner.h"
+#include "Validation.h"
+
+// ============================================================================
+//
+// Directive registry
+//
+// The control file directives are a constexpr table of DirectiveDefinition:
+//  - directiveNamesUnique() lets the table static_assert that no name is
+//    repeated
+//  - buildDirectiveSlots() finds, at compile time, a hash seed which maps
+//    every name to its own slot, so that a lookup is one hash, one table
+//    read and one strcmp
+//  - directiveIndex() lets code which refers to a directive by name
+//    static_assert that the directive exists
+//
+// Each directive has a value type: the value is parsed and validated
+// according to its type (checkDirectiveValue) before the directive's handler
+// is called.
+//
+// ============================================================================
+
+// value types
+typedef enum DIRECTIVE_TYPES
+{
+	DT_STRING,		// any text
+	DT_PATH,		// text shorter than MAX_PATH (empty leaves the default)
+	DT_DIRECTORY,	// DT_PATH naming a directory (checked by validate)
+	DT_INTEGER,		// integer
+	DT_BOOLEAN,		// yes / no
+	DT_ENUM,		// one of a list of choices
+	DT_ASSIGNMENT	// name=value
+};
+
+// a parsed value
+struct DirectiveValue
+{
+	char *text;			// raw value
+	int   integer;		// DT_INTEGER
+	bool  boolean;		// DT_BOOLEAN
+	int   choice;		// DT_ENUM - index into choices
+	char *name;			// DT_ASSIGNMENT - text before '='
+	char *assigned;		// DT_ASSIGNMENT - text after '='
+};
+
+// state shared by the directives of one control file
+struct DirectiveContext
+{
+	bool libDirSet;
+	bool pathSet;
+};
+
+// directive handler
+typedef void DIRECTIVE_HANDLER(LiteSrv::CmdRunner *cmdRunner,DirectiveValue &value,
+								DirectiveContext &context);
+
+// a directive
+struct DirectiveDefinition
+{
+	const char         *name;
+	DIRECTIVE_TYPES     type;
+	const char * const *choices;	// DT_ENUM only: null-terminated list
+	DIRECTIVE_HANDLER  *handler;
+};
+
+// ============================================================================
+//
+// FUNCTION        : directiveHash
+//
+// DESCRIPTION     : seeded hash of a directive name: FNV-1a of the name,
+//                   with the seed mixed in by a 32-bit finaliser (MurmurHash3
+//                   fmix32), so that every bit of the hash - and so every
+//                   slot - depends on every bit of the seed
+//
+// ============================================================================
+constexpr unsigned int directiveHash(const char *name,unsigned int seed)
+{
+	unsigned int hash = 2166136261u;
+	while(*name != '\0')
+	{
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+		name++;
+	}
+	hash ^= seed * 0x9E3779B9u;
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// ============================================================================
+//
+// FUNCTION        : directiveNamesEqual / directiveNamesUnique / directiveIndex
+//
+// DESCRIPTION     : compile-time checks of a directive table
+//
+// ============================================================================
+constexpr bool directiveNamesEqual(const char *a,const char *b)
+{
+	while((*a != '\0')&&(*a == *b)) { a++; b++; }
+	return *a == *b;
+}
+
+template<int N>
+constexpr bool directiveNamesUnique(const DirectiveDefinition (&table)[N])
+{
+	for(int i=0;i<N;i++)
+	{
+		for(int j=i+1;j<N;j++)
+		{
+			if(directiveNamesEqual(table[i].name,table[j].name)) { return false; }
+		}
+	}
+	return true;
+}
+
+template<int N>
+constexpr int directiveIndex(const DirectiveDefinition (&table)[N],const char *name)
+{
+	for(int i=0;i<N;i++)
+	{
+		if(directiveNamesEqual(table[i].name,name)) { return i; }
+	}
+	return -1;
+}
+
+// ============================================================================
+//
+// DirectiveSlots - perfect hash of a directive table
+//
+// ============================================================================
+
+template<int N>
+struct DirectiveSlots
+{
+	// at least eight slots per directive, so that a seed is found within a
+	// few dozen attempts (with four, it takes over a thousand, which is too
+	// much work for the compiler)
+	static const int SIZE = (N<=8) ? 64 : (N<=16) ? 128 : (N<=32) ? 256 : (N<=64) ? 512 : 1024;
+	static_assert(N<128,"too many directives for DirectiveSlots");
+
+	unsigned int seed;				// 0 if no perfect hash was found
+	signed char  slot[SIZE];		// directive index, or -1
+};
+
+// ============================================================================
+//
+// FUNCTION        : buildDirectiveSlots
+//
+// DESCRIPTION     : find a seed for which every directive hashes to a
+//                   different slot (each seed is an independent attempt, so
+//                   if none of SIZE seeds works, the table is too small)
+//
+// ============================================================================
+template<int N>
+constexpr DirectiveSlots<N> buildDirectiveSlots(const DirectiveDefinition (&table)[N])
+{
+	DirectiveSlots<N> slots = {};
+	for(unsigned int seed=1;seed<(unsigned int)DirectiveSlots<N>::SIZE;seed++)
+	{
+		for(int i=0;i<DirectiveSlots<N>::SIZE;i++) { slots.slot[i] = -1; }
+
+		bool collision = false;
+		for(int d=0;(d<N)&&(!collision);d++)
+		{
+			unsigned int s = directiveHash(table[d].name,seed) & (DirectiveSlots<N>::SIZE-1);
+			if(slots.slot[s] >= 0) { collision = true; }
+			else                   { slots.slot[s] = (signed char)d; }
+		}
+
+		if(!collision)
+		{
+			slots.seed = seed;
+			return slots;
+		}
+	}
+	slots.seed = 0;
+	return slots;
+}
+
+// ============================================================================
+//
+// FUNCTION        : findDirective
+//
+// DESCRIPTION     : look up a directive at run time
+//
+// RETURNS         : directive index, or -1 if not found
+//
+// ============================================================================
+template<int N>
+inline int findDirective(const DirectiveDefinition (&table)[N],const DirectiveSlots<N> &slots,
+							const char *name)
+{
+	int d = slots.slot[directiveHash(name,slots.seed) & (DirectiveSlots<N>::SIZE-1)];
+	return ((d >= 0)&&(strcmp(table[d].name,name) == 0)) ? d : -1;
+}
+
+// ============================================================================
+//
+// FUNCTION        : checkDirectiveValue
+//
+// DESCRIPTION     : check a directive value against the directive's type
+//
+// ARGUMENTS       : definition IN directive
+//                   value      IN directive value
+//                   checkPaths IN check that DT_DIRECTORY directories exist
+//                                 (unless they contain substitutions)
+//
+// RETURNS         : 0 if the value is valid, otherwise an error message
+//
+// ============================================================================
+inline const char *checkDirectiveValue
+(
+	const DirectiveDefinition &definition,
+	char                       value[],
+	bool                       checkPaths
+)
+{
+	class Validation v;
+
+	switch(definition.type)
+	{
+		case DT_PATH:
+		case DT_DIRECTORY:
+			// an empty value is allowed (it leaves the default)
+			if(strlen(value)>=MAX_PATH) { return "Invalid path"; }
+			if(checkPaths&&(definition.type==DT_DIRECTORY)&&(value[0]!='\0')&&
+			   (strchr(value,'%')==0)&&(strchr(value,'{')==0)&&(!v.isDirectory(value)))
+			{
+				return "Directory not found";
+			}
+			break;
+
+		case DT_INTEGER:
+			if(!v.isInteger(value)) { return "Invalid integer"; }
+			break;
+
+		case DT_ENUM:
+			{
+				int choice = 0;
+				while((definition.choices[choice]!=0)&&(strcmp(value,definition.choices[choice])!=0)) { choice++; }
+				if(definition.choices[choice]==0) { return "Invalid value"; }
+			}
+			break;
+
+		case DT_ASSIGNMENT:
+			{
+				const char *equals = strchr(value,'=');
+				if((equals==0)||(equals==value)) { return "Missing ="; }
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+#endif // !defined(__DIRECTIVE_REGISTRY_H__)
+
@@ -82,8 +82,7 @@ bool Validation::isRegularFile
 ) const
 {
 	struct stat buf;
-	stat(str,&buf);
-	return (buf.st_mode&_S_IFREG)!=0;
+	return (stat(str,&buf)==0)&&((buf.st_mode&_S_IFREG)!=0);
 }
 
 // ============================================================================
@@ -105,8 +104,7 @@ bool Validation::isDirectory
 ) const
 {
 	struct stat buf;
-	stat(str,&buf);
-	return (buf.st_mode&_S_IFDIR)!=0;
+	return (stat(str,&buf)==0)&&((buf.st_mode&_S_IFDIR)!=0);
 }
 
 // ============================================================================
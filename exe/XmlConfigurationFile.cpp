@@ -0,0 +1,646 @@
+
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <stdlib.h>
+#include <string.h>
+
+// support headers
+#include <logger.h>
+
+// class header
+#include "XmlConfigurationFile.h"
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int XMLCFG_EOF            = -1;
+const int XMLCFG_REFERENCE_SIZE = 12;	// longest character reference, eg #x0010FFFF
+
+// ============================================================================
+//
+// LOCAL FUNCTION
+//
+// ============================================================================
+
+static bool isBlank(int c) { return (c==' ')||(c=='\t')||(c=='\r')||(c=='\n'); }
+
+static bool isNameChar(int c,bool first)
+{
+	if(((c>='a')&&(c<='z'))||((c>='A')&&(c<='Z'))||(c=='_')||(c==':')||(c>=0x80)) { return true; }
+	return (!first)&&(((c>='0')&&(c<='9'))||(c=='-')||(c=='.'));
+}
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::isXmlConfigurationFile
+//
+// ACCESS SPECIFIER: public static
+//
+// DESCRIPTION     : is this an XML configuration file? It is if it has an
+//                   .xml extension, or if its first non-blank character
+//                   is '<'
+//
+// ARGUMENTS       : configPath IN path of configuration file
+//
+// ============================================================================
+bool XmlConfigurationFile::isXmlConfigurationFile
+(
+	char configPath[]
+)
+{
+	const char *extension = strrchr(configPath,'.');
+	if((extension != 0)&&(_stricmp(extension,XMLCFG_EXTENSION) == 0)) { return true; }
+
+	// look at the start of the file
+	HANDLE hFile = CreateFile(configPath,GENERIC_READ,FILE_SHARE_READ,NULL,
+								OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if(hFile == INVALID_HANDLE_VALUE) { return false; }
+
+	unsigned char start[64];
+	DWORD         length = 0;
+	if(!ReadFile(hFile,start,sizeof(start),&length,NULL)) { length = 0; }
+	CloseHandle(hFile);
+
+	DWORD i = 0;
+	if((length>=3)&&(start[0]==0xEF)&&(start[1]==0xBB)&&(start[2]==0xBF)) { i = 3; }
+	while((i<length)&&isBlank(start[i])) { i++; }
+	return (i<length)&&(start[i]=='<');
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::parse
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : parse an XML configuration file
+//
+// ARGUMENTS       : configPath IN path of configuration file
+//                   handler    IN receives the elements
+//
+// RETURNS         : true if successful, false if the file can't be read or
+//                   is not well-formed
+//
+// THROWS          : anything the handler throws
+//
+// ============================================================================
+bool XmlConfigurationFile::parse
+(
+	char                     configPath[],
+	XmlConfigurationHandler &handler
+)
+{
+	LOGGER_LOG_DEBUG1("XmlConfigurationFile::parse(%s)",configPath)
+
+	closeFile();
+	_configPath = configPath;
+	hConfigFile = CreateFile(configPath,GENERIC_READ,FILE_SHARE_READ,NULL,
+								OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(hConfigFile == INVALID_HANDLE_VALUE)
+	{
+		LOGGER_LOG_ERROR2("failed to open XML configuration file '%s', error=%d",configPath,GetLastError())
+		hConfigFile = 0;
+		return false;
+	}
+
+	readLength = readPosition = 0;
+	lineNumber = 1;
+	pathLength = depth = textLength = numberOfAttributes = 0;
+	path[0]    = '\0';
+	rootSeen   = false;
+
+	bool ok = true;
+	try
+	{
+		// skip a UTF-8 byte order mark
+		int c = nextChar();
+		if(c == 0xEF)
+		{
+			if((nextChar()!=0xBB)||(nextChar()!=0xBF)) { ok = syntaxError("invalid byte order mark"); }
+			c = nextChar();
+		}
+
+		while(ok&&(c != XMLCFG_EOF))
+		{
+			if(c == '<')
+			{
+				ok = parseMarkup(handler);
+			}
+			else if(depth == 0)
+			{
+				if(!isBlank(c)) { ok = syntaxError("text outside the root element"); }
+			}
+			else if(c == '&')
+			{
+				ok = readReference(text,textLength,XMLCFG_TEXT_SIZE);
+			}
+			else
+			{
+				ok = appendChar(text,textLength,XMLCFG_TEXT_SIZE,c);
+			}
+
+			if(ok) { c = nextChar(); }
+		}
+
+		if(ok&&(depth > 0)) { ok = syntaxError("unexpected end of file"); }
+		if(ok&&(!rootSeen)) { ok = syntaxError("no root element"); }
+	}
+	catch(...)
+	{
+		closeFile();
+		throw;
+	}
+
+	closeFile();
+	return ok;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::XmlConfigurationFile
+//                   XmlConfigurationFile::~XmlConfigurationFile
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ============================================================================
+XmlConfigurationFile::XmlConfigurationFile()
+{
+	_configPath = 0;
+	hConfigFile = 0;
+}
+
+XmlConfigurationFile::~XmlConfigurationFile() { closeFile(); }
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::nextChar
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : get the next character from the file, reading the next
+//                   block if necessary
+//
+// RETURNS         : character (0-255) or XMLCFG_EOF
+//
+// ============================================================================
+int XmlConfigurationFile::nextChar()
+{
+	if(readPosition >= readLength)
+	{
+		if((!ReadFile(hConfigFile,readBuffer,sizeof(readBuffer),&readLength,NULL))||(readLength == 0))
+		{
+			readLength = readPosition = 0;
+			return XMLCFG_EOF;
+		}
+		readPosition = 0;
+	}
+
+	int c = (unsigned char)readBuffer[readPosition++];
+	if(c == '\n') { lineNumber++; }
+	return c;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::expect
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : check that the next characters are as expected
+//
+// ============================================================================
+bool XmlConfigurationFile::expect
+(
+	const char expected[]
+)
+{
+	for(const char *e=expected;*e!='\0';e++)
+	{
+		if(nextChar() != (unsigned char)*e) { return syntaxError("unrecognised markup"); }
+	}
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::skipUntil
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : skip characters up to and including terminator (at most
+//                   3 characters)
+//
+// ============================================================================
+bool XmlConfigurationFile::skipUntil
+(
+	const char terminator[]
+)
+{
+	int  length    = (int)strlen(terminator);
+	char window[4] = { 0, 0, 0, 0 };
+
+	while(true)
+	{
+		int c = nextChar();
+		if(c == XMLCFG_EOF) { return syntaxError("unexpected end of file"); }
+
+		memmove(window,window+1,length-1);
+		window[length-1] = (char)c;
+		if(memcmp(window,terminator,length) == 0) { return true; }
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::skipBlanks
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : skip blanks
+//
+// ARGUMENTS       : c IN/OUT current character / first non-blank character
+//
+// ============================================================================
+bool XmlConfigurationFile::skipBlanks
+(
+	int &c
+)
+{
+	while(isBlank(c)) { c = nextChar(); }
+	return (c != XMLCFG_EOF) ? true : syntaxError("unexpected end of file");
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::readName
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : read an element or attribute name
+//
+// ARGUMENTS       : c    IN/OUT first character of name / character after name
+//                   name OUT    name (XMLCFG_NAME_SIZE characters)
+//
+// ============================================================================
+bool XmlConfigurationFile::readName
+(
+	int  &c,
+	char  name[]
+)
+{
+	int length = 0;
+	if(!isNameChar(c,true)) { return syntaxError("invalid name"); }
+	while(isNameChar(c,false))
+	{
+		if(length >= XMLCFG_NAME_SIZE-1) { return syntaxError("name too long"); }
+		name[length++] = (char)c;
+		c = nextChar();
+	}
+	name[length] = '\0';
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::readReference
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : read a character reference (the '&' has been read) and
+//                   append the character it refers to
+//
+// ARGUMENTS       : buffer    IN/OUT buffer to append to
+//                   length    IN/OUT length of buffer
+//                   maxLength IN     size of buffer
+//
+// ============================================================================
+bool XmlConfigurationFile::readReference
+(
+	char  buffer[],
+	int  &length,
+	int   maxLength
+)
+{
+	char reference[XMLCFG_REFERENCE_SIZE];
+	int  referenceLength = 0;
+	int  c;
+
+	while((c = nextChar()) != ';')
+	{
+		if((c == XMLCFG_EOF)||(referenceLength >= XMLCFG_REFERENCE_SIZE-1))
+		{
+			return syntaxError("invalid character reference");
+		}
+		reference[referenceLength++] = (char)c;
+	}
+	reference[referenceLength] = '\0';
+
+	if(!strcmp(reference,"lt"))   { return appendChar(buffer,length,maxLength,'<'); }
+	if(!strcmp(reference,"gt"))   { return appendChar(buffer,length,maxLength,'>'); }
+	if(!strcmp(reference,"amp"))  { return appendChar(buffer,length,maxLength,'&'); }
+	if(!strcmp(reference,"quot")) { return appendChar(buffer,length,maxLength,'"'); }
+	if(!strcmp(reference,"apos")) { return appendChar(buffer,length,maxLength,'\''); }
+
+	if((reference[0] != '#')||(reference[1] == '\0')) { return syntaxError("invalid character reference"); }
+
+	// numeric reference - append as UTF-8
+	char         *end;
+	unsigned long code = (reference[1] == 'x') ? strtoul(reference+2,&end,16) : strtoul(reference+1,&end,10);
+	if((*end != '\0')||(code == 0)||(code > 0x10FFFF)) { return syntaxError("invalid character reference"); }
+
+	if(code < 0x80)
+	{
+		return appendChar(buffer,length,maxLength,(int)code);
+	}
+	if(code < 0x800)
+	{
+		return appendChar(buffer,length,maxLength,0xC0|(int)(code>>6))&&
+				appendChar(buffer,length,maxLength,0x80|(int)(code&0x3F));
+	}
+	if(code < 0x10000)
+	{
+		return appendChar(buffer,length,maxLength,0xE0|(int)(code>>12))&&
+				appendChar(buffer,length,maxLength,0x80|(int)((code>>6)&0x3F))&&
+				appendChar(buffer,length,maxLength,0x80|(int)(code&0x3F));
+	}
+	return appendChar(buffer,length,maxLength,0xF0|(int)(code>>18))&&
+			appendChar(buffer,length,maxLength,0x80|(int)((code>>12)&0x3F))&&
+			appendChar(buffer,length,maxLength,0x80|(int)((code>>6)&0x3F))&&
+			appendChar(buffer,length,maxLength,0x80|(int)(code&0x3F));
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::appendChar
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : append a character to a buffer, leaving room for a
+//                   terminating null
+//
+// ============================================================================
+bool XmlConfigurationFile::appendChar
+(
+	char  buffer[],
+	int  &length,
+	int   maxLength,
+	int   c
+)
+{
+	if(length >= maxLength-1) { return syntaxError("value too long"); }
+	buffer[length++] = (char)c;
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::parseMarkup
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : parse markup (the '<' has been read)
+//
+// ============================================================================
+bool XmlConfigurationFile::parseMarkup
+(
+	XmlConfigurationHandler &handler
+)
+{
+	int c = nextChar();
+	switch(c)
+	{
+		case '?':
+			// processing instruction (including the XML declaration)
+			return skipUntil("?>");
+
+		case '!':
+			c = nextChar();
+			if(c == '-')
+			{
+				// comment
+				return expect("-")&&skipUntil("-->");
+			}
+			if(c == '[')
+			{
+				// CDATA section: copied to the text as is
+				if(!expect("CDATA[")) { return false; }
+				if(depth == 0) { return syntaxError("text outside the root element"); }
+				int copied = 0;
+				while(true)
+				{
+					c = nextChar();
+					if(c == XMLCFG_EOF) { return syntaxError("unexpected end of file"); }
+					if(!appendChar(text,textLength,XMLCFG_TEXT_SIZE,c)) { return false; }
+					copied++;
+					if((copied>=3)&&(memcmp(text+textLength-3,"]]>",3) == 0))
+					{
+						textLength -= 3;
+						return true;
+					}
+				}
+			}
+			// DOCTYPE (internal subset is skipped, not interpreted)
+			{
+				int brackets = 0;
+				while(true)
+				{
+					if(c == XMLCFG_EOF) { return syntaxError("unexpected end of file"); }
+					if(c == '[') { brackets++; }
+					if(c == ']') { brackets--; }
+					if((c == '>')&&(brackets <= 0)) { return true; }
+					c = nextChar();
+				}
+			}
+
+		case '/':
+			return parseEndTag(handler);
+
+		default:
+			return parseStartTag(c,handler);
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::parseStartTag
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : parse a start tag or empty element tag
+//
+// ARGUMENTS       : c       IN first character of the element name
+//                   handler IN receives the element
+//
+// ============================================================================
+bool XmlConfigurationFile::parseStartTag
+(
+	int                      c,
+	XmlConfigurationHandler &handler
+)
+{
+	char name[XMLCFG_NAME_SIZE];
+
+	if((depth == 0)&&rootSeen) { return syntaxError("more than one root element"); }
+	if(!readName(c,name)) { return false; }
+
+	// add the element to the path
+	int nameLength = (int)strlen(name);
+	if(depth >= XMLCFG_MAX_DEPTH) { return syntaxError("elements nested too deeply"); }
+	if(pathLength+nameLength+1 >= XMLCFG_PATH_SIZE) { return syntaxError("element path too long"); }
+	elementStart[depth++] = pathLength;
+	if(depth > 1) { path[pathLength++] = '/'; }
+	memcpy(path+pathLength,name,nameLength+1);
+	pathLength += nameLength;
+	rootSeen    = true;
+
+	// attributes
+	numberOfAttributes = 0;
+	while(true)
+	{
+		if(!skipBlanks(c)) { return false; }
+
+		if((c == '>')||(c == '/'))
+		{
+			bool empty = (c == '/');
+			if(empty&&(nextChar() != '>')) { return syntaxError("expected '>'"); }
+
+			// any text of the parent element is discarded
+			textLength = 0;
+			handler.startElement(path,attributes,numberOfAttributes);
+			if(empty)
+			{
+				text[0] = '\0';
+				handler.endElement(path,text);
+				pathLength       = elementStart[--depth];
+				path[pathLength] = '\0';
+			}
+			return true;
+		}
+
+		if(numberOfAttributes >= XMLCFG_MAX_ATTRIBUTES) { return syntaxError("too many attributes"); }
+		XmlAttribute &attribute = attributes[numberOfAttributes++];
+		if(!readName(c,attribute.name)) { return false; }
+
+		if(!skipBlanks(c)) { return false; }
+		if(c != '=') { return syntaxError("expected '='"); }
+		c = nextChar();
+		if(!skipBlanks(c)) { return false; }
+		if((c != '"')&&(c != '\'')) { return syntaxError("expected quoted attribute value"); }
+
+		int quote       = c;
+		int valueLength = 0;
+		while((c = nextChar()) != quote)
+		{
+			bool ok;
+			if(c == XMLCFG_EOF) { return syntaxError("unexpected end of file"); }
+			if(c == '<')        { return syntaxError("'<' in attribute value"); }
+			if(c == '&') { ok = readReference(attribute.value,valueLength,XMLCFG_TEXT_SIZE); }
+			else         { ok = appendChar(attribute.value,valueLength,XMLCFG_TEXT_SIZE,c); }
+			if(!ok) { return false; }
+		}
+		attribute.value[valueLength] = '\0';
+		c = nextChar();
+	}
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::parseEndTag
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : parse an end tag (the "</" has been read)
+//
+// ============================================================================
+bool XmlConfigurationFile::parseEndTag
+(
+	XmlConfigurationHandler &handler
+)
+{
+	char name[XMLCFG_NAME_SIZE];
+	int  c = nextChar();
+
+	if(!readName(c,name)) { return false; }
+	if(!skipBlanks(c)) { return false; }
+	if(c != '>') { return syntaxError("expected '>'"); }
+
+	// must match the current element
+	if(depth == 0) { return syntaxError("unexpected end tag"); }
+	const char *current = path+elementStart[depth-1]+((depth > 1) ? 1 : 0);
+	if(strcmp(name,current) != 0) { return syntaxError("end tag does not match start tag"); }
+
+	// trim the text
+	int start = 0;
+	while((textLength > 0)&&isBlank((unsigned char)text[textLength-1])) { textLength--; }
+	while((start < textLength)&&isBlank((unsigned char)text[start])) { start++; }
+	text[textLength] = '\0';
+
+	handler.endElement(path,text+start);
+
+	pathLength       = elementStart[--depth];
+	path[pathLength] = '\0';
+	textLength       = 0;
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::syntaxError
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : log a syntax error
+//
+// RETURNS         : false
+//
+// ============================================================================
+bool XmlConfigurationFile::syntaxError
+(
+	const char message[]
+)
+{
+	LOGGER_LOG_ERROR3("XML configuration file '%s' line %d: %s",_configPath,lineNumber,message)
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : XmlConfigurationFile::closeFile
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : close the file
+//
+// ============================================================================
+void XmlConfigurationFile::closeFile()
+{
+	if(hConfigFile != 0)
+	{
+		CloseHandle(hConfigFile);
+		hConfigFile = 0;
+	}
+}
+
@@ -0,0 +1,115 @@
+
+// prevent multiple inclusion
+
+#if !defined(__XML_CONFIGURATION_FILE_H__)
+#define __XML_CONFIGURATION_FILE_H__
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int  XMLCFG_READ_BUFFER_SIZE     = 4096;	// bytes read from the file at a time
+const int  XMLCFG_PATH_SIZE            = 512;	// element path, eg "a/b/c"
+const int  XMLCFG_MAX_DEPTH            = 32;
+const int  XMLCFG_NAME_SIZE            = 128;	// element and attribute names
+const int  XMLCFG_TEXT_SIZE            = 5000;	// element text and attribute values
+const int  XMLCFG_MAX_ATTRIBUTES       = 4;
+const char XMLCFG_EXTENSION[]          = ".xml";
+
+// an attribute of the current element
+struct XmlAttribute
+{
+	char name[XMLCFG_NAME_SIZE];
+	char value[XMLCFG_TEXT_SIZE];
+};
+
+// ============================================================================
+//
+// XmlConfigurationHandler - receives the elements of an XML configuration
+//                           file as it is parsed
+//
+// path is the '/'-separated names of the element and its ancestors,
+// starting with the root element
+//
+// ============================================================================
+class XmlConfigurationHandler
+{
+public:
+	virtual void startElement(const char path[],XmlAttribute attributes[],int numberOfAttributes) = 0;
+	virtual void endElement(const char path[],char text[]) = 0;
+	virtual ~XmlConfigurationHandler() {}
+};
+
+// ============================================================================
+//
+// XmlConfigurationFile - streaming XML reader
+//
+// The file is read in fixed-size blocks and parsed one character at a time,
+// so memory use does not depend on the size of the file. Elements, attributes,
+// text, CDATA and the predefined and numeric character references are
+// supported; comments, processing instructions and DOCTYPE are skipped.
+// Text is only kept for the innermost element (mixed content is ignored).
+//
+// ============================================================================
+class XmlConfigurationFile
+{
+public:
+
+	// is this an XML configuration file (by extension or content)?
+	static bool isXmlConfigurationFile(char configPath[]);
+
+	// parse a file, calling handler for each element
+	// returns false (having logged the error) if the file can't be read or
+	// is not well-formed
+	bool parse(char configPath[],XmlConfigurationHandler &handler);
+
+	// constructor and destructor
+	XmlConfigurationFile();
+	virtual ~XmlConfigurationFile();
+
+private:
+	// service functions
+	int  nextChar();
+	bool expect(const char expected[]);
+	bool skipUntil(const char terminator[]);
+	bool skipBlanks(int &c);
+	bool readName(int &c,char name[]);
+	bool readReference(char buffer[],int &length,int maxLength);
+	bool appendChar(char buffer[],int &length,int maxLength,int c);
+	bool parseMarkup(XmlConfigurationHandler &handler);
+	bool parseStartTag(int c,XmlConfigurationHandler &handler);
+	bool parseEndTag(XmlConfigurationHandler &handler);
+	bool syntaxError(const char message[]);
+	void closeFile();
+
+	// file
+	char   *_configPath;
+	HANDLE  hConfigFile;
+	char    readBuffer[XMLCFG_READ_BUFFER_SIZE];
+	DWORD   readLength;
+	DWORD   readPosition;
+	int     lineNumber;
+
+	// current element
+	char         path[XMLCFG_PATH_SIZE];
+	int          pathLength;
+	int          elementStart[XMLCFG_MAX_DEPTH];	// offset of each element name in path
+	int          depth;
+	bool         rootSeen;
+	char         text[XMLCFG_TEXT_SIZE];
+	int          textLength;
+	XmlAttribute attributes[XMLCFG_MAX_ATTRIBUTES];
+	int          numberOfAttributes;
+};
+
+#endif // !defined(__XML_CONFIGURATION_FILE_H__)
+
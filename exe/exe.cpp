@@ -8,6 +8,7 @@
 
 // system headers
 #include <stdlib.h>
+#include <limits.h>
 #include <string>
 #include <stdio.h>
 #include <iostream>
@@ -17,11 +18,16 @@
 
 // class headers
 #include "ArgumentList.h"
+#include "CompiledConfiguration.h"
+#include "ConfigurationDirectory.h"
 #include "ConfigurationFile.h"
+#include "DirectiveRegistry.h"
 #include "Validation.h"
+#include "XmlConfigurationFile.h"
 #include "../dll/CmdRunner.h"
 #include "../dll/LiteSrv.h"
 #include "../dll/ServiceManager.h"
+#include "../dll/StatusPage.h"
 #include "../dll/StringSubstituter.h"
 
 // ============================================================================
@@ -62,6 +68,9 @@ const char	*ANY_MODE_ARG			= "any";
 const char	*INSTALL_ARG			= "install";
 const char	*INSTALL_DESKTOP_ARG	= "install_desktop";
 const char	*REMOVE_ARG				= "remove";
+const char	*COMPILE_ARG			= "compile";
+const char	*VALIDATE_ARG			= "validate";
+const char	*STATUS_ARG				= "status";
 
 const char	*LIBDIR_NAME	= "LIB";
 const char	*PATH_NAME		= "PATH";
@@ -73,18 +82,217 @@ const char	*SYBASE_NAME	= "SYBASE";
 //
 // ============================================================================
 
+void applyConfigurationDirective(CmdRunner *cmdRunner,int directiveId,char directive[],char value[],
+				const char envName[],const char envValue[],DirectiveContext &context)
+				throw(LiteSrvException);
+void compileConfigurationFile(ArgumentList &argList);
 void getDefaultLibDir(char sybase[],char defaultLibDir[]);
+unsigned int getDirectiveTableSignature();
 void getDefaultPath(char sybase[],char defaultPath[]);
 void installService(char *serviceName,bool desktopService,ArgumentList argList)
 				throw(LiteSrvException);
+int lookupDirective(const char directive[]);
 void parseArgv(CmdRunner *cmdRunner,ArgumentList argList)
 				throw(LiteSrvException);
+void parseConfigurationDirectory(CmdRunner *cmdRunner,char configDirectory[]);
 void parseConfigurationFile(CmdRunner *cmdRunner,char configFile[]);
+void parseXmlConfigurationFile(CmdRunner *cmdRunner,char configFile[]);
+void parseDirectiveValue(const DirectiveDefinition &definition,char value[],const char envName[],
+				const char envValue[],DirectiveValue &parsed) throw(LiteSrvException);
 void parseSwitch(CmdRunner *cmdRunner,ArgumentList &argList,bool &libDirSet,bool &pathSet);
 void printSyntaxAndExit(bool success);
 void removeService(char *serviceName) throw(LiteSrvException);
+void showStatus(ArgumentList &argList);
+void validateConfiguration(ArgumentList &argList);
+void validateConfigurationFile(ConfigurationDirectoryFile &file,void *context);
 void exitProcess(bool success);
 
+// control file directive handlers
+void applyAutoRestart(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyCpuAffinity(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyCpuQuota(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyDebug(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyDebugOut(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyDrainTimeout(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyEnv(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyHandoffTimeout(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyIdleTimeout(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyIoPriority(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyKillTimeout(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyLib(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyListen(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyLivenessProbe(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyLocalDrive(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMaxProcesses(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMaxRss(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMaxRssSamples(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMemoryLimit(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMemoryMax(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMemoryPriority(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMetrics(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyMinimised(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyNetworkDrive(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyNewWindow(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyOnDemand(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyOutput(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyPath(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyPriority(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyProbeFailures(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyProbeInterval(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyProbeTimeout(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyReadinessProbe(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyReplicaCpus(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyReplicas(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyReplicasMax(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyReplicasMin(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyRestartInterval(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyRollingRestart(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applySampleInterval(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyScaleCooldown(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyScaleDown(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyScaleInterval(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyScaleMetric(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyScaleUp(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyScheduling(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyShedCpu(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyShedMemory(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyShutdown(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyShutdownMethod(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyStartup(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyStartupDelay(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyStartupDir(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applySybase(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applySybpath(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyWait(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyWaitTime(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyWatchdog(CmdRunner*,DirectiveValue&,DirectiveContext&);
+void applyWatchdogFile(CmdRunner*,DirectiveValue&,DirectiveContext&);
+
+// ============================================================================
+//
+// CONTROL FILE DIRECTIVES
+//
+// ============================================================================
+
+// choices for DT_ENUM directives (in the same order as the CmdRunner enums)
+constexpr const char *PRIORITY_CHOICES[]        = { "high", "idle", "normal", "real", "above_normal", "below_normal", 0 };
+constexpr const char *SHUTDOWN_METHOD_CHOICES[] = { "kill", "command", "winmessage", 0 };
+constexpr const char *SCHEDULING_CHOICES[]      = { "normal", "batch", 0 };
+constexpr const char *IO_PRIORITY_CHOICES[]     = { "inherit", "very_low", "low", "normal", 0 };
+constexpr const char *MEMORY_PRIORITY_CHOICES[] = { "inherit", "very_low", "low", "medium", "below_normal", "normal", 0 };
+
+//
+// control file directives (in any order: names are checked for uniqueness
+// and hashed at compile time)
+//
+constexpr DirectiveDefinition directives [] =
+{
+	{ "auto_restart",		DT_BOOLEAN,		0,							applyAutoRestart		},
+	{ "cpu_affinity",		DT_STRING,		0,							applyCpuAffinity		},
+	{ "cpu_quota",			DT_INTEGER,		0,							applyCpuQuota			},
+	{ "debug",				DT_INTEGER,		0,							applyDebug				},
+	{ "debug_out",			DT_PATH,		0,							applyDebugOut			},
+	{ "drain_timeout",		DT_INTEGER,		0,							applyDrainTimeout		},
+	{ "env",				DT_ASSIGNMENT,	0,							applyEnv				},
+	{ "handoff_timeout",	DT_INTEGER,		0,							applyHandoffTimeout		},
+	{ "idle_timeout",		DT_INTEGER,		0,							applyIdleTimeout		},
+	{ "io_priority",		DT_ENUM,		IO_PRIORITY_CHOICES,		applyIoPriority			},
+	{ "kill_timeout",		DT_INTEGER,		0,							applyKillTimeout		},
+	{ "lib",				DT_STRING,		0,							applyLib				},
+	{ "listen",				DT_STRING,		0,							applyListen				},
+	{ "liveness_probe",		DT_STRING,		0,							applyLivenessProbe		},
+	{ "local_drive",		DT_ASSIGNMENT,	0,							applyLocalDrive			},
+	{ "max_processes",		DT_INTEGER,		0,							applyMaxProcesses		},
+	{ "max_rss",			DT_INTEGER,		0,							applyMaxRss				},
+	{ "max_rss_samples",	DT_INTEGER,		0,							applyMaxRssSamples		},
+	{ "memory_limit",		DT_INTEGER,		0,							applyMemoryLimit		},
+	{ "memory_max",			DT_INTEGER,		0,							applyMemoryMax			},
+	{ "memory_priority",	DT_ENUM,		MEMORY_PRIORITY_CHOICES,	applyMemoryPriority		},
+	{ "metrics",			DT_STRING,		0,							applyMetrics			},
+	{ "minimised",			DT_BOOLEAN,		0,							applyMinimised			},
+	{ "network_drive",		DT_ASSIGNMENT,	0,							applyNetworkDrive		},
+	{ "new_window",			DT_BOOLEAN,		0,							applyNewWindow			},
+	{ "on_demand",			DT_BOOLEAN,		0,							applyOnDemand			},
+	{ "output",				DT_PATH,		0,							applyOutput				},
+	{ "path",				DT_STRING,		0,							applyPath				},
+	{ "priority",			DT_ENUM,		PRIORITY_CHOICES,			applyPriority			},
+	{ "probe_failures",		DT_INTEGER,		0,							applyProbeFailures		},
+	{ "probe_interval",		DT_INTEGER,		0,							applyProbeInterval		},
+	{ "probe_timeout",		DT_INTEGER,		0,							applyProbeTimeout		},
+	{ "readiness_probe",	DT_STRING,		0,							applyReadinessProbe		},
+	{ "replica_cpus",		DT_INTEGER,		0,							applyReplicaCpus		},
+	{ "replicas",			DT_INTEGER,		0,							applyReplicas			},
+	{ "replicas_max",		DT_INTEGER,		0,							applyReplicasMax		},
+	{ "replicas_min",		DT_INTEGER,		0,							applyReplicasMin		},
+	{ "restart_interval",	DT_INTEGER,		0,							applyRestartInterval	},
+	{ "rolling_restart",	DT_BOOLEAN,		0,							applyRollingRestart		},
+	{ "sample_interval",	DT_INTEGER,		0,							applySampleInterval		},
+	{ "scale_cooldown",		DT_INTEGER,		0,							applyScaleCooldown		},
+	{ "scale_down",			DT_INTEGER,		0,							applyScaleDown			},
+	{ "scale_interval",		DT_INTEGER,		0,							applyScaleInterval		},
+	{ "scale_metric",		DT_STRING,		0,							applyScaleMetric		},
+	{ "scale_up",			DT_INTEGER,		0,							applyScaleUp			},
+	{ "scheduling",			DT_ENUM,		SCHEDULING_CHOICES,			applyScheduling			},
+	{ "shed_cpu",			DT_INTEGER,		0,							applyShedCpu			},
+	{ "shed_memory",		DT_BOOLEAN,		0,							applyShedMemory			},
+	{ "shutdown",			DT_STRING,		0,							applyShutdown			},
+	{ "shutdown_method",	DT_ENUM,		SHUTDOWN_METHOD_CHOICES,	applyShutdownMethod		},
+	{ "startup",			DT_STRING,		0,							applyStartup			},
+	{ "startup_delay",		DT_INTEGER,		0,							applyStartupDelay		},
+	{ "startup_dir",		DT_DIRECTORY,	0,							applyStartupDir			},
+	{ "sybase",				DT_DIRECTORY,	0,							applySybase				},
+	{ "sybpath",			DT_DIRECTORY,	0,							applySybpath			},
+	{ "wait",				DT_STRING,		0,							applyWait				},
+	{ "wait_time",			DT_INTEGER,		0,							applyWaitTime			},
+	{ "watchdog",			DT_INTEGER,		0,							applyWatchdog			},
+	{ "watchdog_file",		DT_PATH,		0,							applyWatchdogFile		}
+};
+const int DIRECTIVE_COUNT = sizeof(directives)/sizeof(DirectiveDefinition);
+static_assert(directiveNamesUnique(directives),"control file directive names must be unique");
+
+// perfect hash of the directive names
+constexpr DirectiveSlots<DIRECTIVE_COUNT> directiveSlots = buildDirectiveSlots(directives);
+static_assert(directiveSlots.seed != 0,"no perfect hash found for control file directives");
+
+// directives referred to by name
+#define	W_INVALID	-1
+constexpr int W_ENV = directiveIndex(directives,"env");
+static_assert(W_ENV >= 0,"env directive not found");
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+//
+// maps the elements of an XML <ServiceConfiguration> file onto control file
+// directives
+//
+class ServiceConfigurationHandler : public XmlConfigurationHandler
+{
+public:
+	void startElement(const char path[],XmlAttribute attributes[],int numberOfAttributes);
+	void endElement(const char path[],char text[]);
+
+	// if errors is given, elements are only validated, and errors are
+	// added to it rather than thrown
+	ServiceConfigurationHandler(CmdRunner *cmdRunner,vector<string> *errors = 0);
+
+private:
+	void apply(const char directive[],const char value[],const char envName[],const char envValue[]);
+	void fail(const char message[],const char detail[]);
+
+	CmdRunner        *_cmdRunner;
+	vector<string>   *_errors;
+	DirectiveContext  context;
+	char              executable[MAX_PATH];
+	char              arguments[VALUE_SIZE];
+	char              directiveCopy[DIRECTIVE_SIZE];
+	char              valueCopy[VALUE_SIZE];
+};
+
+
 // ============================================================================
 //
 // FUNCTION        : main
@@ -179,6 +387,33 @@ void main(int argc, char* argv[])
 				LoggerConfigure(LOGGER_DEFAULT_LOGGER,0,const_cast<char*>(LiteSrv::getApplication()),
 						LOGGER_ANSI_STDOUT,0,0,0,0);
 			}
+			else if(!strcmp(arg,COMPILE_ARG))
+			{
+				LOGGER_LOG_DEBUG("mode is 'compile'")
+				argList.popNextArgument(argType,arg,ArgumentList::AL_TO_LOWER);
+				mode = CmdRunner::COMPILE_MODE ;	// compile mode
+				// since compile mode, log to stdout
+				LoggerConfigure(LOGGER_DEFAULT_LOGGER,0,const_cast<char*>(LiteSrv::getApplication()),
+						LOGGER_ANSI_STDOUT,0,0,0,0);
+			}
+			else if(!strcmp(arg,VALIDATE_ARG))
+			{
+				LOGGER_LOG_DEBUG("mode is 'validate'")
+				argList.popNextArgument(argType,arg,ArgumentList::AL_TO_LOWER);
+				mode = CmdRunner::VALIDATE_MODE ;	// validate mode
+				// since validate mode, log to stdout
+				LoggerConfigure(LOGGER_DEFAULT_LOGGER,0,const_cast<char*>(LiteSrv::getApplication()),
+						LOGGER_ANSI_STDOUT,0,0,0,0);
+			}
+			else if(!strcmp(arg,STATUS_ARG))
+			{
+				LOGGER_LOG_DEBUG("mode is 'status'")
+				argList.popNextArgument(argType,arg,ArgumentList::AL_TO_LOWER);
+				mode = CmdRunner::STATUS_MODE ;	// status mode
+				// since status mode, log to stdout
+				LoggerConfigure(LOGGER_DEFAULT_LOGGER,0,const_cast<char*>(LiteSrv::getApplication()),
+						LOGGER_ANSI_STDOUT,0,0,0,0);
+			}
 			else
 			{
 				// invalid mode - assume this argument is the service name
@@ -195,6 +430,24 @@ void main(int argc, char* argv[])
 			printSyntaxAndExit(false);
 	}
 
+	// if compile mode, compile control file and exit (there is no service name)
+	if(mode==CmdRunner::COMPILE_MODE)
+	{
+		compileConfigurationFile(argList);
+	}
+
+	// if validate mode, validate control file or directory and exit
+	if(mode==CmdRunner::VALIDATE_MODE)
+	{
+		validateConfiguration(argList);
+	}
+
+	// if status mode, show the status of the services and exit
+	if(mode==CmdRunner::STATUS_MODE)
+	{
+		showStatus(argList);
+	}
+
 	if(svc_name[0]=='\0')
 	{
 		// get the window / service name
@@ -355,6 +608,15 @@ Syntax for install mode:\n\
 Syntax for remove mode:\n\
  LiteSrv remove service_name\n\
 \n\
+Syntax for compile mode (snapshot defaults to ctrlfile.lsc):\n\
+ LiteSrv compile ctrlfile [snapshot]\n\
+\n\
+Syntax for validate mode (check every section of every file):\n\
+ LiteSrv validate ctrlfile|ctrldir\n\
+\n\
+Syntax for status mode (services running under LiteSrv):\n\
+ LiteSrv status service_name [service_name...]\n\
+\n\
 service_name is short (internal) name of NT service\n\
 \n\
 options:\n\
@@ -365,7 +627,8 @@ options:\n\
   -s sybase    assign value of %SYBASE% variable\n\
   -q sybase    assign default %PATH% based on this value of %SYBASE%\n\
 \n\
-  -x priority  run at given execution priority (normal/high/real/idle)\n\
+  -x priority  run at given execution priority\n\
+               (normal/high/real/idle/above_normal/below_normal)\n\
   -w           start in new window (command mode only)\n\
   -m           start in minimised new window (command mode only)\n\
   -y sec       delay sec seconds before reporting 'started' (service mode only)\n\
@@ -373,7 +636,8 @@ options:\n\
 \n\
   -d level     debug level (0/1/2, 2 highest)\n\
   -o target    send debug output to target (filename or - for stdout or LOG for NT Event Log)\n\
-  -c ctrlfile  get LiteSrv options from file ctrlfile\n\
+  -c ctrlfile  get LiteSrv options from file ctrlfile, or from the file in\n\
+               directory ctrlfile which has a section for this service\n\
   -h           display this help message\n\
 \n\
 Substitute parameters in command using {prompt} or {prompt:default}\n\
@@ -696,6 +960,8 @@ void parseSwitch
 			else if(!strcmp(arg,"idle")) { cmdRunner->setExecutionPriority(CmdRunner::IDLE_PRIORITY); }
 			else if(!strcmp(arg,"normal")) { cmdRunner->setExecutionPriority(CmdRunner::NORMAL_PRIORITY); }
 			else if(!strcmp(arg,"real")) { cmdRunner->setExecutionPriority(CmdRunner::REAL_PRIORITY); }
+			else if(!strcmp(arg,"above_normal")) { cmdRunner->setExecutionPriority(CmdRunner::ABOVE_NORMAL_PRIORITY); }
+			else if(!strcmp(arg,"below_normal")) { cmdRunner->setExecutionPriority(CmdRunner::BELOW_NORMAL_PRIORITY); }
 			else
 			{
 				LOGGER_LOG_ERROR1("Invalid execution priority (-x) %s",arg)
@@ -718,12 +984,16 @@ void parseSwitch
 			break;
 
 		case 'c':	LOGGER_LOG_DEBUG("switch -c")
-			// configuration file
+			// configuration file or directory
 			argList.popNextArgument(argType,ArgumentList::AL_IS_FILE,isValid,arg);
 			if(isValid)
 			{
 				parseConfigurationFile(cmdRunner,arg);
 			}
+			else if(Validation().isDirectory(arg))
+			{
+				parseConfigurationDirectory(cmdRunner,arg);
+			}
 			else
 			{
 				LOGGER_LOG_ERROR1("Configuration file '%s' not found",arg)
@@ -745,6 +1015,10 @@ void parseSwitch
 //
 // DESCRIPTION     : parse a configuration file
 //
+//                   if there is an up to date compiled snapshot of the file
+//                   (see compileConfigurationFile) it is used instead of the
+//                   file itself
+//
 // ARGUMENTS       : cmdRunner  IN CmdRunner object to apply arguments to
 //                   configFile IN name of configuration file
 //
@@ -757,79 +1031,46 @@ void parseConfigurationFile
 	char       configFile[]
 ) throw(LiteSrvException)
 {
-	ConfigurationFile cf;
 	static char       directive[DIRECTIVE_SIZE];
 	static char       value[VALUE_SIZE];
-	bool              libDirSet=false,pathSet=false;
+	DirectiveContext  context = { false, false };
 
-	// control file directive identifiers
-#define	W_EMPTY		-2
-#define	W_INVALID	-1
-	typedef enum 
-	{
-		W_AUTO_RESTART = 0,
-		W_DEBUG,
-		W_DEBUG_OUT,
-		W_ENV,
-		W_LIB,
-		W_LOCAL_DRIVE,
-		W_MINIMISED,
-		W_NET_DRIVE,
-		W_NEW_WINDOW,
-		W_PATH,
-		W_PRIORITY,
-		W_RESTART_INTERVAL,
-		W_SYBASE,
-		W_SYBPATH,
-		W_SHUTDOWN,
-		W_SHUTDOWN_METHOD,
-		W_STARTUP,
-		W_STARTUP_DELAY,
-		W_STARTUP_DIR,
-		W_WAIT,
-		W_WAIT_TIME
-	} directive_ids;
-
-	//
-	// control file directives
-	// !! THESE MUST ALWAYS BE IN ALPHABETICAL ORDER !!
-	//
-
-	typedef struct
-	{
-		char          directive_name[DIRECTIVE_SIZE];
-		directive_ids directive_id;
-	} directive_array;
-
-	directive_array directives [] =
-	{
-		"auto_restart",		W_AUTO_RESTART,
-		"debug",			W_DEBUG,
-		"debug_out",		W_DEBUG_OUT,
-		"env",				W_ENV,
-		"lib",				W_LIB,
-		"local_drive",		W_LOCAL_DRIVE,
-		"minimised",		W_MINIMISED,
-		"network_drive",	W_NET_DRIVE,
-		"new_window",		W_NEW_WINDOW,
-		"path",				W_PATH,
-		"priority",			W_PRIORITY,
-		"restart_interval",	W_RESTART_INTERVAL,
-		"shutdown",			W_SHUTDOWN,
-		"shutdown_method",	W_SHUTDOWN_METHOD,
-		"startup",			W_STARTUP,
-		"startup_delay",	W_STARTUP_DELAY,
-		"startup_dir",		W_STARTUP_DIR,
-		"sybase",			W_SYBASE,
-		"sybpath",			W_SYBPATH,
-		"wait",				W_WAIT,
-		"wait_time",		W_WAIT_TIME
-	};
-
-	directive_array *directive_id;
-	int this_directive_id;
+	// XML configuration file?
+	if(XmlConfigurationFile::isXmlConfigurationFile(configFile))
+	{
+		parseXmlConfigurationFile(cmdRunner,configFile);
+		return;
+	}
+
+	// try the compiled snapshot first
+	char snapshotFile[MAX_PATH];
+	if(strlen(configFile)+strlen(CMPCFG_SNAPSHOT_SUFFIX) < sizeof(snapshotFile))
+	{
+		sprintf(snapshotFile,"%s%s",configFile,CMPCFG_SNAPSHOT_SUFFIX);
+
+		CompiledConfiguration cc;
+		if(cc.open(configFile,snapshotFile,getDirectiveTableSignature()))
+		{
+			LOGGER_LOG_DEBUG1("using compiled configuration '%s'",snapshotFile)
+			cc.setRequestedSection(cmdRunner->getSrvName());
+
+			int         directiveId;
+			const char *snapshotDirective,*snapshotValue,*envName,*envValue;
+			while(cc.getNextConfigurationDirective(directiveId,snapshotDirective,snapshotValue,envName,envValue))
+			{
+				LOGGER_LOG_DEBUG2("next directive '%s' = '%s'",snapshotDirective,snapshotValue)
+				strncpy(directive,snapshotDirective,sizeof(directive)-1);
+				strncpy(value,snapshotValue,sizeof(value)-1);
+				applyConfigurationDirective(cmdRunner,directiveId,directive,value,
+												envName,envValue,context);
+			}
+			LOGGER_LOG_DEBUG("end of compiled configuration reached")
+			return;
+		}
+	}
 
 	// open the configuration file
+	ConfigurationFile cf;
 	LOGGER_LOG_DEBUG1("about to open configuration file '%s'",configFile)
 	if(!cf.openConfigurationFile(configFile))
 	{
@@ -856,423 +1097,1552 @@ void parseConfigurationFile
 		}
 		LOGGER_LOG_DEBUG2("next directive '%s' = '%s'",directive,value)
 
-		// look up directive in directive list
-		LOGGER_LOG_DEBUG1("about to call bsearch for directive '%s'",directive)
-		directive_id = (directive_array*)bsearch((void*)directive,(void*)directives,
-						(int)(sizeof(directives)/sizeof(directive_array)),
-						sizeof(directive_array),
-						(int(__cdecl *)(const void *,const void *))strcmp);
-
-		if (directive_id != 0)
-		{
-			// we have found the word - convert the pointer to an integer
-			this_directive_id = directive_id->directive_id;
-			LOGGER_LOG_DEBUG1("directive id is %d",this_directive_id)
-		}
-		else
-		{
-			LOGGER_LOG_DEBUG("did not find directive")
-			this_directive_id = W_INVALID;
-		}
-
 		// take the appropriate action for this directive
-		class Validation v;
-		switch(this_directive_id)
-		{
-			case W_AUTO_RESTART:
-				// auto restart?
-				cmdRunner->setAutoRestart(v.isLikeYes(value));
-				break;
-
-			case W_DEBUG:
-				if(v.isInteger(value))
-				{
-					LoggerSetDebugLevel(atoi(value)-1);
-				}
-				else
-				{
-					// bad debug level supplied
-					LoggerSetDebugLevel(2);
-					LOGGER_LOG_ERROR1("Invalid debug level directive %s",value)
-					THROW_LiteSrv_EXCEPTION
-						(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				}
-				break;
-
-			case W_DEBUG_OUT:
-				if(!strcmp(value,"-"))
-				{
-					// log to stdout
-					int loggerError;
-					if(LoggerConfigure(LOGGER_DEFAULT_LOGGER,"",const_cast<char*>(APPLICATION),
-											LOGGER_ANSI_STDOUT,0,0,&loggerError,0)==0)
-					{
-						LOGGER_LOG_ERROR1("Logger initialisation failed, error = %d",loggerError)
-						THROW_LiteSrv_EXCEPTION
-							(LiteSrv_EXCEPTION_GENERAL_ERROR,"","parseConfigurationFile")
-					}
-				}
-				else
-				if(!strcmp(value,"LOG"))
-				{
-					// log to event log
-					int loggerError;
-					if(LoggerConfigure(LOGGER_DEFAULT_LOGGER,"",const_cast<char*>(APPLICATION),
-											LOGGER_WIN32_EVENTLOG,"",0,&loggerError,0)==0)
-					{
-						LOGGER_LOG_ERROR1("Logger initialisation failed, error = %d",loggerError)
-						THROW_LiteSrv_EXCEPTION
-							(LiteSrv_EXCEPTION_GENERAL_ERROR,"","parseConfigurationFile")
-					}
-				}
-				else
-				{
-					// log to file
-
-					// get filename and substitute environment variables
-					StringSubstituter stringSubstituter;
-					char *logFile;
-					stringSubstituter.stringInit(logFile);
-
-					// if the first character of the log file is '>', then truncate the log file first
-					int truncateFile;
-					// truncate the log file?
-					if(value[0]=='>')
-					{
-						// strip off the leading '>' and truncate the file
-						stringSubstituter.stringCopy(logFile,value+1);
-						truncateFile=1;
-					}
-					else
-					{
-						// don't truncate the file
-						stringSubstituter.stringCopy(logFile,value);
-						truncateFile=0;
-					}
-
-					// substitute any environment variables in the log file
-					stringSubstituter.stringSubstitute(logFile);
-
-					// configure the logger
-					int loggerError;
-					if(LoggerConfigure(LOGGER_DEFAULT_LOGGER,"",const_cast<char*>(APPLICATION),
-											LOGGER_ANSI_FILENAME,logFile,(void*)&truncateFile,
-											&loggerError,0)==0)
-					{
-						LOGGER_LOG_ERROR1("Logger initialisation failed, error = %d",loggerError)
-						stringSubstituter.stringDelete(logFile);
-						THROW_LiteSrv_EXCEPTION
-							(LiteSrv_EXCEPTION_GENERAL_ERROR,"","parseConfigurationFile")
-					}
-					stringSubstituter.stringDelete(logFile);
-				}
-				break;
-
-			case W_ENV:
-				// environment variable
-				{
-					char  envName[MAX_ARG_SIZE];
-					char  envValue[MAX_ARG_SIZE];
-					int   equalsPosition;
-					equalsPosition=(strchr(value,'=')-value);
-					if(equalsPosition==0)
-					{
-						LOGGER_LOG_ERROR1("missing = in environment directive '%s'",value)
-						THROW_LiteSrv_EXCEPTION
-							(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-					}
-					// get environment variable name
-					strncpy(envName,value,equalsPosition);
-					envName[equalsPosition]='\0';
-					// get environment variable value
-					strcpy(envValue,value+equalsPosition+1);
-					// add environment variable to list
-					LOGGER_LOG_DEBUG2("environment '%s' = '%s'",envName,envValue)
-					cmdRunner->addEnv(envName,envValue);
-				}
-				break;
-
-			case W_LOCAL_DRIVE:
-				// map local drive (ie SUBST)
-				{
-					// find position of =
-					int equalsPosition=(strchr(value,'=')-value);
-					if(equalsPosition==0)
-					{
-						LOGGER_LOG_ERROR1("missing = in environment directive '%s'",value)
-						THROW_LiteSrv_EXCEPTION
-							(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-					}
-
-					// get drive letter
-					char driveLetter;
-					int i = 0;
-					while(value[i]==' ') { i++;}
-					driveLetter = value[i];
-
-					// get drive path and substitute environment variables
-					char drivePath[MAX_PATH];
-					strcpy(drivePath,value+equalsPosition+1);
-
-					// map local drive
-					LOGGER_LOG_DEBUG2("local drive %c = '%s'",driveLetter,drivePath)
-					cmdRunner->mapLocalDrive(driveLetter,drivePath);
-				}
-				break;
-
-			case W_LIB:
-				// value of %LIB%
-				LOGGER_LOG_DEBUG2("'%s' = '%s'",LIBDIR_NAME,value)
-				cmdRunner->addEnv(LIBDIR_NAME,value);
-				libDirSet = true;
-				break;
-
-			case W_MINIMISED:
-				// start minimised?
-				cmdRunner->setStartMinimised(v.isLikeYes(value));
-				break;
-
-			case W_NET_DRIVE:
-				// map network drive (ie NET USE)
-				{
-					// find position of =
-					int equalsPosition=(strchr(value,'=')-value);
-					if(equalsPosition==0)
-					{
-						LOGGER_LOG_ERROR1("missing = in environment directive '%s'",value)
-						THROW_LiteSrv_EXCEPTION
-							(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-					}
-
-					// get drive letter
-					char driveLetter;
-					int i = 0;
-					while(value[i]==' ') { i++;}
-					driveLetter = value[i];
-
-					// get network path and substitute environment variables
-					char networkPath[MAX_PATH];
-					strcpy(networkPath,value+equalsPosition+1);
-
-					// map network drive
-					LOGGER_LOG_DEBUG2("network drive '%s' = '%s'",driveLetter,networkPath)
-					cmdRunner->mapNetworkDrive(driveLetter,networkPath);
-				}
-				break;
-
-			case W_NEW_WINDOW:
-				// start in new window
-				cmdRunner->setStartInNewWindow(v.isLikeYes(value));
-				break;
-
-			case W_PATH:
-				// value of %PATH%
-				LOGGER_LOG_DEBUG2("'%s' = '%s'",PATH_NAME,value)
-				cmdRunner->addEnv(PATH_NAME,value);
-				pathSet = true;
-				break;
-
-			case W_PRIORITY:
-				if(!strcmp(value,"high")) { cmdRunner->setExecutionPriority(CmdRunner::HIGH_PRIORITY); }
-				else if(!strcmp(value,"idle")) { cmdRunner->setExecutionPriority(CmdRunner::IDLE_PRIORITY); }
-				else if(!strcmp(value,"normal")) { cmdRunner->setExecutionPriority(CmdRunner::NORMAL_PRIORITY); }
-				else if(!strcmp(value,"real")) { cmdRunner->setExecutionPriority(CmdRunner::REAL_PRIORITY); }
-				else
-				{
-					LOGGER_LOG_ERROR1("Invalid execution priority %s",value)
-					THROW_LiteSrv_EXCEPTION
-						(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				}
-				break;
-
-			case W_RESTART_INTERVAL:
-				// restart interval
-				if(v.isInteger(value))
-				{
-					cmdRunner->setAutoRestartInterval(atoi(value));
-				}
-				else
-				{
-					LOGGER_LOG_ERROR1("Invalid restart interval %s",value)
-					THROW_LiteSrv_EXCEPTION
-						(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				}
-				break;
-
-			case W_SHUTDOWN:
-				// shutdown command
-				cmdRunner->setShutdownCommand(value);
-				cmdRunner->setShutdownMethod(CmdRunner::SHUTDOWN_BY_COMMAND);
-				break;
-
-			case W_SHUTDOWN_METHOD:
-				// shutdown command
-				if(!strcmp(value,"kill")) { cmdRunner->setShutdownMethod(CmdRunner::SHUTDOWN_BY_KILL); }
-				else if(!strcmp(value,"command")) { cmdRunner->setShutdownMethod(CmdRunner::SHUTDOWN_BY_COMMAND); }
-				else if(!strcmp(value,"winmessage")) { cmdRunner->setShutdownMethod(CmdRunner::SHUTDOWN_BY_WINMESSAGE); }
-				else
-				{
-					LOGGER_LOG_ERROR1("Invalid shutdown method %s",value)
-					THROW_LiteSrv_EXCEPTION
-						(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				}
-				break;
-
-			case W_STARTUP:
-				// startup command
-				cmdRunner->setStartupCommand(value);
-				break;
-
-			case W_STARTUP_DELAY:
-				// startup delay
-				if(v.isInteger(value))
-				{
-					cmdRunner->setStartupDelay(atoi(value));
-				}
-				else
-				{
-					LOGGER_LOG_ERROR1("Invalid startup delay %s",value)
-					THROW_LiteSrv_EXCEPTION
-						(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				}
-				break;
-
-			case W_STARTUP_DIR:
-				// startup directory
-				cmdRunner->setStartupDirectory(value);
-				break;
-
-			case W_SYBASE:
-				// value of %SYBASE%
-				{
-					char tmp[MAX_ARG_SIZE];
-					cmdRunner->addEnv(SYBASE_NAME,value);
-					if(!libDirSet)
-					{
-						getDefaultLibDir(value,tmp);
-						LOGGER_LOG_DEBUG1("lib dir not set, using default '%s'",tmp)
-						cmdRunner->addEnv(LIBDIR_NAME,tmp);
-						libDirSet = true;
-					}
-					if(!pathSet)
-					{
-						getDefaultPath(value,tmp);
-						LOGGER_LOG_DEBUG1("path not set, using default '%s'",tmp)
-						cmdRunner->addEnv(PATH_NAME,tmp);
-						pathSet = true;
-					}
-				}
-				break;
-
-			case W_SYBPATH:
-				// value of %PATH% based on %SYBASE%
-				{
-					char tmp[MAX_ARG_SIZE];
-					getDefaultPath(value,tmp);
-					cmdRunner->addEnv(PATH_NAME,tmp);
-					pathSet = true;
-				}
-				break;
-
-			case W_WAIT:
-				// wait command
-				cmdRunner->setWaitCommand(value);
-				break;
-
-			case W_WAIT_TIME:
-				// wait interval
-				if(v.isInteger(value))
-				{
-					cmdRunner->setWaitInterval(atoi(value));
-				}
-				else
-				{
-					LOGGER_LOG_ERROR1("Invalid wait interval %s",value)
-					THROW_LiteSrv_EXCEPTION
-						(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				}
-				break;
-
-			default:
-				LOGGER_LOG_ERROR2("Invalid directive '%s' = '%s'",directive,value)
-				THROW_LiteSrv_EXCEPTION
-					(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationFile")
-				break;
-
-		}
+		applyConfigurationDirective(cmdRunner,lookupDirective(directive),directive,value,
+										0,0,context);
 	}
 
 }
 
 // ============================================================================
 //
-// FUNCTION        : getDefaultLibDir
+// FUNCTION        : parseXmlConfigurationFile
 //
-// DESCRIPTION     : return default LIB directory based on given value of %SYBASE%
+// DESCRIPTION     : parse an XML <ServiceConfiguration> file
 //
-// ARGUMENTS       : sybase        IN  value of %SYBASE%
-//                   defaultLibDir OUT default LIB directory 
+// ARGUMENTS       : cmdRunner  IN CmdRunner object to apply arguments to
+//                   configFile IN name of configuration file
+//
+// THROWS          : LiteSrvException
 //
 // ============================================================================
-void getDefaultLibDir
+void parseXmlConfigurationFile
 (
-	char sybase[],
-	char defaultLibDir[]
-)
+	CmdRunner *cmdRunner,
+	char       configFile[]
+) throw(LiteSrvException)
 {
-	sprintf(defaultLibDir,"%s\\lib",sybase);
-	LOGGER_LOG_DEBUG1("default LIB is '%s'",defaultLibDir)
+	XmlConfigurationFile        xcf;
+	ServiceConfigurationHandler handler(cmdRunner);
+
+	LOGGER_LOG_DEBUG1("about to parse XML configuration file '%s'",configFile)
+	if(!xcf.parse(configFile,handler))
+	{
+		LOGGER_LOG_ERROR1("failed to parse XML configuration file '%s'",configFile)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseXmlConfigurationFile")
+	}
 }
 
 // ============================================================================
 //
-// FUNCTION        : getDefaultPath
+// MEMBER FUNCTION : ServiceConfigurationHandler::ServiceConfigurationHandler
 //
-// DESCRIPTION     : return default PATH based on given value of %SYBASE%
+// ACCESS SPECIFIER: public
 //
-// ARGUMENTS       : sybase      IN  value of %SYBASE%
-//                   defaultPath OUT default PATH
+// DESCRIPTION     : constructor
+//
+// ARGUMENTS       : cmdRunner IN CmdRunner object to apply elements to
+//                   errors    IN errors found (validate only), or 0
+//
+//                   when validating, cmdRunner may be 0
 //
 // ============================================================================
-void getDefaultPath
+ServiceConfigurationHandler::ServiceConfigurationHandler
 (
-	char sybase[],
-	char defaultPath[]
+	CmdRunner      *cmdRunner,
+	vector<string> *errors
 )
 {
-	char *systemRoot;
-
-	// get the location of the Windows NT directory
-	systemRoot = getenv("SYSTEMROOT");
-	LOGGER_LOG_DEBUG1("systemRoot is '%s'",systemRoot)
-
-	// build up the default path
-	sprintf(defaultPath,"%s\\install;%s\\bin;%s\\dll;%s;%s\\system32",
-				sybase,sybase,sybase,systemRoot,systemRoot);
-	LOGGER_LOG_DEBUG1("default PATH is '%s'",defaultPath)
+	_cmdRunner        = cmdRunner;
+	_errors           = errors;
+	context.libDirSet = false;
+	context.pathSet   = false;
+	executable[0]     = '\0';
+	arguments[0]      = '\0';
 }
 
 // ============================================================================
 //
-// FUNCTION        : installService
+// MEMBER FUNCTION : ServiceConfigurationHandler::startElement
 //
-// DESCRIPTION     : install a LiteSrv.exe-based service with given parameters
+// ACCESS SPECIFIER: public
 //
-// ARGUMENTS       : serviceName    IN  service name
-//                   desktopService IN can this service interact with the desktop?
-//                   argList        IN argument list
+// DESCRIPTION     : handle the start of an element: only environment
+//                   variables are taken from attributes
+//
+// THROWS          : LiteSrvException
 //
 // ============================================================================
-void installService
+void ServiceConfigurationHandler::startElement
 (
-	char         *serviceName,
-	bool          desktopService,
-	ArgumentList  argList
-) throw(LiteSrvException)
+	const char    path[],
+	XmlAttribute  attributes[],
+	int           numberOfAttributes
+)
 {
-	LOGGER_LOG_DEBUG1("installService(%s)",serviceName)
+	if(strcmp(path,"ServiceConfiguration/Application/Environment/Variable") != 0) { return; }
 
-	// get path name of this executable
+	const char *name = 0, *value = "";
+	for(int i=0;i<numberOfAttributes;i++)
+	{
+		if(!strcmp(attributes[i].name,"name"))  { name  = attributes[i].value; }
+		if(!strcmp(attributes[i].name,"value")) { value = attributes[i].value; }
+	}
+	if((name == 0)||(name[0] == '\0'))
+	{
+		fail("<Variable> element has no name attribute",path);
+		return;
+	}
+	apply("env","",name,value);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceConfigurationHandler::endElement
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : handle the end of an element
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ServiceConfigurationHandler::endElement
+(
+	const char path[],
+	char       text[]
+)
+{
+	const char ROOT[] = "ServiceConfiguration";
+	if(strncmp(path,ROOT,sizeof(ROOT)-1) != 0)
+	{
+		fail("Invalid XML configuration element",path);
+		return;
+	}
+	const char *element = path+sizeof(ROOT)-1;
+
+	// containers, and elements handled by startElement
+	if((element[0] == '\0')||
+	   (!strcmp(element,"/Service"))||
+	   (!strcmp(element,"/Recovery"))||
+	   (!strcmp(element,"/Health"))||
+	   (!strcmp(element,"/Sockets"))||
+	   (!strcmp(element,"/Scaling"))||
+	   (!strcmp(element,"/Limits"))||
+	   (!strcmp(element,"/Monitoring"))||
+	   (!strcmp(element,"/Application/Environment"))||
+	   (!strcmp(element,"/Application/Environment/Variable")))
+	{
+		return;
+	}
+
+	// service details are used by the installer, not here
+	if((!strcmp(element,"/Service/n"))||(!strcmp(element,"/Service/Name")))
+	{
+		if((_cmdRunner != 0)&&(strcmp(text,_cmdRunner->getSrvName()) != 0))
+		{
+			LOGGER_LOG_INFO2("configuration is for service '%s', running as '%s'",text,_cmdRunner->getSrvName())
+		}
+		return;
+	}
+	if((!strcmp(element,"/Service/DisplayName"))||
+	   (!strcmp(element,"/Service/Description"))||
+	   (!strcmp(element,"/Service/StartMode")))
+	{
+		LOGGER_LOG_DEBUG2("ignoring '%s' = '%s'",path,text)
+		return;
+	}
+
+	// application
+	if(!strcmp(element,"/Application/Executable"))
+	{
+		if(strlen(text) >= sizeof(executable))
+		{
+			fail("Executable path too long",text);
+			return;
+		}
+		strcpy(executable,text);
+		return;
+	}
+	if(!strcmp(element,"/Application/Arguments"))
+	{
+		strncpy(arguments,text,sizeof(arguments)-1);
+		arguments[sizeof(arguments)-1] = '\0';
+		return;
+	}
+	if(!strcmp(element,"/Application/WorkingDirectory"))
+	{
+		apply("startup_dir",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/Output"))
+	{
+		apply("output",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/Replicas"))
+	{
+		apply("replicas",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/ReplicaCpus"))
+	{
+		apply("replica_cpus",text,0,0);
+		return;
+	}
+
+	// placement
+	if(!strcmp(element,"/Application/Priority"))
+	{
+		apply("priority",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/CpuAffinity"))
+	{
+		apply("cpu_affinity",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/Scheduling"))
+	{
+		apply("scheduling",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/IoPriority"))
+	{
+		apply("io_priority",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application/MemoryPriority"))
+	{
+		apply("memory_priority",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Application"))
+	{
+		// the startup command is the (quoted) executable and its arguments
+		if(executable[0] == '\0')
+		{
+			fail("<Application> element has no <Executable>",path);
+			return;
+		}
+		char command[VALUE_SIZE];
+		bool quote = (strchr(executable,' ') != 0)&&(executable[0] != '"');
+		if(strlen(executable)+strlen(arguments)+4 > sizeof(command))
+		{
+			fail("Command line too long",executable);
+			return;
+		}
+		sprintf(command,quote ? "\"%s\"%s%s" : "%s%s%s",executable,
+					(arguments[0] != '\0') ? " " : "",arguments);
+		apply("startup",command,0,0);
+		return;
+	}
+
+	// recovery
+	if(!strcmp(element,"/Recovery/EnableAutoRestart"))
+	{
+		bool enable = (!_stricmp(text,"true"))||(!strcmp(text,"1"))||Validation().isLikeYes(text);
+		apply("auto_restart",enable ? "yes" : "no",0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/RestartDelay"))
+	{
+		apply("restart_interval",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/WatchdogInterval"))
+	{
+		apply("watchdog",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/HeartbeatFile"))
+	{
+		apply("watchdog_file",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/KillTimeout"))
+	{
+		apply("kill_timeout",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/RollingRestart"))
+	{
+		bool enable = (!_stricmp(text,"true"))||(!strcmp(text,"1"))||Validation().isLikeYes(text);
+		apply("rolling_restart",enable ? "yes" : "no",0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/HandoffTimeout"))
+	{
+		apply("handoff_timeout",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/DrainTimeout"))
+	{
+		apply("drain_timeout",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Recovery/MaxRestartAttempts"))
+	{
+		LOGGER_LOG_INFO1("<MaxRestartAttempts> is not supported - ignoring '%s'",text)
+		return;
+	}
+
+	// health probes
+	if(!strcmp(element,"/Health/LivenessProbe"))
+	{
+		apply("liveness_probe",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Health/ReadinessProbe"))
+	{
+		apply("readiness_probe",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Health/ProbeInterval"))
+	{
+		apply("probe_interval",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Health/ProbeTimeout"))
+	{
+		apply("probe_timeout",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Health/FailureThreshold"))
+	{
+		apply("probe_failures",text,0,0);
+		return;
+	}
+
+	// listening sockets
+	if(!strcmp(element,"/Sockets/Listen"))
+	{
+		apply("listen",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Sockets/OnDemand"))
+	{
+		bool enable = (!_stricmp(text,"true"))||(!strcmp(text,"1"))||Validation().isLikeYes(text);
+		apply("on_demand",enable ? "yes" : "no",0,0);
+		return;
+	}
+	if(!strcmp(element,"/Sockets/IdleTimeout"))
+	{
+		apply("idle_timeout",text,0,0);
+		return;
+	}
+
+	// autoscaling
+	if(!strcmp(element,"/Scaling/Metric"))
+	{
+		apply("scale_metric",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Scaling/MinReplicas"))
+	{
+		apply("replicas_min",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Scaling/MaxReplicas"))
+	{
+		apply("replicas_max",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Scaling/ScaleUp"))
+	{
+		apply("scale_up",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Scaling/ScaleDown"))
+	{
+		apply("scale_down",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Scaling/Interval"))
+	{
+		apply("scale_interval",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Scaling/Cooldown"))
+	{
+		apply("scale_cooldown",text,0,0);
+		return;
+	}
+
+	// resource limits
+	if(!strcmp(element,"/Limits/MemoryLimit"))
+	{
+		apply("memory_limit",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/MemoryMax"))
+	{
+		apply("memory_max",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/CpuQuota"))
+	{
+		apply("cpu_quota",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/MaxProcesses"))
+	{
+		apply("max_processes",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/MaxRss"))
+	{
+		apply("max_rss",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/MaxRssSamples"))
+	{
+		apply("max_rss_samples",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/ShedCpu"))
+	{
+		apply("shed_cpu",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Limits/ShedMemory"))
+	{
+		apply("shed_memory",text,0,0);
+		return;
+	}
+
+	// monitoring
+	if(!strcmp(element,"/Monitoring/SampleInterval"))
+	{
+		apply("sample_interval",text,0,0);
+		return;
+	}
+	if(!strcmp(element,"/Monitoring/Metrics"))
+	{
+		apply("metrics",text,0,0);
+		return;
+	}
+
+	fail("Invalid XML configuration element",path);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceConfigurationHandler::apply
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : apply a control file directive
+//
+// ARGUMENTS       : directive IN directive name
+//                   value     IN value
+//                   envName   IN env name if already split (or 0)
+//                   envValue  IN env value if already split (or 0)
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ServiceConfigurationHandler::apply
+(
+	const char directive[],
+	const char value[],
+	const char envName[],
+	const char envValue[]
+)
+{
+	strncpy(directiveCopy,directive,sizeof(directiveCopy)-1);
+	strncpy(valueCopy,value,sizeof(valueCopy)-1);
+	directiveCopy[sizeof(directiveCopy)-1] = '\0';
+	valueCopy[sizeof(valueCopy)-1]         = '\0';
+	LOGGER_LOG_DEBUG2("XML directive '%s' = '%s'",directiveCopy,valueCopy)
+
+	if(_errors == 0)
+	{
+		applyConfigurationDirective(_cmdRunner,lookupDirective(directiveCopy),directiveCopy,valueCopy,
+										envName,envValue,context);
+		return;
+	}
+
+	// validate only
+	const char *error = (envName != 0) ? 0 :
+						checkDirectiveValue(directives[lookupDirective(directiveCopy)],valueCopy,true);
+	if(error != 0) { fail(error,valueCopy); }
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : ServiceConfigurationHandler::fail
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : report an invalid element: throw, or if validating, add
+//                   it to the errors and carry on
+//
+// ARGUMENTS       : message IN error message
+//                   detail  IN element path or value in error
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void ServiceConfigurationHandler::fail
+(
+	const char message[],
+	const char detail[]
+)
+{
+	if(_errors != 0)
+	{
+		_errors->push_back(string(message)+" '"+detail+"'");
+		return;
+	}
+
+	LOGGER_LOG_ERROR2("%s '%s'",message,detail)
+	THROW_LiteSrv_EXCEPTION
+		(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","ServiceConfigurationHandler")
+}
+
+// ============================================================================
+//
+// FUNCTION        : parseConfigurationDirectory
+//
+// DESCRIPTION     : parse the configuration file in a directory which has a
+//                   section for this service
+//
+// ARGUMENTS       : cmdRunner       IN CmdRunner object to apply arguments to
+//                   configDirectory IN name of configuration directory
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void parseConfigurationDirectory
+(
+	CmdRunner *cmdRunner,
+	char       configDirectory[]
+) throw(LiteSrvException)
+{
+	ConfigurationDirectory cd;
+	bool                   duplicate;
+
+	// errors in other files are logged, but do not stop this service
+	LOGGER_LOG_DEBUG1("about to load configuration directory '%s'",configDirectory)
+	if(!cd.load(configDirectory))
+	{
+		for(int i=0;i<cd.getNumberOfFiles();i++)
+		{
+			ConfigurationDirectoryFile &file = cd.getFile(i);
+			for(size_t e=0;e<file.errors.size();e++)
+			{
+				LOGGER_LOG_ERROR1("%s",const_cast<char*>(file.errors[e].c_str()))
+			}
+		}
+	}
+
+	const char *configFile = cd.findSection(cmdRunner->getSrvName(),duplicate);
+	if(duplicate)
+	{
+		LOGGER_LOG_ERROR2("service '%s' is defined in more than one file in '%s'",
+							cmdRunner->getSrvName(),configDirectory)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationDirectory")
+	}
+	if(configFile == 0)
+	{
+		LOGGER_LOG_ERROR2("no configuration for service '%s' in '%s'",cmdRunner->getSrvName(),configDirectory)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseConfigurationDirectory")
+	}
+
+	char configPath[MAX_ARG_SIZE];
+	strncpy(configPath,configFile,sizeof(configPath)-1);
+	configPath[sizeof(configPath)-1] = '\0';
+	LOGGER_LOG_DEBUG2("service '%s' is configured in '%s'",cmdRunner->getSrvName(),configPath)
+	parseConfigurationFile(cmdRunner,configPath);
+}
+
+// ============================================================================
+//
+// FUNCTION        : validateConfiguration
+//
+// DESCRIPTION     : validate every section of a control file, or of every
+//                   file in a configuration directory, and report all the
+//                   errors found
+//
+//                   syntax is: validate ctrlfile|ctrldir
+//
+// ARGUMENTS       : argList IN argument list
+//
+// ============================================================================
+void validateConfiguration
+(
+	ArgumentList &argList
+)
+{
+	ArgumentList::ArgumentTypes argType;
+	char                        configPath[MAX_ARG_SIZE];
+
+	// get name of control file or directory
+	argList.popNextArgument(argType,configPath);
+	if(argType!=ArgumentList::AL_STRING)
+	{
+		LOGGER_LOG_ERROR1("Expecting control file or directory name, found '%s'",configPath)
+		printSyntaxAndExit(false);
+	}
+
+	// load and validate the files in parallel
+	ConfigurationDirectory cd;
+	bool                   ok = cd.load(configPath);
+	cd.forEachFile(validateConfigurationFile,0);
+
+	// report the errors, in file order
+	int numberOfSections = 0, numberOfErrors = 0;
+	for(int i=0;i<cd.getNumberOfFiles();i++)
+	{
+		ConfigurationDirectoryFile &file = cd.getFile(i);
+		numberOfSections += (int)file.sections.size();
+		for(size_t e=0;e<file.errors.size();e++)
+		{
+			LOGGER_LOG_ERROR1("%s",const_cast<char*>(file.errors[e].c_str()))
+			numberOfErrors++;
+		}
+	}
+
+	LOGGER_LOG_INFO3("validated %d files, %d sections: %d errors",
+						cd.getNumberOfFiles(),numberOfSections,numberOfErrors)
+	exitProcess(ok&&(numberOfErrors==0));
+}
+
+// ============================================================================
+//
+// FUNCTION        : validateConfigurationFile
+//
+// DESCRIPTION     : validate every directive of one file (runs on a
+//                   ConfigurationDirectory worker thread, so errors are
+//                   added to the file rather than logged)
+//
+// ARGUMENTS       : file    IN/OUT file
+//                   context IN     unused
+//
+// ============================================================================
+void validateConfigurationFile
+(
+	ConfigurationDirectoryFile &file,
+	void                       *
+)
+{
+	if(!file.loaded) { return; }
+
+	if(file.isXml)
+	{
+		XmlConfigurationFile        xcf;
+		vector<string>              errors;
+		ServiceConfigurationHandler handler(0,&errors);
+		xcf.parse(const_cast<char*>(file.path.c_str()),handler);
+		for(size_t e=0;e<errors.size();e++) { file.errors.push_back(file.path+": "+errors[e]); }
+		return;
+	}
+
+	ConfigurationFile &cf          = file.configurationFile;
+	int                unsectioned = cf.getNumberOfUnsectionedDirectives();
+	char               directive[DIRECTIVE_SIZE];
+	char               value[VALUE_SIZE];
+	char               allSections[] = "";
+
+	// unsectioned directives, then the directives of each section
+	for(int s=-1;s<cf.getNumberOfSections();s++)
+	{
+		string section;
+		int    skip,count;
+		if(s < 0)
+		{
+			cf.setRequestedSection(allSections);
+			skip  = 0;
+			count = unsectioned;
+		}
+		else
+		{
+			ConfigurationText name = cf.getSectionName(s);
+			section.assign(name.text,name.length);
+			cf.setRequestedSection(const_cast<char*>(section.c_str()));
+			skip  = unsectioned;
+			count = INT_MAX;
+		}
+
+		ConfigurationDirective cd;
+		int                    directiveIdx = 0;
+		while((directiveIdx-skip < count)&&cf.getNextConfigurationDirective(cd))
+		{
+			if((directiveIdx++) < skip) { continue; }
+
+			const char *error = 0;
+			int directiveLength = min(cd.directive.length,(int)sizeof(directive)-1);
+			int valueLength     = min(cd.value.length,(int)sizeof(value)-1);
+			memcpy(directive,cd.directive.text,directiveLength);
+			memcpy(value,cd.value.text,valueLength);
+			directive[directiveLength] = '\0';
+			value[valueLength]         = '\0';
+
+			int directiveId = lookupDirective(directive);
+			if(cd.value.length >= (int)sizeof(value)) { error = "Value too long"; }
+			else if(directiveId == W_INVALID)         { error = "Invalid directive"; }
+			else { error = checkDirectiveValue(directives[directiveId],value,true); }
+
+			if(error != 0)
+			{
+				file.errors.push_back(file.path+": "+((s < 0) ? string() : "["+section+"] ")+
+										directive+"="+value+": "+error);
+			}
+		}
+	}
+}
+
+// ============================================================================
+//
+// FUNCTION        : showStatus
+//
+// DESCRIPTION     : show the status of one or more services, from the
+//                   status pages LiteSrv publishes for them - one line per
+//                   service, of name=value pairs
+//
+//                   syntax is: status service_name [service_name...]
+//
+// ARGUMENTS       : argList IN argument list
+//
+// ============================================================================
+void showStatus
+(
+	ArgumentList &argList
+)
+{
+	ArgumentList::ArgumentTypes argType;
+	char                        serviceName[MAX_ARG_SIZE];
+	const char * const          stateNames[] = LITESRV_STATE_NAMES;
+
+	// the time now (uptimes are from the page's FILETIMEs)
+	FILETIME       fileTime;
+	ULARGE_INTEGER now;
+	GetSystemTimeAsFileTime(&fileTime);
+	now.LowPart  = fileTime.dwLowDateTime;
+	now.HighPart = fileTime.dwHighDateTime;
+
+	int  numberOfServices = 0;
+	bool allFound = true;
+	while(true)
+	{
+		argList.popNextArgument(argType,serviceName);
+		if(argType==ArgumentList::AL_EMPTY) { break; }
+		if(argType!=ArgumentList::AL_STRING)
+		{
+			LOGGER_LOG_ERROR1("Expecting service name, found '%s'",serviceName)
+			printSyntaxAndExit(false);
+		}
+		numberOfServices++;
+
+		LiteSrvStatus status;
+		if(!StatusPage::read(serviceName,status))
+		{
+			cout << serviceName << " state=unknown\n";
+			allFound = false;
+			continue;
+		}
+
+		cout << serviceName
+			 << " state=" << ((status.state < LITESRV_STATE_COUNT) ? stateNames[status.state] : "unknown")
+			 << " pid=" << status.processId
+			 << " processes=" << status.processCount;
+		if((status.processId != 0)&&(status.processTime != 0)&&(now.QuadPart > status.processTime))
+		{
+			cout << " uptime=" << (now.QuadPart-status.processTime)/10000000;
+		}
+		cout << " starts=" << status.starts
+			 << " restarts=" << status.restarts
+			 << " crashes=" << status.crashes;
+		if(status.lastExitTime != 0)
+		{
+			cout << " last_exit_code=" << status.lastExitCode;
+		}
+		cout << " supervisor_pid=" << status.supervisorId << "\n";
+	}
+
+	if(numberOfServices == 0)
+	{
+		LOGGER_LOG_ERROR("Expecting service name")
+		printSyntaxAndExit(false);
+	}
+	exitProcess(allFound);
+}
+
+// ============================================================================
+//
+// FUNCTION        : lookupDirective
+//
+// DESCRIPTION     : look up a control file directive
+//
+// ARGUMENTS       : directive IN directive name
+//
+// RETURNS         : directive id (index into directives), or W_INVALID if
+//                   not found
+//
+// ============================================================================
+int lookupDirective
+(
+	const char directive[]
+)
+{
+	int directiveId = findDirective(directives,directiveSlots,directive);
+	LOGGER_LOG_DEBUG2("directive '%s' has id %d",directive,directiveId)
+	return (directiveId >= 0) ? directiveId : W_INVALID;
+}
+
+// ============================================================================
+//
+// FUNCTION        : getDirectiveTableSignature
+//
+// DESCRIPTION     : return a signature of the directive table, so that a
+//                   compiled configuration is rejected if the directives
+//                   (or their ids) have changed since it was compiled
+//
+// ============================================================================
+unsigned int getDirectiveTableSignature()
+{
+	unsigned int signature = 2166136261u;
+	for(int i=0;i<DIRECTIVE_COUNT;i++)
+	{
+		signature = (signature^directiveHash(directives[i].name,0))*16777619u;
+		signature = (signature^(unsigned int)directives[i].type)*16777619u;
+	}
+	return signature;
+}
+
+// ============================================================================
+//
+// FUNCTION        : applyConfigurationDirective
+//
+// DESCRIPTION     : parse the value of one configuration file directive and
+//                   call its handler
+//
+// ARGUMENTS       : cmdRunner   IN     CmdRunner object to apply directive to
+//                   directiveId IN     directive id (from lookupDirective)
+//                   directive   IN     directive name
+//                   value       IN     directive value (may be modified)
+//                   envName     IN     env name if already split (or 0)
+//                   envValue    IN     env value if already split (or 0)
+//                   context     IN/OUT state shared by the directives
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void applyConfigurationDirective
+(
+	CmdRunner        *cmdRunner,
+	int               directiveId,
+	char              directive[],
+	char              value[],
+	const char        envName[],
+	const char        envValue[],
+	DirectiveContext &context
+) throw(LiteSrvException)
+{
+	if((directiveId < 0)||(directiveId >= DIRECTIVE_COUNT))
+	{
+		LOGGER_LOG_ERROR2("Invalid directive '%s' = '%s'",directive,value)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","applyConfigurationDirective")
+	}
+
+	const DirectiveDefinition &definition = directives[directiveId];
+	DirectiveValue             parsed;
+	parseDirectiveValue(definition,value,envName,envValue,parsed);
+	(*definition.handler)(cmdRunner,parsed,context);
+}
+
+// ============================================================================
+//
+// FUNCTION        : parseDirectiveValue
+//
+// DESCRIPTION     : parse and validate a directive value according to the
+//                   directive's type
+//
+// ARGUMENTS       : definition IN  directive
+//                   value      IN  directive value (DT_ASSIGNMENT values are
+//                                  split in place)
+//                   envName    IN  name if already split (or 0)
+//                   envValue   IN  value if already split (or 0)
+//                   parsed     OUT parsed value
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+void parseDirectiveValue
+(
+	const DirectiveDefinition &definition,
+	char                       value[],
+	const char                 envName[],
+	const char                 envValue[],
+	DirectiveValue            &parsed
+) throw(LiteSrvException)
+{
+	class Validation v;
+
+	const char *error = (envName!=0) ? 0 : checkDirectiveValue(definition,value,false);
+	if(error!=0)
+	{
+		LOGGER_LOG_ERROR3("%s for %s directive '%s'",error,definition.name,value)
+		THROW_LiteSrv_EXCEPTION
+			(LiteSrv_EXCEPTION_INVALID_PARAMETER,"","parseDirectiveValue")
+	}
+
+	memset(&parsed,0,sizeof(parsed));
+	parsed.text = value;
+
+	switch(definition.type)
+	{
+		case DT_INTEGER:
+			parsed.integer = atoi(value);
+			break;
+
+		case DT_BOOLEAN:
+			parsed.boolean = v.isLikeYes(value);
+			break;
+
+		case DT_ENUM:
+			while(strcmp(value,definition.choices[parsed.choice])!=0) { parsed.choice++; }
+			break;
+
+		case DT_ASSIGNMENT:
+			if(envName!=0)
+			{
+				// already split (compiled configuration)
+				parsed.name     = const_cast<char*>(envName);
+				parsed.assigned = const_cast<char*>(envValue);
+			}
+			else
+			{
+				char *equals    = strchr(value,'=');
+				*equals         = '\0';
+				parsed.name     = value;
+				parsed.assigned = equals+1;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+// ============================================================================
+//
+// CONTROL FILE DIRECTIVE HANDLERS
+//
+// ARGUMENTS       : cmdRunner IN     CmdRunner object to apply directive to
+//                   value     IN     parsed directive value
+//                   context   IN/OUT state shared by the directives
+//
+// THROWS          : LiteSrvException
+//
+// ============================================================================
+
+// auto restart?
+void applyAutoRestart(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setAutoRestart(value.boolean);
+}
+
+// CPUs the command may run on
+void applyCpuAffinity(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setCpuAffinity(value.text);
+}
+
+// CPU the command may use, in percent of one CPU
+void applyCpuQuota(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setCpuQuota(value.integer);
+}
+
+// debug level
+void applyDebug(CmdRunner*,DirectiveValue &value,DirectiveContext&)
+{
+	LoggerSetDebugLevel(value.integer-1);
+}
+
+// debug output: - for stdout, LOG for event log, otherwise a file name
+void applyDebugOut(CmdRunner*,DirectiveValue &value,DirectiveContext&)
+{
+	if(!strcmp(value.text,"-"))
+	{
+		// log to stdout
+		int loggerError;
+		if(LoggerConfigure(LOGGER_DEFAULT_LOGGER,"",const_cast<char*>(APPLICATION),
+								LOGGER_ANSI_STDOUT,0,0,&loggerError,0)==0)
+		{
+			LOGGER_LOG_ERROR1("Logger initialisation failed, error = %d",loggerError)
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"","applyDebugOut")
+		}
+	}
+	else
+	if(!strcmp(value.text,"LOG"))
+	{
+		// log to event log
+		int loggerError;
+		if(LoggerConfigure(LOGGER_DEFAULT_LOGGER,"",const_cast<char*>(APPLICATION),
+								LOGGER_WIN32_EVENTLOG,"",0,&loggerError,0)==0)
+		{
+			LOGGER_LOG_ERROR1("Logger initialisation failed, error = %d",loggerError)
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"","applyDebugOut")
+		}
+	}
+	else
+	{
+		// log to file
+
+		// get filename and substitute environment variables
+		StringSubstituter stringSubstituter;
+		char *logFile;
+		stringSubstituter.stringInit(logFile);
+
+		// if the first character of the log file is '>', then truncate the log file first
+		int truncateFile;
+		// truncate the log file?
+		if(value.text[0]=='>')
+		{
+			// strip off the leading '>' and truncate the file
+			stringSubstituter.stringCopy(logFile,value.text+1);
+			truncateFile=1;
+		}
+		else
+		{
+			// don't truncate the file
+			stringSubstituter.stringCopy(logFile,value.text);
+			truncateFile=0;
+		}
+
+		// substitute any environment variables in the log file
+		stringSubstituter.stringSubstitute(logFile);
+
+		// configure the logger
+		int loggerError;
+		if(LoggerConfigure(LOGGER_DEFAULT_LOGGER,"",const_cast<char*>(APPLICATION),
+								LOGGER_ANSI_FILENAME,logFile,(void*)&truncateFile,
+								&loggerError,0)==0)
+		{
+			LOGGER_LOG_ERROR1("Logger initialisation failed, error = %d",loggerError)
+			stringSubstituter.stringDelete(logFile);
+			THROW_LiteSrv_EXCEPTION
+				(LiteSrv_EXCEPTION_GENERAL_ERROR,"","applyDebugOut")
+		}
+		stringSubstituter.stringDelete(logFile);
+	}
+}
+
+// seconds the old command of a rolling restart has to finish its work
+void applyDrainTimeout(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setDrainTimeout(value.integer);
+}
+
+// environment variable
+void applyEnv(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	LOGGER_LOG_DEBUG2("environment '%s' = '%s'",value.name,value.assigned)
+	cmdRunner->addEnv(value.name,value.assigned);
+}
+
+// seconds the new command of a rolling restart has to become ready
+void applyHandoffTimeout(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setHandoffTimeout(value.integer);
+}
+
+// seconds an on-demand command may be idle before it is stopped
+void applyIdleTimeout(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setIdleTimeout(value.integer);
+}
+
+// I/O priority of the command
+void applyIoPriority(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	const CmdRunner::IO_PRIORITIES priorities[] =
+		{ CmdRunner::INHERITED_IO_PRIORITY, CmdRunner::VERY_LOW_IO_PRIORITY, CmdRunner::LOW_IO_PRIORITY,
+		  CmdRunner::NORMAL_IO_PRIORITY };
+	cmdRunner->setIoPriority(priorities[value.choice]);
+}
+
+// seconds to wait for the shutdown method before terminating the command
+void applyKillTimeout(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setKillTimeout(value.integer);
+}
+
+// value of %LIB%
+void applyLib(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext &context)
+{
+	LOGGER_LOG_DEBUG2("'%s' = '%s'",LIBDIR_NAME,value.text)
+	cmdRunner->addEnv(LIBDIR_NAME,value.text);
+	context.libDirSet = true;
+}
+
+// listening socket (opened by LiteSrv, inherited by the command)
+void applyListen(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->addListenSocket(value.text);
+}
+
+// liveness probe (restart the command when it fails)
+void applyLivenessProbe(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->addLivenessProbe(value.text);
+}
+
+// map local drive (ie SUBST)
+void applyLocalDrive(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	// get drive letter
+	char *driveLetter = value.name;
+	while(*driveLetter==' ') { driveLetter++; }
+
+	LOGGER_LOG_DEBUG2("local drive %c = '%s'",*driveLetter,value.assigned)
+	cmdRunner->mapLocalDrive(*driveLetter,value.assigned);
+}
+
+// most processes the command may have running at once
+void applyMaxProcesses(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMaxProcesses(value.integer);
+}
+
+// working set (MB) a process of the command is recycled for staying over
+void applyMaxRss(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMaxRss(value.integer);
+}
+
+// samples in a row over max_rss before a process is recycled
+void applyMaxRssSamples(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMaxRssSamples(value.integer);
+}
+
+// memory (MB) each process of the command may commit
+void applyMemoryLimit(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMemoryLimit(value.integer);
+}
+
+// memory (MB) the processes of the command may commit between them
+void applyMemoryMax(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMemoryMax(value.integer);
+}
+
+// memory priority of the command (low priority memory is trimmed first)
+void applyMemoryPriority(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	const CmdRunner::MEMORY_PRIORITIES priorities[] =
+		{ CmdRunner::INHERITED_MEMORY_PRIORITY, CmdRunner::VERY_LOW_MEMORY_PRIORITY, CmdRunner::LOW_MEMORY_PRIORITY,
+		  CmdRunner::MEDIUM_MEMORY_PRIORITY, CmdRunner::BELOW_NORMAL_MEMORY_PRIORITY, CmdRunner::NORMAL_MEMORY_PRIORITY };
+	cmdRunner->setMemoryPriority(priorities[value.choice]);
+}
+
+// address the metrics are served on
+void applyMetrics(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMetricsAddress(value.text);
+}
+
+// start minimised?
+void applyMinimised(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setStartMinimised(value.boolean);
+}
+
+// map network drive (ie NET USE)
+void applyNetworkDrive(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	// get drive letter
+	char *driveLetter = value.name;
+	while(*driveLetter==' ') { driveLetter++; }
+
+	LOGGER_LOG_DEBUG2("network drive %c = '%s'",*driveLetter,value.assigned)
+	cmdRunner->mapNetworkDrive(*driveLetter,value.assigned);
+}
+
+// start in new window?
+void applyNewWindow(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setStartInNewWindow(value.boolean);
+}
+
+// start the command when the first connection arrives?
+void applyOnDemand(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setOnDemand(value.boolean);
+}
+
+// file the output of the command is appended to
+void applyOutput(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setOutputFile(value.text);
+}
+
+// value of %PATH%
+void applyPath(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext &context)
+{
+	LOGGER_LOG_DEBUG2("'%s' = '%s'",PATH_NAME,value.text)
+	cmdRunner->addEnv(PATH_NAME,value.text);
+	context.pathSet = true;
+}
+
+// execution priority
+void applyPriority(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	const CmdRunner::EXECUTION_PRIORITIES priorities[] =
+		{ CmdRunner::HIGH_PRIORITY, CmdRunner::IDLE_PRIORITY, CmdRunner::NORMAL_PRIORITY, CmdRunner::REAL_PRIORITY,
+		  CmdRunner::ABOVE_NORMAL_PRIORITY, CmdRunner::BELOW_NORMAL_PRIORITY };
+	cmdRunner->setExecutionPriority(priorities[value.choice]);
+}
+
+// consecutive probe failures before a probe counts as failed
+void applyProbeFailures(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setProbeFailureThreshold(value.integer);
+}
+
+// seconds between probes
+void applyProbeInterval(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setProbeInterval(value.integer);
+}
+
+// seconds a probe may take
+void applyProbeTimeout(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setProbeTimeout(value.integer);
+}
+
+// readiness probe (report the service running once it passes)
+void applyReadinessProbe(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->addReadinessProbe(value.text);
+}
+
+// CPUs each replica is pinned to
+void applyReplicaCpus(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setReplicaCpus(value.integer);
+}
+
+// number of instances of the command
+void applyReplicas(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setReplicas(value.integer);
+}
+
+// most replicas the autoscaler may run
+void applyReplicasMax(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMaxReplicas(value.integer);
+}
+
+// fewest replicas the autoscaler may run
+void applyReplicasMin(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setMinReplicas(value.integer);
+}
+
+// restart interval
+void applyRestartInterval(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setAutoRestartInterval(value.integer);
+}
+
+// start the new command alongside the old one on a reload?
+void applyRollingRestart(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setRollingRestart(value.boolean);
+}
+
+// how often what the command uses is sampled
+void applySampleInterval(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setSampleInterval(value.integer);
+}
+
+// seconds after the replicas are scaled before they are scaled again
+void applyScaleCooldown(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setScaleCooldown(value.integer);
+}
+
+// load per replica below which a replica is removed
+void applyScaleDown(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setScaleDown(value.integer);
+}
+
+// seconds between load samples
+void applyScaleInterval(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setScaleInterval(value.integer);
+}
+
+// load metric the number of replicas follows
+void applyScaleMetric(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setScaleMetric(value.text);
+}
+
+// load per replica above which replicas are added
+void applyScaleUp(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setScaleUp(value.integer);
+}
+
+// scheduling policy (batch runs the command in efficiency mode)
+void applyScheduling(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	const CmdRunner::SCHEDULING_POLICIES policies[] = { CmdRunner::NORMAL_SCHEDULING, CmdRunner::BATCH_SCHEDULING };
+	cmdRunner->setSchedulingPolicy(policies[value.choice]);
+}
+
+// pause the command while the CPUs are busier than this (percent)
+void applyShedCpu(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setShedCpu(value.integer);
+}
+
+// pause the command while memory is low?
+void applyShedMemory(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setShedMemory(value.boolean);
+}
+
+// shutdown command
+void applyShutdown(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setShutdownCommand(value.text);
+	cmdRunner->setShutdownMethod(CmdRunner::SHUTDOWN_BY_COMMAND);
+}
+
+// shutdown method
+void applyShutdownMethod(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	const CmdRunner::SHUTDOWN_METHODS methods[] =
+		{ CmdRunner::SHUTDOWN_BY_KILL, CmdRunner::SHUTDOWN_BY_COMMAND, CmdRunner::SHUTDOWN_BY_WINMESSAGE };
+	cmdRunner->setShutdownMethod(methods[value.choice]);
+}
+
+// startup command
+void applyStartup(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setStartupCommand(value.text);
+}
+
+// startup delay
+void applyStartupDelay(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setStartupDelay(value.integer);
+}
+
+// startup directory
+void applyStartupDir(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setStartupDirectory(value.text);
+}
+
+// value of %SYBASE% (and default %LIB% and %PATH%)
+void applySybase(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext &context)
+{
+	char tmp[MAX_ARG_SIZE];
+	cmdRunner->addEnv(SYBASE_NAME,value.text);
+	if(!context.libDirSet)
+	{
+		getDefaultLibDir(value.text,tmp);
+		LOGGER_LOG_DEBUG1("lib dir not set, using default '%s'",tmp)
+		cmdRunner->addEnv(LIBDIR_NAME,tmp);
+		context.libDirSet = true;
+	}
+	if(!context.pathSet)
+	{
+		getDefaultPath(value.text,tmp);
+		LOGGER_LOG_DEBUG1("path not set, using default '%s'",tmp)
+		cmdRunner->addEnv(PATH_NAME,tmp);
+		context.pathSet = true;
+	}
+}
+
+// value of %PATH% based on %SYBASE%
+void applySybpath(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext &context)
+{
+	char tmp[MAX_ARG_SIZE];
+	getDefaultPath(value.text,tmp);
+	cmdRunner->addEnv(PATH_NAME,tmp);
+	context.pathSet = true;
+}
+
+// wait command
+void applyWait(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setWaitCommand(value.text);
+}
+
+// wait interval
+void applyWaitTime(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setWaitInterval(value.integer);
+}
+
+// watchdog keepalive interval
+void applyWatchdog(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setWatchdogInterval(value.integer);
+}
+
+// watchdog heartbeat file (instead of keepalive messages)
+void applyWatchdogFile(CmdRunner *cmdRunner,DirectiveValue &value,DirectiveContext&)
+{
+	cmdRunner->setWatchdogFile(value.text);
+}
+
+// ============================================================================
+//
+// FUNCTION        : compileConfigurationFile
+//
+// DESCRIPTION     : compile a control file to a binary snapshot, which
+//                   parseConfigurationFile will then use in preference to
+//                   the control file for as long as the control file is
+//                   unchanged
+//
+//                   syntax is: compile ctrlfile [snapshot]
+//
+// ARGUMENTS       : argList IN argument list
+//
+// ============================================================================
+void compileConfigurationFile
+(
+	ArgumentList &argList
+)
+{
+	ArgumentList::ArgumentTypes argType;
+	char                        configFile[MAX_ARG_SIZE];
+	char                        snapshotFile[MAX_ARG_SIZE];
+
+	// get name of control file
+	bool isValid;
+	argList.popNextArgument(argType,ArgumentList::AL_IS_FILE,isValid,configFile);
+	if(argType!=ArgumentList::AL_STRING)
+	{
+		LOGGER_LOG_ERROR1("Expecting control file name, found '%s'",configFile)
+		printSyntaxAndExit(false);
+	}
+	if(!isValid)
+	{
+		LOGGER_LOG_ERROR1("Configuration file '%s' not found",configFile)
+		exitProcess(false);
+	}
+
+	// get name of snapshot (default is control file name plus suffix)
+	argList.popNextArgument(argType,snapshotFile);
+	if(argType==ArgumentList::AL_EMPTY)
+	{
+		if(strlen(configFile)+strlen(CMPCFG_SNAPSHOT_SUFFIX) >= MAX_PATH)
+		{
+			LOGGER_LOG_ERROR1("Configuration file name '%s' is too long",configFile)
+			exitProcess(false);
+		}
+		sprintf(snapshotFile,"%s%s",configFile,CMPCFG_SNAPSHOT_SUFFIX);
+	}
+	else if(argType!=ArgumentList::AL_STRING)
+	{
+		LOGGER_LOG_ERROR1("Expecting snapshot file name, found '%s'",snapshotFile)
+		printSyntaxAndExit(false);
+	}
+
+	// only control files are compiled
+	if(XmlConfigurationFile::isXmlConfigurationFile(configFile))
+	{
+		LOGGER_LOG_ERROR1("'%s' is an XML configuration file: only control files can be compiled",configFile)
+		exitProcess(false);
+	}
+
+	// compile it
+	CompiledConfiguration cc;
+	cc.setEnvDirectiveId(W_ENV);
+	exitProcess(cc.compile(configFile,snapshotFile,lookupDirective,getDirectiveTableSignature()));
+}
+
+// ============================================================================
+//
+// FUNCTION        : getDefaultLibDir
+//
+// DESCRIPTION     : return default LIB directory based on given value of %SYBASE%
+//
+// ARGUMENTS       : sybase        IN  value of %SYBASE%
+//                   defaultLibDir OUT default LIB directory 
+//
+// ============================================================================
+void getDefaultLibDir
+(
+	char sybase[],
+	char defaultLibDir[]
+)
+{
+	sprintf(defaultLibDir,"%s\\lib",sybase);
+	LOGGER_LOG_DEBUG1("default LIB is '%s'",defaultLibDir)
+}
+
+// ============================================================================
+//
+// FUNCTION        : getDefaultPath
+//
+// DESCRIPTION     : return default PATH based on given value of %SYBASE%
+//
+// ARGUMENTS       : sybase      IN  value of %SYBASE%
+//                   defaultPath OUT default PATH
+//
+// ============================================================================
+void getDefaultPath
+(
+	char sybase[],
+	char defaultPath[]
+)
+{
+	char *systemRoot;
+
+	// get the location of the Windows NT directory
+	systemRoot = getenv("SYSTEMROOT");
+	LOGGER_LOG_DEBUG1("systemRoot is '%s'",systemRoot)
+
+	// build up the default path
+	sprintf(defaultPath,"%s\\install;%s\\bin;%s\\dll;%s;%s\\system32",
+				sybase,sybase,sybase,systemRoot,systemRoot);
+	LOGGER_LOG_DEBUG1("default PATH is '%s'",defaultPath)
+}
+
+// ============================================================================
+//
+// FUNCTION        : installService
+//
+// DESCRIPTION     : install a LiteSrv.exe-based service with given parameters
+//
+// ARGUMENTS       : serviceName    IN  service name
+//                   desktopService IN can this service interact with the desktop?
+//                   argList        IN argument list
+//
+// ============================================================================
+void installService
+(
+	char         *serviceName,
+	bool          desktopService,
+	ArgumentList  argList
+) throw(LiteSrvException)
+{
+	LOGGER_LOG_DEBUG1("installService(%s)",serviceName)
+
+	// get path name of this executable
 	char *thisExe = new char[_MAX_PATH];
 	if(!argList.getExeFullPath(thisExe))
 	{
@@ -1300,7 +2670,7 @@ void installService
 			// next argument must be the path name of the control file
 			bool isValid;
 			argList.popNextArgument(argType,ArgumentList::AL_IS_FILE,isValid,arg);
-			if(isValid)
+			if(isValid||Validation().isDirectory(arg))
 			{
 				// add the parameter
 				LOGGER_LOG_DEBUG1("control file '%s' exists",arg)
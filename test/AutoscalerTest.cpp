@@ -0,0 +1,180 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+// class headers
+#include "Test.h"
+#include "Autoscaler.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int TEST_MINIMUM    = 1;
+const int TEST_MAXIMUM    = 10;
+const int TEST_SCALE_UP   = 100;
+const int TEST_SCALE_DOWN = 50;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// an autoscaler which samples the load from a file, with no cooldown
+static void setUp(Autoscaler &autoscaler,const ScratchFile &loadFile)
+{
+	string spec = string("file ")+loadFile.getPath();
+	autoscaler.setMetric(spec.c_str());
+	autoscaler.setMinimum(TEST_MINIMUM);
+	autoscaler.setMaximum(TEST_MAXIMUM);
+	autoscaler.setScaleUp(TEST_SCALE_UP);
+	autoscaler.setScaleDown(TEST_SCALE_DOWN);
+	autoscaler.setCooldown(0);
+}
+
+// the decision for a load (as the file's text) and a number of replicas
+static int decide(Autoscaler &autoscaler,const ScratchFile &loadFile,const char *load,int current)
+{
+	FILE *file = fopen(loadFile.getPath(),"w");
+	if(file == 0) { return -1; }
+	fputs(load,file);
+	fclose(file);
+	return autoscaler.decide(current,0,0);
+}
+
+// does validate throw?
+static bool isInvalid(const Autoscaler &autoscaler,int maxReplicas)
+{
+	try
+	{
+		autoscaler.validate(maxReplicas);
+	}
+	catch(LiteSrvException &)
+	{
+		return true;
+	}
+	return false;
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testAutoscalerDecisions)
+{
+	ScratchFile loadFile("LiteSrvTest.load");
+	Autoscaler  autoscaler;
+	setUp(autoscaler,loadFile);
+	CHECK(autoscaler.isEnabled());
+
+	// the configured number of replicas, within the limits
+	CHECK(autoscaler.getInitialCount(3) == 3);
+	CHECK(autoscaler.getInitialCount(0) == TEST_MINIMUM);
+	CHECK(autoscaler.getInitialCount(20) == TEST_MAXIMUM);
+
+	// above scale up, enough replicas to bring the load per replica down to
+	// it, up to the maximum
+	CHECK(decide(autoscaler,loadFile,"250",2) == 3);
+	CHECK(decide(autoscaler,loadFile," 300\n",2) == 3);
+	CHECK(decide(autoscaler,loadFile,"301.5",2) == 4);
+	CHECK(decide(autoscaler,loadFile,"5000",2) == TEST_MAXIMUM);
+
+	// between the thresholds, no change
+	CHECK(decide(autoscaler,loadFile,"200",2) == 2);
+	CHECK(decide(autoscaler,loadFile,"150",3) == 3);
+
+	// below scale down, one fewer, down to the minimum
+	CHECK(decide(autoscaler,loadFile,"60",4) == 3);
+	CHECK(decide(autoscaler,loadFile,"0",4) == 3);
+	CHECK(decide(autoscaler,loadFile,"10",2) == 1);
+	CHECK(decide(autoscaler,loadFile,"10",1) == 1);
+	autoscaler.setMinimum(2);
+	CHECK(decide(autoscaler,loadFile,"10",2) == 2);
+	autoscaler.setMinimum(TEST_MINIMUM);
+
+	// but not if that would take the load per replica above scale up
+	autoscaler.setScaleDown(80);
+	CHECK(decide(autoscaler,loadFile,"150",2) == 2);
+	CHECK(decide(autoscaler,loadFile,"150",3) == 2);
+	autoscaler.setScaleDown(TEST_SCALE_DOWN);
+
+	// no sample, no change
+	CHECK(decide(autoscaler,loadFile,"none",2) == 2);
+	CHECK(decide(autoscaler,loadFile,"-5",2) == 2);
+	remove(loadFile.getPath());
+	CHECK(autoscaler.decide(2,0,0) == 2);
+}
+
+TEST_CASE(testAutoscalerCooldown)
+{
+	ScratchFile loadFile("LiteSrvTest.load");
+	Autoscaler  autoscaler;
+	setUp(autoscaler,loadFile);
+	autoscaler.setCooldown(1);
+
+	// nothing changes until the cooldown has passed since the start, or
+	// since the last change
+	CHECK(autoscaler.getInitialCount(2) == 2);
+	CHECK(decide(autoscaler,loadFile,"500",2) == 2);
+	this_thread::sleep_for(chrono::milliseconds(1100));
+	CHECK(decide(autoscaler,loadFile,"500",2) == 5);
+	CHECK(decide(autoscaler,loadFile,"10",5) == 5);
+	this_thread::sleep_for(chrono::milliseconds(1100));
+	CHECK(decide(autoscaler,loadFile,"10",5) == 4);
+}
+
+TEST_CASE(testAutoscalerSettings)
+{
+	Autoscaler autoscaler;
+	CHECK(!autoscaler.isEnabled());
+	CHECK(!isInvalid(autoscaler,1));
+
+	// metrics
+	bool thrown = false;
+	try { autoscaler.setMetric("memory"); } catch(LiteSrvException &) { thrown = true; }
+	CHECK(thrown);
+	thrown = false;
+	try { autoscaler.setMetric("tcp 70000"); } catch(LiteSrvException &) { thrown = true; }
+	CHECK(thrown);
+	thrown = false;
+	try { autoscaler.setMetric("exec "); } catch(LiteSrvException &) { thrown = true; }
+	CHECK(thrown);
+	CHECK(!autoscaler.isEnabled());
+	autoscaler.setMetric("cpu");
+	CHECK(autoscaler.isEnabled());
+
+	// limits and thresholds which do not fit together
+	CHECK(isInvalid(autoscaler,TEST_MAXIMUM));
+	autoscaler.setMaximum(TEST_MAXIMUM);
+	CHECK(!isInvalid(autoscaler,TEST_MAXIMUM));
+	CHECK(isInvalid(autoscaler,TEST_MAXIMUM-1));
+	autoscaler.setMinimum(TEST_MAXIMUM+1);
+	CHECK(isInvalid(autoscaler,TEST_MAXIMUM));
+	autoscaler.setMinimum(TEST_MINIMUM);
+	autoscaler.setScaleDown(autoscaler.getScaleUp());
+	CHECK(isInvalid(autoscaler,TEST_MAXIMUM));
+}
@@ -0,0 +1,270 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// class headers
+#include "Test.h"
+#include "CompiledConfiguration.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// directive ids handed out by lookupTestDirective
+const int TEST_ENV       = 0;
+const int TEST_STARTUP   = 1;
+const int TEST_WAIT_TIME = 2;
+
+const unsigned int TEST_SIGNATURE = 0x12345678;
+
+// a control file, and the same one with one value changed but not its size
+const char TEST_CONFIGURATION[] =
+	"# unsectioned directives come first in every section\n"
+	"env=SYBASE=c:\\sybase\n"
+	"\n"
+	"[beta]\n"
+	"startup=beta.exe\n"
+	"wait_time=5\n"
+	"\n"
+	"[alpha]\n"
+	"startup=alpha.exe -x\n"
+	"env=MODE=a=b\n"
+	"unknown=1\n";
+const char CHANGED_CONFIGURATION[] =
+	"# unsectioned directives come first in every section\n"
+	"env=SYBASE=c:\\sybase\n"
+	"\n"
+	"[beta]\n"
+	"startup=beta.exe\n"
+	"wait_time=7\n"
+	"\n"
+	"[alpha]\n"
+	"startup=alpha.exe -x\n"
+	"env=MODE=a=b\n"
+	"unknown=1\n";
+
+// where the snapshot header keeps the size of the snapshot (after the magic
+// number, the version and the directive table signature)
+const int TOTAL_SIZE_OFFSET = 12;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+static int lookupTestDirective(const char *directive)
+{
+	if(strcmp(directive,"env") == 0)       { return TEST_ENV; }
+	if(strcmp(directive,"startup") == 0)   { return TEST_STARTUP; }
+	if(strcmp(directive,"wait_time") == 0) { return TEST_WAIT_TIME; }
+	return -1;
+}
+
+static bool writeFile(const char *path,const void *data,size_t size)
+{
+	FILE *file = fopen(path,"wb");
+	if(file == 0) { return false; }
+	bool written = (fwrite(data,1,size,file) == size);
+	return (fclose(file) == 0)&&written;
+}
+
+static bool readFile(const char *path,vector<char> &data)
+{
+	FILE *file = fopen(path,"rb");
+	if(file == 0) { return false; }
+	data.clear();
+	char   buffer[4096];
+	size_t length;
+	while((length = fread(buffer,1,sizeof(buffer),file)) > 0) { data.insert(data.end(),buffer,buffer+length); }
+	fclose(file);
+	return true;
+}
+
+// move the last write time of a file on (so that it looks written since it
+// was compiled)
+static bool touchFile(const char *path,ULONGLONG seconds)
+{
+	HANDLE hFile = CreateFile(path,FILE_WRITE_ATTRIBUTES,FILE_SHARE_READ,NULL,OPEN_EXISTING,
+								FILE_ATTRIBUTE_NORMAL,NULL);
+	if(hFile == INVALID_HANDLE_VALUE) { return false; }
+	FILETIME       lastWrite;
+	ULARGE_INTEGER time;
+	bool           touched = (GetFileTime(hFile,NULL,NULL,&lastWrite) != 0);
+	time.LowPart  = lastWrite.dwLowDateTime;
+	time.HighPart = lastWrite.dwHighDateTime;
+	time.QuadPart += seconds*10000000;
+	lastWrite.dwLowDateTime  = time.LowPart;
+	lastWrite.dwHighDateTime = time.HighPart;
+	touched = touched&&(SetFileTime(hFile,NULL,NULL,&lastWrite) != 0);
+	CloseHandle(hFile);
+	return touched;
+}
+
+// the directives of a section, one "directive=value" (or, for env
+// directives, "env:name=value") per directive, each followed by '\n'
+static string getSection(CompiledConfiguration &compiled,const char *section)
+{
+	compiled.setRequestedSection(section);
+	string      text;
+	int         directiveId;
+	const char *directive,*value,*envName,*envValue;
+	while(compiled.getNextConfigurationDirective(directiveId,directive,value,envName,envValue))
+	{
+		if(envName != 0)
+		{
+			text += (directiveId == TEST_ENV) ? "env:" : "?:";
+			text += string(envName)+"="+envValue+"\n";
+		}
+		else
+		{
+			text += string(directive)+"="+value+"\n";
+		}
+	}
+	return text;
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testSnapshotRoundTrip)
+{
+	ScratchFile configPath("LiteSrvTest.cfg");
+	ScratchFile snapshotPath("LiteSrvTest.cfg.lsc");
+	CHECK(writeFile(configPath.getPath(),TEST_CONFIGURATION,strlen(TEST_CONFIGURATION)));
+
+	CompiledConfiguration compiler;
+	compiler.setEnvDirectiveId(TEST_ENV);
+	CHECK(compiler.compile((char*)configPath.getPath(),(char*)snapshotPath.getPath(),
+							lookupTestDirective,TEST_SIGNATURE));
+
+	// every section has the unsectioned directives, then its own, in the
+	// order of the file (with env values split, at the first '=')
+	CompiledConfiguration compiled;
+	CHECK(compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+	CHECK(getSection(compiled,"alpha") == "env:SYBASE=c:\\sybase\nstartup=alpha.exe -x\nenv:MODE=a=b\nunknown=1\n");
+	CHECK(getSection(compiled,"beta") == "env:SYBASE=c:\\sybase\nstartup=beta.exe\nwait_time=5\n");
+	CHECK(getSection(compiled,"gamma") == "env:SYBASE=c:\\sybase\n");
+
+	// and each directive has the id the lookup gave it
+	compiled.setRequestedSection("beta");
+	int         directiveId;
+	const char *directive,*value,*envName,*envValue;
+	int         ids[3];
+	for(int i=0;i<3;i++)
+	{
+		CHECK(compiled.getNextConfigurationDirective(directiveId,directive,value,envName,envValue));
+		ids[i] = directiveId;
+	}
+	CHECK(!compiled.getNextConfigurationDirective(directiveId,directive,value,envName,envValue));
+	CHECK((ids[0] == TEST_ENV)&&(ids[1] == TEST_STARTUP)&&(ids[2] == TEST_WAIT_TIME));
+	compiled.setRequestedSection("alpha");
+	for(int i=0;i<4;i++) { CHECK(compiled.getNextConfigurationDirective(directiveId,directive,value,envName,envValue)); }
+	CHECK(directiveId == -1);
+}
+
+TEST_CASE(testStaleSnapshot)
+{
+	ScratchFile configPath("LiteSrvTest.cfg");
+	ScratchFile otherPath("LiteSrvTestOther.cfg");
+	ScratchFile snapshotPath("LiteSrvTest.cfg.lsc");
+	CHECK(writeFile(configPath.getPath(),TEST_CONFIGURATION,strlen(TEST_CONFIGURATION)));
+	CHECK(writeFile(otherPath.getPath(),TEST_CONFIGURATION,strlen(TEST_CONFIGURATION)));
+
+	CompiledConfiguration compiled;
+	compiled.setEnvDirectiveId(TEST_ENV);
+	CHECK(compiled.compile((char*)configPath.getPath(),(char*)snapshotPath.getPath(),
+							lookupTestDirective,TEST_SIGNATURE));
+	CHECK(compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// compiled with other directives, or from another file
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE+1));
+	CHECK(!compiled.open((char*)otherPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// written again with the same contents: the hash says it is current
+	CHECK(touchFile(configPath.getPath(),10));
+	CHECK(compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// changed, but not its size
+	CHECK(writeFile(configPath.getPath(),CHANGED_CONFIGURATION,strlen(CHANGED_CONFIGURATION)));
+	CHECK(touchFile(configPath.getPath(),20));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// changed size
+	CHECK(writeFile(configPath.getPath(),TEST_CONFIGURATION,strlen(TEST_CONFIGURATION)-1));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// gone
+	remove(configPath.getPath());
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+}
+
+TEST_CASE(testCorruptSnapshot)
+{
+	ScratchFile configPath("LiteSrvTest.cfg");
+	ScratchFile snapshotPath("LiteSrvTest.cfg.lsc");
+	CHECK(writeFile(configPath.getPath(),TEST_CONFIGURATION,strlen(TEST_CONFIGURATION)));
+
+	CompiledConfiguration compiled;
+	compiled.setEnvDirectiveId(TEST_ENV);
+	CHECK(compiled.compile((char*)configPath.getPath(),(char*)snapshotPath.getPath(),
+							lookupTestDirective,TEST_SIGNATURE));
+	vector<char> good;
+	CHECK(readFile(snapshotPath.getPath(),good));
+	CHECK(good.size() > (size_t)TOTAL_SIZE_OFFSET+sizeof(unsigned int));
+
+	// not a snapshot
+	vector<char> bad(good);
+	bad[0] = 'X';
+	CHECK(writeFile(snapshotPath.getPath(),bad.data(),bad.size()));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// truncated, and empty
+	CHECK(writeFile(snapshotPath.getPath(),good.data(),good.size()-1));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+	CHECK(writeFile(snapshotPath.getPath(),good.data(),0));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// truncated, with the size in its header to match (so that its tables
+	// run past its end)
+	bad.assign(good.begin(),good.end()-good.size()/4);
+	unsigned int totalSize = (unsigned int)bad.size();
+	memcpy(&bad[TOTAL_SIZE_OFFSET],&totalSize,sizeof(totalSize));
+	bad.back() = '\0';
+	CHECK(writeFile(snapshotPath.getPath(),bad.data(),bad.size()));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// a string table which does not end with a null
+	bad = good;
+	bad.back() = 'X';
+	CHECK(writeFile(snapshotPath.getPath(),bad.data(),bad.size()));
+	CHECK(!compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+
+	// and the snapshot as it was is still good
+	CHECK(writeFile(snapshotPath.getPath(),good.data(),good.size()));
+	CHECK(compiled.open((char*)configPath.getPath(),(char*)snapshotPath.getPath(),TEST_SIGNATURE));
+}
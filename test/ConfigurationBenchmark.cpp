@@ -0,0 +1,197 @@
+
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+// class headers
+#include "Test.h"
+#include "ConfigurationFile.h"
+#include "XmlConfigurationFile.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int BENCHMARK_SECTIONS = 10000;
+const int BENCHMARK_OPENS    = 20;
+const int BENCHMARK_LOOKUPS  = 100000;
+const int BENCHMARK_SCANS    = 20;
+const int BENCHMARK_PARSES   = 20;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// write a control file with BENCHMARK_SECTIONS sections of 4 directives
+static bool writeControlFile(const ScratchFile &path)
+{
+	FILE *file = fopen(path.getPath(),"w");
+	if(file == 0) { return false; }
+
+	fprintf(file,"# %d services\ndebug=0\n",BENCHMARK_SECTIONS);
+	for(int i=0;i<BENCHMARK_SECTIONS;i++)
+	{
+		fprintf(file,"\n[service%d]\nstartup=c:\\services\\service%d.exe -port %d\n"
+					 "startup_dir=c:\\services\nauto_restart=yes\nwait_time=5\n",i,i,10000+i);
+	}
+	fclose(file);
+	return true;
+}
+
+// write an XML configuration with as many elements as the control file has
+// directives (4 per section): one service, with that many environment
+// variables
+static bool writeXmlFile(const ScratchFile &path)
+{
+	FILE *file = fopen(path.getPath(),"w");
+	if(file == 0) { return false; }
+
+	fprintf(file,"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<ServiceConfiguration>\n"
+				 "  <Service>\n    <n>service</n>\n    <StartMode>Automatic</StartMode>\n  </Service>\n"
+				 "  <Application>\n    <Executable>c:\\services\\service.exe</Executable>\n"
+				 "    <Arguments>-port 10000</Arguments>\n    <Environment>\n");
+	for(int i=0;i<4*BENCHMARK_SECTIONS;i++)
+	{
+		fprintf(file,"      <Variable name=\"SERVICE_SETTING_%d\" value=\"c:\\services\\data\\%d &amp; more\" />\n",i,i);
+	}
+	fprintf(file,"    </Environment>\n  </Application>\n"
+				 "  <Recovery>\n    <EnableAutoRestart>true</EnableAutoRestart>\n"
+				 "    <RestartDelay>30</RestartDelay>\n  </Recovery>\n</ServiceConfiguration>\n");
+	fclose(file);
+	return true;
+}
+
+// counts the elements, and the attribute values whose "&amp;" was decoded
+class CountingHandler : public XmlConfigurationHandler
+{
+public:
+	CountingHandler() : elements(0), decodedValues(0) {}
+
+	void startElement(const char path[],XmlAttribute attributes[],int numberOfAttributes)
+	{
+		elements++;
+		for(int i=0;i<numberOfAttributes;i++)
+		{
+			if(strstr(attributes[i].value," & more") != 0) { decodedValues++; }
+		}
+	}
+	void endElement(const char path[],char text[]) {}
+
+	int elements;
+	int decodedValues;
+};
+
+// find a section the way ConfigurationFile used to: read the file a line at
+// a time from the start until the section header turns up
+static bool scanForSection(const char path[],const char section[])
+{
+	ifstream stream(path);
+	char     line[CFGFILE_MAX_LINE_LENGTH];
+	string   header = string("[")+section+"]";
+	while(stream.getline(line,sizeof(line)))
+	{
+		if(header == line) { return true; }
+	}
+	return false;
+}
+
+// ============================================================================
+//
+// BENCHMARKS
+//
+// ============================================================================
+
+BENCHMARK(benchmarkConfigurationFile)
+{
+	ScratchFile path("LiteSrvBenchmark.cfg");
+	CHECK(writeControlFile(path));
+
+	// map and index the whole file
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int i=0;i<BENCHMARK_OPENS;i++)
+	{
+		ConfigurationFile configurationFile;
+		CHECK(configurationFile.openConfigurationFile((char*)path.getPath()));
+		CHECK(configurationFile.getNumberOfSections() == BENCHMARK_SECTIONS);
+	}
+	double openMs = elapsedMs(start)/BENCHMARK_OPENS;
+
+	// look up sections all over the file, and read each one
+	ConfigurationFile configurationFile;
+	CHECK(configurationFile.openConfigurationFile((char*)path.getPath()));
+	char section[CFGFILE_SECTION_SIZE];
+	int  directives = 0;
+	start = chrono::steady_clock::now();
+	for(int i=0;i<BENCHMARK_LOOKUPS;i++)
+	{
+		sprintf(section,"service%d",(int)((i*7919L)%BENCHMARK_SECTIONS));
+		configurationFile.setRequestedSection(section);
+		ConfigurationDirective directive;
+		while(configurationFile.getNextConfigurationDirective(directive)) { directives++; }
+	}
+	double lookupUs = elapsedMs(start)*1000.0/BENCHMARK_LOOKUPS;
+	// each section has its 4 directives, and the unsectioned one
+	CHECK(directives == 5*BENCHMARK_LOOKUPS);
+
+	// what a lookup of the last section cost before the index
+	sprintf(section,"service%d",BENCHMARK_SECTIONS-1);
+	start = chrono::steady_clock::now();
+	for(int i=0;i<BENCHMARK_SCANS;i++)
+	{
+		CHECK(scanForSection(path.getPath(),section));
+	}
+	double scanMs = elapsedMs(start)/BENCHMARK_SCANS;
+
+	printf("  %d sections: open and index %.2f ms, lookup %.3f us, linear scan to the last section %.2f ms\n",
+			BENCHMARK_SECTIONS,openMs,lookupUs,scanMs);
+}
+
+BENCHMARK(benchmarkXmlConfigurationFile)
+{
+	ScratchFile path("LiteSrvBenchmark.xml");
+	CHECK(writeXmlFile(path));
+
+	FILE *file = fopen(path.getPath(),"r");
+	CHECK(file != 0);
+	fseek(file,0,SEEK_END);
+	long size = ftell(file);
+	fclose(file);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int elements = 0;
+	for(int i=0;i<BENCHMARK_PARSES;i++)
+	{
+		XmlConfigurationFile xmlFile;
+		CountingHandler      handler;
+		CHECK(xmlFile.parse((char*)path.getPath(),handler));
+		CHECK(handler.decodedValues == 4*BENCHMARK_SECTIONS);
+		elements = handler.elements;
+	}
+	double parseMs = elapsedMs(start)/BENCHMARK_PARSES;
+	// 4 per section, and the 11 elements around them
+	CHECK(elements == 4*BENCHMARK_SECTIONS+11);
+
+	printf("  %d elements (%ld KB): parse %.2f ms (%.1f MB/s, %.0f ns per element)\n",
+			elements,size/1024,parseMs,size/1024.0/1024.0/(parseMs/1000.0),parseMs*1000000.0/elements);
+}
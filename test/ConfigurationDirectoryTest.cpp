@@ -0,0 +1,182 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// class headers
+#include "Test.h"
+#include "ConfigurationDirectory.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+#define	TEST_DIRECTORY	"LiteSrvTestDirectory"
+
+const char TEST_XML_SERVICE[] =
+	"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<ServiceConfiguration>\n"
+	"  <Service>\n    <n>four</n>\n  </Service>\n"
+	"  <Application>\n    <Executable>c:\\services\\four.exe</Executable>\n  </Application>\n"
+	"</ServiceConfiguration>\n";
+const char TEST_XML_UNNAMED[] =
+	"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<ServiceConfiguration>\n"
+	"  <Application>\n    <Executable>c:\\services\\five.exe</Executable>\n  </Application>\n"
+	"</ServiceConfiguration>\n";
+
+// ============================================================================
+//
+// LOCAL CLASSES AND FUNCTIONS
+//
+// ============================================================================
+
+// a scratch directory, removed when the test returns (its files first, as
+// they are declared after it)
+class ScratchDirectory
+{
+public:
+	ScratchDirectory(const char *name) : path(getScratchPath(name))
+	{
+		created = (CreateDirectory(path.c_str(),NULL) != 0)||(GetLastError() == ERROR_ALREADY_EXISTS);
+	}
+	~ScratchDirectory() { RemoveDirectory(path.c_str()); }
+
+	string path;
+	bool   created;
+};
+
+static bool writeFile(const ScratchFile &path,const char *text)
+{
+	FILE *file = fopen(path.getPath(),"w");
+	if(file == 0) { return false; }
+	fputs(text,file);
+	return fclose(file) == 0;
+}
+
+// the errors of the file whose name ends with name
+static string getErrors(ConfigurationDirectory &directory,const char *name)
+{
+	string errors;
+	for(int i=0;i<directory.getNumberOfFiles();i++)
+	{
+		ConfigurationDirectoryFile &file = directory.getFile(i);
+		if((file.path.length() < strlen(name))||
+		   (file.path.compare(file.path.length()-strlen(name),string::npos,name) != 0))
+		{
+			continue;
+		}
+		for(size_t e=0;e<file.errors.size();e++) { errors += file.errors[e]+"\n"; }
+	}
+	return errors;
+}
+
+// the file defining a section, from its last separator on ("" if none,
+// "duplicate" if more than one)
+static string findSection(ConfigurationDirectory &directory,const char *section)
+{
+	bool        duplicate;
+	const char *path = directory.findSection(section,duplicate);
+	if(duplicate) { return "duplicate"; }
+	if(path == 0) { return ""; }
+	const char *name = strrchr(path,'\\');
+	return (name != 0) ? name : path;
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testConfigurationDirectory)
+{
+	ScratchDirectory directory(TEST_DIRECTORY);
+	CHECK(directory.created);
+	ScratchFile      a(TEST_DIRECTORY "\\a.cfg");
+	ScratchFile      b(TEST_DIRECTORY "\\b.cfg");
+	ScratchFile      c(TEST_DIRECTORY "\\c.xml");
+	ScratchFile      five(TEST_DIRECTORY "\\five.xml");
+	ScratchFile      snapshot(TEST_DIRECTORY "\\a.cfg.lsc");
+	CHECK(writeFile(a,"debug=0\n[one]\nstartup=one.exe\n[two]\nstartup=two.exe\n"));
+	CHECK(writeFile(b,"[three]\nstartup=three.exe\n"));
+	CHECK(writeFile(c,TEST_XML_SERVICE));
+	CHECK(writeFile(five,TEST_XML_UNNAMED));
+	CHECK(writeFile(snapshot,"not a control file\n[six]\n"));
+
+	// every section is found in its file (an unnamed XML service is named
+	// after its file, and snapshots are not configuration files)
+	ConfigurationDirectory configurationDirectory;
+	CHECK(configurationDirectory.load((char*)directory.path.c_str()));
+	CHECK(configurationDirectory.getNumberOfFiles() == 4);
+	CHECK(findSection(configurationDirectory,"one") == "\\a.cfg");
+	CHECK(findSection(configurationDirectory,"two") == "\\a.cfg");
+	CHECK(findSection(configurationDirectory,"three") == "\\b.cfg");
+	CHECK(findSection(configurationDirectory,"four") == "\\c.xml");
+	CHECK(findSection(configurationDirectory,"five") == "\\five.xml");
+	CHECK(findSection(configurationDirectory,"six") == "");
+	CHECK(getErrors(configurationDirectory,"a.cfg").empty());
+}
+
+TEST_CASE(testDuplicateSections)
+{
+	ScratchDirectory directory(TEST_DIRECTORY);
+	CHECK(directory.created);
+	ScratchFile      a(TEST_DIRECTORY "\\a.cfg");
+	ScratchFile      b(TEST_DIRECTORY "\\b.cfg");
+	ScratchFile      c(TEST_DIRECTORY "\\c.cfg");
+	ScratchFile      d(TEST_DIRECTORY "\\d.xml");
+	CHECK(writeFile(a,"[one]\nstartup=one.exe\n[two]\nstartup=two.exe\n[four]\nstartup=four.exe\n"));
+	CHECK(writeFile(b,"[two]\nstartup=other.exe\n[three]\nstartup=three.exe\n[three]\nwait_time=5\n"));
+	CHECK(writeFile(c,"[two]\nstartup=another.exe\n"));
+	CHECK(writeFile(d,TEST_XML_SERVICE));
+
+	// a section defined again in a later file (in name order) is an error
+	// in that file, naming the first file, and is found in neither
+	ConfigurationDirectory configurationDirectory;
+	CHECK(!configurationDirectory.load((char*)directory.path.c_str()));
+	string bErrors = getErrors(configurationDirectory,"b.cfg");
+	string cErrors = getErrors(configurationDirectory,"c.cfg");
+	string dErrors = getErrors(configurationDirectory,"d.xml");
+	CHECK(getErrors(configurationDirectory,"a.cfg").empty());
+	CHECK(bErrors == string(b.getPath())+": [two] is already defined in "+a.getPath()+"\n");
+	CHECK(cErrors == string(c.getPath())+": [two] is already defined in "+a.getPath()+"\n");
+	CHECK(dErrors == string(d.getPath())+": [four] is already defined in "+a.getPath()+"\n");
+	CHECK(findSection(configurationDirectory,"two") == "duplicate");
+	CHECK(findSection(configurationDirectory,"four") == "duplicate");
+
+	// the other sections are still found (a section repeated within one file
+	// is not a duplicate)
+	CHECK(findSection(configurationDirectory,"one") == "\\a.cfg");
+	CHECK(findSection(configurationDirectory,"three") == "\\b.cfg");
+
+	// loaded again without the later files, there is no error
+	remove(b.getPath());
+	remove(c.getPath());
+	remove(d.getPath());
+	CHECK(configurationDirectory.load((char*)directory.path.c_str()));
+	CHECK(findSection(configurationDirectory,"two") == "\\a.cfg");
+	CHECK(findSection(configurationDirectory,"four") == "\\a.cfg");
+
+	// as is a single file
+	CHECK(configurationDirectory.load((char*)a.getPath()));
+	CHECK(configurationDirectory.getNumberOfFiles() == 1);
+	CHECK(findSection(configurationDirectory,"one") == "\\a.cfg");
+}
@@ -0,0 +1,117 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <thread>
+#include <vector>
+
+// class headers
+#include "Test.h"
+#include "ControlQueue.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int TEST_PRODUCERS        = 4;
+const int COMMANDS_PER_PRODUCER = 20000;
+
+// longest wait for the producers to post everything
+const double TEST_TIMEOUT_MS = 20000.0;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// post COMMANDS_PER_PRODUCER custom commands, whose codes are the producer
+// number and a sequence number
+static void produce(ControlQueue *controlQueue,int producer)
+{
+	for(int i=0;i<COMMANDS_PER_PRODUCER;i++)
+	{
+		while(!controlQueue->post(ControlCommand::CONTROL_CUSTOM,(unsigned long)(producer*COMMANDS_PER_PRODUCER+i))) {}
+	}
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testControlQueueOrder)
+{
+	ControlQueue   controlQueue;
+	ControlCommand command;
+	CHECK(!controlQueue.take(command));
+
+	// commands are taken in the order they were posted
+	CHECK(controlQueue.post(ControlCommand::CONTROL_PAUSE));
+	CHECK(controlQueue.post(ControlCommand::CONTROL_CUSTOM,200));
+	CHECK(controlQueue.post(ControlCommand::CONTROL_CONTINUE));
+#if defined(_WIN32)
+	CHECK(WaitForSingleObject(controlQueue.getEvent(),0) == WAIT_OBJECT_0);
+#endif
+	CHECK(controlQueue.take(command)&&(command.type == ControlCommand::CONTROL_PAUSE));
+	CHECK(controlQueue.take(command)&&(command.type == ControlCommand::CONTROL_CUSTOM)&&(command.code == 200));
+
+	// including those posted after the consumer took the list, which come
+	// after the rest of it
+	CHECK(controlQueue.post(ControlCommand::CONTROL_RESTART));
+	CHECK(controlQueue.post(ControlCommand::CONTROL_STOP));
+	CHECK(controlQueue.take(command)&&(command.type == ControlCommand::CONTROL_CONTINUE));
+	CHECK(controlQueue.take(command)&&(command.type == ControlCommand::CONTROL_RESTART));
+	CHECK(controlQueue.take(command)&&(command.type == ControlCommand::CONTROL_STOP));
+	CHECK(!controlQueue.take(command));
+
+	// commands left in the queue are freed with it
+	CHECK(controlQueue.post(ControlCommand::CONTROL_RELOAD));
+}
+
+TEST_CASE(testControlQueueProducers)
+{
+	// each producer's commands are taken in the order it posted them, and
+	// none is lost, while the consumer takes as they are posted
+	ControlQueue   controlQueue;
+	vector<thread> producers;
+	for(int p=0;p<TEST_PRODUCERS;p++) { producers.push_back(thread(produce,&controlQueue,p)); }
+
+	int  next[TEST_PRODUCERS] = {};
+	int  taken                = 0;
+	bool ordered              = true;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	while((taken < TEST_PRODUCERS*COMMANDS_PER_PRODUCER)&&(elapsedMs(start) < TEST_TIMEOUT_MS))
+	{
+		ControlCommand command;
+		if(!controlQueue.take(command)) { this_thread::yield(); continue; }
+		int producer = (int)(command.code/COMMANDS_PER_PRODUCER);
+		int sequence = (int)(command.code%COMMANDS_PER_PRODUCER);
+		ordered = ordered&&(command.type == ControlCommand::CONTROL_CUSTOM)&&
+					(producer < TEST_PRODUCERS)&&(sequence == next[producer]);
+		if(producer < TEST_PRODUCERS) { next[producer] = sequence+1; }
+		taken++;
+	}
+	for(size_t p=0;p<producers.size();p++) { producers[p].join(); }
+
+	CHECK(ordered);
+	CHECK(taken == TEST_PRODUCERS*COMMANDS_PER_PRODUCER);
+	ControlCommand command;
+	CHECK(!controlQueue.take(command));
+}
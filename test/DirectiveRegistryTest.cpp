@@ -0,0 +1,136 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <string.h>
+#include <string>
+
+// class headers
+#include "Test.h"
+#include "DirectiveRegistry.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+constexpr const char *TEST_CHOICES[] = { "kill", "command", "winmessage", 0 };
+
+// a table in no particular order, with names which share prefixes (the
+// handlers are never called)
+constexpr DirectiveDefinition testDirectives [] =
+{
+	{ "wait_time",			DT_INTEGER,		0,				0	},
+	{ "startup_dir",		DT_DIRECTORY,	0,				0	},
+	{ "auto_restart",		DT_BOOLEAN,		0,				0	},
+	{ "env",				DT_ASSIGNMENT,	0,				0	},
+	{ "output",				DT_PATH,		0,				0	},
+	{ "shutdown",			DT_STRING,		0,				0	},
+	{ "shutdown_method",	DT_ENUM,		TEST_CHOICES,	0	},
+	{ "wait",				DT_STRING,		0,				0	}
+};
+const int TEST_DIRECTIVE_COUNT = sizeof(testDirectives)/sizeof(DirectiveDefinition);
+static_assert(directiveNamesUnique(testDirectives),"test directive names must be unique");
+static_assert(directiveIndex(testDirectives,"env") == 3,"env is the fourth test directive");
+static_assert(directiveIndex(testDirectives,"envelope") == -1,"envelope is not a test directive");
+
+constexpr DirectiveSlots<TEST_DIRECTIVE_COUNT> testSlots = buildDirectiveSlots(testDirectives);
+static_assert(testSlots.seed != 0,"no perfect hash found for the test directives");
+
+// the same name twice
+constexpr DirectiveDefinition duplicateDirectives [] =
+{
+	{ "wait",				DT_STRING,		0,				0	},
+	{ "output",				DT_PATH,		0,				0	},
+	{ "wait",				DT_INTEGER,		0,				0	}
+};
+static_assert(!directiveNamesUnique(duplicateDirectives),"a repeated name is found");
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// check a value of the named test directive (on a copy, as values may be
+// modified)
+static const char *checkValue(const char *name,const char *value,bool checkPaths)
+{
+	char copy[MAX_PATH+16];
+	strncpy(copy,value,sizeof(copy)-1);
+	copy[sizeof(copy)-1] = '\0';
+	return checkDirectiveValue(testDirectives[findDirective(testDirectives,testSlots,name)],copy,checkPaths);
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testDirectiveLookup)
+{
+	// every directive is found at its own index
+	for(int i=0;i<TEST_DIRECTIVE_COUNT;i++)
+	{
+		CHECK(findDirective(testDirectives,testSlots,testDirectives[i].name) == i);
+	}
+
+	// names which are not directives are not found, however close they are
+	const char *unknown[] = { "", "wai", "waits", "wait_tim", "Wait", "shutdown_", "env ", "startup_dir2" };
+	for(size_t i=0;i<sizeof(unknown)/sizeof(unknown[0]);i++)
+	{
+		CHECK(findDirective(testDirectives,testSlots,unknown[i]) == -1);
+	}
+}
+
+TEST_CASE(testDirectiveValues)
+{
+	// an empty path or directory is allowed, as it always has been (it
+	// leaves the default), even when directories are checked
+	CHECK(checkValue("output","",false) == 0);
+	CHECK(checkValue("startup_dir","",false) == 0);
+	CHECK(checkValue("startup_dir","",true) == 0);
+
+	// a path must fit in MAX_PATH
+	string longPath(MAX_PATH,'a');
+	CHECK(checkValue("output",longPath.c_str(),false) != 0);
+	CHECK(checkValue("output",longPath.substr(1).c_str(),false) == 0);
+
+	// a directory is only looked for when asked, and not if it has
+	// substitutions
+	CHECK(checkValue("startup_dir","c:\\no such directory",false) == 0);
+	CHECK(checkValue("startup_dir","c:\\no such directory",true) != 0);
+	CHECK(checkValue("startup_dir","%SYBASE%\\no such directory",true) == 0);
+	CHECK(checkValue("startup_dir",".",true) == 0);
+
+	CHECK(checkValue("wait_time","30",false) == 0);
+	CHECK(checkValue("wait_time","30s",false) != 0);
+	CHECK(checkValue("wait_time","",false) != 0);
+
+	CHECK(checkValue("shutdown_method","command",false) == 0);
+	CHECK(checkValue("shutdown_method","Command",false) != 0);
+	CHECK(checkValue("shutdown_method","",false) != 0);
+
+	CHECK(checkValue("env","NAME=value",false) == 0);
+	CHECK(checkValue("env","NAME=",false) == 0);
+	CHECK(checkValue("env","NAME",false) != 0);
+	CHECK(checkValue("env","=value",false) != 0);
+
+	CHECK(checkValue("shutdown","",false) == 0);
+}
@@ -0,0 +1,363 @@
+
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <thread>
+
+// support headers
+#include <logger.h>
+
+// class headers
+#include "FakeServiceControlBackend.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace std;
+
+// ============================================================================
+//
+// PUBLIC MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::addScriptedRequest
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : add a step to the script run by runDispatcher
+//
+// ARGUMENTS       : state   IN state which triggers the request
+//                   request IN request to send
+//                   delayMs IN delay after the state is reported
+//                   code    IN request code (SCR_CUSTOM)
+//
+// ============================================================================
+void FakeServiceControlBackend::addScriptedRequest
+(
+	SERVICE_CONTROL_STATES   state,
+	SERVICE_CONTROL_REQUESTS request,
+	unsigned long            delayMs,
+	unsigned long            code
+)
+{
+	lock_guard<mutex> lock(_lock);
+	ScriptedRequest   step = { state,request,delayMs,code };
+	_script.push_back(step);
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::sendRequest
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : send a request to the service's control handler
+//
+// ARGUMENTS       : request IN request
+//                   code    IN request code (SCR_CUSTOM)
+//
+// RETURNS         : false if the service has not registered a handler
+//
+// ============================================================================
+bool FakeServiceControlBackend::sendRequest
+(
+	SERVICE_CONTROL_REQUESTS request,
+	unsigned long            code
+)
+{
+	CONTROL_HANDLER_FUNCTION *controlHandler;
+	{
+		lock_guard<mutex> lock(_lock);
+		controlHandler = _controlHandler;
+	}
+
+	if(controlHandler == 0)
+	{
+		LOGGER_LOG_ERROR1("FakeServiceControlBackend: no control handler for request %d",request)
+		return false;
+	}
+
+	LOGGER_LOG_DEBUG1("FakeServiceControlBackend: sending request %d",request)
+	(*controlHandler)(request,code);
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::waitForState
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : wait until the service reports a state
+//
+// ARGUMENTS       : state     IN state
+//                   timeoutMs IN longest wait
+//
+// RETURNS         : false if timed out
+//
+// ============================================================================
+bool FakeServiceControlBackend::waitForState
+(
+	SERVICE_CONTROL_STATES state,
+	unsigned long          timeoutMs
+)
+{
+	unique_lock<mutex> lock(_lock);
+	return _changed.wait_for(lock,chrono::milliseconds(timeoutMs),[&] { return hasReported(state); });
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::waitForDispatcher
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : wait until runDispatcher has returned, so that the
+//                   service has finished with this controller
+//
+// ARGUMENTS       : timeoutMs IN longest wait
+//
+// RETURNS         : false if timed out
+//
+// ============================================================================
+bool FakeServiceControlBackend::waitForDispatcher
+(
+	unsigned long timeoutMs
+)
+{
+	unique_lock<mutex> lock(_lock);
+	return _changed.wait_for(lock,chrono::milliseconds(timeoutMs),[&] { return _dispatcherReturned; });
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::getTransitions
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : status reports so far, oldest first
+//
+// ============================================================================
+vector<FakeServiceControlBackend::Transition> FakeServiceControlBackend::getTransitions() const
+{
+	lock_guard<mutex> lock(_lock);
+	return _transitions;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::runDispatcher
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : run the service on this thread, and the script on another
+//
+// ARGUMENTS       : svcName     IN service name
+//                   serviceMain IN service entry point
+//
+// RETURNS         : false if not running as a service
+//
+// ============================================================================
+bool FakeServiceControlBackend::runDispatcher
+(
+	const char            *svcName,
+	SERVICE_MAIN_FUNCTION *serviceMain
+)
+{
+	LOGGER_LOG_DEBUG1("FakeServiceControlBackend::runDispatcher(%s)",svcName)
+
+	if(!_runAsService) { return false; }
+
+	{
+		lock_guard<mutex> lock(_lock);
+		_started            = chrono::steady_clock::now();
+		_dispatcherDone     = false;
+		_dispatcherReturned = false;
+		_transitions.clear();
+	}
+
+	thread script(&FakeServiceControlBackend::runScript,this);
+	(*serviceMain)();
+
+	// stop the script if it is still waiting for a state
+	{
+		lock_guard<mutex> lock(_lock);
+		_dispatcherDone = true;
+	}
+	_changed.notify_all();
+	script.join();
+
+	// (notified with the lock held, as the waiter may destroy this at once)
+	lock_guard<mutex> lock(_lock);
+	_dispatcherReturned = true;
+	_changed.notify_all();
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::registerControlHandler
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : register the handler for requests
+//
+// ARGUMENTS       : svcName        IN service name
+//                   controlHandler IN handler
+//
+// RETURNS         : true
+//
+// ============================================================================
+bool FakeServiceControlBackend::registerControlHandler
+(
+	const char               *svcName,
+	CONTROL_HANDLER_FUNCTION *controlHandler
+)
+{
+	LOGGER_LOG_DEBUG1("FakeServiceControlBackend::registerControlHandler(%s)",svcName)
+
+	lock_guard<mutex> lock(_lock);
+	_controlHandler = controlHandler;
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::reportStatus
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : record a status report
+//
+// ARGUMENTS       : state      IN state
+//                   checkPoint IN checkpoint
+//                   waitHint   IN wait hint (ms)
+//
+// RETURNS         : true
+//
+// ============================================================================
+bool FakeServiceControlBackend::reportStatus
+(
+	SERVICE_CONTROL_STATES state,
+	unsigned long          checkPoint,
+	unsigned long          waitHint
+)
+{
+	{
+		lock_guard<mutex> lock(_lock);
+		Transition transition;
+		transition.state      = state;
+		transition.checkPoint = checkPoint;
+		transition.waitHint   = waitHint;
+		transition.elapsedMs  = chrono::duration<double,milli>(chrono::steady_clock::now()-_started).count();
+		_transitions.push_back(transition);
+	}
+	_changed.notify_all();
+	return true;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::getName
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : name of backend
+//
+// ============================================================================
+const char *FakeServiceControlBackend::getName() const { return "fake"; }
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::FakeServiceControlBackend
+//                   FakeServiceControlBackend::~FakeServiceControlBackend
+//
+// ACCESS SPECIFIER: public
+//
+// DESCRIPTION     : constructor / destructor
+//
+// ARGUMENTS       : runAsService IN if false, runDispatcher fails
+//
+// ============================================================================
+FakeServiceControlBackend::FakeServiceControlBackend
+(
+	bool runAsService
+)
+{
+	_runAsService   = runAsService;
+	_controlHandler = 0;
+	_started            = chrono::steady_clock::now();
+	_dispatcherDone     = false;
+	_dispatcherReturned = false;
+}
+
+FakeServiceControlBackend::~FakeServiceControlBackend() {}
+
+// ============================================================================
+//
+// PRIVATE MEMBER FUNCTIONS
+//
+// ============================================================================
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::hasReported
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : has a state been reported? (the caller holds _lock)
+//
+// ============================================================================
+bool FakeServiceControlBackend::hasReported
+(
+	SERVICE_CONTROL_STATES state
+) const
+{
+	for(size_t i=0;i<_transitions.size();i++)
+	{
+		if(_transitions[i].state == state) { return true; }
+	}
+	return false;
+}
+
+// ============================================================================
+//
+// MEMBER FUNCTION : FakeServiceControlBackend::runScript
+//
+// ACCESS SPECIFIER: private
+//
+// DESCRIPTION     : send the scripted requests (runs on its own thread, as
+//                   the SCM calls control handlers on its own thread)
+//
+// ============================================================================
+void FakeServiceControlBackend::runScript()
+{
+	for(size_t step=0;;step++)
+	{
+		ScriptedRequest scripted;
+		{
+			unique_lock<mutex> lock(_lock);
+			if(step >= _script.size()) { return; }
+			scripted = _script[step];
+
+			_changed.wait(lock,[&] { return _dispatcherDone||hasReported(scripted.state); });
+			if(_dispatcherDone) { return; }
+		}
+
+		if(scripted.delayMs > 0) { this_thread::sleep_for(chrono::milliseconds(scripted.delayMs)); }
+		sendRequest(scripted.request,scripted.code);
+	}
+}
+
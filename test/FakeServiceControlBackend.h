@@ -0,0 +1,108 @@
+
+// prevent multiple inclusion
+
+#if !defined(__FAKE_SERVICE_CONTROL_BACKEND_H__)
+#define __FAKE_SERVICE_CONTROL_BACKEND_H__
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// standard headers
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+// interface
+#include "ServiceControlBackend.h"
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+// all the DLL classes are defined within the LiteSrv namespace
+namespace LiteSrv {
+
+// ============================================================================
+//
+// FakeServiceControlBackend class
+//
+// An in-process service controller for the tests and benchmarks. It runs
+// the service on the dispatcher thread, as the SCM does, sends requests as
+// scripted (or on demand), and records every status report with the time
+// since the dispatcher started. Only standard C++ is used, so that the
+// service lifecycle can be exercised without Windows.
+//
+// ============================================================================
+class FakeServiceControlBackend : public ServiceControlBackend
+{
+public:
+	// a status report
+	struct Transition
+	{
+		SERVICE_CONTROL_STATES state;
+		unsigned long          checkPoint;
+		unsigned long          waitHint;
+		double                 elapsedMs;	// since runDispatcher was called
+	};
+
+	// once the service has reported state, wait delayMs and then send request
+	// (steps are taken in the order they are added)
+	void addScriptedRequest(SERVICE_CONTROL_STATES state,SERVICE_CONTROL_REQUESTS request,
+							unsigned long delayMs = 0,unsigned long code = 0);
+
+	// send a request now, on the calling thread (false if no handler yet)
+	bool sendRequest(SERVICE_CONTROL_REQUESTS request,unsigned long code = 0);
+
+	// wait until state has been reported (false if timed out)
+	bool waitForState(SERVICE_CONTROL_STATES state,unsigned long timeoutMs);
+
+	// wait until runDispatcher has returned (false if timed out)
+	bool waitForDispatcher(unsigned long timeoutMs);
+
+	// all status reports so far
+	std::vector<Transition> getTransitions() const;
+
+	// ServiceControlBackend
+	bool runDispatcher(const char *svcName,SERVICE_MAIN_FUNCTION *serviceMain);
+	bool registerControlHandler(const char *svcName,CONTROL_HANDLER_FUNCTION *controlHandler);
+	bool reportStatus(SERVICE_CONTROL_STATES state,unsigned long checkPoint,unsigned long waitHint);
+	const char *getName() const;
+
+	// constructor and destructor
+	// if runAsService is false, runDispatcher fails (as if started from a console)
+	FakeServiceControlBackend(bool runAsService = true);
+	virtual ~FakeServiceControlBackend();
+
+private:
+	struct ScriptedRequest
+	{
+		SERVICE_CONTROL_STATES   state;
+		SERVICE_CONTROL_REQUESTS request;
+		unsigned long            delayMs;
+		unsigned long            code;
+	};
+
+	// service functions
+	bool hasReported(SERVICE_CONTROL_STATES state) const;
+	void runScript();
+
+	// private variables
+	bool                                  _runAsService;
+	CONTROL_HANDLER_FUNCTION             *_controlHandler;
+	std::chrono::steady_clock::time_point _started;
+	std::vector<Transition>               _transitions;
+	std::vector<ScriptedRequest>          _script;
+	bool                                  _dispatcherDone;		// serviceMain has returned
+	bool                                  _dispatcherReturned;	// runDispatcher has returned
+	mutable std::mutex                    _lock;		// guards all of the above
+	std::condition_variable               _changed;		// signalled on each report
+};
+
+} // namespace LiteSrv
+
+#endif // !defined(__FAKE_SERVICE_CONTROL_BACKEND_H__)
+
@@ -0,0 +1,213 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <winsock2.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+// class headers
+#include "Test.h"
+#include "HealthProbes.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// probe timeouts (seconds): a refused connection must fail well within the
+// long one, and a silent listener must time out at the short one
+const int LONG_PROBE_TIMEOUT  = 10;
+const int SHORT_PROBE_TIMEOUT = 1;
+
+// how late a timed out probe may be reported
+const double TIMEOUT_SLACK_MS = 2000.0;
+
+const int TEST_REQUEST_SIZE = 1024;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// listen on an ephemeral port of the loopback address
+static SOCKET openListener(unsigned short &port,bool listening)
+{
+	static bool winsockStarted = false;
+	if(!winsockStarted)
+	{
+		WSADATA wsaData;
+		if(WSAStartup(MAKEWORD(2,2),&wsaData) != 0) { return INVALID_SOCKET; }
+		winsockStarted = true;
+	}
+
+	SOCKET s = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+	if(s == INVALID_SOCKET) { return INVALID_SOCKET; }
+
+	sockaddr_in address;
+	int         addressLength = sizeof(address);
+	memset(&address,0,sizeof(address));
+	address.sin_family      = AF_INET;
+	address.sin_port        = 0;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if((bind(s,(sockaddr*)&address,sizeof(address)) != 0)||
+	   (getsockname(s,(sockaddr*)&address,&addressLength) != 0)||
+	   (listening&&(listen(s,1) != 0)))
+	{
+		closesocket(s);
+		return INVALID_SOCKET;
+	}
+	port = ntohs(address.sin_port);
+	return s;
+}
+
+// accept one connection, read the request as far as the blank line after
+// its headers, and answer it
+static void serveResponse(SOCKET listenSocket,const char *response,string *request)
+{
+	SOCKET s = accept(listenSocket,NULL,NULL);
+	if(s == INVALID_SOCKET) { return; }
+
+	char text[TEST_REQUEST_SIZE];
+	int  length = 0;
+	text[0] = '\0';
+	while((length < (int)sizeof(text)-1)&&(strstr(text,"\r\n\r\n") == 0))
+	{
+		int received = recv(s,text+length,(int)sizeof(text)-1-length,0);
+		if(received <= 0) { break; }
+		length += received;
+		text[length] = '\0';
+	}
+	*request = text;
+
+	send(s,response,(int)strlen(response),0);
+	closesocket(s);
+}
+
+// run a readiness probe once, the way the supervision loop does
+// returns whether it passed
+static bool probeOnce(const char *spec,int timeout,double &elapsed)
+{
+	HealthProbes probes;
+	probes.setTimeout(timeout);
+	probes.setFailureThreshold(1);
+	probes.addProbe(HealthProbes::PROBE_READINESS,spec);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	probes.start();
+	probes.run();
+	HANDLE handles[MAX_HEALTH_PROBES];
+	int    count;
+	while((count = probes.getWaitHandles(handles,MAX_HEALTH_PROBES)) > 0)
+	{
+		WaitForMultipleObjects(count,handles,FALSE,probes.getWaitTime());
+		probes.run();
+	}
+	elapsed = elapsedMs(start);
+
+	bool ready = probes.isReady();
+	probes.stop();
+	return ready;
+}
+
+// probe a listener which answers with response
+static bool probeHttp(const char *path,const char *response,string &request)
+{
+	unsigned short port;
+	SOCKET listenSocket = openListener(port,true);
+	if(listenSocket == INVALID_SOCKET) { return false; }
+
+	thread server(serveResponse,listenSocket,response,&request);
+	char   spec[TEST_REQUEST_SIZE];
+	double elapsed;
+	sprintf(spec,"http %u%s",port,path);
+	bool passed = probeOnce(spec,LONG_PROBE_TIMEOUT,elapsed);
+
+	closesocket(listenSocket);			// in case nothing connected
+	server.join();
+	return passed;
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testHttpStatusLine)
+{
+	string request;
+
+	// the expected status (200 by default) passes
+	CHECK(probeHttp("/health","HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n",request));
+	CHECK(strncmp(request.c_str(),"GET /health HTTP/1.1\r\n",22) == 0);
+	CHECK(request.find("\r\nConnection: close\r\n") != string::npos);
+	CHECK(probeHttp(" 204","HTTP/1.0 204 No Content\r\n\r\n",request));
+	CHECK(strncmp(request.c_str(),"GET / HTTP/1.1\r\n",16) == 0);
+
+	// any other status fails, as does a response which is not HTTP
+	CHECK(!probeHttp("/health","HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n",request));
+	CHECK(!probeHttp("/health 204","HTTP/1.1 200 OK\r\n\r\n",request));
+	CHECK(!probeHttp("/health","SSH-2.0-OpenSSH\r\n",request));
+
+	// so does a connection closed before the status line is complete
+	CHECK(!probeHttp("/health","HTTP/1.1 20",request));
+}
+
+TEST_CASE(testConnectionRefused)
+{
+	// a port bound but not listened on refuses connections
+	unsigned short port;
+	SOCKET         s = openListener(port,false);
+	CHECK(s != INVALID_SOCKET);
+
+	char   spec[TEST_REQUEST_SIZE];
+	double elapsed;
+	sprintf(spec,"tcp %u",port);
+	bool passed = probeOnce(spec,LONG_PROBE_TIMEOUT,elapsed);
+	sprintf(spec,"http %u/health",port);
+	bool httpPassed = probeOnce(spec,LONG_PROBE_TIMEOUT,elapsed);
+	closesocket(s);
+
+	// failed at the refusal, not at the timeout
+	CHECK(!passed);
+	CHECK(!httpPassed);
+	CHECK(elapsed < LONG_PROBE_TIMEOUT*1000.0-TIMEOUT_SLACK_MS);
+}
+
+TEST_CASE(testProbeTimeout)
+{
+	// the connection is queued by the listener, which never answers it
+	unsigned short port;
+	SOCKET         s = openListener(port,true);
+	CHECK(s != INVALID_SOCKET);
+
+	char   spec[TEST_REQUEST_SIZE];
+	double elapsed;
+	sprintf(spec,"http %u/health",port);
+	bool passed = probeOnce(spec,SHORT_PROBE_TIMEOUT,elapsed);
+	closesocket(s);
+
+	CHECK(!passed);
+	CHECK(elapsed >= SHORT_PROBE_TIMEOUT*1000.0-50.0);
+	CHECK(elapsed < SHORT_PROBE_TIMEOUT*1000.0+TIMEOUT_SLACK_MS);
+}
@@ -0,0 +1,178 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// class headers
+#include "Test.h"
+#include "LoadShedder.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+const int TEST_CPU_THRESHOLD = 80;
+
+// ============================================================================
+//
+// LOCAL CLASSES
+//
+// ============================================================================
+
+// a load shedder under the pressure the test sets (it has no processes to
+// pause: the slots are empty)
+class TestShedder : public LoadShedder
+{
+public:
+	TestShedder() : busy(0), low(false)
+	{
+		for(int i=0;i<MAX_SHED_PROCESSES;i++) { processes[i] = 0; processIds[i] = 0; }
+	}
+
+	bool check(int cpuBusy,bool memoryLow)
+	{
+		busy = cpuBusy;
+		low  = memoryLow;
+		return LoadShedder::check(processes,processIds,MAX_SHED_PROCESSES);
+	}
+
+	int    busy;
+	bool   low;
+	HANDLE processes[MAX_SHED_PROCESSES];
+	DWORD  processIds[MAX_SHED_PROCESSES];
+
+protected:
+	int  getCpuBusy() { return busy; }
+	bool isMemoryLow() { return low; }
+};
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testLoadShedderHysteresis)
+{
+	TestShedder shedder;
+	shedder.setCpuThreshold(TEST_CPU_THRESHOLD);
+	CHECK(shedder.isEnabled());
+	shedder.prepare();
+
+	// below the threshold, nothing happens
+	CHECK(!shedder.check(TEST_CPU_THRESHOLD-1,false));
+	CHECK(!shedder.isPaused());
+
+	// at it, the processes are paused (once)
+	CHECK(shedder.check(TEST_CPU_THRESHOLD,false));
+	CHECK(shedder.isPaused());
+	CHECK(!shedder.check(100,false));
+	CHECK(shedder.isPaused());
+
+	// they stay paused until there has been no pressure for
+	// SHED_RESUME_CHECKS checks in a row
+	for(int i=1;i<SHED_RESUME_CHECKS;i++)
+	{
+		CHECK(!shedder.check(0,false));
+		CHECK(shedder.isPaused());
+	}
+	CHECK(!shedder.check(TEST_CPU_THRESHOLD+5,false));
+	for(int i=1;i<SHED_RESUME_CHECKS;i++)
+	{
+		CHECK(!shedder.check(TEST_CPU_THRESHOLD-1,false));
+		CHECK(shedder.isPaused());
+	}
+	CHECK(shedder.check(TEST_CPU_THRESHOLD-1,false));
+	CHECK(!shedder.isPaused());
+
+	// and are paused again at the next pressure
+	CHECK(!shedder.check(0,false));
+	CHECK(shedder.check(TEST_CPU_THRESHOLD,false));
+	CHECK(shedder.isPaused());
+}
+
+TEST_CASE(testLoadShedderMemory)
+{
+	TestShedder shedder;
+	shedder.setMemoryPressure(true);
+	CHECK(shedder.isEnabled());
+	shedder.prepare();
+
+	// the notification is waited on while the processes run, and not
+	// while they are paused (it stays signalled while memory is low)
+	CHECK(shedder.getEvent() != NULL);
+
+	// the CPU is not watched
+	CHECK(!shedder.check(100,false));
+	CHECK(!shedder.isPaused());
+
+	CHECK(shedder.check(0,true));
+	CHECK(shedder.isPaused());
+	CHECK(shedder.getEvent() == NULL);
+	CHECK(!shedder.isDue());
+
+	for(int i=1;i<SHED_RESUME_CHECKS;i++) { CHECK(!shedder.check(0,false)); }
+	CHECK(shedder.check(0,false));
+	CHECK(!shedder.isPaused());
+	CHECK(shedder.getEvent() != NULL);
+}
+
+TEST_CASE(testLoadShedderDisabled)
+{
+	// with no pressure to yield to, nothing is ever paused
+	TestShedder shedder;
+	CHECK(!shedder.isEnabled());
+	shedder.prepare();
+	CHECK(shedder.getEvent() == NULL);
+	CHECK(!shedder.check(100,true));
+	CHECK(!shedder.isPaused());
+
+	// thresholds are percentages
+	shedder.setCpuThreshold(150);
+	CHECK(shedder.getCpuThreshold() == 100);
+	shedder.setCpuThreshold(-1);
+	CHECK(shedder.getCpuThreshold() == 0);
+}
+
+TEST_CASE(testLoadShedderHold)
+{
+	// held at the SCM's request, the processes stay paused whatever the
+	// pressure, until they are released
+	TestShedder shedder;
+	shedder.prepare();
+	CHECK(shedder.hold(shedder.processes,shedder.processIds,MAX_SHED_PROCESSES));
+	CHECK(shedder.isHeld()&&shedder.isPaused());
+	CHECK(!shedder.hold(shedder.processes,shedder.processIds,MAX_SHED_PROCESSES));
+	for(int i=0;i<2*SHED_RESUME_CHECKS;i++) { CHECK(!shedder.check(0,false)); }
+	CHECK(shedder.isPaused());
+	CHECK(shedder.release(shedder.processes,shedder.processIds,MAX_SHED_PROCESSES));
+	CHECK(!shedder.isHeld()&&!shedder.isPaused());
+	CHECK(!shedder.release(shedder.processes,shedder.processIds,MAX_SHED_PROCESSES));
+
+	// pressure which is still there when they are released pauses them
+	// again at the next check
+	shedder.setCpuThreshold(TEST_CPU_THRESHOLD);
+	CHECK(shedder.check(100,false));
+	CHECK(!shedder.hold(shedder.processes,shedder.processIds,MAX_SHED_PROCESSES));
+	CHECK(shedder.isHeld());
+	CHECK(shedder.release(shedder.processes,shedder.processIds,MAX_SHED_PROCESSES));
+	CHECK(!shedder.isPaused());
+	CHECK(shedder.check(100,false));
+	CHECK(shedder.isPaused());
+}
@@ -0,0 +1,303 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <winsock2.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+// class headers
+#include "Test.h"
+#include "ServiceMetrics.h"
+#include "MetricsServer.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// longest wait for a scrape
+const double TEST_TIMEOUT_MS = 5000.0;
+
+const char * const TEST_STATES[] = { "stopped", "starting", "running" };
+const int          TEST_STATE_COUNT = sizeof(TEST_STATES)/sizeof(TEST_STATES[0]);
+const int          TEST_STATE       = 2;
+
+// a service name which has to be escaped as a label value, and how
+const char TEST_SERVICE[] = "my \"service\"\\1";
+const char TEST_LABEL[]   = "service=\"my \\\"service\\\"\\\\1\"";
+
+const int TEST_BUFFER_SIZE = 1024;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// a port of the loopback address which nothing is listening on
+static unsigned short getFreePort()
+{
+	static bool winsockStarted = false;
+	if(!winsockStarted)
+	{
+		WSADATA wsaData;
+		if(WSAStartup(MAKEWORD(2,2),&wsaData) != 0) { return 0; }
+		winsockStarted = true;
+	}
+
+	SOCKET s = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+	if(s == INVALID_SOCKET) { return 0; }
+	sockaddr_in address;
+	int         addressLength = sizeof(address);
+	memset(&address,0,sizeof(address));
+	address.sin_family      = AF_INET;
+	address.sin_port        = 0;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	unsigned short port = 0;
+	if((bind(s,(sockaddr*)&address,sizeof(address)) == 0)&&
+	   (getsockname(s,(sockaddr*)&address,&addressLength) == 0))
+	{
+		port = ntohs(address.sin_port);
+	}
+	closesocket(s);
+	return port;
+}
+
+// send a request, and read the response until the server closes the
+// connection
+static void sendRequest(unsigned short port,const char *request,string *response,atomic<bool> *done)
+{
+	SOCKET s = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+	sockaddr_in address;
+	memset(&address,0,sizeof(address));
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if((s != INVALID_SOCKET)&&(connect(s,(sockaddr*)&address,sizeof(address)) == 0))
+	{
+		send(s,request,(int)strlen(request),0);
+		char buffer[TEST_BUFFER_SIZE];
+		int  received;
+		while((received = recv(s,buffer,sizeof(buffer),0)) > 0) { response->append(buffer,received); }
+	}
+	if(s != INVALID_SOCKET) { closesocket(s); }
+	*done = true;
+}
+
+// scrape the server, serving it the way the supervision loop does
+static string scrape(MetricsServer &server,unsigned short port,const char *request,
+						const ServiceMetrics &metrics,const HANDLE processes[],int count)
+{
+	string       response;
+	atomic<bool> done(false);
+	thread       client(sendRequest,port,request,&response,&done);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	while(!done&&(elapsedMs(start) < TEST_TIMEOUT_MS))
+	{
+		DWORD waitTime = server.getWaitTime();
+		WaitForSingleObject(server.getEvent(),(waitTime < 100) ? waitTime : 100);
+		server.serve(metrics,TEST_SERVICE,TEST_STATES,TEST_STATE_COUNT,TEST_STATE,processes,count);
+	}
+	client.join();
+	return response;
+}
+
+// check that text is in the Prometheus text format: every family has its
+// HELP and TYPE, every sample belongs to the family before it, has well
+// formed labels and a number, and each histogram's buckets are cumulative
+// and end with +Inf, which is its count
+// returns 0 if it is, otherwise what is wrong with it
+static const char *checkExposition(const string &text)
+{
+	if(text.empty()||(text[text.length()-1] != '\n')) { return "not ended by a new line"; }
+
+	string family,type;
+	double lastBucket = -1.0;
+	size_t lineStart  = 0;
+	while(lineStart < text.length())
+	{
+		size_t lineEnd = text.find('\n',lineStart);
+		string line    = text.substr(lineStart,lineEnd-lineStart);
+		lineStart = lineEnd+1;
+
+		if(line.compare(0,7,"# HELP ") == 0)
+		{
+			size_t nameEnd = line.find(' ',7);
+			if(nameEnd == string::npos) { return "HELP without text"; }
+			family     = line.substr(7,nameEnd-7);
+			type       = "";
+			lastBucket = -1.0;
+			continue;
+		}
+		if(line.compare(0,7,"# TYPE ") == 0)
+		{
+			if(line.compare(7,family.length()+1,family+" ") != 0) { return "TYPE not after its HELP"; }
+			type = line.substr(7+family.length()+1);
+			if((type != "counter")&&(type != "gauge")&&(type != "histogram")) { return "unknown TYPE"; }
+			continue;
+		}
+		if(line[0] == '#') { return "unknown comment"; }
+		if(type.empty()) { return "sample without a TYPE"; }
+
+		// name
+		size_t nameEnd = line.find('{');
+		if(nameEnd == string::npos) { return "sample without labels"; }
+		string name   = line.substr(0,nameEnd);
+		string suffix = (name.compare(0,family.length(),family) == 0) ? name.substr(family.length()) : "?";
+		if((type == "histogram") ? ((suffix != "_bucket")&&(suffix != "_sum")&&(suffix != "_count")) : !suffix.empty())
+		{
+			return "sample of another family";
+		}
+		if((type == "counter")&&(family.length() < 6)) { return "counter not named _total"; }
+		if((type == "counter")&&(family.compare(family.length()-6,6,"_total") != 0)) { return "counter not named _total"; }
+
+		// labels: name="value", with \\, \" and \n escaped
+		size_t c = nameEnd+1;
+		string le;
+		for(;;)
+		{
+			size_t equals = line.find("=\"",c);
+			if(equals == string::npos) { return "label without a value"; }
+			string labelName = line.substr(c,equals-c);
+			string value;
+			for(c=equals+2;(c < line.length())&&(line[c] != '"');c++)
+			{
+				if(line[c] == '\\')
+				{
+					c++;
+					if((c >= line.length())||((line[c] != '\\')&&(line[c] != '"')&&(line[c] != 'n'))) { return "bad escape"; }
+				}
+				value += line[c];
+			}
+			if(c >= line.length()) { return "unterminated label value"; }
+			if(labelName == "le") { le = value; }
+			c++;
+			if(line[c] == '}') { break; }
+			if(line[c] != ',') { return "labels not separated by a comma"; }
+			c++;
+		}
+		if(line.compare(c,2,"} ") != 0) { return "no space before the value"; }
+
+		// value
+		const char *value = line.c_str()+c+2;
+		char       *end;
+		double      number = strtod(value,&end);
+		if((end == value)||(*end != '\0')) { return "value is not a number"; }
+
+		if(suffix == "_bucket")
+		{
+			if(le.empty()) { return "bucket without le"; }
+			if(number < lastBucket) { return "buckets not cumulative"; }
+			lastBucket = number;
+		}
+		else if(suffix == "_count")
+		{
+			if(number != lastBucket) { return "count is not the +Inf bucket"; }
+		}
+	}
+	return 0;
+}
+
+// the value of a sample (-1 if it is not there)
+static double getSample(const string &text,const string &sample)
+{
+	size_t found = text.find("\n"+sample+" ");
+	return (found == string::npos) ? -1.0 : atof(text.c_str()+found+1+sample.length()+1);
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testMetricsExposition)
+{
+	unsigned short port = getFreePort();
+	CHECK(port != 0);
+	char address[64];
+	sprintf(address,"tcp 127.0.0.1:%u",port);
+	MetricsServer server;
+	server.setAddress(address);
+	server.open();
+
+	// two slots started, one crashed and started again, one ready, and two
+	// stops
+	ServiceMetrics metrics;
+	metrics.processStarted(0,101);
+	metrics.processStarted(1,102);
+	metrics.processExited(101,1,true);
+	metrics.processStarted(0,103);
+	metrics.processReady(1);
+	metrics.processesStopped(120);
+	metrics.processesStopped(3000);
+
+	// this process runs in the first slot, and nothing in the second
+	HANDLE processes[2] = { GetCurrentProcess(), 0 };
+	string response = scrape(server,port,"GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n",metrics,processes,2);
+
+	// the header
+	size_t headerEnd = response.find("\r\n\r\n");
+	CHECK(headerEnd != string::npos);
+	string header = response.substr(0,headerEnd+2);
+	string body   = response.substr(headerEnd+4);
+	CHECK(header.compare(0,17,"HTTP/1.0 200 OK\r\n") == 0);
+	CHECK(header.find("\r\nContent-Type: text/plain; version=0.0.4\r\n") != string::npos);
+	char contentLength[64];
+	sprintf(contentLength,"\r\nContent-Length: %d\r\n",(int)body.length());
+	CHECK(header.find(contentLength) != string::npos);
+
+	// the body
+	const char *error = checkExposition(body);
+	if(error != 0) { printf("  %s\n",error); }
+	CHECK(error == 0);
+	string label(TEST_LABEL);
+	CHECK(getSample(body,"litesrv_process_starts_total{"+label+"}") == 3.0);
+	CHECK(getSample(body,"litesrv_process_restarts_total{"+label+"}") == 1.0);
+	CHECK(getSample(body,"litesrv_process_crashes_total{"+label+"}") == 1.0);
+	CHECK(getSample(body,"litesrv_service_state{"+label+",state=\"stopped\"}") == 0.0);
+	CHECK(getSample(body,"litesrv_service_state{"+label+",state=\"running\"}") == 1.0);
+	CHECK(getSample(body,"litesrv_ready_latency_seconds_count{"+label+"}") == 1.0);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_bucket{"+label+",le=\"0.100\"}") == 0.0);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_bucket{"+label+",le=\"0.250\"}") == 1.0);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_bucket{"+label+",le=\"2.500\"}") == 1.0);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_bucket{"+label+",le=\"5.000\"}") == 2.0);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_bucket{"+label+",le=\"+Inf\"}") == 2.0);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_sum{"+label+"}") == 3.12);
+	CHECK(getSample(body,"litesrv_stop_latency_seconds_count{"+label+"}") == 2.0);
+	CHECK(getSample(body,"litesrv_process_uptime_seconds{"+label+",instance=\"0\"}") >= 0.0);
+	CHECK(getSample(body,"litesrv_process_cpu_seconds_total{"+label+",instance=\"0\"}") >= 0.0);
+	CHECK(getSample(body,"litesrv_process_resident_memory_bytes{"+label+",instance=\"0\"}") > 0.0);
+	CHECK(body.find("instance=\"1\"") == string::npos);
+
+	// / is the metrics too, anything else is not found, and anything but
+	// GET is a bad request
+	response = scrape(server,port,"GET / HTTP/1.0\r\n\r\n",metrics,processes,2);
+	CHECK(response.compare(0,17,"HTTP/1.0 200 OK\r\n") == 0);
+	response = scrape(server,port,"GET /health HTTP/1.1\r\n\r\n",metrics,processes,2);
+	CHECK(response.compare(0,24,"HTTP/1.0 404 Not Found\r\n") == 0);
+	response = scrape(server,port,"POST /metrics HTTP/1.1\r\n\r\n",metrics,processes,2);
+	CHECK(response.compare(0,26,"HTTP/1.0 400 Bad Request\r\n") == 0);
+}
@@ -0,0 +1,119 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+
+// class headers
+#include "Test.h"
+#include "ResourceSampler.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// the most replicas a service may have, each of them sampled
+const int BENCHMARK_PROCESSES = MAXIMUM_WAIT_OBJECTS-1;
+const int BENCHMARK_SAMPLES   = 1000;
+
+// ============================================================================
+//
+// LOCAL FUNCTIONS
+//
+// ============================================================================
+
+// start copies of this program, suspended so that they never run (they are
+// sampled all the same)
+static int startProcesses(HANDLE processes[],DWORD processIds[],int count)
+{
+	char path[MAX_PATH];
+	if(GetModuleFileName(NULL,path,sizeof(path)) == 0) { return 0; }
+
+	int started = 0;
+	for(;started<count;started++)
+	{
+		STARTUPINFO         startupInfo;
+		PROCESS_INFORMATION processInfo;
+		char                command[MAX_PATH+2];
+		memset(&startupInfo,0,sizeof(startupInfo));
+		startupInfo.cb = sizeof(startupInfo);
+		sprintf(command,"\"%s\"",path);
+		if(!CreateProcess(NULL,command,NULL,NULL,FALSE,CREATE_SUSPENDED|CREATE_NO_WINDOW,
+						  NULL,NULL,&startupInfo,&processInfo))
+		{
+			break;
+		}
+		CloseHandle(processInfo.hThread);
+		processes[started]  = processInfo.hProcess;
+		processIds[started] = processInfo.dwProcessId;
+	}
+	return started;
+}
+
+static void stopProcesses(HANDLE processes[],int count)
+{
+	for(int i=0;i<count;i++)
+	{
+		TerminateProcess(processes[i],0);
+		CloseHandle(processes[i]);
+	}
+}
+
+// ============================================================================
+//
+// BENCHMARKS
+//
+// ============================================================================
+
+BENCHMARK(benchmarkResourceSampler)
+{
+	HANDLE processes[BENCHMARK_PROCESSES];
+	DWORD  processIds[BENCHMARK_PROCESSES];
+	int    count = startProcesses(processes,processIds,BENCHMARK_PROCESSES);
+	if(count < BENCHMARK_PROCESSES) { stopProcesses(processes,count); }
+	CHECK(count == BENCHMARK_PROCESSES);
+
+	// the histories are too big for the stack
+	static ResourceSampler sampler;
+
+	// the first sample of each process only sets its baseline
+	sampler.sample(processes,processIds,count);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int i=0;i<BENCHMARK_SAMPLES;i++)
+	{
+		sampler.sample(processes,processIds,count);
+	}
+	double sampleMs = elapsedMs(start)/BENCHMARK_SAMPLES;
+
+	// every process was sampled, and its history has wrapped around
+	ResourceSample history[SAMPLE_HISTORY];
+	bool           sampled = true;
+	for(int i=0;i<count;i++)
+	{
+		sampled = sampled&&(sampler.getProcessId(i) == processIds[i])&&
+					(sampler.getHistory(i,history,SAMPLE_HISTORY) == SAMPLE_HISTORY);
+	}
+	stopProcesses(processes,count);
+	CHECK(sampled);
+
+	printf("  %d processes: sample %.3f ms (%.2f us per process, %.3f%% of a 1 second interval)\n",
+			count,sampleMs,sampleMs*1000.0/count,sampleMs/10.0);
+}
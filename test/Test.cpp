@@ -0,0 +1,144 @@
+
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// class headers
+#include "Test.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrvTest;
+using namespace std;
+
+// ============================================================================
+//
+// LOCAL DATA
+//
+// ============================================================================
+
+struct RegisteredTest
+{
+	const char    *name;
+	TEST_FUNCTION *function;
+	bool           benchmark;
+};
+
+// registered tests, in the order they were registered (a function, so that
+// it exists before the registrars in other files are constructed)
+static vector<RegisteredTest> &getRegisteredTests()
+{
+	static vector<RegisteredTest> registeredTests;
+	return registeredTests;
+}
+
+// failed CHECKs in the test being run
+static int G_failures = 0;
+
+// ============================================================================
+//
+// FUNCTIONS
+//
+// ============================================================================
+
+TestRegistrar::TestRegistrar
+(
+	const char    *name,
+	TEST_FUNCTION *function,
+	bool           benchmark
+)
+{
+	RegisteredTest registered = { name,function,benchmark };
+	getRegisteredTests().push_back(registered);
+}
+
+void LiteSrvTest::checkFailed
+(
+	const char *file,
+	int         line,
+	const char *condition
+)
+{
+	printf("  %s(%d): CHECK(%s) failed\n",file,line,condition);
+	G_failures++;
+}
+
+string LiteSrvTest::getScratchPath
+(
+	const char *name
+)
+{
+	const char *directory = getenv("TEMP");
+	if(directory == 0) { directory = getenv("TMPDIR"); }
+	if(directory == 0) { directory = "."; }
+#if defined(_WIN32)
+	return string(directory)+"\\"+name;
+#else
+	return string(directory)+"/"+name;
+#endif
+}
+
+ScratchFile::~ScratchFile()
+{
+	remove(path.c_str());
+}
+
+// ============================================================================
+//
+// FUNCTION        : main
+//
+// DESCRIPTION     : run the tests
+//
+//                   test                  all the tests
+//                   test -bench           all the tests and benchmarks
+//                   test name...          the named tests or benchmarks
+//
+// RETURNS         : 0 if all passed, 1 otherwise
+//
+// ============================================================================
+int main
+(
+	int   argc,
+	char *argv[]
+)
+{
+	bool benchmarks = (argc == 2)&&(strcmp(argv[1],"-bench") == 0);
+	bool named      = (argc > 1)&&!benchmarks;
+
+	int run    = 0;
+	int failed = 0;
+	vector<RegisteredTest> &registeredTests = getRegisteredTests();
+	for(size_t i=0;i<registeredTests.size();i++)
+	{
+		const RegisteredTest &test = registeredTests[i];
+		bool selected = !named&&(benchmarks||!test.benchmark);
+		for(int arg=1;named&&(arg<argc)&&!selected;arg++)
+		{
+			selected = (strcmp(argv[arg],test.name) == 0);
+		}
+		if(!selected) { continue; }
+
+		printf("%s %s\n",test.benchmark ? "BENCHMARK" : "TEST",test.name);
+		fflush(stdout);
+		G_failures = 0;
+		(*test.function)();
+		run++;
+		if(G_failures > 0) { failed++; printf("  FAILED\n"); }
+	}
+
+	printf("%d run, %d failed\n",run,failed);
+	return (failed == 0)&&(run > 0) ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+
+// prevent multiple inclusion
+
+#if !defined(__TEST_H__)
+#define __TEST_H__
+
+// ============================================================================
+//
+// LiteSrv tests and benchmarks
+//
+// Each test or benchmark is a function registered with TEST_CASE or
+// BENCHMARK; the test program runs every test, and the benchmarks too if
+// asked to (see Test.cpp). A test fails at its first CHECK which does not
+// hold. Benchmarks print what they measured, and CHECK that the work they
+// timed was done right.
+//
+// ============================================================================
+
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+// standard headers
+#include <chrono>
+#include <string>
+
+// ============================================================================
+//
+// NAMESPACE
+//
+// ============================================================================
+
+namespace LiteSrvTest {
+
+// a test or a benchmark
+typedef void TEST_FUNCTION();
+
+// registers a test (constructed by TEST_CASE and BENCHMARK)
+class TestRegistrar
+{
+public:
+	TestRegistrar(const char *name,TEST_FUNCTION *function,bool benchmark);
+};
+
+// record a failed CHECK
+void checkFailed(const char *file,int line,const char *condition);
+
+// a path for a scratch file (in $TEMP, $TMPDIR or the current directory)
+std::string getScratchPath(const char *name);
+
+// a scratch file, removed when the test returns (whether or not it passed)
+class ScratchFile
+{
+public:
+	ScratchFile(const char *name) : path(getScratchPath(name)) {}
+	~ScratchFile();
+
+	const char *getPath() const { return path.c_str(); }
+
+private:
+	std::string path;
+};
+
+// milliseconds since start
+inline double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+}
+
+} // namespace LiteSrvTest
+
+// ============================================================================
+//
+// MACROS
+//
+// ============================================================================
+
+#define	TEST_CASE(name)															\
+	static void name();															\
+	static LiteSrvTest::TestRegistrar name##Registrar(#name,name,false);		\
+	static void name()
+
+#define	BENCHMARK(name)															\
+	static void name();															\
+	static LiteSrvTest::TestRegistrar name##Registrar(#name,name,true);			\
+	static void name()
+
+// fail the test (and return from it) if condition does not hold
+#define	CHECK(condition)														\
+	do { if(!(condition)) { LiteSrvTest::checkFailed(__FILE__,__LINE__,#condition); return; } } while(0)
+
+#endif // !defined(__TEST_H__)
@@ -0,0 +1,245 @@
+// ============================================================================
+//
+// PROJECT HEADER FILES
+//
+// ============================================================================
+
+// system headers
+#define WIN32_LEAN_AND_MEAN		// Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+// class headers
+#include "Test.h"
+#include "TimerWheel.h"
+
+// ============================================================================
+//
+// NAMESPACE DECLARATIONS
+//
+// ============================================================================
+
+using namespace LiteSrv;
+using namespace LiteSrvTest;
+
+// ============================================================================
+//
+// CONSTANT DEFINITIONS
+//
+// ============================================================================
+
+// a time on a boundary of every level but the last (so that the first
+// level and the ones above it all start a turn there)
+const ULONGLONG LEVEL_BOUNDARY = (ULONGLONG)16384*10000;
+
+// one turn of the whole wheel (beyond it, timers wait in the overflow)
+const ULONGLONG WHEEL_TURN = (ULONGLONG)1<<(TIMER_WHEEL_FIRST_BITS+(TIMER_WHEEL_LEVELS-1)*TIMER_WHEEL_LEVEL_BITS);
+
+const int FUZZ_TIMERS     = 64;
+const int FUZZ_OPERATIONS = 20000;
+
+// ============================================================================
+//
+// LOCAL CLASSES AND FUNCTIONS
+//
+// ============================================================================
+
+// a wheel on a clock the test sets
+class TestWheel : public TimerWheel
+{
+public:
+	TestWheel(ULONGLONG start) : now(start) {}
+	ULONGLONG now;
+
+protected:
+	ULONGLONG getTickCount() const { return now; }
+};
+
+// move the clock on by the wait the wheel asks for, and run it
+static void step(TestWheel &wheel)
+{
+	DWORD waitTime = wheel.getWaitTime();
+	if(waitTime != INFINITE) { wheel.now += waitTime; }
+	wheel.run();
+}
+
+// run the wheel the way the supervision loop does until the timer expires
+// returns the time it expired, or 0 if it did not (after limit)
+static ULONGLONG runUntilExpired(TestWheel &wheel,Timer &timer,ULONGLONG limit)
+{
+	while(!timer.hasExpired())
+	{
+		if(wheel.getWaitTime() == INFINITE) { return 0; }
+		step(wheel);
+		if(wheel.now > limit) { return 0; }
+	}
+	return wheel.now;
+}
+
+// a pseudo-random number (the same ones on every run)
+static unsigned int G_random = 12345;
+static unsigned int nextRandom()
+{
+	G_random = G_random*1103515245+12345;
+	return (G_random>>8)&0xffffff;
+}
+
+// ============================================================================
+//
+// TESTS
+//
+// ============================================================================
+
+TEST_CASE(testTimerWheelBoundary)
+{
+	// a timer which cascades down at a level boundary that the wheel has
+	// reached, but not yet run, is due before a later first level timer
+	TestWheel wheel(LEVEL_BOUNDARY-1000);
+	Timer     a,c;
+	wheel.schedule(a,1100);
+	wheel.now = LEVEL_BOUNDARY-1;
+	wheel.run();
+	wheel.schedule(c,5001);
+	CHECK(wheel.getWaitTime() <= 101);
+
+	CHECK(runUntilExpired(wheel,a,LEVEL_BOUNDARY+5000) == LEVEL_BOUNDARY+100);
+	CHECK(!c.hasExpired()&&c.isPending());
+	CHECK(runUntilExpired(wheel,c,LEVEL_BOUNDARY+10000) == LEVEL_BOUNDARY+5000);
+	CHECK(wheel.getWaitTime() == INFINITE);
+}
+
+TEST_CASE(testTimerWheelCascade)
+{
+	// delays on every level, and on either side of their boundaries, each
+	// expire on the tick they are due
+	const DWORD delays[] = { 1, 255, 256, 257, 1000, 16383, 16384, 16385, 1000000,
+							 (DWORD)1<<20, ((DWORD)1<<26)+7, ((DWORD)1<<31)+3 };
+	const int   count    = sizeof(delays)/sizeof(delays[0]);
+	for(int i=0;i<count;i++)
+	{
+		TestWheel wheel(LEVEL_BOUNDARY-100);
+		Timer     timer;
+		ULONGLONG start = wheel.now;
+		wheel.schedule(timer,delays[i]);
+		CHECK(wheel.getWaitTime() <= delays[i]);
+		CHECK(runUntilExpired(wheel,timer,start+delays[i]+1) == start+delays[i]);
+		CHECK(!timer.isPending());
+	}
+
+	// all at once, from just short of a turn of the whole wheel (so that
+	// some go to the overflow)
+	TestWheel wheel(WHEEL_TURN-50);
+	Timer     timers[count];
+	ULONGLONG start = wheel.now;
+	for(int i=0;i<count;i++) { wheel.schedule(timers[i],delays[i]); }
+	for(int i=0;i<count;i++)
+	{
+		CHECK(runUntilExpired(wheel,timers[i],start+delays[i]+1) == start+delays[i]);
+		for(int j=i+1;j<count;j++) { CHECK(!timers[j].hasExpired()||(delays[j] == delays[i])); }
+	}
+}
+
+TEST_CASE(testTimerWheelCancel)
+{
+	TestWheel wheel(LEVEL_BOUNDARY);
+	Timer     a,b;
+
+	// a cancelled timer never expires, and leaves the wheel idle
+	wheel.schedule(a,500);
+	CHECK(a.isPending());
+	wheel.cancel(a);
+	CHECK(!a.isPending());
+	CHECK(wheel.getWaitTime() == INFINITE);
+	wheel.now += 1000;
+	CHECK(wheel.run() == 0);
+	CHECK(!a.hasExpired());
+
+	// scheduling a pending timer moves it
+	wheel.schedule(a,500);
+	wheel.schedule(b,700);
+	wheel.schedule(a,1000);
+	CHECK(wheel.getWaitTime() <= 700);
+	ULONGLONG start = wheel.now;
+	CHECK(runUntilExpired(wheel,b,start+2000) == start+700);
+	CHECK(!a.hasExpired());
+	CHECK(runUntilExpired(wheel,a,start+2000) == start+1000);
+
+	// a timer destroyed while pending is cancelled
+	{
+		Timer c;
+		wheel.schedule(c,100);
+	}
+	CHECK(wheel.getWaitTime() == INFINITE);
+}
+
+TEST_CASE(testTimerWheelSlack)
+{
+	// a timer with slack expires within it, on the tick with the most
+	// trailing zero bits
+	TestWheel wheel(LEVEL_BOUNDARY+3);
+	Timer     a,b,c;
+	ULONGLONG start = wheel.now;
+	wheel.schedule(a,1000,100);
+	ULONGLONG expiry = runUntilExpired(wheel,a,start+2000);
+	CHECK((expiry >= start+1000)&&(expiry <= start+1100));
+	CHECK((expiry&63) == 0);
+
+	// timers whose slack overlaps expire on the same tick
+	start = wheel.now;
+	wheel.schedule(b,1000,200);
+	wheel.schedule(c,1010,200);
+	CHECK(runUntilExpired(wheel,b,start+2000) != 0);
+	CHECK(c.hasExpired());
+}
+
+TEST_CASE(testTimerWheelFuzz)
+{
+	// schedule and cancel timers at random, moving the clock on by no more
+	// than the wheel asks for - the wheel must never ask to wait past the
+	// first timer due, and must expire exactly the timers which are due
+	TestWheel wheel(LEVEL_BOUNDARY-(nextRandom()%100000));
+	Timer     timers[FUZZ_TIMERS];
+	ULONGLONG expiries[FUZZ_TIMERS];
+	for(int i=0;i<FUZZ_TIMERS;i++) { expiries[i] = 0; }
+
+	static const DWORD RANGES[] = { 300, 20000, 2000000, 200000000 };
+	for(int operation=0;operation<FUZZ_OPERATIONS;operation++)
+	{
+		int          i      = nextRandom()%FUZZ_TIMERS;
+		unsigned int choice = nextRandom()%10;
+		if(choice < 4)
+		{
+			DWORD delay = 1+nextRandom()%RANGES[nextRandom()%4];
+			wheel.schedule(timers[i],delay);
+			expiries[i] = wheel.now+delay;
+		}
+		else if(choice < 5)
+		{
+			wheel.cancel(timers[i]);
+			expiries[i] = 0;
+		}
+		else
+		{
+			ULONGLONG first = 0;
+			for(int j=0;j<FUZZ_TIMERS;j++)
+			{
+				if((expiries[j] != 0)&&((first == 0)||(expiries[j] < first))) { first = expiries[j]; }
+			}
+			DWORD waitTime = wheel.getWaitTime();
+			CHECK((first == 0) ? (waitTime == INFINITE) : (wheel.now+waitTime <= first));
+			if(waitTime == INFINITE) { continue; }
+
+			// sometimes wake up early, as the loop does for other handles
+			DWORD jump = (choice == 5) ? nextRandom()%(waitTime+1) : waitTime;
+			wheel.now += jump;
+			wheel.run();
+			for(int j=0;j<FUZZ_TIMERS;j++)
+			{
+				if(expiries[j] == 0) { continue; }
+				bool due = (expiries[j] <= wheel.now);
+				CHECK(timers[j].hasExpired() == due);
+				CHECK(timers[j].isPending() == !due);
+				if(due) { expiries[j] = 0; }
+			}
+		}
+	}
+}
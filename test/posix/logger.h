@@ -0,0 +1,43 @@
+
+// prevent multiple inclusion
+
+#if !defined(__LOGGER_H__)
+#define __LOGGER_H__
+
+// ============================================================================
+//
+// Stand-in for the logger's header, for building the portable tests
+// without the logger library (see the Makefile). Messages are dropped,
+// unless LITESRV_TEST_LOG is #defined, when they go to stderr.
+//
+// ============================================================================
+
+#include <stdio.h>
+
+#if defined(LITESRV_TEST_LOG)
+#define	LOGGER_LOG_MESSAGE(m,...)	{ fprintf(stderr,m,##__VA_ARGS__); fputc('\n',stderr); }
+#else
+#define	LOGGER_LOG_MESSAGE(m,...)	{ }
+#endif
+
+#define	LOGGER_SET_DEBUG_LEVEL(d)
+
+#define	LOGGER_LOG_DEBUG(m)					LOGGER_LOG_MESSAGE(m)
+#define	LOGGER_LOG_DEBUG1(m,p1)				LOGGER_LOG_MESSAGE(m,p1)
+#define	LOGGER_LOG_DEBUG2(m,p1,p2)			LOGGER_LOG_MESSAGE(m,p1,p2)
+#define	LOGGER_LOG_DEBUG3(m,p1,p2,p3)		LOGGER_LOG_MESSAGE(m,p1,p2,p3)
+#define	LOGGER_LOG_DEBUG4(m,p1,p2,p3,p4)	LOGGER_LOG_MESSAGE(m,p1,p2,p3,p4)
+
+#define	LOGGER_LOG_INFO(m)					LOGGER_LOG_MESSAGE(m)
+#define	LOGGER_LOG_INFO1(m,p1)				LOGGER_LOG_MESSAGE(m,p1)
+#define	LOGGER_LOG_INFO2(m,p1,p2)			LOGGER_LOG_MESSAGE(m,p1,p2)
+#define	LOGGER_LOG_INFO3(m,p1,p2,p3)		LOGGER_LOG_MESSAGE(m,p1,p2,p3)
+#define	LOGGER_LOG_INFO4(m,p1,p2,p3,p4)		LOGGER_LOG_MESSAGE(m,p1,p2,p3,p4)
+
+#define	LOGGER_LOG_ERROR(m)					LOGGER_LOG_MESSAGE(m)
+#define	LOGGER_LOG_ERROR1(m,p1)				LOGGER_LOG_MESSAGE(m,p1)
+#define	LOGGER_LOG_ERROR2(m,p1,p2)			LOGGER_LOG_MESSAGE(m,p1,p2)
+#define	LOGGER_LOG_ERROR3(m,p1,p2,p3)		LOGGER_LOG_MESSAGE(m,p1,p2,p3)
+#define	LOGGER_LOG_ERROR4(m,p1,p2,p3,p4)	LOGGER_LOG_MESSAGE(m,p1,p2,p3,p4)
+
+#endif // !defined(__LOGGER_H__)
@@ -0,0 +1,30 @@
+
+// prevent multiple inclusion
+
+#if !defined(__WINDOWS_H__)
+#define __WINDOWS_H__
+
+// ============================================================================
+//
+// Stand-in for the few Windows types and calls which the portable classes
+// (the timer wheel) use, for building their tests on Linux (see the
+// Makefile).
+//
+// ============================================================================
+
+#include <time.h>
+
+typedef unsigned int		DWORD;
+typedef unsigned long long	ULONGLONG;
+
+#define	INFINITE	0xFFFFFFFF
+
+// milliseconds since some fixed point (the system start, on Windows)
+inline ULONGLONG GetTickCount64()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (ULONGLONG)now.tv_sec*1000+(ULONGLONG)now.tv_nsec/1000000;
+}
+
+#endif // !defined(__WINDOWS_H__)